@@ -29,14 +29,43 @@
 #include "TcpBase.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <netdb.h>
+#include <string.h>
 #include <string>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <stdexcept>
 #include <system_error>
 
 
+/**
+ * Constructs an empty receive buffer.
+ *
+ * @param[in] capacity  Size of the buffer in bytes.
+ * @throws std::invalid_argument  if `capacity` is zero.
+ */
+TcpRecvBuffer::TcpRecvBuffer(const size_t capacity)
+    : buf(NULL), capacity(capacity), head(0), tail(0), ncalls(0)
+{
+    if (capacity == 0)
+        throw std::invalid_argument("TcpRecvBuffer::TcpRecvBuffer() "
+                "zero capacity");
+    buf = new char[capacity];
+}
+
+
+/**
+ * Destroys the receive buffer.
+ */
+TcpRecvBuffer::~TcpRecvBuffer()
+{
+    delete[] buf;
+}
+
+
 /**
  * Constructor of Tcp.
  */
@@ -106,6 +135,66 @@ size_t TcpBase::recvall(void* const buf, const size_t nbytes)
 }
 
 
+/**
+ * Attempts to read a given number of bytes from a streaming socket through a
+ * receive buffer. Returns when that number is read, the end-of-file is
+ * encountered, or an error occurs. Whatever is buffered is copied out first.
+ * If more is needed and it is at least a quarter of the buffer, it is read
+ * directly into `buf`, so large payloads are placed without an extra copy;
+ * otherwise the buffer is refilled with a single `recv()` of up to its whole
+ * capacity, which usually brings in the following messages as well.
+ *
+ * @param[in] sock     The streaming socket.
+ * @param[in] rbuf     The receive buffer of the socket.
+ * @param[in] buf      Pointer to a buffer.
+ * @param[in] nbytes   Number of bytes to attempt to read.
+ * @return             Number of bytes read. If less than `nbytes` and
+ *                     `nbytes > 0`, then EOF was encountered.
+ * @throws std::system_error  if an error is encountered reading from the
+ *                            socket.
+ */
+size_t TcpBase::recvbuffered(const int sock, TcpRecvBuffer& rbuf,
+                             void* const buf, const size_t nbytes)
+{
+    size_t nleft = nbytes;
+    char*  ptr   = (char*) buf;
+
+    while (nleft > 0) {
+        if (rbuf.head < rbuf.tail) {
+            const size_t n = std::min(nleft, rbuf.tail - rbuf.head);
+            (void)memcpy(ptr, rbuf.buf + rbuf.head, n);
+            rbuf.head += n;
+            ptr       += n;
+            nleft     -= n;
+            continue;
+        }
+
+        /* the buffer is empty */
+        rbuf.head = rbuf.tail = 0;
+        const bool direct = nleft >= rbuf.capacity / 4;
+        ssize_t    nread  = recv(sock, direct ? ptr : rbuf.buf,
+                direct ? nleft : rbuf.capacity, 0);
+        rbuf.ncalls++;
+        if (nread < 0) {
+            throw std::system_error(errno, std::system_category(),
+                    "TcpBase::recvbuffered() Error receiving from socket " +
+                    std::to_string(sock));
+        }
+        if (nread == 0)
+            break; // EOF encountered
+        if (direct) {
+            ptr   += nread;
+            nleft -= nread;
+        }
+        else {
+            rbuf.tail = nread;
+        }
+    }
+
+    return nbytes - nleft; // >= 0
+}
+
+
 /**
  * Writes a given number of bytes to a given streaming socket. Returns when that
  * number is written or an error occurs.
@@ -174,3 +263,33 @@ void TcpBase::sendall(void* const buf, const size_t nbytes)
 {
     sendall(sockfd, buf, nbytes);
 }
+
+
+/**
+ * Writes the buffers of an I/O vector to a given streaming socket. Each
+ * `writev()` takes up to IOV_MAX buffers; after a partial write, the vector is
+ * advanced past what has been written and the rest is written again.
+ *
+ * @param[in]     sock    The streaming socket.
+ * @param[in,out] iov     The buffers. Modified to account for partial writes.
+ * @param[in]     iovcnt  Number of buffers.
+ * @throws std::system_error  if an error is encountered writing to the
+ *                            socket.
+ */
+void TcpBase::sendallv(const int sock, struct iovec* iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t nwritten = writev(sock, iov, std::min(iovcnt, IOV_MAX));
+        if (nwritten <= 0) {
+            throw std::system_error(errno, std::system_category(),
+                    "TcpBase::sendallv() Error sending to socket " +
+                    std::to_string(sock));
+        }
+        for (; iovcnt > 0 && (size_t)nwritten >= iov->iov_len; ++iov, --iovcnt)
+            nwritten -= iov->iov_len;
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + nwritten;
+            iov->iov_len -= nwritten;
+        }
+    }
+}
@@ -29,7 +29,46 @@
 #ifndef FMTP_TCPBASE_H_
 #define FMTP_TCPBASE_H_
 
+#include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+
+
+/**
+ * Receive buffer of one TCP stream. Reading FMTP messages through it takes
+ * one `recv()` for many small messages instead of one for each header and
+ * each payload. It must only be used by one thread at a time.
+ */
+class TcpRecvBuffer
+{
+public:
+    /**
+     * Constructs an empty buffer.
+     *
+     * @param[in] capacity  Size of the buffer in bytes.
+     * @throws std::invalid_argument  if `capacity` is zero.
+     */
+    explicit TcpRecvBuffer(const size_t capacity = 65536);
+    ~TcpRecvBuffer();
+    /** discards the buffered bytes, e.g. when the connection is replaced */
+    void reset() {head = tail = 0;}
+    /** returns the number of `recv()` calls made so far */
+    uint64_t getRecvCalls() const {return ncalls;}
+
+private:
+    friend class TcpBase;
+    /* Prevent copying because it's meaningless */
+    TcpRecvBuffer(const TcpRecvBuffer&);
+    TcpRecvBuffer& operator=(const TcpRecvBuffer&);
+
+    char*    buf;
+    size_t   capacity;
+    /* buffered bytes are buf[head] up to buf[tail] */
+    size_t   head;
+    size_t   tail;
+    uint64_t ncalls;
+};
+
 
 class TcpBase
 {
@@ -64,6 +103,24 @@ protected:
      */
    size_t recvall(void* const buf, const size_t len);
 
+    /**
+     * Attempts to read a given number of bytes from a given streaming socket
+     * through a receive buffer. Small reads are served from the buffer, which
+     * is refilled with as much as the socket has. Reads which the buffer can't
+     * serve and which are large go directly into the caller's buffer.
+     *
+     * @param[in] sock     The streaming socket.
+     * @param[in] rbuf     The receive buffer of the socket.
+     * @param[in] buf      Pointer to a buffer.
+     * @param[in] nbytes   Number of bytes to attempt to read.
+     * @return             Number of bytes read. If less than `nbytes` and
+     *                     `nbytes > 0`, then EOF was encountered.
+     * @throws std::system_error  if an error is encountered reading from the
+     *                            socket.
+     */
+   size_t recvbuffered(const int sock, TcpRecvBuffer& rbuf, void* const buf,
+                       const size_t nbytes);
+
     /**
      * Writes a given number of bytes to a given streaming socket. Returns when that
      * number is written or an error occurs.
@@ -89,6 +146,20 @@ protected:
      */
     void sendall(void* const buf, const size_t nbytes);
 
+    /**
+     * Writes the buffers of an I/O vector to a given streaming socket with as
+     * few system calls as possible. Returns when everything is written or an
+     * error occurs.
+     *
+     * @param[in]     sock    The streaming socket.
+     * @param[in,out] iov     The buffers. Modified to account for partial
+     *                        writes.
+     * @param[in]     iovcnt  Number of buffers.
+     * @throws std::system_error  if an error is encountered writing to the
+     *                            socket.
+     */
+    void sendallv(const int sock, struct iovec* iov, int iovcnt);
+
     /// The TCP socket
     int sockfd;
 };
@@ -71,13 +71,27 @@ const int MAX_FMTP_PACKET_LEN = MTU - 20 - 20; /* exclude IP and TCP header */
 const int FMTP_DATA_LEN       = MAX_FMTP_PACKET_LEN - FMTP_HEADER_LEN;
 /* sizeof(uint32_t) for BOPMsg.prodsize, sizeof(uint16_t) for BOPMsg.metasize */
 const int AVAIL_BOP_LEN       = FMTP_DATA_LEN - sizeof(uint32_t) - sizeof(uint16_t);
+/* length of the optional send rate after the metadata of a BOP */
+const int BOP_RATE_HINT_LEN   = sizeof(uint64_t);
+/**
+ * extra length of BOPMsg.prodsize with 64-bit offsets, which takes room from
+ * the metadata, see fmtpSendv3::SetWideOffsets()
+ */
+const int WIDE_PRODSIZE_EXTRA = sizeof(uint64_t) - sizeof(uint32_t);
+/**
+ * largest product with 64-bit offsets: the seqnum of a data block or a
+ * retransmission request is then the number of the block, which is 32-bit
+ */
+const uint64_t MAX_WIDE_PRODSIZE = (uint64_t)UINT32_MAX * FMTP_DATA_LEN;
 
 
 /**
- * structure of Begin-Of-Product message
+ * structure of Begin-Of-Product message. On multicast, the metadata may be
+ * followed by the send rate of the sender in bits per second as a 64-bit
+ * integer in network byte order, see fmtpSendv3::SetBopRateHint().
  */
 typedef struct FmtpBOPMessage {
-    uint32_t   prodsize;     /*!< support 4GB maximum */
+    uint64_t   prodsize;     /*!< 4GB maximum, see MAX_WIDE_PRODSIZE */
     uint16_t   metasize;
     char       metadata[AVAIL_BOP_LEN];
     /* Be aware this default constructor could implicitly create a new BOP */
@@ -96,6 +110,33 @@ const uint16_t FMTP_BOP_REQ   = 0x0080;
 const uint16_t FMTP_RETX_BOP  = 0x0100;
 const uint16_t FMTP_EOP_REQ   = 0x0200;
 const uint16_t FMTP_RETX_EOP  = 0x0400;
+/* requests the BOPs of `seqnum` products from `prodindex` on */
+const uint16_t FMTP_BOP_RANGE_REQ = 0x0800;
+/* most products a ranged BOP request covers */
+const uint32_t MAX_BOP_RANGE  = 1024;
+/**
+ * acknowledges the products of `seqnum` ranges, each a {first, count} pair of
+ * uint32_t in network byte order in the payload
+ */
+const uint16_t FMTP_RETX_END_BATCH = 0x1000;
+/* most ranges a batched acknowledgement carries */
+const uint32_t MAX_ACK_RANGES = 512;
+/**
+ * carries the complete BOP, data and EOP packets of small products, `seqnum`
+ * packets in all, one after the other in the payload
+ */
+const uint16_t FMTP_AGGREGATE = 0x2000;
+/**
+ * carries a whole product: the product size, metadata size and metadata of a
+ * BOP followed by all of the data
+ */
+const uint16_t FMTP_TINY      = 0x4000;
+/**
+ * marks a BOP, retransmitted BOP or tiny product whose product size takes 8
+ * bytes, see SetWideOffsets(), so that a receiver which expects 4 bytes
+ * rejects it instead of misreading the size
+ */
+const uint16_t FMTP_WIDE      = 0x8000;
 
 
 /** For communication between mcast thread and retx thread */
@@ -103,10 +144,17 @@ const int MISSING_BOP  = 1;
 const int MISSING_DATA = 2;
 const int MISSING_EOP  = 3;
 const int SHUTDOWN     = 4;
+/* a data gap which might be mere reordering, see SetReorderWindow() */
+const int DELAYED_DATA = 5;
+/* BOPs of `seqnum` products from `prodindex` on, see BopBacklog */
+const int MISSING_BOP_RANGE = 6;
+/* wakes the retx thread to flush the acknowledgements, see AckBatch */
+const int ACKS_PENDING = 7;
 typedef struct recvInternalRetxReqMessage {
     int reqtype;
     uint32_t prodindex;
-    uint32_t seqnum;
+    /* offset of a block in bytes, or a number of products */
+    uint64_t seqnum;
     uint16_t payloadlen;
 } INLReqMsg;
 
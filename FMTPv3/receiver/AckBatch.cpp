@@ -0,0 +1,178 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      AckBatch.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the AckBatch class.
+ */
+
+
+#include "AckBatch.h"
+
+#include <stdexcept>
+
+
+/**
+ * Constructs an empty batch.
+ *
+ * @param[in] maxProducts  Number of products which fill a batch.
+ * @param[in] delay        Longest time a product waits in the batch, in
+ *                         seconds.
+ * @param[in] maxRanges    Number of ranges which fill a batch, e.g. so that
+ *                         they fit into one message.
+ * @throws std::invalid_argument  if `maxProducts` or `maxRanges` is 0 or
+ *                                `delay` isn't positive.
+ */
+AckBatch::AckBatch(const uint32_t maxProducts, const double delay,
+                   const uint32_t maxRanges)
+:
+    maxProducts(maxProducts),
+    delay(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(delay))),
+    maxRanges(maxRanges),
+    mutex(),
+    ranges(),
+    products(0),
+    deadline()
+{
+    if (maxProducts == 0)
+        throw std::invalid_argument("AckBatch::AckBatch(): empty batch");
+    if (!(delay > 0))
+        throw std::invalid_argument("AckBatch::AckBatch(): "
+                "non-positive delay");
+    if (maxRanges == 0)
+        throw std::invalid_argument("AckBatch::AckBatch(): no ranges");
+    ranges.reserve(maxRanges);
+}
+
+
+/**
+ * Adds a completed product. It extends the range which it follows or
+ * precedes, if any, and that range is joined with the one it then meets. The
+ * latest range is tried first because products mostly complete in order.
+ *
+ * @param[in]  prodindex  Index of the product.
+ * @param[in]  now        Current time.
+ * @param[out] started    Whether the product started the batch, i.e. set its
+ *                        deadline.
+ * @return                True if the batch is full and should be taken.
+ */
+bool AckBatch::add(const uint32_t prodindex, const Clock::time_point& now,
+                   bool& started)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    started = ranges.empty();
+    if (started)
+        deadline = now + delay;
+
+    size_t i = ranges.size();
+    while (i-- > 0) {
+        Range& range = ranges[i];
+        if (range.first + range.count == prodindex) {
+            range.count++;
+            break;
+        }
+        if (prodindex + 1 == range.first) {
+            range.first--;
+            range.count++;
+            break;
+        }
+    }
+    if (i < ranges.size()) {
+        /* the extended range might now meet another one */
+        const Range range = ranges[i];
+        for (size_t j = 0; j < ranges.size(); j++) {
+            Range& other = ranges[j];
+            if (j == i)
+                continue;
+            if (range.first + range.count == other.first) {
+                ranges[i].count += other.count;
+                ranges.erase(ranges.begin() + j);
+                break;
+            }
+            if (other.first + other.count == range.first) {
+                other.count += range.count;
+                ranges.erase(ranges.begin() + i);
+                break;
+            }
+        }
+    }
+    else {
+        const Range range = {prodindex, 1};
+        ranges.push_back(range);
+    }
+
+    return ++products >= maxProducts || ranges.size() >= maxRanges;
+}
+
+
+/**
+ * Removes the batch, e.g. to send it, and clears its deadline.
+ *
+ * @param[out] out  The ranges of the batch. Cleared first.
+ * @return          Number of products in the batch.
+ */
+uint64_t AckBatch::take(std::vector<Range>& out)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    out.assign(ranges.begin(), ranges.end());
+    ranges.clear();
+    const uint64_t taken = products;
+    products = 0;
+    return taken;
+}
+
+
+/**
+ * Tells whether the batch holds products.
+ *
+ * @return  True if nextDeadline() is valid.
+ */
+bool AckBatch::hasDeadline() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return !ranges.empty();
+}
+
+
+/**
+ * Returns when the batch should be taken, i.e. when its first product has
+ * waited for the delay.
+ *
+ * @pre     hasDeadline() is true.
+ * @return  The deadline of the batch.
+ */
+AckBatch::Clock::time_point AckBatch::nextDeadline() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return deadline;
+}
+
+
+/**
+ * Returns the number of products in the batch.
+ *
+ * @return  The number of products.
+ */
+uint64_t AckBatch::size() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return products;
+}
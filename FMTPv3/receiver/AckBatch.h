@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      AckBatch.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the AckBatch class.
+ *
+ * Collects the products which a receiver has completed, so that they're
+ * acknowledged to the sender with one FMTP_RETX_END_BATCH message instead of
+ * one FMTP_RETX_END each. Consecutive products are merged into ranges: the
+ * products completed in order form one growing range and the ones completed
+ * out of order a few sparse ones. A batch is flushed once it holds enough
+ * products or ranges, or has waited long enough. Thread-safe.
+ */
+
+
+#ifndef FMTP_RECEIVER_ACKBATCH_H_
+#define FMTP_RECEIVER_ACKBATCH_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+
+class AckBatch
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Range {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    /**
+     * Constructs an empty batch.
+     *
+     * @param[in] maxProducts  Number of products which fill a batch.
+     * @param[in] delay        Longest time a product waits in the batch, in
+     *                         seconds.
+     * @param[in] maxRanges    Number of ranges which fill a batch.
+     * @throws std::invalid_argument  if `maxProducts` or `maxRanges` is 0 or
+     *                                `delay` isn't positive.
+     */
+    AckBatch(const uint32_t maxProducts, const double delay,
+             const uint32_t maxRanges);
+    /**
+     * Adds a completed product.
+     *
+     * @param[in]  prodindex  Index of the product.
+     * @param[in]  now        Current time.
+     * @param[out] started    Whether the product started the batch, i.e. set
+     *                        its deadline.
+     * @return                True if the batch is full and should be taken.
+     */
+    bool add(const uint32_t prodindex, const Clock::time_point& now,
+             bool& started);
+    /**
+     * Removes the batch.
+     *
+     * @param[out] out  The ranges of the batch. Cleared first.
+     * @return          Number of products in the batch.
+     */
+    uint64_t take(std::vector<Range>& out);
+    /**
+     * Tells whether the batch holds products.
+     *
+     * @return  True if nextDeadline() is valid.
+     */
+    bool hasDeadline() const;
+    /**
+     * Returns when the batch should be taken.
+     *
+     * @pre     hasDeadline() is true.
+     * @return  The deadline of the batch.
+     */
+    Clock::time_point nextDeadline() const;
+    /**
+     * Returns the number of products in the batch.
+     *
+     * @return  The number of products.
+     */
+    uint64_t size() const;
+
+private:
+    /* Prevent copying because it's meaningless */
+    AckBatch(const AckBatch&);
+    AckBatch& operator=(const AckBatch&);
+
+    const uint32_t        maxProducts;
+    const Clock::duration delay;
+    const uint32_t        maxRanges;
+    mutable std::mutex    mutex;
+    std::vector<Range>    ranges;
+    uint64_t              products;
+    Clock::time_point     deadline;
+};
+
+
+#endif /* FMTP_RECEIVER_ACKBATCH_H_ */
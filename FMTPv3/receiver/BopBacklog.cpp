@@ -0,0 +1,202 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      BopBacklog.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the BopBacklog class.
+ */
+
+
+#include "BopBacklog.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+/**
+ * Constructs an empty backlog.
+ *
+ * @param[in] window   Maximum number of products in a range.
+ * @param[in] timeout  Time after which a range counts as answered, in
+ *                     seconds, e.g. because the answers were lost with the
+ *                     connection.
+ * @param[in] limit    Maximum number of waiting products, see dropExcess().
+ * @throws std::invalid_argument  if `window` or `limit` is 0 or `timeout`
+ *                                isn't positive.
+ */
+BopBacklog::BopBacklog(const uint32_t window, const double timeout,
+                       const uint64_t limit)
+:
+    window(window),
+    timeout(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(timeout))),
+    limit(limit),
+    mutex(),
+    ranges(),
+    waiting(0),
+    pending(false),
+    pendingLast(0),
+    deadline()
+{
+    if (window == 0)
+        throw std::invalid_argument("BopBacklog::BopBacklog(): empty window");
+    if (!(timeout > 0))
+        throw std::invalid_argument("BopBacklog::BopBacklog(): "
+                "non-positive timeout");
+    if (limit == 0)
+        throw std::invalid_argument("BopBacklog::BopBacklog(): zero limit");
+}
+
+
+/**
+ * Adds missed products. Products which follow on the latest ones are merged
+ * with them, so a long outage which is reported piecemeal is requested in
+ * full windows.
+ *
+ * @param[in] first  Index of the first product.
+ * @param[in] count  Number of products.
+ */
+void BopBacklog::add(const uint32_t first, const uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!ranges.empty() && ranges.back().first + ranges.back().count == first &&
+            ranges.back().count <= UINT32_MAX - count) {
+        ranges.back().count += count;
+    }
+    else {
+        const Range range = {first, count};
+        ranges.push_back(range);
+    }
+    waiting += count;
+}
+
+
+/**
+ * Removes the oldest waiting products beyond the limit. They won't be
+ * requested, so the caller has to give them up. Call it until it returns 0.
+ *
+ * @param[out] first  Index of the first product removed.
+ * @return            Number of products removed, 0 for none.
+ */
+uint32_t BopBacklog::dropExcess(uint32_t& first)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (waiting <= limit)
+        return 0;
+
+    Range&         range = ranges.front();
+    const uint32_t count = (uint32_t)std::min<uint64_t>(range.count,
+            waiting - limit);
+    first        = range.first;
+    range.first += count;
+    range.count -= count;
+    if (range.count == 0)
+        ranges.pop_front();
+    waiting -= count;
+    return count;
+}
+
+
+/**
+ * Removes the next range to request if the previous one is complete, i.e.
+ * answered or overdue. The range starts the deadline of its answer.
+ *
+ * @param[in]  now    Current time.
+ * @param[out] first  Index of the first product of the range.
+ * @return            Number of products in the range, 0 for none.
+ */
+uint32_t BopBacklog::next(const Clock::time_point& now, uint32_t& first)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ranges.empty() || (pending && now < deadline))
+        return 0;
+
+    Range&         range = ranges.front();
+    const uint32_t count = std::min(range.count, window);
+    first        = range.first;
+    range.first += count;
+    range.count -= count;
+    if (range.count == 0)
+        ranges.pop_front();
+    waiting -= count;
+
+    pending     = true;
+    pendingLast = first + count - 1;
+    deadline    = now + timeout;
+    return count;
+}
+
+
+/**
+ * Notes the answer of the sender for a product, i.e. a retransmitted BOP or a
+ * rejection.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @return               True if it completes the requested range and more
+ *                       products are waiting, i.e. next() has a range.
+ */
+bool BopBacklog::answered(const uint32_t prodindex)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!pending || prodindex != pendingLast)
+        return false;
+    pending = false;
+    return !ranges.empty();
+}
+
+
+/**
+ * Tells whether products are waiting for an incomplete range.
+ *
+ * @return  True if nextDeadline() is valid.
+ */
+bool BopBacklog::hasDeadline() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return pending && !ranges.empty();
+}
+
+
+/**
+ * Returns when the requested range counts as answered.
+ *
+ * @pre     hasDeadline() is true.
+ * @return  The deadline of the requested range.
+ */
+BopBacklog::Clock::time_point BopBacklog::nextDeadline() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return deadline;
+}
+
+
+/**
+ * Returns the number of products waiting to be requested.
+ *
+ * @return  The number of products.
+ */
+uint64_t BopBacklog::size() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return waiting;
+}
@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      BopBacklog.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the BopBacklog class.
+ *
+ * Holds the products whose BOPs were missed, e.g. during an outage of the
+ * receiver, until they are requested. They are requested in ranges of at most
+ * a window of products with one request each, and the next range only once
+ * the sender has answered the previous one, so that a gap of many products
+ * floods neither the sender nor the receiver. The sender answers a range in
+ * order, so the answer for its last product completes it; a range whose
+ * answer is overdue counts as complete as well. The number of waiting
+ * products is limited, and the oldest ones beyond the limit are dropped.
+ * Thread-safe.
+ */
+
+
+#ifndef FMTP_RECEIVER_BOPBACKLOG_H_
+#define FMTP_RECEIVER_BOPBACKLOG_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+
+class BopBacklog
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Constructs an empty backlog.
+     *
+     * @param[in] window   Maximum number of products in a range.
+     * @param[in] timeout  Time after which a range counts as answered, in
+     *                     seconds.
+     * @param[in] limit    Maximum number of waiting products, see
+     *                     dropExcess().
+     * @throws std::invalid_argument  if `window` or `limit` is 0 or
+     *                                `timeout` isn't positive.
+     */
+    BopBacklog(const uint32_t window, const double timeout,
+               const uint64_t limit = UINT32_MAX);
+    /**
+     * Adds missed products. Products which follow on the latest ones are
+     * merged with them.
+     *
+     * @param[in] first  Index of the first product.
+     * @param[in] count  Number of products.
+     */
+    void add(const uint32_t first, const uint32_t count);
+    /**
+     * Removes the oldest waiting products beyond the limit, which won't be
+     * requested.
+     *
+     * @param[out] first  Index of the first product removed.
+     * @return            Number of products removed, 0 for none.
+     */
+    uint32_t dropExcess(uint32_t& first);
+    /**
+     * Removes the next range to request if the previous one is complete.
+     *
+     * @param[in]  now    Current time.
+     * @param[out] first  Index of the first product of the range.
+     * @return            Number of products in the range, 0 for none.
+     */
+    uint32_t next(const Clock::time_point& now, uint32_t& first);
+    /**
+     * Notes the answer of the sender for a product.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @return               True if it completes the requested range and more
+     *                       products are waiting.
+     */
+    bool answered(const uint32_t prodindex);
+    /**
+     * Tells whether products are waiting for an incomplete range.
+     *
+     * @return  True if nextDeadline() is valid.
+     */
+    bool hasDeadline() const;
+    /**
+     * Returns when the requested range counts as answered.
+     *
+     * @pre     hasDeadline() is true.
+     * @return  The deadline of the requested range.
+     */
+    Clock::time_point nextDeadline() const;
+    /**
+     * Returns the number of products waiting to be requested.
+     *
+     * @return  The number of products.
+     */
+    uint64_t size() const;
+
+private:
+    /* Prevent copying because it's meaningless */
+    BopBacklog(const BopBacklog&);
+    BopBacklog& operator=(const BopBacklog&);
+
+    struct Range {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    const uint32_t        window;
+    const Clock::duration timeout;
+    const uint64_t        limit;
+    mutable std::mutex    mutex;
+    std::deque<Range>     ranges;
+    uint64_t              waiting;
+    /* whether a range is requested and not yet answered */
+    bool                  pending;
+    /* index of the last product of the requested range */
+    uint32_t              pendingLast;
+    Clock::time_point     deadline;
+};
+
+
+#endif /* FMTP_RECEIVER_BOPBACKLOG_H_ */
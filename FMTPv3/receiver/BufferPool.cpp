@@ -0,0 +1,275 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      BufferPool.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the BufferPool class.
+ *
+ * The arena is taken from the reserved huge pages if there are any, and
+ * otherwise from ordinary pages with a request for transparent huge pages.
+ * The NUMA policy is set before the first touch, which is what places a page,
+ * so the whole arena ends up on the requested node. The system calls are made
+ * directly, so libnuma isn't needed.
+ */
+
+
+#include "BufferPool.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#if defined(__NR_mbind) && defined(__NR_getcpu)
+    #include <linux/mempolicy.h>
+    #define BUFFERPOOL_NUMA 1
+#endif
+
+
+/* sizes of a huge page and of the pages touched to fault the arena in */
+#define HUGE_PAGE_SIZE  ((size_t)2 << 20)
+#define SMALL_PAGE_SIZE ((size_t)4096)
+
+
+/**
+ * Constructs a pool and allocates its buffers as one arena.
+ *
+ * @param[in] bufsize  Size of a buffer in bytes.
+ * @param[in] count    Number of buffers.
+ * @param[in] node     NUMA node of the memory, -1 for the node of the calling
+ *                     thread.
+ * @throws std::invalid_argument  if `bufsize` or `count` is 0.
+ * @throws std::system_error      if the memory can't be allocated.
+ */
+BufferPool::BufferPool(const size_t bufsize, const size_t count,
+                       const int node)
+:
+    bufsize(bufsize),
+    count(count),
+    maplen((bufsize * count + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1)),
+    huge(false),
+    mem(NULL),
+    freebufs(queueCapacity(count)),
+    misses(0)
+{
+    if (bufsize == 0 || count == 0)
+        throw std::invalid_argument("BufferPool::BufferPool(): empty pool");
+
+    mem = mapArena(maplen, huge);
+    /* the policy must be set before the first touch, which places a page */
+    bindArena(node, 0);
+    /* fault the arena in now rather than while data is being received */
+    for (size_t off = 0; off < maplen; off += SMALL_PAGE_SIZE)
+        mem[off] = 0;
+    if (!huge)
+        huge = hasTransparentHugePages();
+    for (size_t i = 0; i < count; ++i)
+        (void)freebufs.tryPush(mem + i * bufsize);
+}
+
+
+/**
+ * Destroys the pool and its buffers, whether they are returned or not.
+ */
+BufferPool::~BufferPool()
+{
+    (void)munmap(mem, maplen);
+}
+
+
+/**
+ * Takes a buffer from the pool. Never blocks. A request that can't be served
+ * is counted as a miss.
+ *
+ * @param[in] size  Number of bytes needed.
+ * @return          The buffer, or NULL if `size` exceeds the size of the
+ *                  buffers or no buffer is free.
+ */
+void* BufferPool::tryGet(const size_t size)
+{
+    char* buf;
+    if (size > bufsize || !freebufs.tryPop(buf)) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    return buf;
+}
+
+
+/**
+ * Returns a buffer to the pool. Never waits for long.
+ *
+ * @param[in] buf  The buffer.
+ * @throws std::invalid_argument  if `buf` isn't a buffer of the pool.
+ */
+void BufferPool::put(void* const buf)
+{
+    if (!owns(buf))
+        throw std::invalid_argument("BufferPool::put(): not a buffer of the "
+                "pool");
+    /**
+     * There is room for every buffer, but a slot which a concurrent
+     * tryGet() has reserved isn't free until that call is done.
+     */
+    while (!freebufs.tryPush((char*)buf))
+        std::this_thread::yield();
+}
+
+
+/**
+ * Tells whether a pointer is a buffer of the pool.
+ *
+ * @param[in] buf  The pointer.
+ * @return         True if `buf` is a buffer of the pool.
+ */
+bool BufferPool::owns(const void* const buf) const
+{
+    const char* const ptr = (const char*)buf;
+    return ptr >= mem && ptr < mem + bufsize * count &&
+            (size_t)(ptr - mem) % bufsize == 0;
+}
+
+
+/**
+ * Maps an arena aligned to a huge page. Reserved huge pages are tried first;
+ * otherwise transparent huge pages are requested for ordinary memory.
+ *
+ * @param[in]  len   Length in bytes, a multiple of the huge-page size.
+ * @param[out] huge  Whether reserved huge pages were granted.
+ * @return           The arena.
+ * @throws std::system_error  if the memory can't be mapped.
+ */
+char* BufferPool::mapArena(const size_t len, bool& huge)
+{
+    char* mem = (char*)mmap(NULL, len, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    huge = mem != MAP_FAILED;
+    if (huge)
+        return mem;
+
+    /* over-map to align the arena, as THP only backs aligned ranges */
+    char* const raw = (char*)mmap(NULL, len + HUGE_PAGE_SIZE,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        throw std::system_error(errno, std::system_category(),
+                "BufferPool::mapArena() Couldn't map " + std::to_string(len) +
+                " bytes");
+    mem = (char*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) &
+            ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    if (mem > raw)
+        (void)munmap(raw, mem - raw);
+    if (raw + HUGE_PAGE_SIZE > mem)
+        (void)munmap(mem + len, raw + HUGE_PAGE_SIZE - mem);
+    (void)madvise(mem, len, MADV_HUGEPAGE);
+    return mem;
+}
+
+
+/**
+ * Sets the NUMA policy of the arena. A failure, e.g. on a kernel without NUMA
+ * support, leaves the default policy.
+ *
+ * @param[in] node   NUMA node, -1 for the node of the calling thread.
+ * @param[in] flags  Flags of `mbind()`.
+ */
+void BufferPool::bindArena(const int node, const unsigned flags)
+{
+#ifdef BUFFERPOOL_NUMA
+    unsigned target = node;
+    if (node < 0) {
+        unsigned cpu;
+        if (syscall(__NR_getcpu, &cpu, &target, NULL))
+            return;
+    }
+    if (target < 8 * sizeof(unsigned long)) {
+        const unsigned long mask = 1UL << target;
+        (void)syscall(__NR_mbind, mem, maplen, MPOL_PREFERRED, &mask,
+                8 * sizeof(mask) + 1, flags);
+    }
+#else
+    (void)node;
+    (void)flags;
+#endif
+}
+
+
+/**
+ * Tells whether transparent huge pages back the arena, as shown by the
+ * statistics of its mapping.
+ *
+ * @return  True if at least one does.
+ */
+bool BufferPool::hasTransparentHugePages() const
+{
+    FILE* const smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == NULL)
+        return false;
+
+    char          line[256];
+    bool          inArena = false;
+    bool          found   = false;
+    unsigned long lo;
+    unsigned long hi;
+    unsigned long kb;
+    while (!found && fgets(line, sizeof(line), smaps)) {
+        if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2)
+            inArena = (uintptr_t)mem >= lo && (uintptr_t)mem < hi;
+        else if (inArena && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+            found = kb > 0;
+    }
+    fclose(smaps);
+    return found;
+}
+
+
+/**
+ * Moves the buffers to a NUMA node, e.g. the node of the thread which will
+ * fill them. Best effort: without NUMA support nothing happens.
+ *
+ * @param[in] node  NUMA node, -1 for the node of the calling thread.
+ */
+void BufferPool::bind(const int node)
+{
+#ifdef BUFFERPOOL_NUMA
+    bindArena(node, MPOL_MF_MOVE);
+#else
+    (void)node;
+#endif
+}
+
+
+/**
+ * Returns the capacity of the queue of free buffers.
+ *
+ * @param[in] count  Number of buffers.
+ * @return           The smallest power of 2 not less than `count`, at least 2.
+ */
+size_t BufferPool::queueCapacity(const size_t count)
+{
+    size_t capacity = 2;
+    while (capacity < count)
+        capacity <<= 1;
+    return capacity;
+}
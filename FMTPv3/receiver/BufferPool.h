@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      BufferPool.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the BufferPool class.
+ *
+ * A pool of equally sized product buffers reserved in advance. A buffer is
+ * taken and returned without a lock, so the multicast thread can hand a
+ * buffer to the receiving application in `notify_of_bop()` without waiting
+ * for the memory allocator. The buffers live in one arena of 2 MiB huge pages
+ * on a given NUMA node, faulted in when the pool is constructed, so that
+ * placing data into them causes neither page faults nor many TLB misses.
+ */
+
+
+#ifndef FMTP_RECEIVER_BUFFERPOOL_H_
+#define FMTP_RECEIVER_BUFFERPOOL_H_
+
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+#include "MpmcQueue.h"
+
+
+class BufferPool
+{
+public:
+    /**
+     * Constructs a pool and allocates its buffers.
+     *
+     * @param[in] bufsize  Size of a buffer in bytes.
+     * @param[in] count    Number of buffers.
+     * @param[in] node     NUMA node of the memory, -1 for the node of the
+     *                     calling thread.
+     * @throws std::invalid_argument  if `bufsize` or `count` is 0.
+     * @throws std::system_error      if the memory can't be allocated.
+     */
+    BufferPool(const size_t bufsize, const size_t count, const int node = -1);
+    ~BufferPool();
+    /**
+     * Takes a buffer from the pool. Never blocks.
+     *
+     * @param[in] size  Number of bytes needed.
+     * @return          The buffer, or NULL if `size` exceeds the size of the
+     *                  buffers or no buffer is free.
+     */
+    void* tryGet(const size_t size);
+    /**
+     * Returns a buffer to the pool.
+     *
+     * @param[in] buf  The buffer.
+     * @throws std::invalid_argument  if `buf` isn't a buffer of the pool.
+     */
+    void put(void* const buf);
+    /**
+     * Tells whether a pointer is a buffer of the pool.
+     *
+     * @param[in] buf  The pointer.
+     * @return         True if `buf` is a buffer of the pool.
+     */
+    bool owns(const void* const buf) const;
+    /**
+     * Moves the buffers to a NUMA node. Best effort: without NUMA support
+     * nothing happens.
+     *
+     * @param[in] node  NUMA node, -1 for the node of the calling thread.
+     */
+    void bind(const int node);
+    size_t available() const {return freebufs.size();}
+    /**
+     * Tells whether the arena is backed by huge pages, either reserved ones
+     * or, at least in part, transparent ones.
+     *
+     * @return  True if huge pages were granted.
+     */
+    bool usesHugePages() const {return huge;}
+    size_t getBufSize() const {return bufsize;}
+    uint64_t getMisses() const {return misses.load(std::memory_order_relaxed);}
+
+private:
+    /* Prevent copying because it's meaningless */
+    BufferPool(const BufferPool&);
+    BufferPool& operator=(const BufferPool&);
+
+    /**
+     * Maps an arena aligned to a huge page.
+     *
+     * @param[in]  len   Length in bytes, a multiple of the huge-page size.
+     * @param[out] huge  Whether reserved huge pages were granted.
+     * @return           The arena.
+     * @throws std::system_error  if the memory can't be mapped.
+     */
+    static char* mapArena(const size_t len, bool& huge);
+    /**
+     * Sets the NUMA policy of the arena.
+     *
+     * @param[in] node   NUMA node, -1 for the node of the calling thread.
+     * @param[in] flags  Flags of `mbind()`.
+     */
+    void bindArena(const int node, const unsigned flags);
+    /**
+     * Tells whether transparent huge pages back the arena.
+     *
+     * @return  True if at least one does.
+     */
+    bool hasTransparentHugePages() const;
+    /**
+     * Returns the capacity of the queue of free buffers.
+     *
+     * @param[in] count  Number of buffers.
+     * @return           The smallest power of 2 not less than `count`.
+     */
+    static size_t queueCapacity(const size_t count);
+
+    const size_t          bufsize;
+    const size_t          count;
+    /* length of the arena, a multiple of the huge-page size */
+    const size_t          maplen;
+    bool                  huge;
+    char*                 mem;
+    MpmcQueue<char*>      freebufs;
+    /* number of requests that couldn't be served */
+    std::atomic<uint64_t> misses;
+};
+
+
+#endif /* FMTP_RECEIVER_BUFFERPOOL_H_ */
@@ -0,0 +1,670 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      FileSink.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the FileSink class.
+ *
+ * The writer thread takes the whole queue at once, sorts the blocks of a
+ * batch by file and offset, and writes every run of contiguous blocks with a
+ * single vectored write. With io_uring the runs of a batch are in flight at
+ * the same time and cost one system call; the ring is set up with raw system
+ * calls, so no library is needed. Finish and discard requests are handled
+ * after the blocks queued before them have been written; a finished file then
+ * goes to the sync thread, which calls the callbacks in order.
+ */
+
+
+#include "FileSink.h"
+#include "fmtpBase.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup)
+    #include <linux/io_uring.h>
+    #define FILESINK_IO_URING 1
+#endif
+
+
+/* number of submission-queue entries of the ring */
+#define RING_ENTRIES 256
+
+/**
+ * Constructs a sink and starts its writer and sync threads. Falls back to
+ * pwritev() if io_uring isn't wanted or can't be set up.
+ *
+ * @param[in] dir         Directory of the product files.
+ * @param[in] done        Called for every finished product.
+ * @param[in] nbufs       Number of block buffers.
+ * @param[in] useIoUring  Whether to use io_uring if the kernel supports it.
+ * @throws std::invalid_argument  if `nbufs` is 0.
+ * @throws std::system_error      if a thread can't be started.
+ */
+FileSink::FileSink(const std::string& dir, const Callback& done,
+                   const size_t nbufs, const bool useIoUring)
+:
+    dir(dir),
+    done(done),
+    bufs(NULL),
+    freebufs(),
+    bufmtx(),
+    bufcond(),
+    files(),
+    queue(),
+    mutex(),
+    cond(),
+    stop(false),
+    thread(),
+    syncq(),
+    syncmtx(),
+    synccond(),
+    syncstop(false),
+    syncthread(),
+    iovs(),
+    runs(),
+    ringfd(-1),
+    sqring(NULL),
+    sqringlen(0),
+    cqring(NULL),
+    cqringlen(0),
+    sqes(NULL),
+    sqeslen(0),
+    sqentries(0),
+    sqtail(NULL),
+    sqmask(NULL),
+    sqarray(NULL),
+    cqhead(NULL),
+    cqtail(NULL),
+    cqmask(NULL),
+    cqes(NULL)
+{
+    if (nbufs == 0)
+        throw std::invalid_argument("FileSink::FileSink(): no buffers");
+
+    bufs = new char[nbufs * FMTP_DATA_LEN];
+    freebufs.reserve(nbufs);
+    for (size_t i = 0; i < nbufs; ++i)
+        freebufs.push_back(bufs + i * FMTP_DATA_LEN);
+
+    if (useIoUring)
+        initRing(RING_ENTRIES);
+
+    int status = pthread_create(&syncthread, NULL, &FileSink::startSyncer,
+            this);
+    if (status == 0) {
+        status = pthread_create(&thread, NULL, &FileSink::start, this);
+        if (status) {
+            {
+                std::unique_lock<std::mutex> lock(syncmtx);
+                syncstop = true;
+            }
+            synccond.notify_one();
+            (void)pthread_join(syncthread, NULL);
+        }
+    }
+    if (status) {
+        if (ringfd >= 0) {
+            (void)munmap(sqes, sqeslen);
+            if (cqringlen)
+                (void)munmap(cqring, cqringlen);
+            (void)munmap(sqring, sqringlen);
+            (void)close(ringfd);
+        }
+        delete[] bufs;
+        throw std::system_error(status, std::system_category(),
+                "FileSink::FileSink(): Couldn't start thread");
+    }
+}
+
+
+/**
+ * Stops the writer thread after the queue is empty, and then the sync thread
+ * after the finished files are synced. Files of products which haven't been
+ * finished are removed.
+ */
+FileSink::~FileSink()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_one();
+    (void)pthread_join(thread, NULL);
+    {
+        std::unique_lock<std::mutex> lock(syncmtx);
+        syncstop = true;
+    }
+    synccond.notify_one();
+    (void)pthread_join(syncthread, NULL);
+
+    for (auto it = files.begin(); it != files.end(); ++it)
+        closeFile(it->second, true);
+
+    if (ringfd >= 0) {
+        (void)munmap(sqes, sqeslen);
+        if (cqringlen)
+            (void)munmap(cqring, cqringlen);
+        (void)munmap(sqring, sqringlen);
+        (void)close(ringfd);
+    }
+    delete[] bufs;
+}
+
+
+/**
+ * Returns the pathname of the file of a product, which is named after the
+ * index of the product.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @return               Pathname of the file.
+ */
+std::string FileSink::pathOf(const uint32_t prodindex) const
+{
+    return dir + "/" + std::to_string(prodindex);
+}
+
+
+/**
+ * Creates the file of a product and reserves its disk space, so that the
+ * blocks, which may arrive in any order, don't fragment the file and a full
+ * disk is detected before any block is received. File systems which can't
+ * preallocate still get the file.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @param[in] prodsize   Size of the product in bytes.
+ * @throws std::system_error  if the file can't be created or the disk space
+ *                            can't be reserved.
+ */
+void FileSink::open(const uint32_t prodindex, const uint64_t prodsize)
+{
+    const std::string path = pathOf(prodindex);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC |
+            O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(),
+                "FileSink::open() Couldn't create " + path);
+
+    if (prodsize && fallocate(fd, 0, 0, prodsize) && errno != EOPNOTSUPP &&
+            errno != ENOSYS) {
+        const int err = errno;
+        (void)close(fd);
+        (void)unlink(path.c_str());
+        throw std::system_error(err, std::system_category(),
+                "FileSink::open() Couldn't allocate " +
+                std::to_string(prodsize) + " bytes for " + path);
+    }
+
+    File* const file = new File();
+    file->prodindex  = prodindex;
+    file->fd         = fd;
+    file->error      = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    File*& slot = files[prodindex];
+    if (slot) {
+        /* a stale product with the same index */
+        Item item = {DISCARD, slot, 0, 0, NULL};
+        queue.push_back(item);
+        cond.notify_one();
+    }
+    slot = file;
+}
+
+
+/**
+ * Returns a buffer of FMTP_DATA_LEN bytes for a data block. Waits if all
+ * buffers are being written, which slows the receiving threads down to the
+ * speed of the disk.
+ *
+ * @return  The buffer.
+ */
+char* FileSink::getBuffer()
+{
+    std::unique_lock<std::mutex> lock(bufmtx);
+    while (freebufs.empty())
+        bufcond.wait(lock);
+    char* const buf = freebufs.back();
+    freebufs.pop_back();
+    return buf;
+}
+
+
+/**
+ * Returns a buffer which isn't going to be written.
+ *
+ * @param[in] buf  The buffer.
+ */
+void FileSink::putBuffer(char* const buf)
+{
+    std::unique_lock<std::mutex> lock(bufmtx);
+    freebufs.push_back(buf);
+    bufcond.notify_one();
+}
+
+
+/**
+ * Queues a data block for writing and takes over its buffer. The block is
+ * dropped if the product isn't in the sink (any more).
+ *
+ * @param[in] prodindex  Index of the product.
+ * @param[in] offset     Offset of the block in the product.
+ * @param[in] buf        Buffer from getBuffer() holding the block.
+ * @param[in] len        Length of the block in bytes.
+ */
+void FileSink::write(const uint32_t prodindex, const uint64_t offset,
+                     char* const buf, const uint16_t len)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = files.find(prodindex);
+        if (it != files.end()) {
+            Item item = {WRITE, it->second, offset, len, buf};
+            queue.push_back(item);
+            cond.notify_one();
+            return;
+        }
+    }
+    putBuffer(buf);
+}
+
+
+/**
+ * Finishes a product. The product leaves the sink at once. After the blocks
+ * queued before have been written, the sync thread syncs and closes the file
+ * and calls the callback. A file that couldn't be written is removed.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @return               False if the product isn't in the sink.
+ */
+bool FileSink::finish(const uint32_t prodindex)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = files.find(prodindex);
+    if (it == files.end())
+        return false;
+    Item item = {FINISH, it->second, 0, 0, NULL};
+    files.erase(it);
+    queue.push_back(item);
+    cond.notify_one();
+    return true;
+}
+
+
+/**
+ * Abandons a product. The writer thread removes the file after the blocks
+ * queued before have been written; the callback isn't called.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @return               False if the product isn't in the sink.
+ */
+bool FileSink::discard(const uint32_t prodindex)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = files.find(prodindex);
+    if (it == files.end())
+        return false;
+    Item item = {DISCARD, it->second, 0, 0, NULL};
+    files.erase(it);
+    queue.push_back(item);
+    cond.notify_one();
+    return true;
+}
+
+
+/**
+ * Closes the file of a product and releases its entry.
+ *
+ * @param[in] file    The file.
+ * @param[in] remove  Whether to remove the file.
+ */
+void FileSink::closeFile(File* const file, const bool remove)
+{
+    (void)close(file->fd);
+    if (remove)
+        (void)unlink(pathOf(file->prodindex).c_str());
+    delete file;
+}
+
+
+/**
+ * Sets up an io_uring instance and maps its rings. Leaves `ringfd` at -1 if
+ * the headers or the kernel don't support io_uring, or if it isn't permitted.
+ *
+ * @param[in] entries  Number of submission-queue entries.
+ */
+void FileSink::initRing(const unsigned entries)
+{
+#ifdef FILESINK_IO_URING
+    struct io_uring_params params;
+    (void)memset(&params, 0, sizeof(params));
+    const int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+        return;
+
+    sqringlen = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqringlen = params.cq_off.cqes +
+            params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+        sqringlen = cqringlen = std::max(sqringlen, cqringlen);
+    sqeslen = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sqring = mmap(NULL, sqringlen, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cqring = single ? sqring : mmap(NULL, cqringlen, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqes   = mmap(NULL, sqeslen, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqring == MAP_FAILED || cqring == MAP_FAILED || sqes == MAP_FAILED) {
+        if (sqes != MAP_FAILED)
+            (void)munmap(sqes, sqeslen);
+        if (!single && cqring != MAP_FAILED)
+            (void)munmap(cqring, cqringlen);
+        if (sqring != MAP_FAILED)
+            (void)munmap(sqring, sqringlen);
+        (void)close(fd);
+        sqring = cqring = sqes = NULL;
+        return;
+    }
+    if (single)
+        cqringlen = 0; // unmapped with the submission ring
+
+    char* const sq = (char*)sqring;
+    char* const cq = (char*)cqring;
+    sqtail    = (unsigned*)(sq + params.sq_off.tail);
+    sqmask    = (unsigned*)(sq + params.sq_off.ring_mask);
+    sqarray   = (unsigned*)(sq + params.sq_off.array);
+    cqhead    = (unsigned*)(cq + params.cq_off.head);
+    cqtail    = (unsigned*)(cq + params.cq_off.tail);
+    cqmask    = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes      = cq + params.cq_off.cqes;
+    sqentries = params.sq_entries;
+    ringfd    = fd;
+#else
+    (void)entries;
+#endif
+}
+
+
+/**
+ * Writes a run of blocks with pwritev(), starting after the bytes of the run
+ * which have already been written. Records an error in the file of the run.
+ *
+ * @param[in] run   The run.
+ * @param[in] done  Number of bytes of the run already written.
+ */
+void FileSink::pwriteRun(const Run& run, size_t done)
+{
+    struct iovec* iov  = &iovs[run.iov];
+    int           cnt  = run.iovcnt;
+    size_t        left = run.nbytes - done;
+
+    while (left) {
+        /* skip what has been written, the vectors are scratch space */
+        while (done >= iov->iov_len) {
+            done -= iov->iov_len;
+            ++iov;
+            --cnt;
+        }
+        iov->iov_base = (char*)iov->iov_base + done;
+        iov->iov_len -= done;
+
+        const ssize_t n = pwritev(run.file->fd, iov, cnt,
+                run.offset + run.nbytes - left);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (!run.file->error)
+                run.file->error = errno;
+            return;
+        }
+        left -= n;
+        done  = n;
+    }
+}
+
+
+/**
+ * Writes runs of blocks through the io_uring instance. As many runs as the
+ * submission queue holds are submitted together, and the call returns after
+ * all of them have completed. A short write is finished with pwritev().
+ *
+ * @param[in] runs   The runs.
+ * @param[in] nruns  Number of runs.
+ * @throws std::system_error  if the ring fails, which is fatal.
+ */
+void FileSink::ringWriteRuns(const Run* const runs, const size_t nruns)
+{
+#ifdef FILESINK_IO_URING
+    struct io_uring_sqe* const sqe = (struct io_uring_sqe*)sqes;
+    struct io_uring_cqe* const cqe = (struct io_uring_cqe*)cqes;
+
+    for (size_t first = 0; first < nruns; first += sqentries) {
+        const unsigned n    = std::min<size_t>(sqentries, nruns - first);
+        unsigned       tail = *sqtail;
+
+        for (unsigned i = 0; i < n; ++i, ++tail) {
+            const Run&     run = runs[first + i];
+            const unsigned idx = tail & *sqmask;
+            (void)memset(&sqe[idx], 0, sizeof(sqe[idx]));
+            sqe[idx].opcode    = IORING_OP_WRITEV;
+            sqe[idx].fd        = run.file->fd;
+            sqe[idx].addr      = (uint64_t)(uintptr_t)&iovs[run.iov];
+            sqe[idx].len       = run.iovcnt;
+            sqe[idx].off       = run.offset;
+            sqe[idx].user_data = first + i;
+            sqarray[idx]       = idx;
+        }
+        __atomic_store_n(sqtail, tail, __ATOMIC_RELEASE);
+
+        unsigned submitted = 0;
+        unsigned reaped    = 0;
+        while (reaped < n) {
+            const int status = syscall(__NR_io_uring_enter, ringfd,
+                    n - submitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if (status < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    continue;
+                /* the kernel may still use the buffers, nothing can be done */
+                throw std::system_error(errno, std::system_category(),
+                        "FileSink::ringWriteRuns() io_uring_enter() failed");
+            }
+            submitted += status;
+
+            unsigned       head  = *cqhead;
+            const unsigned ctail = __atomic_load_n(cqtail, __ATOMIC_ACQUIRE);
+            for (; head != ctail; ++head, ++reaped) {
+                const struct io_uring_cqe& c   = cqe[head & *cqmask];
+                const Run&                 run = runs[c.user_data];
+                if (c.res < 0) {
+                    if (!run.file->error)
+                        run.file->error = -c.res;
+                }
+                else if ((size_t)c.res < run.nbytes) {
+                    pwriteRun(run, c.res);
+                }
+            }
+            __atomic_store_n(cqhead, head, __ATOMIC_RELEASE);
+        }
+    }
+#else
+    for (size_t i = 0; i < nruns; ++i)
+        pwriteRun(runs[i], 0);
+#endif
+}
+
+
+/**
+ * Entry point of the writer thread.
+ *
+ * @param[in] arg  The sink.
+ * @return         NULL.
+ */
+void* FileSink::start(void* arg)
+{
+    static_cast<FileSink*>(arg)->writer();
+    return NULL;
+}
+
+
+/**
+ * Entry point of the sync thread.
+ *
+ * @param[in] arg  The sink.
+ * @return         NULL.
+ */
+void* FileSink::startSyncer(void* arg)
+{
+    static_cast<FileSink*>(arg)->syncer();
+    return NULL;
+}
+
+
+/**
+ * Syncs and closes finished files in the order in which they were finished,
+ * and reports them. Doesn't return until the sink is stopped and no finished
+ * file is left.
+ */
+void FileSink::syncer()
+{
+    std::vector<File*> batch;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(syncmtx);
+            while (syncq.empty() && !syncstop)
+                synccond.wait(lock);
+            if (syncq.empty())
+                break;
+            batch.swap(syncq);
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            File* const file = batch[i];
+            if (!file->error && fsync(file->fd))
+                file->error = errno;
+            const uint32_t prodindex = file->prodindex;
+            const bool     ok        = !file->error;
+            closeFile(file, !ok);
+            done(prodindex, ok);
+        }
+        batch.clear();
+    }
+}
+
+
+/**
+ * Takes the queue in batches and handles it in order. Doesn't return until the
+ * sink is stopped and the queue is empty.
+ */
+void FileSink::writer()
+{
+    std::vector<Item> batch;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (queue.empty() && !stop)
+                cond.wait(lock);
+            if (queue.empty())
+                break;
+            batch.swap(queue);
+        }
+
+        for (size_t i = 0; i < batch.size();) {
+            size_t j = i;
+            while (j < batch.size() && batch[j].type == WRITE)
+                ++j;
+            if (j > i)
+                writeBlocks(&batch[i], j - i);
+            if (j < batch.size()) {
+                File* const file = batch[j].file;
+                if (batch[j].type == FINISH) {
+                    std::unique_lock<std::mutex> lock(syncmtx);
+                    syncq.push_back(file);
+                    synccond.notify_one();
+                }
+                else {
+                    closeFile(file, true);
+                }
+                ++j;
+            }
+            i = j;
+        }
+        batch.clear();
+    }
+}
+
+
+/**
+ * Writes blocks to their files. The blocks are sorted by file and offset, so
+ * that every run of contiguous blocks becomes one vectored write, and their
+ * buffers are released afterwards.
+ *
+ * @param[in] items  The blocks.
+ * @param[in] n      Number of blocks.
+ */
+void FileSink::writeBlocks(Item* const items, const size_t n)
+{
+    std::sort(items, items + n, [](const Item& a, const Item& b) {
+        return a.file != b.file ? a.file < b.file : a.offset < b.offset;
+    });
+
+    iovs.resize(n);
+    runs.clear();
+    for (size_t i = 0; i < n; ++i) {
+        const Item& item = items[i];
+        iovs[i].iov_base = item.buf;
+        iovs[i].iov_len  = item.len;
+        if (!runs.empty()) {
+            Run& run = runs.back();
+            if (run.file == item.file && run.iovcnt < IOV_MAX &&
+                    run.offset + run.nbytes == item.offset) {
+                ++run.iovcnt;
+                run.nbytes += item.len;
+                continue;
+            }
+        }
+        Run run = {item.file, item.offset, i, 1, item.len};
+        runs.push_back(run);
+    }
+
+    if (ringfd >= 0) {
+        ringWriteRuns(runs.data(), runs.size());
+    }
+    else {
+        for (size_t i = 0; i < runs.size(); ++i)
+            pwriteRun(runs[i], 0);
+    }
+
+    std::unique_lock<std::mutex> lock(bufmtx);
+    for (size_t i = 0; i < n; ++i)
+        freebufs.push_back(items[i].buf);
+    bufcond.notify_all();
+}
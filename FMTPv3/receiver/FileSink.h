@@ -0,0 +1,220 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      FileSink.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the FileSink class.
+ *
+ * Writes received products straight into one file per product. The receiving
+ * threads hand over data blocks in buffers of the sink, and a writer thread
+ * writes them to their offsets in the files asynchronously with io_uring, or
+ * with vectored pwritev() calls where io_uring is unavailable. A finished
+ * file is synced to disk by a second thread before the product is reported
+ * complete, so that syncing doesn't hold up the blocks of other products.
+ */
+
+
+#ifndef FMTP_RECEIVER_FILESINK_H_
+#define FMTP_RECEIVER_FILESINK_H_
+
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class FileSink
+{
+public:
+    /**
+     * Called by the sync thread when a finished product is on disk or has
+     * failed to be written.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] ok         Whether the file is complete.
+     */
+    typedef std::function<void(uint32_t prodindex, bool ok)> Callback;
+
+    /**
+     * Constructs a sink and starts its writer and sync threads.
+     *
+     * @param[in] dir         Directory of the product files.
+     * @param[in] done        Called for every finished product.
+     * @param[in] nbufs       Number of block buffers.
+     * @param[in] useIoUring  Whether to use io_uring if the kernel supports
+     *                        it.
+     * @throws std::system_error  if a thread can't be started.
+     */
+    FileSink(const std::string& dir, const Callback& done,
+             const size_t nbufs = 4096, const bool useIoUring = true);
+    /**
+     * Stops the threads. Files of unfinished products are removed.
+     */
+    ~FileSink();
+    /**
+     * Returns the pathname of the file of a product.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @return               Pathname of the file.
+     */
+    std::string pathOf(const uint32_t prodindex) const;
+    /**
+     * Creates and preallocates the file of a product.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] prodsize   Size of the product in bytes.
+     * @throws std::system_error  if the file can't be created.
+     */
+    void open(const uint32_t prodindex, const uint64_t prodsize);
+    /**
+     * Returns a buffer of FMTP_DATA_LEN bytes for a data block. Waits if all
+     * buffers are being written.
+     *
+     * @return  The buffer.
+     */
+    char* getBuffer();
+    /**
+     * Returns a buffer which isn't going to be written.
+     *
+     * @param[in] buf  The buffer.
+     */
+    void putBuffer(char* const buf);
+    /**
+     * Queues a data block for writing and takes over its buffer.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] offset     Offset of the block in the product.
+     * @param[in] buf        Buffer from getBuffer() holding the block.
+     * @param[in] len        Length of the block in bytes.
+     */
+    void write(const uint32_t prodindex, const uint64_t offset,
+               char* const buf, const uint16_t len);
+    /**
+     * Finishes a product after all of its blocks have been queued. The file
+     * is synced and closed and the callback is called once the queued blocks
+     * are written.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @return               False if the product isn't in the sink.
+     */
+    bool finish(const uint32_t prodindex);
+    /**
+     * Abandons a product. Its file is removed and the callback isn't called.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @return               False if the product isn't in the sink.
+     */
+    bool discard(const uint32_t prodindex);
+    /**
+     * Tells whether blocks are written with io_uring.
+     *
+     * @return  True if io_uring is used, false if pwritev() is.
+     */
+    bool usesIoUring() const {return ringfd >= 0;}
+
+private:
+    /* Prevent copying because it's meaningless */
+    FileSink(const FileSink&);
+    FileSink& operator=(const FileSink&);
+
+    struct File {
+        uint32_t    prodindex;
+        int         fd;
+        /* first write error, 0 if none */
+        int         error;
+    };
+    enum ItemType {WRITE, FINISH, DISCARD};
+    struct Item {
+        ItemType    type;
+        File*       file;
+        uint64_t    offset;
+        uint16_t    len;
+        char*       buf;
+    };
+    /* contiguous blocks of a file written by one request */
+    struct Run {
+        File*       file;
+        uint64_t    offset;
+        size_t      iov;
+        int         iovcnt;
+        size_t      nbytes;
+    };
+
+    void closeFile(File* const file, const bool remove);
+    void initRing(const unsigned entries);
+    void pwriteRun(const Run& run, size_t done);
+    void ringWriteRuns(const Run* const runs, const size_t nruns);
+    static void* start(void* arg);
+    static void* startSyncer(void* arg);
+    void syncer();
+    void writer();
+    void writeBlocks(Item* const items, const size_t n);
+
+    const std::string       dir;
+    const Callback          done;
+    /* block buffers and the ones not in use */
+    char*                   bufs;
+    std::vector<char*>      freebufs;
+    std::mutex              bufmtx;
+    std::condition_variable bufcond;
+    /* products being written, by index */
+    std::unordered_map<uint32_t, File*> files;
+    /* blocks and requests for the writer thread */
+    std::vector<Item>       queue;
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    stop;
+    pthread_t               thread;
+    /* finished files for the sync thread */
+    std::vector<File*>      syncq;
+    std::mutex              syncmtx;
+    std::condition_variable synccond;
+    bool                    syncstop;
+    pthread_t               syncthread;
+    /* used by the writer thread only */
+    std::vector<struct iovec> iovs;
+    std::vector<Run>        runs;
+    /* io_uring instance, ringfd is -1 if pwritev() is used */
+    int                     ringfd;
+    void*                   sqring;
+    size_t                  sqringlen;
+    void*                   cqring;
+    size_t                  cqringlen;
+    void*                   sqes;
+    size_t                  sqeslen;
+    unsigned                sqentries;
+    unsigned*               sqtail;
+    unsigned*               sqmask;
+    unsigned*               sqarray;
+    unsigned*               cqhead;
+    unsigned*               cqtail;
+    unsigned*               cqmask;
+    void*                   cqes;
+};
+
+
+#endif /* FMTP_RECEIVER_FILESINK_H_ */
@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      McastPoller.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the McastPoller class.
+ *
+ * In busy-poll mode the socket is read with MSG_DONTWAIT in a loop. Setting
+ * SO_BUSY_POLL as well makes the kernel poll the device queue during such a
+ * read, so a packet can be taken without waiting for its interrupt. Raising
+ * SO_BUSY_POLL above `net.core.busy_read` needs CAP_NET_ADMIN; without it the
+ * loop still avoids the wake-up latency of a sleeping thread.
+ *
+ * The arrival time of a packet is the kernel's receive timestamp, so it isn't
+ * delayed by the time the packet spent in the socket buffer.
+ */
+
+
+#include "McastPoller.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <chrono>
+
+
+/**
+ * Configures a socket for peeking at its packets: makes the kernel report
+ * dropped datagrams and receive timestamps and, in busy-poll mode, poll the
+ * device. Failures only
+ * reduce what the poller can do, so they aren't fatal.
+ *
+ * @param[in] sock           The socket, which the caller keeps owning.
+ * @param[in] busyPollUsecs  0 to sleep until a packet arrives, otherwise poll
+ *                           without sleeping and let the kernel busy poll the
+ *                           device for this many microseconds.
+ */
+McastPoller::McastPoller(const int sock, const unsigned busyPollUsecs)
+:
+    sock(sock),
+    busy(busyPollUsecs > 0),
+    kernelBusy(false),
+    counted(false),
+    stamped(false),
+    drops(0),
+    lastCount(0),
+    arrival(0)
+{
+    const int on = 1;
+    counted = setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == 0;
+    stamped = setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &on,
+            sizeof(on)) == 0;
+
+    if (busy) {
+        const int usecs = busyPollUsecs;
+        kernelBusy = setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usecs,
+                sizeof(usecs)) == 0;
+#ifdef SO_PREFER_BUSY_POLL
+        if (kernelBusy)
+            (void)setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &on,
+                    sizeof(on));
+#endif
+    }
+}
+
+
+/**
+ * Peeks at the next packet. Doesn't return before there is one. Is a
+ * cancellation point in both modes. The packet carries the drop counter of
+ * the socket at the time it was queued, so every increase is added to the
+ * number of drops. Without a receive timestamp, the packet arrived when it's
+ * peeked at.
+ *
+ * @param[out] buf  Buffer for the start of the packet.
+ * @param[in]  len  Size of the buffer in bytes.
+ * @return          The result of `recvmsg()`.
+ */
+ssize_t McastPoller::peek(void* const buf, const size_t len)
+{
+    struct iovec  iov = {buf, len};
+    union {
+        char           buf[CMSG_SPACE(sizeof(uint32_t)) +
+                           CMSG_SPACE(sizeof(struct timespec))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {};
+    ssize_t       nbytes;
+
+    for (;;) {
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        nbytes = recvmsg(sock, &msg, busy ? MSG_PEEK | MSG_DONTWAIT :
+                MSG_PEEK);
+        if (nbytes >= 0 || !busy || (errno != EAGAIN && errno != EWOULDBLOCK))
+            break;
+        pthread_testcancel();
+        #if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+        #endif
+    }
+
+    if (nbytes >= 0) {
+        bool hasStamp = false;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+                cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET &&
+                    cmsg->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t count;
+                (void)memcpy(&count, CMSG_DATA(cmsg), sizeof(count));
+                /* the kernel's counter is 32 bits and wraps */
+                drops.fetch_add(count - lastCount, std::memory_order_relaxed);
+                lastCount = count;
+            }
+            else if (cmsg->cmsg_level == SOL_SOCKET &&
+                    cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec stamp;
+                (void)memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                arrival  = stamp.tv_sec + stamp.tv_nsec / 1e9;
+                hasStamp = true;
+            }
+        }
+        if (!hasStamp)
+            arrival = std::chrono::duration<double>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+    }
+    return nbytes;
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      McastPoller.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the McastPoller class.
+ *
+ * Peeks at the packets of the multicast socket of a receiver, either by
+ * sleeping in the kernel or, for low latency, by polling the socket without
+ * ever sleeping. It also counts the datagrams which the socket dropped for
+ * lack of buffer space and tells when the latest packet arrived.
+ */
+
+
+#ifndef FMTP_RECEIVER_MCASTPOLLER_H_
+#define FMTP_RECEIVER_MCASTPOLLER_H_
+
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include <cstddef>
+
+
+class McastPoller
+{
+public:
+    /**
+     * Configures a socket for peeking at its packets.
+     *
+     * @param[in] sock           The socket, which the caller keeps owning.
+     * @param[in] busyPollUsecs  0 to sleep until a packet arrives, otherwise
+     *                           poll without sleeping and let the kernel busy
+     *                           poll the device for this many microseconds.
+     */
+    explicit McastPoller(const int sock, const unsigned busyPollUsecs = 0);
+    /**
+     * Peeks at the next packet. Doesn't return before there is one. Is a
+     * cancellation point.
+     *
+     * @param[out] buf  Buffer for the start of the packet.
+     * @param[in]  len  Size of the buffer in bytes.
+     * @return          The result of `recvmsg()`.
+     */
+    ssize_t peek(void* const buf, const size_t len);
+    /**
+     * Returns the number of datagrams the socket has dropped. Thread-safe.
+     *
+     * @return  The number of dropped datagrams up to the latest peek.
+     */
+    uint64_t getDrops() const {return drops.load(std::memory_order_relaxed);}
+    /* false if the kernel doesn't count drops, see SO_RXQ_OVFL */
+    bool dropsCounted() const {return counted;}
+    /**
+     * Returns when the packet of the latest peek arrived. Only for the
+     * peeking thread.
+     *
+     * @return  Seconds since the epoch of the system clock.
+     */
+    double getArrival() const {return arrival;}
+    /* false if the kernel doesn't timestamp packets, see SO_TIMESTAMPNS */
+    bool arrivalStamped() const {return stamped;}
+    bool isBusyPolling() const {return busy;}
+    /* true if the kernel busy polls the device as well */
+    bool kernelBusyPolls() const {return kernelBusy;}
+
+private:
+    /* Prevent copying because it's meaningless */
+    McastPoller(const McastPoller&);
+    McastPoller& operator=(const McastPoller&);
+
+    const int             sock;
+    const bool            busy;
+    bool                  kernelBusy;
+    bool                  counted;
+    bool                  stamped;
+    std::atomic<uint64_t> drops;
+    /* last drop counter of the kernel, only used by the peeking thread */
+    uint32_t              lastCount;
+    /* arrival time of the latest packet, only used by the peeking thread */
+    double                arrival;
+};
+
+
+#endif /* FMTP_RECEIVER_MCASTPOLLER_H_ */
@@ -0,0 +1,171 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      MpmcQueue.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the MpmcQueue class template.
+ *
+ * A bounded, lock-free multi-producer, multi-consumer queue. It is the ring of
+ * RetxReqQueue with consumers reserving positions the same way producers do.
+ * Neither side ever blocks; waiting is left to the user.
+ */
+
+
+#ifndef FMTP_RECEIVER_MPMCQUEUE_H_
+#define FMTP_RECEIVER_MPMCQUEUE_H_
+
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+
+template<class T>
+class MpmcQueue
+{
+public:
+    /**
+     * Constructs an empty queue.
+     *
+     * @param[in] capacity  Maximum number of items, a power of 2.
+     * @throws std::invalid_argument  if `capacity` isn't a power of 2.
+     */
+    explicit MpmcQueue(const size_t capacity)
+    :
+        cells(NULL),
+        mask(capacity - 1),
+        head(0),
+        tail(0)
+    {
+        if (capacity < 2 || (capacity & mask))
+            throw std::invalid_argument("MpmcQueue::MpmcQueue(): capacity "
+                    "is not a power of 2");
+        cells = new Cell[capacity];
+        for (size_t i = 0; i < capacity; ++i)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    ~MpmcQueue()
+    {
+        delete[] cells;
+    }
+
+    /**
+     * Adds an item to the queue if there is room for it.
+     *
+     * @param[in] item  The item.
+     * @return          False if the queue is full.
+     */
+    bool tryPush(const T& item)
+    {
+        Cell* const cell = reserve(tail, 0);
+        if (cell == NULL)
+            return false;
+        cell->item = item;
+        cell->seq.store(cell->pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Removes the item at the head of the queue if there is one.
+     *
+     * @param[out] item  The item.
+     * @return           False if the queue is empty.
+     */
+    bool tryPop(T& item)
+    {
+        Cell* const cell = reserve(head, 1);
+        if (cell == NULL)
+            return false;
+        item = cell->item;
+        cell->seq.store(cell->pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns the number of items in the queue. The value is only a snapshot
+     * if other threads use the queue.
+     *
+     * @return  The number of items.
+     */
+    size_t size() const
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        const size_t t = tail.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+    size_t capacity() const {return mask + 1;}
+
+private:
+    /* Prevent copying because it's meaningless */
+    MpmcQueue(const MpmcQueue&);
+    MpmcQueue& operator=(const MpmcQueue&);
+
+    struct Cell {
+        /* position for which the cell is writable or, +1, readable */
+        std::atomic<size_t> seq;
+        /* position of the reservation, only used by its owner */
+        size_t              pos;
+        T                   item;
+    };
+
+    /**
+     * Reserves the cell at a position of the queue.
+     *
+     * @param[in,out] index  `tail` for pushing or `head` for popping.
+     * @param[in]     ready  Offset of the sequence number of a cell which is
+     *                       ready for the caller: 0 to push, 1 to pop.
+     * @return               The cell or NULL if the queue is full or empty.
+     */
+    Cell* reserve(std::atomic<size_t>& index, const size_t ready)
+    {
+        size_t pos = index.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell* const    cell = &cells[pos & mask];
+            const size_t   seq  = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + ready);
+            if (diff == 0) {
+                if (index.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed)) {
+                    cell->pos = pos;
+                    return cell;
+                }
+            }
+            else if (diff < 0) {
+                return NULL;
+            }
+            else {
+                pos = index.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Cell*               cells;
+    const size_t        mask;
+    /* consumers and producers are kept on different cache lines */
+    std::atomic<size_t> head;
+    char                pad[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;
+};
+
+
+#endif /* FMTP_RECEIVER_MPMCQUEUE_H_ */
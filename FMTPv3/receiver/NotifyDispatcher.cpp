@@ -0,0 +1,195 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      NotifyDispatcher.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the NotifyDispatcher class.
+ *
+ * A thread that finds the queue empty looks again a few times and then goes
+ * to sleep after announcing it in `sleepers`. A producer only takes the mutex
+ * to wake a thread when it sees a sleeper, so queueing a notification is
+ * normally free of locks and system calls.
+ */
+
+
+#include "NotifyDispatcher.h"
+
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+
+/* number of times a thread looks for notifications before going to sleep */
+#define POP_SPINS 16
+
+/**
+ * Constructs a dispatcher and starts its threads.
+ *
+ * @param[in] deliver   Called on a dispatcher thread for every notification.
+ * @param[in] nthreads  Number of threads.
+ * @param[in] capacity  Maximum number of waiting notifications, a power of 2.
+ * @throws std::invalid_argument  if `nthreads` is 0 or `capacity` isn't a
+ *                                power of 2.
+ * @throws std::system_error      if a thread can't be started.
+ */
+NotifyDispatcher::NotifyDispatcher(const Callback& deliver,
+                                   const unsigned  nthreads,
+                                   const size_t    capacity)
+:
+    deliver(deliver),
+    queue(capacity),
+    maxDepth(0),
+    delivered(0),
+    sleepers(0),
+    mutex(),
+    cond(),
+    stop(false),
+    threads()
+{
+    if (nthreads == 0)
+        throw std::invalid_argument("NotifyDispatcher::NotifyDispatcher(): "
+                "no threads");
+
+    for (unsigned i = 0; i < nthreads; ++i) {
+        pthread_t  thread;
+        const int  status = pthread_create(&thread, NULL,
+                &NotifyDispatcher::start, this);
+        if (status) {
+            stopThreads();
+            throw std::system_error(status, std::system_category(),
+                    "NotifyDispatcher::NotifyDispatcher(): Couldn't start "
+                    "thread");
+        }
+        threads.push_back(thread);
+    }
+}
+
+
+/**
+ * Delivers the waiting notifications and stops the threads.
+ */
+NotifyDispatcher::~NotifyDispatcher()
+{
+    stopThreads();
+}
+
+
+/**
+ * Queues a notification and wakes up a sleeping thread if there is one. If the
+ * queue is full, yields until a thread has made room; notifications are never
+ * dropped.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @param[in] complete   True if the product is complete, false if it is
+ *                       missed.
+ */
+void NotifyDispatcher::push(const uint32_t prodindex, const bool complete)
+{
+    const Notice notice = {prodindex, complete};
+    while (!queue.tryPush(notice))
+        std::this_thread::yield();
+
+    const size_t depth = queue.size();
+    size_t       max   = maxDepth.load(std::memory_order_relaxed);
+    while (depth > max && !maxDepth.compare_exchange_weak(max, depth,
+            std::memory_order_relaxed))
+        ;
+
+    /* pairs with the fence in worker(): either side sees the other's store */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.notify_one();
+    }
+}
+
+
+/**
+ * Returns the statistics of the queue.
+ *
+ * @return  The statistics. The buffer-pool fields are 0.
+ */
+NotifyStats NotifyDispatcher::getStats() const
+{
+    NotifyStats stats = {};
+    stats.depth     = queue.size();
+    stats.maxDepth  = maxDepth.load(std::memory_order_relaxed);
+    stats.delivered = delivered.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+/**
+ * Entry point of a dispatcher thread.
+ *
+ * @param[in] arg  The dispatcher.
+ * @return         NULL.
+ */
+void* NotifyDispatcher::start(void* arg)
+{
+    static_cast<NotifyDispatcher*>(arg)->worker();
+    return NULL;
+}
+
+
+/**
+ * Tells the threads to stop once the queue is empty and joins them.
+ */
+void NotifyDispatcher::stopThreads()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stop = true;
+        cond.notify_all();
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+        (void)pthread_join(threads[i], NULL);
+    threads.clear();
+}
+
+
+/**
+ * Delivers notifications until the dispatcher is stopped and the queue is
+ * empty.
+ */
+void NotifyDispatcher::worker()
+{
+    for (;;) {
+        Notice notice;
+        bool   found = queue.tryPop(notice);
+        /* notifications come in bursts, so look again before sleeping */
+        for (int i = 0; !found && i < POP_SPINS; ++i) {
+            std::this_thread::yield();
+            found = queue.tryPop(notice);
+        }
+        if (!found) {
+            std::unique_lock<std::mutex> lock(mutex);
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!(found = queue.tryPop(notice)) && !stop)
+                cond.wait(lock);
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            if (!found)
+                return;
+        }
+        deliver(notice.prodindex, notice.complete);
+        delivered.fetch_add(1, std::memory_order_relaxed);
+    }
+}
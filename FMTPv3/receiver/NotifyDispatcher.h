@@ -0,0 +1,138 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      NotifyDispatcher.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the NotifyDispatcher class.
+ *
+ * Moves the end-of-product and missed-product notifications of the receiving
+ * application off the receiving threads. Notifications are queued without a
+ * lock and delivered by a pool of threads, so a slow application only makes
+ * the queue grow instead of delaying the reading of packets.
+ */
+
+
+#ifndef FMTP_RECEIVER_NOTIFYDISPATCHER_H_
+#define FMTP_RECEIVER_NOTIFYDISPATCHER_H_
+
+
+#include <pthread.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "MpmcQueue.h"
+
+
+/**
+ * Statistics of the notification stage of a receiver.
+ */
+struct NotifyStats
+{
+    /* notifications waiting to be delivered */
+    size_t   depth;
+    /* largest number of waiting notifications seen */
+    size_t   maxDepth;
+    /* notifications delivered */
+    uint64_t delivered;
+    /* BOP buffers available in the buffer pool */
+    size_t   buffersFree;
+    /* BOPs for which the buffer pool had no buffer */
+    uint64_t bufferMisses;
+};
+
+
+class NotifyDispatcher
+{
+public:
+    /**
+     * Delivers a notification to the application.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] complete   True if the product is complete, false if it is
+     *                       missed.
+     */
+    typedef std::function<void(uint32_t prodindex, bool complete)> Callback;
+
+    /**
+     * Constructs a dispatcher and starts its threads.
+     *
+     * @param[in] deliver   Called on a dispatcher thread for every
+     *                      notification.
+     * @param[in] nthreads  Number of threads.
+     * @param[in] capacity  Maximum number of waiting notifications, a power
+     *                      of 2.
+     * @throws std::invalid_argument  if `nthreads` is 0 or `capacity` isn't a
+     *                                power of 2.
+     * @throws std::system_error      if a thread can't be started.
+     */
+    NotifyDispatcher(const Callback& deliver, const unsigned nthreads = 2,
+                     const size_t capacity = 65536);
+    /**
+     * Delivers the waiting notifications and stops the threads.
+     */
+    ~NotifyDispatcher();
+    /**
+     * Queues a notification. Only waits if the queue is full.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] complete   True if the product is complete, false if it is
+     *                       missed.
+     */
+    void push(const uint32_t prodindex, const bool complete);
+    /**
+     * Returns the statistics of the queue. The buffer-pool fields are 0.
+     *
+     * @return  The statistics.
+     */
+    NotifyStats getStats() const;
+
+private:
+    /* Prevent copying because it's meaningless */
+    NotifyDispatcher(const NotifyDispatcher&);
+    NotifyDispatcher& operator=(const NotifyDispatcher&);
+
+    struct Notice {
+        uint32_t prodindex;
+        bool     complete;
+    };
+
+    static void* start(void* arg);
+    void stopThreads();
+    void worker();
+
+    const Callback          deliver;
+    MpmcQueue<Notice>       queue;
+    std::atomic<size_t>     maxDepth;
+    std::atomic<uint64_t>   delivered;
+    /* number of threads waiting for notifications */
+    std::atomic<unsigned>   sleepers;
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    stop;
+    std::vector<pthread_t>  threads;
+};
+
+
+#endif /* FMTP_RECEIVER_NOTIFYDISPATCHER_H_ */
@@ -0,0 +1,188 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ProdFilter.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the ProdFilter class.
+ *
+ * A UDP socket filter sees the datagram from its UDP header on, so the FMTP
+ * header starts at offset 8. A rejected product stays rejected for as long
+ * as it is among the last `capacity` ones, which outlasts its packets by far.
+ * The program is replaced on every rejection; SO_ATTACH_FILTER swaps it
+ * atomically, so no packet passes unfiltered meanwhile.
+ */
+
+
+#include "ProdFilter.h"
+#include "fmtpBase.h"
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <stdexcept>
+
+
+/* offsets of the fields of the FMTP header in a UDP datagram */
+#define UDP_HEADER_LEN  8
+#define PRODINDEX_OFF   (UDP_HEADER_LEN + offsetof(FmtpHeader, prodindex))
+#define FLAGS_OFF       (UDP_HEADER_LEN + offsetof(FmtpHeader, flags))
+
+
+/**
+ * Makes a BPF instruction.
+ *
+ * @param[in] code  Operation.
+ * @param[in] k     Operand.
+ * @param[in] jt    Relative target of a conditional jump if true, else the
+ *                  next instruction.
+ * @return          The instruction.
+ */
+static struct sock_filter insn(const uint16_t code, const uint32_t k,
+                               const unsigned jt = 0)
+{
+    struct sock_filter insn;
+    insn.code = code;
+    insn.jt   = jt;
+    insn.jf   = 0;
+    insn.k    = k;
+    return insn;
+}
+
+
+/**
+ * Constructs a filter which passes every packet. No program is attached
+ * until a product is rejected.
+ *
+ * @param[in] sock      The UDP socket, which the caller keeps owning.
+ * @param[in] capacity  Number of rejected products the kernel filters, at most
+ *                      `MAX_CAPACITY`.
+ * @throws std::invalid_argument  if `capacity` is 0 or too large.
+ */
+ProdFilter::ProdFilter(const int sock, const unsigned capacity)
+:
+    sock(sock),
+    capacity(capacity),
+    mutex(),
+    indexes(),
+    next(0),
+    rejected(0),
+    attached(false)
+{
+    if (capacity == 0 || capacity > MAX_CAPACITY)
+        throw std::invalid_argument("ProdFilter::ProdFilter(): invalid "
+                "capacity " + std::to_string(capacity));
+    indexes.reserve(capacity);
+}
+
+
+/**
+ * Removes the program from the socket.
+ */
+ProdFilter::~ProdFilter()
+{
+    if (attached) {
+        const int ignored = 0;
+        (void)setsockopt(sock, SOL_SOCKET, SO_DETACH_FILTER, &ignored,
+                sizeof(ignored));
+    }
+}
+
+
+/**
+ * Drops the data and EOP packets of a product from now on, in the kernel if
+ * it accepts the program. Thread-safe.
+ *
+ * @param[in] prodindex  Index of the product.
+ */
+void ProdFilter::reject(const uint32_t prodindex)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (indexes.size() < capacity) {
+        indexes.push_back(prodindex);
+    }
+    else {
+        indexes[next] = prodindex;
+        next = (next + 1) % capacity;
+    }
+    ++rejected;
+
+    std::vector<struct sock_filter> prog = compile(indexes);
+    struct sock_fprog               fprog;
+    fprog.len    = prog.size();
+    fprog.filter = prog.data();
+    attached = setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &fprog,
+            sizeof(fprog)) == 0;
+}
+
+
+/**
+ * Tells whether a product is rejected. Thread-safe.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @return               True if the product is rejected.
+ */
+bool ProdFilter::isRejected(const uint32_t prodindex) const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return std::find(indexes.begin(), indexes.end(), prodindex) !=
+            indexes.end();
+}
+
+
+/**
+ * Returns the number of rejections. Thread-safe.
+ *
+ * @return  The number of rejections.
+ */
+uint64_t ProdFilter::getRejected() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return rejected;
+}
+
+
+/**
+ * Compiles the program which drops every packet of a set of products except
+ * their BOPs. It compares the product index with each rejected one in turn;
+ * a short datagram fails the loads and is dropped, as FMTP would discard it
+ * anyway.
+ *
+ * @param[in] indexes  Indexes of the products, at most `MAX_CAPACITY`.
+ * @return             The program.
+ */
+std::vector<struct sock_filter> ProdFilter::compile(
+        const std::vector<uint32_t>& indexes)
+{
+    const unsigned                  n = indexes.size();
+    std::vector<struct sock_filter> prog;
+
+    /* pc 0-1: BOPs always pass */
+    prog.push_back(insn(BPF_LD | BPF_H | BPF_ABS, FLAGS_OFF));
+    prog.push_back(insn(BPF_JMP | BPF_JEQ | BPF_K, FMTP_BOP, n + 1));
+    /* pc 2: the loads convert from network byte order */
+    prog.push_back(insn(BPF_LD | BPF_W | BPF_ABS, PRODINDEX_OFF));
+    /* pc 3..n+2: a match jumps to the drop at pc n+4 */
+    for (unsigned i = 0; i < n; ++i)
+        prog.push_back(insn(BPF_JMP | BPF_JEQ | BPF_K, indexes[i], n - i));
+    /* pc n+3: accept, pc n+4: drop */
+    prog.push_back(insn(BPF_RET | BPF_K, 0xFFFFFFFF));
+    prog.push_back(insn(BPF_RET | BPF_K, 0));
+    return prog;
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ProdFilter.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the ProdFilter class.
+ *
+ * Keeps the products which the receiving application doesn't subscribe to
+ * out of user space. The indexes of the most recently rejected products are
+ * compiled into a classic BPF program on the multicast socket, so the kernel
+ * drops their data and EOP packets before they are copied or even queued.
+ */
+
+
+#ifndef FMTP_RECEIVER_PRODFILTER_H_
+#define FMTP_RECEIVER_PRODFILTER_H_
+
+
+#include <linux/filter.h>
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+
+class ProdFilter
+{
+public:
+    /**
+     * Decides from the metadata in its BOP whether a product is wanted.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] metadata   Application-level product metadata.
+     * @param[in] metasize   Size of the metadata in bytes.
+     * @return               True if the product is wanted.
+     */
+    typedef std::function<bool(uint32_t prodindex, const void* metadata,
+            unsigned metasize)> Predicate;
+
+    /**
+     * Constructs a filter which passes every packet.
+     *
+     * @param[in] sock      The UDP socket, which the caller keeps owning.
+     * @param[in] capacity  Number of rejected products the kernel filters,
+     *                      at most `MAX_CAPACITY`.
+     * @throws std::invalid_argument  if `capacity` is 0 or too large.
+     */
+    explicit ProdFilter(const int sock, const unsigned capacity = 64);
+    /**
+     * Removes the program from the socket.
+     */
+    ~ProdFilter();
+    /**
+     * Drops the data and EOP packets of a product from now on. The oldest
+     * rejected product is forgotten once `capacity` products are rejected.
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void reject(const uint32_t prodindex);
+    /**
+     * Tells whether a product is rejected, e.g. for packets which were queued
+     * before the program was updated.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @return               True if the product is rejected.
+     */
+    bool isRejected(const uint32_t prodindex) const;
+    /* false if the kernel refused the program and only isRejected() works */
+    bool inKernel() const {return attached;}
+    /**
+     * Returns the number of rejections.
+     *
+     * @return  The number of rejections.
+     */
+    uint64_t getRejected() const;
+    /**
+     * Compiles the program which drops every packet of a set of products
+     * except their BOPs.
+     *
+     * @param[in] indexes  Indexes of the products.
+     * @return             The program.
+     */
+    static std::vector<struct sock_filter> compile(
+            const std::vector<uint32_t>& indexes);
+
+    /* largest capacity whose program the conditional jumps can span */
+    static const unsigned MAX_CAPACITY = 250;
+
+private:
+    /* Prevent copying because it's meaningless */
+    ProdFilter(const ProdFilter&);
+    ProdFilter& operator=(const ProdFilter&);
+
+    const int             sock;
+    const unsigned        capacity;
+    mutable std::mutex    mutex;
+    /* ring of the indexes of the most recently rejected products */
+    std::vector<uint32_t> indexes;
+    size_t                next;
+    uint64_t              rejected;
+    bool                  attached;
+};
+
+
+#endif /* FMTP_RECEIVER_PRODFILTER_H_ */
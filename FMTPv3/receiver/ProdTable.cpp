@@ -0,0 +1,457 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ProdTable.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the ProdTable class.
+ *
+ * The table is open-addressed with linear probing. Product indices are mostly
+ * consecutive, so the product index itself is used as the hash and records of
+ * neighbouring products sit in neighbouring slots. Lookups don't take any
+ * table-wide lock, they only lock the record they end up with. Insertions are
+ * rare (once per product) and serialized among themselves. Removed records
+ * become tombstones which are reused by later insertions, and the length of
+ * a lookup is bounded by the longest probe sequence of a live record. Every
+ * so often an insertion purges the tombstones, so a crowded period doesn't
+ * slow down the lookups of unknown products for the rest of the run.
+ *
+ * Data blocks are written without any lock. A writer increments the `users`
+ * count of a record before checking that the record is still alive, and the
+ * remover marks the record dead before waiting for `users` to drop to zero.
+ * Both sides use sequentially consistent operations, so either the writer
+ * sees the record dead and backs off, or the remover waits for the writer.
+ */
+
+
+#include "ProdTable.h"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "fmtpBase.h"
+
+
+/* states of a slot */
+#define SLOT_EMPTY 0
+#define SLOT_LIVE  1
+#define SLOT_DEAD  2
+
+
+/**
+ * Constructs an empty record.
+ */
+ProdRecord::ProdRecord()
+:
+    state(SLOT_EMPTY),
+    prodindex(0),
+    users(0),
+    mutex(),
+    hasBOP(false),
+    bopRequested(false),
+    eopArrived(false),
+    prodsize(0),
+    prodptr(NULL),
+    tofile(false),
+    seqnum(0),
+    paylen(0),
+    nblocks(0),
+    blocksLeft(0),
+    blockmap(NULL),
+    mapwords(0),
+    blocksLost(0),
+    dropsAtBop(0)
+{
+}
+
+
+/**
+ * Destroys the record.
+ */
+ProdRecord::~ProdRecord()
+{
+    delete[] blockmap;
+}
+
+
+/**
+ * Initializes the record with the information carried by a BOP. The block
+ * bitmap keeps its capacity from the previous product in this slot. Nobody
+ * references the record yet because it has no BOP, so the bitmap can be
+ * reallocated. `hasBOP` is set last to publish the other fields.
+ *
+ * @pre               The record is locked by the caller.
+ * @param[in] size    Size of the product in bytes.
+ * @param[in] ptr     Where the product is to be written, may be NULL.
+ * @param[in] tofile  Whether the product is written to the file sink.
+ */
+void ProdRecord::init(const uint64_t size, void* const ptr, const bool tofile)
+{
+    bopRequested = false;
+    eopArrived   = false;
+    prodsize     = size;
+    prodptr      = ptr;
+    this->tofile = tofile;
+    nblocks      = (size + FMTP_DATA_LEN - 1) / FMTP_DATA_LEN;
+    seqnum.store(0, std::memory_order_relaxed);
+    paylen.store(0, std::memory_order_relaxed);
+    blocksLeft.store(nblocks, std::memory_order_relaxed);
+    blocksLost.store(0, std::memory_order_relaxed);
+    dropsAtBop   = 0;
+
+    const uint32_t words = ((uint64_t)nblocks + 63) / 64;
+    if (words > mapwords) {
+        delete[] blockmap;
+        blockmap = new std::atomic<uint64_t>[words];
+        mapwords = words;
+    }
+    for (uint32_t i = 0; i < words; ++i)
+        blockmap[i].store(0, std::memory_order_relaxed);
+
+    hasBOP.store(true, std::memory_order_release);
+}
+
+
+/**
+ * Claims a block for writing. The sender always cuts a product into blocks of
+ * FMTP_DATA_LEN bytes except the last one, so a block is identified by its
+ * sequence number. The claim is a single atomic bit, so exactly one thread
+ * wins it no matter how many copies of the block arrive at the same time.
+ *
+ * @pre                   The record is referenced or locked by the caller.
+ * @param[in] seqnum      Offset of the block in bytes.
+ * @param[in] payloadlen  Length of the block in bytes.
+ * @return                -1 if the block is misaligned or out of range,
+ *                        0 if the block is a duplicate,
+ *                        1 if the block is claimed by the caller.
+ */
+int ProdRecord::claimBlock(const uint64_t seqnum, const uint16_t payloadlen)
+{
+    if (seqnum % FMTP_DATA_LEN || seqnum >= prodsize)
+        return -1;
+
+    const uint32_t block = seqnum / FMTP_DATA_LEN;
+    const uint64_t left  = prodsize - seqnum;
+    if (payloadlen != (left < FMTP_DATA_LEN ? left : FMTP_DATA_LEN))
+        return -1;
+
+    const uint64_t bit = (uint64_t)1 << (block % 64);
+    if (blockmap[block / 64].load(std::memory_order_relaxed) & bit)
+        return 0;
+
+    return (blockmap[block / 64].fetch_or(bit, std::memory_order_relaxed) &
+            bit) ? 0 : 1;
+}
+
+
+/**
+ * Accounts for a claimed block whose data has been written. The thread which
+ * writes the last block of a product is the only one getting true.
+ *
+ * @pre                   The caller has claimed a block and written it.
+ * @return                True if it is the last block of the product.
+ */
+bool ProdRecord::blockDone()
+{
+    return blocksLeft.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+
+/**
+ * Checks if the block starting at the given sequence number is claimed, i.e.,
+ * received or being written.
+ *
+ * @param[in] seqnum      Offset of the block in bytes.
+ * @return                Arrival status of the block.
+ */
+bool ProdRecord::hasBlock(const uint64_t seqnum) const
+{
+    const uint64_t block = seqnum / FMTP_DATA_LEN;
+    if (block >= nblocks)
+        return false;
+    return blockmap[block / 64].load(std::memory_order_relaxed) &
+            ((uint64_t)1 << (block % 64));
+}
+
+
+/**
+ * Checks if the last block of the product is received.
+ *
+ * @return                Arrival status of the last block.
+ */
+bool ProdRecord::hasLastBlock() const
+{
+    return nblocks == 0 || hasBlock((uint64_t)(nblocks - 1) * FMTP_DATA_LEN);
+}
+
+
+/**
+ * Releases the referenced record, if any. Idempotent.
+ */
+void ProdRef::release()
+{
+    if (rec) {
+        rec->users.fetch_sub(1, std::memory_order_seq_cst);
+        rec = NULL;
+    }
+}
+
+
+/**
+ * Constructs an empty table.
+ *
+ * @param[in] capacity  Maximum number of products, rounded up to a power of 2.
+ * @throw std::invalid_argument  if `capacity` is 0 or too large.
+ */
+ProdTable::ProdTable(const uint32_t capacity)
+:
+    slots(NULL),
+    mask(0),
+    maxprobe(0),
+    count(0),
+    erased(0),
+    addmtx()
+{
+    if (capacity == 0 || capacity > 0x80000000u)
+        throw std::invalid_argument("ProdTable::ProdTable(): invalid capacity");
+
+    uint32_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    slots = new ProdRecord[size];
+    mask  = size - 1;
+}
+
+
+/**
+ * Destroys the table and all its records.
+ */
+ProdTable::~ProdTable()
+{
+    delete[] slots;
+}
+
+
+/**
+ * Finds the record of a product and locks it. The slot state and product
+ * index are checked once without the lock to skip foreign slots, and again
+ * with the lock held in case the record was removed in between.
+ *
+ * @param[in]  prodindex  Product index.
+ * @param[out] lock       Holds the lock of the record on success.
+ * @return                The locked record or NULL if not found.
+ */
+ProdRecord* ProdTable::find(const uint32_t              prodindex,
+                            std::unique_lock<std::mutex>& lock)
+{
+    const uint32_t probes = maxprobe.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i <= probes; ++i) {
+        ProdRecord* const rec = &slots[(prodindex + i) & mask];
+        const uint32_t state = rec->state.load(std::memory_order_acquire);
+
+        if (state == SLOT_EMPTY)
+            break;
+        if (state != SLOT_LIVE ||
+                rec->prodindex.load(std::memory_order_relaxed) != prodindex)
+            continue;
+
+        std::unique_lock<std::mutex> reclock(rec->mutex);
+        if (rec->state.load(std::memory_order_relaxed) == SLOT_LIVE &&
+                rec->prodindex.load(std::memory_order_relaxed) == prodindex) {
+            lock = std::move(reclock);
+            return rec;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Finds the record of a product or adds a new one, and locks it. A new record
+ * has all of its flags cleared and the caller is responsible for filling it.
+ *
+ * @param[in]  prodindex  Product index.
+ * @param[out] lock       Holds the lock of the record on success.
+ * @param[out] added      Whether the record is newly added.
+ * @return                The locked record or NULL if the table is full.
+ */
+ProdRecord* ProdTable::findOrAdd(const uint32_t              prodindex,
+                                 std::unique_lock<std::mutex>& lock,
+                                 bool&                         added)
+{
+    added = false;
+    ProdRecord* rec = find(prodindex, lock);
+    if (rec)
+        return rec;
+
+    std::unique_lock<std::mutex> addlock(addmtx);
+    /* somebody else might have added it before addmtx is acquired */
+    rec = find(prodindex, lock);
+    if (rec)
+        return rec;
+
+    if (erased.load(std::memory_order_relaxed) > mask / 4)
+        purge();
+
+    for (uint32_t i = 0; i <= mask; ++i) {
+        rec = &slots[(prodindex + i) & mask];
+        if (rec->state.load(std::memory_order_acquire) == SLOT_LIVE)
+            continue;
+
+        std::unique_lock<std::mutex> reclock(rec->mutex);
+        rec->hasBOP.store(false, std::memory_order_relaxed);
+        rec->bopRequested = false;
+        rec->eopArrived   = false;
+        rec->prodsize     = 0;
+        rec->prodptr      = NULL;
+        rec->nblocks      = 0;
+        rec->seqnum.store(0, std::memory_order_relaxed);
+        rec->paylen.store(0, std::memory_order_relaxed);
+        rec->blocksLeft.store(0, std::memory_order_relaxed);
+        rec->prodindex.store(prodindex, std::memory_order_relaxed);
+        rec->state.store(SLOT_LIVE, std::memory_order_release);
+
+        if (i > maxprobe.load(std::memory_order_relaxed))
+            maxprobe.store(i, std::memory_order_release);
+        ++count;
+
+        lock  = std::move(reclock);
+        added = true;
+        return rec;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Finds the record of a product which has a BOP and references it without
+ * locking. The reference is taken before the record is checked, so that
+ * erase() either sees the reference or the check sees the removal.
+ *
+ * @param[in]  prodindex  Product index.
+ * @param[out] ref        Holds the reference to the record on success.
+ * @return                The record or NULL if not found.
+ */
+ProdRecord* ProdTable::acquire(const uint32_t prodindex, ProdRef& ref)
+{
+    const uint32_t probes = maxprobe.load(std::memory_order_acquire);
+
+    ref.release();
+    for (uint32_t i = 0; i <= probes; ++i) {
+        ProdRecord* const rec = &slots[(prodindex + i) & mask];
+        const uint32_t state = rec->state.load(std::memory_order_acquire);
+
+        if (state == SLOT_EMPTY)
+            break;
+        if (state != SLOT_LIVE ||
+                rec->prodindex.load(std::memory_order_relaxed) != prodindex)
+            continue;
+
+        rec->users.fetch_add(1, std::memory_order_seq_cst);
+        if (rec->state.load(std::memory_order_seq_cst) == SLOT_LIVE &&
+                rec->prodindex.load(std::memory_order_relaxed) == prodindex) {
+            if (rec->hasBOP.load(std::memory_order_acquire)) {
+                ref.rec = rec;
+                return rec;
+            }
+            /* the product is there but its BOP isn't */
+            rec->users.fetch_sub(1, std::memory_order_seq_cst);
+            break;
+        }
+        rec->users.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Removes a record from the table. The slot becomes a tombstone so that the
+ * probe sequences going through it stay intact. Blocks being written by other
+ * threads are waited for, so the product buffer is not touched any more once
+ * this function returns.
+ *
+ * @pre                The record is locked by the caller.
+ * @param[in] rec      The record to remove.
+ */
+void ProdTable::erase(ProdRecord* const rec)
+{
+    rec->state.store(SLOT_DEAD, std::memory_order_seq_cst);
+    while (rec->users.load(std::memory_order_seq_cst))
+        std::this_thread::yield();
+    rec->hasBOP.store(false, std::memory_order_relaxed);
+    rec->prodptr = NULL;
+    --count;
+    ++erased;
+}
+
+
+/**
+ * Empties the tombstones which no probe sequence goes through and shortens
+ * `maxprobe` to the longest probe sequence of a live record. The probe
+ * sequence of a live record covers the slots from its home slot up to its
+ * own slot; a tombstone outside of every such sequence can't be needed by a
+ * lookup, so it becomes empty again and ends the lookups of unknown products.
+ * Lookups may run meanwhile: an emptied slot was never on their way to a
+ * live record, and only insertions, which are excluded, make a slot live.
+ *
+ * @pre  `addmtx` is locked by the caller.
+ */
+void ProdTable::purge()
+{
+    const uint32_t size = mask + 1;
+    /* number of probe sequences starting minus ending at each slot */
+    std::vector<int32_t> starts(size + 1, 0);
+    uint32_t             longest = 0;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        const ProdRecord& rec = slots[i];
+        if (rec.state.load(std::memory_order_acquire) != SLOT_LIVE)
+            continue;
+        const uint32_t home  = rec.prodindex.load(std::memory_order_relaxed) &
+                mask;
+        const uint32_t probe = (i - home) & mask;
+        if (probe > longest)
+            longest = probe;
+        if (probe == 0)
+            continue;
+        /* the sequence covers home to i - 1, possibly wrapping around */
+        ++starts[home];
+        --starts[i];
+        if (home > i) {
+            ++starts[0];
+            --starts[size];
+        }
+    }
+
+    int32_t covered = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        covered += starts[i];
+        if (covered == 0 &&
+                slots[i].state.load(std::memory_order_relaxed) == SLOT_DEAD)
+            slots[i].state.store(SLOT_EMPTY, std::memory_order_release);
+    }
+
+    maxprobe.store(longest, std::memory_order_release);
+    erased.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,213 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ProdTable.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the ProdTable class.
+ *
+ * A per-receiver table of product records. Each record holds everything the
+ * receiver knows about one product (BOP, EOP and block status), so that a
+ * packet only needs one lookup and one lock. Data blocks don't even need the
+ * lock: the multicast and the retransmission threads claim blocks through
+ * atomic bits, and a reference count keeps the record alive meanwhile.
+ */
+
+
+#ifndef FMTP_RECEIVER_PRODTABLE_H_
+#define FMTP_RECEIVER_PRODTABLE_H_
+
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+
+/**
+ * State of a single product on the receiver side. The atomic fields may be
+ * accessed without holding `mutex`, the other fields are protected by `mutex`.
+ * Once `hasBOP` is set, `prodsize`, `prodptr` and `nblocks` don't change until
+ * the record is removed, so a holder of a `ProdRef` may read them as well.
+ */
+struct ProdRecord
+{
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> prodindex;
+    /* number of threads writing blocks of the product, see ProdRef */
+    std::atomic<uint32_t> users;
+    std::mutex            mutex;
+    /* BOP has been received, prodsize and prodptr are valid */
+    std::atomic<bool>     hasBOP;
+    /* BOP has been requested for retransmission and is not received yet */
+    bool                  bopRequested;
+    /* EOP has been received, from multicast or retransmitted */
+    bool                  eopArrived;
+    uint64_t              prodsize;
+    void*                 prodptr;
+    /* blocks go to the file sink of the receiver instead of prodptr */
+    bool                  tofile;
+    /* seqnum and payload length of the most recent multicast block */
+    std::atomic<uint64_t> seqnum;
+    std::atomic<uint16_t> paylen;
+    /* total number of blocks and number of blocks not yet written */
+    uint32_t              nblocks;
+    std::atomic<uint32_t> blocksLeft;
+    /* one bit per FMTP_DATA_LEN block, set when the block is claimed */
+    std::atomic<uint64_t>* blockmap;
+    /* number of words allocated for blockmap */
+    uint32_t              mapwords;
+    /* number of blocks requested because they were missed on multicast */
+    std::atomic<uint32_t> blocksLost;
+    /* socket drop counter of the receiver when the BOP arrived */
+    uint64_t              dropsAtBop;
+
+    ProdRecord();
+    ~ProdRecord();
+    /**
+     * Initializes the record with the information carried by a BOP.
+     *
+     * @param[in] size    Size of the product in bytes.
+     * @param[in] ptr     Where the product is to be written, may be NULL.
+     * @param[in] tofile  Whether the product is written to the file sink.
+     */
+    void init(const uint64_t size, void* const ptr, const bool tofile = false);
+    /**
+     * Claims a block for writing. Exactly one caller wins the claim of a
+     * block, others get a duplicate.
+     *
+     * @param[in] seqnum      Offset of the block in bytes.
+     * @param[in] payloadlen  Length of the block in bytes.
+     * @return                -1 if the block is misaligned or out of range,
+     *                        0 if the block is a duplicate,
+     *                        1 if the block is claimed by the caller.
+     */
+    int  claimBlock(const uint64_t seqnum, const uint16_t payloadlen);
+    /**
+     * Accounts for a claimed block whose data has been written.
+     *
+     * @return                True if it is the last block of the product.
+     */
+    bool blockDone();
+    bool hasBlock(const uint64_t seqnum) const;
+    bool hasLastBlock() const;
+    bool isComplete() const {return hasBOP && blocksLeft == 0;}
+
+private:
+    ProdRecord(const ProdRecord&);
+    ProdRecord& operator=(const ProdRecord&);
+};
+
+
+/**
+ * A reference to a record which has a BOP. The record can't be removed from
+ * its table as long as the reference is held. Unlike the record lock, it
+ * doesn't exclude other threads, so data blocks can be written in parallel.
+ */
+class ProdRef
+{
+public:
+    ProdRef() : rec(NULL) {}
+    ~ProdRef() {release();}
+    void release();
+
+private:
+    friend class ProdTable;
+    ProdRef(const ProdRef&);
+    ProdRef& operator=(const ProdRef&);
+
+    ProdRecord* rec;
+};
+
+
+class ProdTable
+{
+public:
+    /**
+     * Constructs a table able to hold `capacity` products at the same time.
+     *
+     * @param[in] capacity  Maximum number of products, rounded up to a power
+     *                      of 2.
+     */
+    explicit ProdTable(const uint32_t capacity = 65536);
+    ~ProdTable();
+    /**
+     * Finds the record of a product and locks it.
+     *
+     * @param[in]  prodindex  Product index.
+     * @param[out] lock       Holds the lock of the record on success.
+     * @return                The locked record or NULL if not found.
+     */
+    ProdRecord* find(const uint32_t prodindex,
+                     std::unique_lock<std::mutex>& lock);
+    /**
+     * Finds the record of a product or adds a new one, and locks it.
+     *
+     * @param[in]  prodindex  Product index.
+     * @param[out] lock       Holds the lock of the record on success.
+     * @param[out] added      Whether the record is newly added.
+     * @return                The locked record or NULL if the table is full.
+     */
+    ProdRecord* findOrAdd(const uint32_t prodindex,
+                          std::unique_lock<std::mutex>& lock, bool& added);
+    /**
+     * Finds the record of a product which has a BOP and references it without
+     * locking.
+     *
+     * @param[in]  prodindex  Product index.
+     * @param[out] ref        Holds the reference to the record on success.
+     * @return                The record or NULL if not found.
+     */
+    ProdRecord* acquire(const uint32_t prodindex, ProdRef& ref);
+    /**
+     * Removes a record from the table. Waits for the references to the record
+     * to be released.
+     *
+     * @pre                The record is locked by the caller.
+     * @param[in] rec      The record to remove.
+     */
+    void erase(ProdRecord* const rec);
+    uint32_t size() const {return count;}
+    /* longest probe sequence a lookup may need */
+    uint32_t probeLength() const {return maxprobe;}
+
+private:
+    /* Prevent copying because it's meaningless */
+    ProdTable(const ProdTable&);
+    ProdTable& operator=(const ProdTable&);
+    /**
+     * Empties the tombstones which no probe sequence goes through and
+     * shortens `maxprobe` to the longest probe sequence of a live record.
+     *
+     * @pre  `addmtx` is locked by the caller.
+     */
+    void purge();
+
+    ProdRecord*           slots;
+    uint32_t              mask;
+    /* longest probe sequence of a live record, see purge() */
+    std::atomic<uint32_t> maxprobe;
+    std::atomic<uint32_t> count;
+    /* number of records removed since the last purge() */
+    std::atomic<uint32_t> erased;
+    /* serializes insertions, lookups don't take it */
+    std::mutex            addmtx;
+};
+
+
+#endif /* FMTP_RECEIVER_PRODTABLE_H_ */
@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ProductBufferPool.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the ProductBufferPool class.
+ */
+
+
+#include "ProductBufferPool.h"
+
+#include <stdexcept>
+
+
+/**
+ * Constructs a pool and allocates its buffers. The sizes of the classes
+ * double from `minsize` until `maxsize` is reached, so a buffer is never more
+ * than twice as large as the product it holds unless the product is smaller
+ * than `minsize`.
+ *
+ * @param[in] minsize  Size of a buffer of the smallest class in bytes.
+ * @param[in] maxsize  Size of a buffer of the largest class in bytes.
+ * @param[in] count    Number of buffers of every class.
+ * @param[in] node     NUMA node of the memory, -1 for the node of the calling
+ *                     thread.
+ * @throws std::invalid_argument  if a size or `count` is 0 or `minsize`
+ *                                exceeds `maxsize`.
+ * @throws std::system_error      if the memory can't be allocated.
+ */
+ProductBufferPool::ProductBufferPool(const size_t minsize,
+                                     const size_t maxsize,
+                                     const size_t count,
+                                     const int    node)
+:
+    classes(),
+    node(node),
+    misses(0)
+{
+    if (minsize == 0 || minsize > maxsize)
+        throw std::invalid_argument("ProductBufferPool::ProductBufferPool(): "
+                "invalid sizes");
+
+    try {
+        for (size_t size = minsize; size < maxsize; size *= 2)
+            classes.push_back(new BufferPool(size, count, node));
+        classes.push_back(new BufferPool(maxsize, count, node));
+    }
+    catch (...) {
+        for (size_t i = 0; i < classes.size(); ++i)
+            delete classes[i];
+        throw;
+    }
+}
+
+
+/**
+ * Destroys the pool and its buffers, whether they are returned or not.
+ */
+ProductBufferPool::~ProductBufferPool()
+{
+    for (size_t i = 0; i < classes.size(); ++i)
+        delete classes[i];
+}
+
+
+/**
+ * Takes a buffer of the smallest class that has a free buffer which is large
+ * enough. Never blocks. A request that can't be served is counted as a miss.
+ *
+ * @param[in] size  Number of bytes needed.
+ * @return          The buffer, or NULL if `size` exceeds the largest size or
+ *                  no buffer large enough is free.
+ */
+void* ProductBufferPool::tryGet(const size_t size)
+{
+    for (size_t i = 0; i < classes.size(); ++i) {
+        if (size <= classes[i]->getBufSize() && classes[i]->available()) {
+            void* const buf = classes[i]->tryGet(size);
+            if (buf)
+                return buf;
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+}
+
+
+/**
+ * Returns a buffer to its class.
+ *
+ * @param[in] buf  The buffer.
+ * @throws std::invalid_argument  if `buf` isn't a buffer of the pool.
+ */
+void ProductBufferPool::put(void* const buf)
+{
+    for (size_t i = 0; i < classes.size(); ++i) {
+        if (classes[i]->owns(buf)) {
+            classes[i]->put(buf);
+            return;
+        }
+    }
+    throw std::invalid_argument("ProductBufferPool::put(): not a buffer of "
+            "the pool");
+}
+
+
+/**
+ * Tells whether a pointer is a buffer of the pool.
+ *
+ * @param[in] buf  The pointer.
+ * @return         True if `buf` is a buffer of the pool.
+ */
+bool ProductBufferPool::owns(const void* const buf) const
+{
+    for (size_t i = 0; i < classes.size(); ++i)
+        if (classes[i]->owns(buf))
+            return true;
+    return false;
+}
+
+
+/**
+ * Moves the buffers of all classes to a NUMA node. Best effort.
+ *
+ * @param[in] node  NUMA node, -1 for the node of the calling thread.
+ */
+void ProductBufferPool::bind(const int node)
+{
+    for (size_t i = 0; i < classes.size(); ++i)
+        classes[i]->bind(node);
+}
+
+
+/**
+ * Returns the number of free buffers of all classes. The value is only a
+ * snapshot if other threads use the pool.
+ *
+ * @return  The number of free buffers.
+ */
+size_t ProductBufferPool::available() const
+{
+    size_t n = 0;
+    for (size_t i = 0; i < classes.size(); ++i)
+        n += classes[i]->available();
+    return n;
+}
+
+
+/**
+ * Tells whether every class is backed by huge pages.
+ *
+ * @return  True if huge pages were granted to every class.
+ */
+bool ProductBufferPool::usesHugePages() const
+{
+    for (size_t i = 0; i < classes.size(); ++i)
+        if (!classes[i]->usesHugePages())
+            return false;
+    return true;
+}
@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ProductBufferPool.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the ProductBufferPool class.
+ *
+ * Product buffers in size classes which double from a minimum to a maximum
+ * size. Every class is a BufferPool, i.e. an arena of pre-faulted huge pages
+ * on one NUMA node, so products of very different sizes can be received into
+ * recycled memory without reserving the largest size for every product.
+ */
+
+
+#ifndef FMTP_RECEIVER_PRODUCTBUFFERPOOL_H_
+#define FMTP_RECEIVER_PRODUCTBUFFERPOOL_H_
+
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "BufferPool.h"
+
+
+class ProductBufferPool
+{
+public:
+    /**
+     * Constructs a pool and allocates its buffers.
+     *
+     * @param[in] minsize  Size of a buffer of the smallest class in bytes.
+     * @param[in] maxsize  Size of a buffer of the largest class in bytes.
+     * @param[in] count    Number of buffers of every class.
+     * @param[in] node     NUMA node of the memory, -1 for the node of the
+     *                     calling thread.
+     * @throws std::invalid_argument  if a size or `count` is 0 or `minsize`
+     *                                exceeds `maxsize`.
+     * @throws std::system_error      if the memory can't be allocated.
+     */
+    ProductBufferPool(const size_t minsize, const size_t maxsize,
+                      const size_t count, const int node = -1);
+    ~ProductBufferPool();
+    /**
+     * Takes a buffer of the smallest class that has a free buffer which is
+     * large enough. Never blocks.
+     *
+     * @param[in] size  Number of bytes needed.
+     * @return          The buffer, or NULL if `size` exceeds the largest size
+     *                  or no buffer large enough is free.
+     */
+    void* tryGet(const size_t size);
+    /**
+     * Returns a buffer to its class.
+     *
+     * @param[in] buf  The buffer.
+     * @throws std::invalid_argument  if `buf` isn't a buffer of the pool.
+     */
+    void put(void* const buf);
+    /**
+     * Tells whether a pointer is a buffer of the pool.
+     *
+     * @param[in] buf  The pointer.
+     * @return         True if `buf` is a buffer of the pool.
+     */
+    bool owns(const void* const buf) const;
+    /**
+     * Moves the buffers to a NUMA node. Best effort.
+     *
+     * @param[in] node  NUMA node, -1 for the node of the calling thread.
+     */
+    void bind(const int node);
+    /**
+     * Returns the number of free buffers of all classes.
+     *
+     * @return  The number of free buffers.
+     */
+    size_t available() const;
+    /**
+     * Tells whether every class is backed by huge pages.
+     *
+     * @return  True if huge pages were granted to every class.
+     */
+    bool usesHugePages() const;
+    size_t getClassCount() const {return classes.size();}
+    size_t getMaxSize() const {return classes.back()->getBufSize();}
+    /* the node given to the constructor, -1 for the constructing thread's */
+    int getNode() const {return node;}
+    uint64_t getMisses() const {return misses.load(std::memory_order_relaxed);}
+
+private:
+    /* Prevent copying because it's meaningless */
+    ProductBufferPool(const ProductBufferPool&);
+    ProductBufferPool& operator=(const ProductBufferPool&);
+
+    /* size classes in increasing size */
+    std::vector<BufferPool*> classes;
+    const int                node;
+    /* number of requests that couldn't be served */
+    std::atomic<uint64_t>    misses;
+};
+
+
+#endif /* FMTP_RECEIVER_PRODUCTBUFFERPOOL_H_ */
@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      RateEstimator.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the RateEstimator class.
+ */
+
+
+#include "RateEstimator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+/* a gap counts as at most this many packet times at the estimated rate */
+#define IDLE_PACKETS 4
+/* a gap counts as at least this long at most, in seconds */
+#define MIN_IDLE_GAP 0.001
+/* what a gap counts as at most before there is an estimate, in seconds */
+#define INITIAL_IDLE_GAP 0.01
+
+
+/**
+ * Constructs an estimator without an estimate.
+ *
+ * @param[in] weight         Weight of a new sample in the average.
+ * @param[in] samplePackets  Number of packets in a sample. More packets
+ *                           smooth out the jitter of the arrival times.
+ * @throws std::invalid_argument  if `weight` isn't in (0, 1] or
+ *                                `samplePackets` is 0.
+ */
+RateEstimator::RateEstimator(const double weight, const unsigned samplePackets)
+:
+    weight(weight),
+    samplePackets(samplePackets),
+    sampling(false),
+    sampleTime(0),
+    lastTime(0),
+    sampleBytes(0),
+    sampleCount(0),
+    average(0),
+    estimate(0),
+    sendRate(0)
+{
+    if (!(weight > 0 && weight <= 1))
+        throw std::invalid_argument("RateEstimator::RateEstimator(): "
+                "invalid weight");
+    if (samplePackets == 0)
+        throw std::invalid_argument("RateEstimator::RateEstimator(): "
+                "no packets per sample");
+}
+
+
+/**
+ * Adds the arrival of a packet. The gap before a packet counts as at most
+ * `IDLE_PACKETS` packet times at the current estimate: a longer one is mostly
+ * the sender being idle between products, which mustn't lower the estimate.
+ * If the rate really has dropped, every gap is clamped, so each sample is a
+ * fraction of the estimate and the estimate soon follows. A clock going
+ * backwards starts a new sample.
+ *
+ * @param[in] time    Arrival time in seconds since any fixed epoch.
+ * @param[in] nbytes  Size of the packet in bytes.
+ */
+void RateEstimator::add(const double time, const size_t nbytes)
+{
+    if (!sampling || time < lastTime) {
+        sampling    = true;
+        sampleTime  = 0;
+        sampleBytes = 0;
+        sampleCount = 0;
+    }
+    else {
+        const double maxGap = average > 0 ?
+                std::max(MIN_IDLE_GAP, IDLE_PACKETS * 8.0 * nbytes / average) :
+                INITIAL_IDLE_GAP;
+        sampleTime  += std::min(time - lastTime, maxGap);
+        sampleBytes += nbytes;
+        if (++sampleCount >= samplePackets && sampleTime > 0) {
+            const double rate = 8.0 * sampleBytes / sampleTime;
+            average = average > 0 ? average + weight * (rate - average) : rate;
+            estimate.store((uint64_t)average, std::memory_order_relaxed);
+            sampleTime  = 0;
+            sampleBytes = 0;
+            sampleCount = 0;
+        }
+    }
+    lastTime = time;
+}
+
+
+/**
+ * Returns the estimated rate. The multicast can't arrive faster than the
+ * sender sends it, so an announced send rate caps the estimate, e.g. when
+ * the samples are distorted by a burst of queued packets, and stands in for
+ * it before there is a sample.
+ *
+ * @return  The rate in bits per second, or 0 if there is neither a sample nor
+ *          a send rate yet.
+ */
+uint64_t RateEstimator::get() const
+{
+    const uint64_t measured = estimate.load(std::memory_order_relaxed);
+    const uint64_t hinted   = sendRate.load(std::memory_order_relaxed);
+
+    if (measured == 0)
+        return hinted;
+    return hinted ? std::min(measured, hinted) : measured;
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      RateEstimator.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the RateEstimator class.
+ *
+ * Estimates the rate at which the multicast of a sender arrives from the
+ * arrival times of its packets. The bytes of a number of packets over the time
+ * they took form a sample, and the estimate is an exponentially weighted
+ * moving average of the samples. A long gap is mostly the sender being idle
+ * between products, so it only counts as a few packet times. The sender can
+ * also announce its send rate, which caps the estimate. Packets are added by
+ * one thread, the estimate can be read by any.
+ */
+
+
+#ifndef FMTP_RECEIVER_RATEESTIMATOR_H_
+#define FMTP_RECEIVER_RATEESTIMATOR_H_
+
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+
+class RateEstimator
+{
+public:
+    /**
+     * Constructs an estimator without an estimate.
+     *
+     * @param[in] weight         Weight of a new sample in the average.
+     * @param[in] samplePackets  Number of packets in a sample.
+     * @throws std::invalid_argument  if `weight` isn't in (0, 1] or
+     *                                `samplePackets` is 0.
+     */
+    explicit RateEstimator(const double   weight = 0.125,
+                           const unsigned samplePackets = 32);
+    /**
+     * Adds the arrival of a packet. Not thread-safe.
+     *
+     * @param[in] time    Arrival time in seconds since any fixed epoch.
+     * @param[in] nbytes  Size of the packet in bytes.
+     */
+    void add(const double time, const size_t nbytes);
+    /**
+     * Sets the send rate announced by the sender. Thread-safe.
+     *
+     * @param[in] rate  Send rate in bits per second, 0 for none.
+     */
+    void hint(const uint64_t rate)
+    {
+        sendRate.store(rate, std::memory_order_relaxed);
+    }
+    /**
+     * Returns the estimated rate. Thread-safe.
+     *
+     * @return  The rate in bits per second, or 0 if there is neither a sample
+     *          nor a send rate yet.
+     */
+    uint64_t get() const;
+
+private:
+    /* Prevent copying because it's meaningless */
+    RateEstimator(const RateEstimator&);
+    RateEstimator& operator=(const RateEstimator&);
+
+    const double          weight;
+    const unsigned        samplePackets;
+    /* the current sample, only used by the adding thread */
+    bool                  sampling;
+    /* the time the packets of the sample took, gaps clamped */
+    double                sampleTime;
+    double                lastTime;
+    uint64_t              sampleBytes;
+    unsigned              sampleCount;
+    /* the average in bits per second, only written by the adding thread */
+    double                average;
+    std::atomic<uint64_t> estimate;
+    std::atomic<uint64_t> sendRate;
+};
+
+
+#endif /* FMTP_RECEIVER_RATEESTIMATOR_H_ */
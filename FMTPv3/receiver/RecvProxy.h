@@ -36,14 +36,46 @@ public:
      * @param[in]  metaSize  Size of the metadata in bytes.
      * @param[out] data      Pointer to where FMTP should write subsequent
      *                       data. If `*data == nullptr`, then the data-product
-     *                       should be ignored.
+     *                       should be ignored. If the receiver writes products
+     *                       into files (see `fmtpRecvv3::SetFileSink()`),
+     *                       `*data` points to the pathname of the file on
+     *                       entry, and any non-null value keeps the product.
+     *                       If the receiver has a buffer pool (see
+     *                       `fmtpRecvv3::SetBufferPool()` or
+     *                       `fmtpRecvv3::SetProductBufferPool()`), `*data`
+     *                       is a free buffer large enough for the product
+     *                       on entry, or NULL; a buffer of the pool which is
+     *                       kept must be given back with
+     *                       `fmtpRecvv3::releaseBuffer()`.
      */
     virtual void notify_of_bop(const uint32_t iProd, size_t prodSize,
             void* metadata, unsigned metaSize, void** data) = 0;
 
+    /**
+     * Asks the receiving application whether it already holds a product,
+     * e.g. by looking up a signature in the BOP metadata (see
+     * `SignatureIndex`). A product that is held isn't received at all: its
+     * packets are dropped, RETX_END is sent to the sender at once, and
+     * neither `notify_of_bop()` nor any other notification is called for it.
+     * Called before `notify_of_bop()`. This method is thread-safe.
+     *
+     * @param[in] iProd     FMTP product-index.
+     * @param[in] metadata  Application-level product metadata.
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @return              True if the product is a duplicate.
+     */
+    virtual bool is_duplicate(const uint32_t /* iProd */,
+            const void* /* metadata */, unsigned /* metaSize */) {
+        return false;
+    }
+
     /**
      * Notifies the receiving application about the complete reception of the
-     * previous product. This method is thread-safe.
+     * previous product. If the receiver writes products into files, the file
+     * has been synced to disk. With a notification dispatcher (see
+     * `fmtpRecvv3::SetNotifyDispatcher()`), this and
+     * `notify_of_missed_prod()` are called on the threads of the dispatcher.
+     * This method is thread-safe.
      */
     virtual void notify_of_eop(uint32_t iProd) = 0;
 
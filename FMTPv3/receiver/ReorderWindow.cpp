@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ReorderWindow.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the ReorderWindow class.
+ */
+
+
+#include "ReorderWindow.h"
+
+#include <stdexcept>
+
+
+/**
+ * Constructs an empty window.
+ *
+ * @param[in] delay  How long a gap is held back in seconds.
+ * @throws std::invalid_argument  if `delay` is negative.
+ */
+ReorderWindow::ReorderWindow(const double delay)
+:
+    delay(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(delay))),
+    gaps(),
+    keys()
+{
+    if (delay < 0)
+        throw std::invalid_argument("ReorderWindow::ReorderWindow(): "
+                "negative delay");
+}
+
+
+/**
+ * Adds a gap which expires `delay` seconds from now. A gap which is already
+ * held back is ignored, so a block is requested at most once per window.
+ *
+ * @param[in] reqmsg  Request for the missing block.
+ * @param[in] now     Current time.
+ * @return            False if the gap is already held back.
+ */
+bool ReorderWindow::add(const INLReqMsg& reqmsg, const Clock::time_point& now)
+{
+    if (!keys.insert(keyOf(reqmsg)).second)
+        return false;
+
+    const Gap gap = {reqmsg, now + delay};
+    gaps.push_back(gap);
+    return true;
+}
+
+
+/**
+ * Removes the gaps whose delay has passed, oldest first. The removed requests
+ * are for `MISSING_DATA`.
+ *
+ * @param[in]  now      Current time.
+ * @param[out] reqmsgs  Requests for the missing blocks.
+ * @param[in]  max      Maximum number of gaps to remove.
+ * @return              Number of removed gaps.
+ */
+size_t ReorderWindow::expire(const Clock::time_point& now,
+                             INLReqMsg* const         reqmsgs,
+                             const size_t             max)
+{
+    size_t n = 0;
+
+    while (n < max && !gaps.empty() && gaps.front().deadline <= now) {
+        reqmsgs[n] = gaps.front().reqmsg;
+        reqmsgs[n++].reqtype = MISSING_DATA;
+        keys.erase(keyOf(gaps.front().reqmsg));
+        gaps.pop_front();
+    }
+    return n;
+}
+
+
+/**
+ * Returns when the delay of the oldest gap passes.
+ *
+ * @pre     The window isn't empty.
+ * @return  The deadline of the oldest gap.
+ */
+ReorderWindow::Clock::time_point ReorderWindow::nextDeadline() const
+{
+    return gaps.front().deadline;
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      ReorderWindow.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the ReorderWindow class.
+ *
+ * Holds back the requests for data blocks which were missing when a later
+ * block arrived on multicast. Multicast packets can be reordered on the way,
+ * e.g. by multipath routing or bonded links, so such a block usually arrives
+ * shortly afterwards; a gap is only requested if it is still open when its
+ * delay has passed. Used by the retransmission-request thread only.
+ */
+
+
+#ifndef FMTP_RECEIVER_REORDERWINDOW_H_
+#define FMTP_RECEIVER_REORDERWINDOW_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <unordered_set>
+
+#include "fmtpBase.h"
+
+
+class ReorderWindow
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Constructs an empty window.
+     *
+     * @param[in] delay  How long a gap is held back in seconds.
+     * @throws std::invalid_argument  if `delay` is negative.
+     */
+    explicit ReorderWindow(const double delay);
+    /**
+     * Adds a gap. A gap which is already held back is ignored.
+     *
+     * @param[in] reqmsg  Request for the missing block.
+     * @param[in] now     Current time.
+     * @return            False if the gap is already held back.
+     */
+    bool add(const INLReqMsg& reqmsg, const Clock::time_point& now);
+    /**
+     * Removes the gaps whose delay has passed, oldest first.
+     *
+     * @param[in]  now      Current time.
+     * @param[out] reqmsgs  Requests for the missing blocks.
+     * @param[in]  max      Maximum number of gaps to remove.
+     * @return              Number of removed gaps.
+     */
+    size_t expire(const Clock::time_point& now, INLReqMsg* const reqmsgs,
+                  const size_t max);
+    /**
+     * Returns when the delay of the oldest gap passes.
+     *
+     * @pre     The window isn't empty.
+     * @return  The deadline of the oldest gap.
+     */
+    Clock::time_point nextDeadline() const;
+    bool empty() const {return gaps.empty();}
+    size_t size() const {return gaps.size();}
+
+private:
+    /* Prevent copying because it's meaningless */
+    ReorderWindow(const ReorderWindow&);
+    ReorderWindow& operator=(const ReorderWindow&);
+
+    struct Gap {
+        INLReqMsg         reqmsg;
+        Clock::time_point deadline;
+    };
+
+    /**
+     * Returns the key of a gap.
+     *
+     * @param[in] reqmsg  Request for the missing block.
+     * @return            Product-index and number of the block in one word.
+     */
+    static uint64_t keyOf(const INLReqMsg& reqmsg)
+    {
+        return ((uint64_t)reqmsg.prodindex << 32) |
+                (uint32_t)(reqmsg.seqnum / FMTP_DATA_LEN);
+    }
+
+    const Clock::duration        delay;
+    /* every gap has the same delay, so they expire in order of addition */
+    std::deque<Gap>              gaps;
+    std::unordered_set<uint64_t> keys;
+};
+
+
+#endif /* FMTP_RECEIVER_REORDERWINDOW_H_ */
@@ -0,0 +1,267 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      RetxReqQueue.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the RetxReqQueue class.
+ *
+ * The queue is a ring of cells, each with a sequence number telling whether
+ * the cell is free for the producer holding a given position or holds the
+ * request of that position. Producers reserve a position with a CAS on
+ * `tail`; the single consumer owns `head`. The consumer only sleeps after
+ * announcing it in `sleeping`, and producers only take the mutex when they
+ * see that flag, so the common path is free of locks and system calls.
+ */
+
+
+#include "RetxReqQueue.h"
+
+#include <stdexcept>
+#include <thread>
+
+
+/* number of times pop() looks for requests before going to sleep */
+#define POP_SPINS 16
+
+/**
+ * Constructs an empty queue.
+ *
+ * @param[in] capacity  Maximum number of requests, a power of 2.
+ * @throws std::invalid_argument  if `capacity` isn't a power of 2.
+ */
+RetxReqQueue::RetxReqQueue(const size_t capacity)
+:
+    cells(NULL),
+    mask(capacity - 1),
+    head(0),
+    tail(0),
+    sleeping(false),
+    mutex(),
+    cond()
+{
+    if (capacity < 2 || (capacity & mask))
+        throw std::invalid_argument("RetxReqQueue::RetxReqQueue(): capacity "
+                "is not a power of 2");
+
+    cells = new Cell[capacity];
+    for (size_t i = 0; i < capacity; ++i)
+        cells[i].seq.store(i, std::memory_order_relaxed);
+}
+
+
+/**
+ * Destroys the queue.
+ */
+RetxReqQueue::~RetxReqQueue()
+{
+    delete[] cells;
+}
+
+
+/**
+ * Adds a request to the queue if there is room for it, and wakes up the
+ * consumer if it is waiting.
+ *
+ * @param[in] reqmsg  The request.
+ * @return            False if the queue is full.
+ */
+bool RetxReqQueue::tryPush(const INLReqMsg& reqmsg)
+{
+    size_t pos = tail.load(std::memory_order_relaxed);
+    Cell*  cell;
+
+    for (;;) {
+        cell = &cells[pos & mask];
+        const size_t   seq  = cell->seq.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->reqmsg = reqmsg;
+    cell->seq.store(pos + 1, std::memory_order_release);
+
+    /* pairs with the fence in pop(): either side sees the other's store */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.notify_one();
+    }
+    return true;
+}
+
+
+/**
+ * Adds a request to the queue. If the queue is full, yields until the
+ * consumer has made room; requests are never dropped.
+ *
+ * @param[in] reqmsg  The request.
+ */
+void RetxReqQueue::push(const INLReqMsg& reqmsg)
+{
+    while (!tryPush(reqmsg))
+        std::this_thread::yield();
+}
+
+
+/**
+ * Removes the requests at the head of the queue without blocking.
+ *
+ * @param[out] reqmsgs  The removed requests.
+ * @param[in]  max      Maximum number of requests to remove.
+ * @return              Number of removed requests.
+ */
+size_t RetxReqQueue::drain(INLReqMsg* const reqmsgs, const size_t max)
+{
+    size_t pos = head.load(std::memory_order_relaxed);
+    size_t n   = 0;
+
+    for (; n < max; ++n, ++pos) {
+        Cell& cell = cells[pos & mask];
+        if (cell.seq.load(std::memory_order_acquire) != pos + 1)
+            break;
+        reqmsgs[n] = cell.reqmsg;
+        cell.seq.store(pos + mask + 1, std::memory_order_release);
+    }
+    head.store(pos, std::memory_order_relaxed);
+    return n;
+}
+
+
+/**
+ * Removes the requests at the head of the queue. Blocks until at least one
+ * request is available.
+ *
+ * @param[out] reqmsgs  The removed requests, in order of addition.
+ * @param[in]  max      Maximum number of requests to remove.
+ * @return              Number of removed requests.
+ */
+size_t RetxReqQueue::pop(INLReqMsg* const reqmsgs, const size_t max)
+{
+    size_t n = drain(reqmsgs, max);
+    /* a burst of requests usually continues, so look again before sleeping */
+    for (int i = 0; n == 0 && max && i < POP_SPINS; ++i) {
+        std::this_thread::yield();
+        n = drain(reqmsgs, max);
+    }
+    if (n || max == 0)
+        return n;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while ((n = drain(reqmsgs, max)) == 0)
+        cond.wait(lock);
+    sleeping.store(false, std::memory_order_relaxed);
+    return n;
+}
+
+
+/**
+ * Removes the requests at the head of the queue. Blocks until at least one
+ * request is available or the deadline has passed.
+ *
+ * @param[out] reqmsgs   The removed requests, in order of addition.
+ * @param[in]  max       Maximum number of requests to remove.
+ * @param[in]  deadline  When to stop waiting.
+ * @return               Number of removed requests, 0 if the deadline has
+ *                       passed.
+ */
+size_t RetxReqQueue::pop(INLReqMsg* const reqmsgs, const size_t max,
+                         const std::chrono::steady_clock::time_point& deadline)
+{
+    size_t n = drain(reqmsgs, max);
+    if (n || max == 0)
+        return n;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while ((n = drain(reqmsgs, max)) == 0 &&
+            cond.wait_until(lock, deadline) == std::cv_status::no_timeout)
+        ;
+    sleeping.store(false, std::memory_order_relaxed);
+    return n;
+}
+
+
+/**
+ * Returns the number of requests in the queue.
+ *
+ * @return  The number of requests.
+ */
+size_t RetxReqQueue::size() const
+{
+    const size_t h = head.load(std::memory_order_relaxed);
+    const size_t t = tail.load(std::memory_order_relaxed);
+    return t > h ? t - h : 0;
+}
+
+
+/**
+ * Coalesces a batch of requests in place. A data request is merged into the
+ * preceding one if it continues it, and dropped if the preceding one already
+ * covers it. A BOP or EOP request is dropped if it repeats the preceding
+ * request. Merged requests are kept to whole blocks, so the sender, which
+ * splits a request into blocks, sends exactly the same packets as before.
+ *
+ * @param[in,out] reqmsgs  The requests.
+ * @param[in]     n        Number of requests.
+ * @return                 Number of requests after coalescing.
+ */
+size_t RetxReqQueue::coalesce(INLReqMsg* const reqmsgs, const size_t n)
+{
+    /* longest run of whole blocks a 16-bit payload length can describe */
+    static const uint32_t maxlen =
+            (UINT16_MAX / FMTP_DATA_LEN) * FMTP_DATA_LEN;
+    size_t                out    = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        const INLReqMsg& req = reqmsgs[i];
+        if (out) {
+            INLReqMsg& prev = reqmsgs[out - 1];
+            if (req.reqtype == prev.reqtype &&
+                    req.prodindex == prev.prodindex) {
+                if (req.reqtype != MISSING_DATA)
+                    continue;
+                const uint64_t end = prev.seqnum + prev.payloadlen;
+                if (req.seqnum >= prev.seqnum &&
+                        req.seqnum + req.payloadlen <= end)
+                    continue;
+                if (req.seqnum == end && prev.payloadlen % FMTP_DATA_LEN == 0
+                        && prev.payloadlen + req.payloadlen <= maxlen) {
+                    prev.payloadlen += req.payloadlen;
+                    continue;
+                }
+            }
+        }
+        reqmsgs[out++] = req;
+    }
+    return out;
+}
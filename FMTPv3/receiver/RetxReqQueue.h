@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      RetxReqQueue.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the RetxReqQueue class.
+ *
+ * A bounded multi-producer, single-consumer queue of internal retransmission
+ * requests. Producers (the multicast, retransmission and timer threads) never
+ * take a lock unless the consumer is asleep, and the consumer (the
+ * retransmission-request thread) removes requests in batches.
+ */
+
+
+#ifndef FMTP_RECEIVER_RETXREQQUEUE_H_
+#define FMTP_RECEIVER_RETXREQQUEUE_H_
+
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+#include "fmtpBase.h"
+
+
+class RetxReqQueue
+{
+public:
+    /**
+     * Constructs an empty queue.
+     *
+     * @param[in] capacity  Maximum number of requests, a power of 2.
+     * @throws std::invalid_argument  if `capacity` isn't a power of 2.
+     */
+    explicit RetxReqQueue(const size_t capacity = 65536);
+    ~RetxReqQueue();
+    /**
+     * Adds a request to the queue if there is room for it. Never blocks.
+     *
+     * @param[in] reqmsg  The request.
+     * @return            False if the queue is full.
+     */
+    bool tryPush(const INLReqMsg& reqmsg);
+    /**
+     * Adds a request to the queue. Only waits if the queue is full.
+     *
+     * @param[in] reqmsg  The request.
+     */
+    void push(const INLReqMsg& reqmsg);
+    /**
+     * Removes the requests at the head of the queue. Blocks until at least
+     * one request is available. Must only be called by one thread.
+     *
+     * @param[out] reqmsgs  The removed requests, in order of addition.
+     * @param[in]  max      Maximum number of requests to remove.
+     * @return              Number of removed requests.
+     */
+    size_t pop(INLReqMsg* const reqmsgs, const size_t max);
+    /**
+     * Removes the requests at the head of the queue. Blocks until at least
+     * one request is available or the deadline has passed. Must only be
+     * called by one thread.
+     *
+     * @param[out] reqmsgs   The removed requests, in order of addition.
+     * @param[in]  max       Maximum number of requests to remove.
+     * @param[in]  deadline  When to stop waiting.
+     * @return               Number of removed requests, 0 if the deadline has
+     *                       passed.
+     */
+    size_t pop(INLReqMsg* const reqmsgs, const size_t max,
+               const std::chrono::steady_clock::time_point& deadline);
+    /**
+     * Returns the number of requests in the queue. The value is only a
+     * snapshot if other threads use the queue.
+     *
+     * @return  The number of requests.
+     */
+    size_t size() const;
+    /**
+     * Coalesces a batch of requests in place. Requests for adjacent blocks of
+     * the same product are merged into one as long as the length fits into
+     * the 16-bit payload length of a request, and repeated requests are
+     * removed. The order of the remaining requests is kept.
+     *
+     * @param[in,out] reqmsgs  The requests.
+     * @param[in]     n        Number of requests.
+     * @return                 Number of requests after coalescing.
+     */
+    static size_t coalesce(INLReqMsg* const reqmsgs, const size_t n);
+
+private:
+    /* Prevent copying because it's meaningless */
+    RetxReqQueue(const RetxReqQueue&);
+    RetxReqQueue& operator=(const RetxReqQueue&);
+
+    struct Cell {
+        /* position for which the cell is writable or, +1, readable */
+        std::atomic<size_t> seq;
+        INLReqMsg           reqmsg;
+    };
+
+    /**
+     * Removes the requests at the head of the queue without blocking.
+     *
+     * @param[out] reqmsgs  The removed requests.
+     * @param[in]  max      Maximum number of requests to remove.
+     * @return              Number of removed requests.
+     */
+    size_t drain(INLReqMsg* const reqmsgs, const size_t max);
+
+    Cell*                   cells;
+    const size_t            mask;
+    /* head is only written by the consumer and tail by the producers, so
+     * they are kept on different cache lines */
+    std::atomic<size_t>     head;
+    char                    pad[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t>     tail;
+    /* set while the consumer waits for requests */
+    std::atomic<bool>       sleeping;
+    std::mutex              mutex;
+    std::condition_variable cond;
+};
+
+
+#endif /* FMTP_RECEIVER_RETXREQQUEUE_H_ */
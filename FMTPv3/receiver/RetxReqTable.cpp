@@ -0,0 +1,218 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      RetxReqTable.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the RetxReqTable class.
+ */
+
+
+#include "RetxReqTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+/**
+ * Constructs an empty table.
+ *
+ * @param[in] timeout     Time to the first retry of a request in seconds.
+ * @param[in] maxTimeout  Limit of the time between retries in seconds.
+ * @throws std::invalid_argument  if `timeout` isn't positive or `maxTimeout`
+ *                                is less than `timeout`.
+ */
+RetxReqTable::RetxReqTable(const double timeout, const double maxTimeout)
+:
+    timeout(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(timeout))),
+    maxTimeout(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(maxTimeout))),
+    prods(),
+    deadlines(),
+    count(0)
+{
+    if (!(timeout > 0) || maxTimeout < timeout)
+        throw std::invalid_argument("RetxReqTable::RetxReqTable(): invalid "
+                "timeout");
+}
+
+
+/**
+ * Adds a request which is about to be sent and schedules its first retry. A
+ * stale request, i.e. one returned by `expire()` and not yet retried, counts
+ * as outstanding as well.
+ *
+ * @param[in] reqmsg  The request, for one packet.
+ * @param[in] now     Current time.
+ * @return            False if the same request is outstanding, in which case
+ *                    it shouldn't be sent.
+ */
+bool RetxReqTable::add(const INLReqMsg& reqmsg, const Clock::time_point& now)
+{
+    ProdReqs&                                 reqs = prods[reqmsg.prodindex];
+    const std::pair<ProdReqs::iterator, bool> ins  =
+            reqs.insert(ProdReqs::value_type(keyOf(reqmsg), Entry()));
+    if (!ins.second)
+        return false;
+
+    Entry& entry   = ins.first->second;
+    entry.reqmsg   = reqmsg;
+    entry.timeout  = timeout;
+    entry.deadline = deadlines.end();
+    schedule(entry, now);
+    ++count;
+    return true;
+}
+
+
+/**
+ * Removes the requests whose timeout has passed from the schedule, oldest
+ * deadline first. They stay in the table until they are retried or removed.
+ *
+ * @param[in]  now      Current time.
+ * @param[out] reqmsgs  The stale requests.
+ * @param[in]  max      Maximum number of requests to return.
+ * @return              Number of returned requests.
+ */
+size_t RetxReqTable::expire(const Clock::time_point& now,
+                            INLReqMsg* const         reqmsgs,
+                            const size_t             max)
+{
+    size_t n = 0;
+
+    while (n < max && !deadlines.empty() && deadlines.begin()->first <= now) {
+        const std::pair<uint32_t, Key>& ref = deadlines.begin()->second;
+        Entry& entry   = prods.find(ref.first)->second.find(ref.second)->second;
+        entry.deadline = deadlines.end();
+        reqmsgs[n++]   = entry.reqmsg;
+        deadlines.erase(deadlines.begin());
+    }
+    return n;
+}
+
+
+/**
+ * Schedules a stale request again with twice the previous timeout, but no
+ * more than the limit.
+ *
+ * @param[in] reqmsg  The request returned by `expire()`.
+ * @param[in] now     Current time.
+ */
+void RetxReqTable::retry(const INLReqMsg& reqmsg, const Clock::time_point& now)
+{
+    Entry* const entry = find(reqmsg);
+
+    if (entry) {
+        entry->timeout = std::min(2 * entry->timeout, maxTimeout);
+        schedule(*entry, now);
+    }
+}
+
+
+/**
+ * Removes a request.
+ *
+ * @param[in] reqmsg  The request.
+ */
+void RetxReqTable::remove(const INLReqMsg& reqmsg)
+{
+    std::unordered_map<uint32_t, ProdReqs>::iterator prod =
+            prods.find(reqmsg.prodindex);
+    if (prod == prods.end())
+        return;
+
+    ProdReqs::iterator req = prod->second.find(keyOf(reqmsg));
+    if (req != prod->second.end()) {
+        if (req->second.deadline != deadlines.end())
+            deadlines.erase(req->second.deadline);
+        prod->second.erase(req);
+        --count;
+    }
+    if (prod->second.empty())
+        prods.erase(prod);
+}
+
+
+/**
+ * Removes all the requests of a product, e.g. because the product is done.
+ *
+ * @param[in] prodindex  Index of the product.
+ */
+void RetxReqTable::forget(const uint32_t prodindex)
+{
+    std::unordered_map<uint32_t, ProdReqs>::iterator prod =
+            prods.find(prodindex);
+    if (prod == prods.end())
+        return;
+
+    for (ProdReqs::iterator req = prod->second.begin();
+            req != prod->second.end(); ++req) {
+        if (req->second.deadline != deadlines.end())
+            deadlines.erase(req->second.deadline);
+    }
+    count -= prod->second.size();
+    prods.erase(prod);
+}
+
+
+/**
+ * Returns the earliest deadline of the scheduled requests.
+ *
+ * @pre     The table has scheduled requests.
+ * @return  The earliest deadline.
+ */
+RetxReqTable::Clock::time_point RetxReqTable::nextDeadline() const
+{
+    return deadlines.begin()->first;
+}
+
+
+/**
+ * Schedules a request `entry.timeout` from now.
+ *
+ * @param[in,out] entry  The request.
+ * @param[in]     now    Current time.
+ */
+void RetxReqTable::schedule(Entry& entry, const Clock::time_point& now)
+{
+    if (entry.deadline != deadlines.end())
+        deadlines.erase(entry.deadline);
+    entry.deadline = deadlines.insert(Deadlines::value_type(
+            now + entry.timeout,
+            std::make_pair(entry.reqmsg.prodindex, keyOf(entry.reqmsg))));
+}
+
+
+/**
+ * Returns the entry of a request.
+ *
+ * @param[in] reqmsg  The request.
+ * @return            The entry or NULL if the request isn't in the table.
+ */
+RetxReqTable::Entry* RetxReqTable::find(const INLReqMsg& reqmsg)
+{
+    std::unordered_map<uint32_t, ProdReqs>::iterator prod =
+            prods.find(reqmsg.prodindex);
+    if (prod == prods.end())
+        return NULL;
+
+    ProdReqs::iterator req = prod->second.find(keyOf(reqmsg));
+    return req == prod->second.end() ? NULL : &req->second;
+}
@@ -0,0 +1,164 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      RetxReqTable.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the RetxReqTable class.
+ *
+ * Remembers the retransmission requests a receiver has sent, per product, so
+ * that a packet which is already requested isn't requested again, and a
+ * request which got no answer in time, e.g. because it was lost with a TCP
+ * connection, is sent again. The timeout of a request doubles with every
+ * retry up to a limit. Used by the retransmission-request thread only.
+ */
+
+
+#ifndef FMTP_RECEIVER_RETXREQTABLE_H_
+#define FMTP_RECEIVER_RETXREQTABLE_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "fmtpBase.h"
+
+
+class RetxReqTable
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Constructs an empty table.
+     *
+     * @param[in] timeout     Time to the first retry of a request in seconds.
+     * @param[in] maxTimeout  Limit of the time between retries in seconds.
+     * @throws std::invalid_argument  if `timeout` isn't positive or
+     *                                `maxTimeout` is less than `timeout`.
+     */
+    RetxReqTable(const double timeout, const double maxTimeout);
+    /**
+     * Adds a request which is about to be sent.
+     *
+     * @param[in] reqmsg  The request, for one packet.
+     * @param[in] now     Current time.
+     * @return            False if the same request is outstanding, in which
+     *                    case it shouldn't be sent.
+     */
+    bool add(const INLReqMsg& reqmsg, const Clock::time_point& now);
+    /**
+     * Removes the requests whose timeout has passed from the schedule, oldest
+     * deadline first. Each must then be passed to `retry()` or `remove()`.
+     *
+     * @param[in]  now      Current time.
+     * @param[out] reqmsgs  The stale requests.
+     * @param[in]  max      Maximum number of requests to return.
+     * @return              Number of returned requests.
+     */
+    size_t expire(const Clock::time_point& now, INLReqMsg* const reqmsgs,
+                  const size_t max);
+    /**
+     * Schedules a stale request again with twice the previous timeout.
+     *
+     * @param[in] reqmsg  The request returned by `expire()`.
+     * @param[in] now     Current time.
+     */
+    void retry(const INLReqMsg& reqmsg, const Clock::time_point& now);
+    /**
+     * Removes a request.
+     *
+     * @param[in] reqmsg  The request.
+     */
+    void remove(const INLReqMsg& reqmsg);
+    /**
+     * Removes all the requests of a product.
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void forget(const uint32_t prodindex);
+    /**
+     * Returns the earliest deadline of the scheduled requests.
+     *
+     * @pre     The table has scheduled requests.
+     * @return  The earliest deadline.
+     */
+    Clock::time_point nextDeadline() const;
+    bool hasDeadline() const {return !deadlines.empty();}
+    size_t size() const {return count;}
+
+private:
+    /* Prevent copying because it's meaningless */
+    RetxReqTable(const RetxReqTable&);
+    RetxReqTable& operator=(const RetxReqTable&);
+
+    /* request within its product: reqtype and number of the block */
+    typedef uint64_t Key;
+    /* product-index and key of every scheduled request */
+    typedef std::multimap<Clock::time_point, std::pair<uint32_t, Key> >
+            Deadlines;
+
+    struct Entry {
+        INLReqMsg           reqmsg;
+        Clock::duration     timeout;
+        /* position in `deadlines`, end() while the request is stale */
+        Deadlines::iterator deadline;
+    };
+    typedef std::unordered_map<Key, Entry> ProdReqs;
+
+    /**
+     * Returns the key of a request within its product. Requested data starts
+     * at a block, so the number of the block identifies it.
+     *
+     * @param[in] reqmsg  The request.
+     * @return            The key.
+     */
+    static Key keyOf(const INLReqMsg& reqmsg)
+    {
+        return ((uint64_t)reqmsg.reqtype << 32) |
+                (uint32_t)(reqmsg.seqnum / FMTP_DATA_LEN);
+    }
+    /**
+     * Schedules a request.
+     *
+     * @param[in,out] entry  The request.
+     * @param[in]     now    Current time.
+     */
+    void schedule(Entry& entry, const Clock::time_point& now);
+    /**
+     * Returns the entry of a request.
+     *
+     * @param[in] reqmsg  The request.
+     * @return            The entry or NULL if the request isn't in the table.
+     */
+    Entry* find(const INLReqMsg& reqmsg);
+
+    const Clock::duration                  timeout;
+    const Clock::duration                  maxTimeout;
+    std::unordered_map<uint32_t, ProdReqs> prods;
+    Deadlines                              deadlines;
+    size_t                                 count;
+};
+
+
+#endif /* FMTP_RECEIVER_RETXREQTABLE_H_ */
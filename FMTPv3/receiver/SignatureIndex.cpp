@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      SignatureIndex.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the SignatureIndex class.
+ */
+
+
+#include "SignatureIndex.h"
+
+#include <stdexcept>
+
+
+/**
+ * Constructs an empty index.
+ *
+ * @param[in] capacity  Number of signatures kept.
+ * @throws std::invalid_argument  if `capacity` is 0.
+ */
+SignatureIndex::SignatureIndex(const size_t capacity)
+:
+    capacity(capacity),
+    mutex(),
+    sigs(),
+    order()
+{
+    if (capacity == 0)
+        throw std::invalid_argument("SignatureIndex::SignatureIndex(): "
+                "empty index");
+    sigs.reserve(capacity);
+}
+
+
+/**
+ * Tells whether a signature is known. Thread-safe.
+ *
+ * @param[in] sig  The signature.
+ * @param[in] len  Length of the signature in bytes.
+ * @return         True if the signature is known.
+ */
+bool SignatureIndex::contains(const void* const sig, const size_t len) const
+{
+    const std::string            key((const char*)sig, len);
+    std::unique_lock<std::mutex> lock(mutex);
+    return sigs.count(key) > 0;
+}
+
+
+/**
+ * Adds a signature, typically once a product is completely received. The
+ * oldest signature is forgotten if the index is full. Thread-safe.
+ *
+ * @param[in] sig  The signature.
+ * @param[in] len  Length of the signature in bytes.
+ * @return         False if the signature was already known.
+ */
+bool SignatureIndex::insert(const void* const sig, const size_t len)
+{
+    const std::string            key((const char*)sig, len);
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!sigs.insert(key).second)
+        return false;
+    order.push_back(key);
+    if (order.size() > capacity) {
+        (void)sigs.erase(order.front());
+        order.pop_front();
+    }
+    return true;
+}
+
+
+/**
+ * Returns the number of signatures kept. Thread-safe.
+ *
+ * @return  The number of signatures.
+ */
+size_t SignatureIndex::size() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return sigs.size();
+}
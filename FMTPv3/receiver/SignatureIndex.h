@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      SignatureIndex.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the SignatureIndex class.
+ *
+ * Remembers the signatures, e.g. MD5 checksums, of the most recently received
+ * products, so that a receiving application can tell in
+ * `RecvProxy::is_duplicate()` whether it already holds a product announced
+ * by a BOP.
+ */
+
+
+#ifndef FMTP_RECEIVER_SIGNATUREINDEX_H_
+#define FMTP_RECEIVER_SIGNATUREINDEX_H_
+
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+
+class SignatureIndex
+{
+public:
+    /**
+     * Constructs an empty index.
+     *
+     * @param[in] capacity  Number of signatures kept.
+     * @throws std::invalid_argument  if `capacity` is 0.
+     */
+    explicit SignatureIndex(const size_t capacity);
+    /**
+     * Tells whether a signature is known.
+     *
+     * @param[in] sig  The signature.
+     * @param[in] len  Length of the signature in bytes.
+     * @return         True if the signature is known.
+     */
+    bool contains(const void* const sig, const size_t len) const;
+    /**
+     * Adds a signature. The oldest one is forgotten if the index is full.
+     *
+     * @param[in] sig  The signature.
+     * @param[in] len  Length of the signature in bytes.
+     * @return         False if the signature was already known.
+     */
+    bool insert(const void* const sig, const size_t len);
+    size_t size() const;
+
+private:
+    /* Prevent copying because it's meaningless */
+    SignatureIndex(const SignatureIndex&);
+    SignatureIndex& operator=(const SignatureIndex&);
+
+    const size_t                    capacity;
+    mutable std::mutex              mutex;
+    std::unordered_set<std::string> sigs;
+    /* signatures in the order of insertion */
+    std::deque<std::string>         order;
+};
+
+
+#endif /* FMTP_RECEIVER_SIGNATUREINDEX_H_ */
@@ -50,7 +50,8 @@
  *                              byte-order.
  */
 TcpRecv::TcpRecv(const std::string& tcpaddr, unsigned short tcpport)
-    : tcpAddr(tcpaddr), tcpPort(tcpport), servAddr()
+    : servAddr(), tcpAddr(tcpaddr), tcpPort(tcpport), rbuf(),
+      sendmtx()
 {
 }
 
@@ -88,7 +89,8 @@ void TcpRecv::Init()
 /**
  * Receives a header and a payload on the TCP connection. Blocks until a
  * complete packet is received, the end-of-file is encountered, or an error
- * occurs.
+ * occurs. Both are read through the receive buffer of the connection, so a
+ * burst of retransmitted packets costs few `recv()` calls.
  *
  * @param[in] header   Header.
  * @param[in] headLen  Length of the header in bytes.
@@ -105,13 +107,13 @@ size_t TcpRecv::recvData(void* header, size_t headLen, char* payload,
     size_t nread;
 
     if (header && headLen) {
-        nread = recvall(header, headLen);
+        nread = recvbuffered(sockfd, rbuf, header, headLen);
         if (nread < headLen)
             return 0; // EOF
     }
 
     if (payload && payLen) {
-        nread = recvall(payload, payLen);
+        nread = recvbuffered(sockfd, rbuf, payload, payLen);
         if (nread < payLen)
             return 0; // EOF
     }
@@ -122,7 +124,9 @@ size_t TcpRecv::recvData(void* header, size_t headLen, char* payload,
 
 /**
  * Sends a header and a payload on the TCP connection. Blocks until the packet
- * is sent or a severe error occurs.
+ * is sent or a severe error occurs. Several threads send requests, so the
+ * packet is written with one `writev()` while the other senders wait, which
+ * keeps it from being split by another packet.
  *
  * @param[in] header   Header.
  * @param[in] headLen  Length of the header in bytes.
@@ -134,8 +138,14 @@ size_t TcpRecv::recvData(void* header, size_t headLen, char* payload,
 ssize_t TcpRecv::sendData(void* header, size_t headLen, char* payload,
                           size_t payLen)
 {
-    sendall(header, headLen);
-    sendall(payload, payLen);
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len  = headLen;
+    iov[1].iov_base = payload;
+    iov[1].iov_len  = payLen;
+
+    std::lock_guard<std::mutex> lock(sendmtx);
+    sendallv(sockfd, iov, payLen ? 2 : 1);
 
     return (headLen + payLen);
 }
@@ -150,6 +160,7 @@ ssize_t TcpRecv::sendData(void* header, size_t headLen, char* payload,
  */
 void TcpRecv::initSocket()
 {
+    rbuf.reset();
     sockfd = socket(AF_INET, SOCK_STREAM, 0);
 
     if (sockfd < 0)
@@ -60,9 +60,10 @@ public:
     size_t recvData(void* header, size_t headLen, char* payload,
                      size_t payLen);
     /**
-     * Sends a header and a payload on the TCP connection. Blocks until the packet
-     * is sent or a severe error occurs. Re-establishes the TCP connection if
-     * necessary.
+     * Sends a header and a payload on the TCP connection as one write, so that
+     * packets which several threads send concurrently don't interleave.
+     * Blocks until the packet is sent or a severe error occurs.
+     * Re-establishes the TCP connection if necessary.
      *
      * @param[in] header   Header.
      * @param[in] headLen  Length of the header in bytes.
@@ -73,6 +74,12 @@ public:
      */
     ssize_t sendData(void* header, size_t headLen, char* payload,
                      size_t payLen);
+    /**
+     * Returns the number of `recv()` calls made on the TCP connection.
+     *
+     * @return             The number of calls.
+     */
+    uint64_t getRecvCalls() const {return rbuf.getRecvCalls();}
 
 private:
     /**
@@ -86,6 +93,10 @@ private:
     struct sockaddr_in      servAddr;
     std::string             tcpAddr;  /* a copy of the passed-in tcpAddr */
     unsigned short          tcpPort;  /* a copy of the passed-in tcpPort */
+    /* only used by the retransmission thread, which reads all the packets */
+    TcpRecvBuffer           rbuf;
+    /* serializes the packets sent by different threads */
+    std::mutex              sendmtx;
 };
 
 
@@ -0,0 +1,258 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      TimingWheel.cpp
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the entity of the TimingWheel class.
+ *
+ * A deadline is hashed into the slot of its tick number modulo the number of
+ * slots. Each time the wheel turns, the slots the cursor passes are scanned
+ * and the entries which are due are moved to a ready-queue. Entries which are
+ * more than one turn away simply stay in their slot.
+ */
+
+
+#include "TimingWheel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+/**
+ * Constructs an instance.
+ *
+ * @param[in] tick    Resolution of the wheel in seconds.
+ * @param[in] nslots  Number of slots of the wheel.
+ * @throws std::invalid_argument  if `tick` or `nslots` isn't positive.
+ */
+TimingWheel::TimingWheel(const double tick, const size_t nslots)
+:
+    mutex(),
+    cond(),
+    epoch(Clock::now()),
+    tick(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(tick))),
+    slots(nslots),
+    pending(),
+    ready(),
+    cursor(0),
+    disabled(false)
+{
+    if (this->tick.count() <= 0 || nslots == 0)
+        throw std::invalid_argument("TimingWheel::TimingWheel(): invalid "
+                "tick or number of slots");
+}
+
+
+/**
+ * Returns the tick number of a time point, rounded up so that a deadline never
+ * expires early.
+ *
+ * @param[in] time  The time point.
+ * @return          The tick number.
+ */
+uint64_t TimingWheel::tickOf(const Clock::time_point& time) const
+{
+    if (time <= epoch)
+        return 0;
+    return (time - epoch + tick - Clock::duration(1)) / tick;
+}
+
+
+/**
+ * Moves the expired deadlines of all the slots passed since the last call to
+ * the ready-queue. A slot is visited at most once per call even if the wheel
+ * has turned more than once.
+ *
+ * @pre        The instance is locked.
+ * @param[in]  now  Current tick number.
+ */
+void TimingWheel::advance(const uint64_t now)
+{
+    if (now <= cursor)
+        return;
+
+    const uint64_t nslots = slots.size();
+    const uint64_t steps  = std::min(now - cursor, nslots);
+    for (uint64_t i = 1; i <= steps && !pending.empty(); ++i) {
+        std::list<Entry>& slot = slots[(cursor + i) % nslots];
+        for (std::list<Entry>::iterator it = slot.begin(); it != slot.end();) {
+            if (it->expiry <= now) {
+                ready.push_back(it->index);
+                pending.erase(it->index);
+                it = slot.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+    cursor = now;
+}
+
+
+/**
+ * Adds a deadline for a product-index. An existing deadline of the same
+ * product-index is replaced.
+ *
+ * @param[in] index    The product-index.
+ * @param[in] seconds  The duration, in seconds, until the deadline. May be
+ *                     negative.
+ * @throws std::runtime_error  if the wheel is disabled.
+ */
+void TimingWheel::push(const uint32_t index, const double seconds)
+{
+    const Clock::time_point when = Clock::now() +
+            std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds));
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (disabled)
+        throw std::runtime_error("TimingWheel::push(): wheel is disabled");
+
+    advance(tickOf(Clock::now()));
+    (void)cancelLocked(index);
+
+    const uint64_t expiry = tickOf(when);
+    if (expiry <= cursor) {
+        ready.push_back(index);
+    }
+    else {
+        const size_t      slot  = expiry % slots.size();
+        const Entry       entry = {index, expiry};
+        Location          loc   = {slot, slots[slot].insert(
+                slots[slot].end(), entry)};
+        pending[index] = loc;
+    }
+    cond.notify_all();
+}
+
+
+/**
+ * Cancels the deadline of a product-index.
+ *
+ * @param[in] index    The product-index.
+ * @retval    true     If the deadline was pending and is cancelled.
+ * @retval    false    If there was no pending deadline.
+ */
+bool TimingWheel::cancel(const uint32_t index)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return cancelLocked(index);
+}
+
+
+/**
+ * Cancels the deadline of a product-index, including one which has expired
+ * but hasn't been returned by pop() yet.
+ *
+ * @pre                The instance is locked.
+ * @param[in] index    The product-index.
+ * @retval    true     If the deadline was pending and is cancelled.
+ * @retval    false    If there was no pending deadline.
+ */
+bool TimingWheel::cancelLocked(const uint32_t index)
+{
+    std::unordered_map<uint32_t, Location>::iterator it = pending.find(index);
+    if (it != pending.end()) {
+        slots[it->second.slot].erase(it->second.iter);
+        pending.erase(it);
+        return true;
+    }
+
+    std::deque<uint32_t>::iterator pos =
+            std::find(ready.begin(), ready.end(), index);
+    if (pos != ready.end()) {
+        ready.erase(pos);
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * Returns the tick number of the next non-empty slot. The deadlines in it
+ * might be due in a later turn, in which case pop() just goes back to sleep.
+ *
+ * @pre        The instance is locked and has pending deadlines.
+ * @return     The tick number of the next non-empty slot.
+ */
+uint64_t TimingWheel::nextTick() const
+{
+    const uint64_t nslots = slots.size();
+    for (uint64_t i = 1; i < nslots; ++i) {
+        if (!slots[(cursor + i) % nslots].empty())
+            return cursor + i;
+    }
+    return cursor + nslots;
+}
+
+
+/**
+ * Returns a product-index whose deadline has expired and removes it. Blocks
+ * until such a product-index exists.
+ *
+ * @return  The product-index.
+ * @throws std::runtime_error  if the wheel is disabled.
+ */
+uint32_t TimingWheel::pop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        if (disabled)
+            throw std::runtime_error("TimingWheel::pop(): wheel is disabled");
+
+        advance(tickOf(Clock::now()));
+        if (!ready.empty()) {
+            const uint32_t index = ready.front();
+            ready.pop_front();
+            return index;
+        }
+
+        if (pending.empty())
+            cond.wait(lock);
+        else
+            cond.wait_until(lock, epoch + tick * nextTick());
+    }
+}
+
+
+/**
+ * Returns the number of pending and expired deadlines.
+ *
+ * @return  The number of deadlines.
+ */
+size_t TimingWheel::size()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return pending.size() + ready.size();
+}
+
+
+/**
+ * Disables the wheel. After this call, both `push()` and `pop()` will fail.
+ */
+void TimingWheel::disable() noexcept
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    disabled = true;
+    cond.notify_all();
+}
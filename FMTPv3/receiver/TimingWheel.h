@@ -0,0 +1,155 @@
+/**
+ * Copyright (C) 2026 University of Virginia. All rights reserved.
+ *
+ * @file      TimingWheel.h
+ * @version   1.0
+ * @date      Oct 18, 2026
+ *
+ * @section   LICENSE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @brief     Define the interfaces of the TimingWheel class.
+ *
+ * A thread-safe hashed timing wheel of product-index deadlines. Any number of
+ * deadlines can be pending at the same time, adding and cancelling one takes
+ * constant time, and expired deadlines are returned in the order they expire
+ * (to the resolution of one tick).
+ */
+
+
+#ifndef FMTP_RECEIVER_TIMINGWHEEL_H_
+#define FMTP_RECEIVER_TIMINGWHEEL_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+class TimingWheel {
+public:
+    /**
+     * Constructs an instance.
+     *
+     * @param[in] tick    Resolution of the wheel in seconds.
+     * @param[in] nslots  Number of slots of the wheel. Deadlines further than
+     *                    `tick * nslots` seconds away take more than one turn.
+     * @throws std::invalid_argument  if `tick` or `nslots` isn't positive.
+     */
+    explicit TimingWheel(double tick = 0.001, size_t nslots = 1024);
+    /**
+     * Adds a deadline for a product-index. An existing deadline of the same
+     * product-index is replaced.
+     *
+     * @param[in] index    The product-index.
+     * @param[in] seconds  The duration, in seconds, until the deadline. May be
+     *                     negative.
+     * @throws std::runtime_error  if the wheel is disabled.
+     */
+    void push(uint32_t index, double seconds);
+    /**
+     * Cancels the deadline of a product-index.
+     *
+     * @param[in] index    The product-index.
+     * @retval    true     If the deadline was pending and is cancelled.
+     * @retval    false    If there was no pending deadline.
+     */
+    bool cancel(uint32_t index);
+    /**
+     * Returns a product-index whose deadline has expired and removes it.
+     * Blocks until such a product-index exists.
+     *
+     * @return  The product-index.
+     * @throws std::runtime_error  if the wheel is disabled.
+     */
+    uint32_t pop();
+    /**
+     * Returns the number of pending and expired deadlines.
+     *
+     * @return  The number of deadlines.
+     */
+    size_t size();
+    /**
+     * Disables the wheel. After this call, both `push()` and `pop()` will
+     * fail.
+     */
+    void disable() noexcept;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        uint32_t index;
+        /* absolute tick number of the deadline */
+        uint64_t expiry;
+    };
+    struct Location {
+        size_t                     slot;
+        std::list<Entry>::iterator iter;
+    };
+
+    /**
+     * Returns the tick number of a time point, rounded up.
+     *
+     * @param[in] time  The time point.
+     * @return          The tick number.
+     */
+    uint64_t tickOf(const Clock::time_point& time) const;
+    /**
+     * Moves the expired deadlines of all the slots passed since the last call
+     * to the ready-queue.
+     *
+     * @pre        The instance is locked.
+     * @param[in]  now  Current tick number.
+     */
+    void advance(uint64_t now);
+    /**
+     * Cancels the deadline of a product-index.
+     *
+     * @pre                The instance is locked.
+     * @param[in] index    The product-index.
+     * @return             Whether a deadline is cancelled.
+     */
+    bool cancelLocked(uint32_t index);
+    /**
+     * Returns the tick number of the next non-empty slot.
+     *
+     * @pre        The instance is locked and has pending deadlines.
+     * @return     The tick number.
+     */
+    uint64_t nextTick() const;
+
+    std::mutex                             mutex;
+    std::condition_variable                cond;
+    const Clock::time_point                epoch;
+    const Clock::duration                  tick;
+    std::vector<std::list<Entry> >         slots;
+    /* where each pending deadline is, for constant-time cancellation */
+    std::unordered_map<uint32_t, Location> pending;
+    /* expired product-indexes not yet returned by pop() */
+    std::deque<uint32_t>                   ready;
+    /* tick number up to which slots have been processed */
+    uint64_t                               cursor;
+    bool                                   disabled;
+};
+
+
+#endif /* FMTP_RECEIVER_TIMINGWHEEL_H_ */
@@ -37,17 +37,32 @@
 #include <math.h>
 #include <memory.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
 #include <utility>
+#include <vector>
 #include <fstream>
 #include <iostream>
 #include <system_error>
 
 #define Frcv 20
+/* maximum number of retx requests the request thread handles at a time */
+#define RETX_REQ_BATCH 256
+/* seconds after which an unanswered retx request is sent again */
+#define RETX_TIMEOUT     1.0
+/* upper limit of the doubling time between retries of a request */
+#define RETX_MAX_TIMEOUT 16.0
+/* most products whose missed BOPs wait to be requested */
+#define BOP_BACKLOG_LIMIT (1U << 20)
+/* seconds of multicast traffic the socket buffer should hold */
+#define RCVBUF_SECONDS 0.1
+/* upper limit of the automatic size of the socket buffer */
+#define RCVBUF_MAX     (256 << 20)
 
 
 /**
@@ -74,34 +89,57 @@ fmtpRecvv3::fmtpRecvv3(
     tcpPort(tcpPort),
     mcastAddr(mcastAddr),
     mcastPort(mcastPort),
+    ifAddr(ifAddr),
+    mcastSock(0),
+    retxSock(0),
     mcastgroup(),
     mreq(),
     prodidx_mcast(0xFFFFFFFF),
-    ifAddr(ifAddr),
-    tcprecv(new TcpRecv(tcpAddr, tcpPort)),
+    lastMcastProd(0),
+    poller(NULL),
+    accept(),
+    prodfilter(NULL),
+    busyPollUsecs(0),
+    reorderDelay(0),
+    fifoPriority(0),
+    rcvbufSize(0),
+    blocksLost(0),
+    reorderedBlocks(0),
+    eopsInferred(0),
+    duplicateReqs(0),
+    retriedReqs(0),
+    bopsLost(0),
+    lossyProds(0),
+    sockLossProds(0),
     notifier(notifier),
-    mcastSock(0),
-    retxSock(0),
-    pSegMNG(new ProdSegMNG()),
-    msgQfilled(),
-    msgQmutex(),
-    BOPSetMtx(),
-    exitMutex(),
-    exitCond(),
-    stopRequested(false),
-    except(),
+    tcprecv(new TcpRecv(tcpAddr, tcpPort)),
+    prodtable(new ProdTable()),
+    filesink(NULL),
+    dispatcher(NULL),
+    bufpool(NULL),
+    bopBacklog(MAX_BOP_RANGE, RETX_TIMEOUT, BOP_BACKLOG_LIMIT),
+    ackBatch(NULL),
+    wide(false),
     retx_rq(),
     retx_t(),
     mcast_t(),
     timer_t(),
+    eopTimers(),
+    exitMutex(),
+    exitCond(),
+    stopRequested(false),
+    except(),
     //linkspeed(0),
-    /* Coverity Scan #1: Issue #2. Initialize notifyprodidx to 0 for product index */
-    notifyprodidx(0),
     linkspeed(20000000),
+    linkrate(),
     retxHandlerCanceled(ATOMIC_FLAG_INIT),
     mcastHandlerCanceled(ATOMIC_FLAG_INIT),
+    /* Coverity Scan #1: Issue #2. Initialize notifyprodidx to 0 for product index */
+    notifyprodidx(0),
     measure(new Measure())
 {
+    for (int i = 0; i < THREAD_COUNT; ++i)
+        threadCpu[i] = -1;
 }
 
 
@@ -113,18 +151,19 @@ fmtpRecvv3::fmtpRecvv3(
 fmtpRecvv3::~fmtpRecvv3()
 {
     Stop();
+    /* the filter is detached while the socket is still open */
+    delete prodfilter;
     close(mcastSock);
+    delete poller;
     (void)close(retxSock); // failure is irrelevant
-    {
-        std::unique_lock<std::mutex> lock(BOPSetMtx);
-        misBOPset.clear();
-    }
-    {
-        std::unique_lock<std::mutex> lock(trackermtx);
-        trackermap.clear();
-    }
     delete tcprecv;
-    delete pSegMNG;
+    delete prodtable;
+    /* finishes the files of completed products */
+    delete filesink;
+    /* delivers the waiting notifications, which may release buffers */
+    delete dispatcher;
+    delete bufpool;
+    delete ackBatch;
     delete measure;
 }
 
@@ -142,13 +181,171 @@ uint32_t fmtpRecvv3::getNotify()
 }
 
 
+/**
+ * Returns the statistics of the notification stage: the depth of the queue of
+ * the notification dispatcher and the state of the buffer pool.
+ *
+ * @return  The statistics, 0 for the parts which aren't set up.
+ */
+NotifyStats fmtpRecvv3::getNotifyStats() const
+{
+    NotifyStats stats = {};
+    if (dispatcher)
+        stats = dispatcher->getStats();
+    if (bufpool) {
+        stats.buffersFree  = bufpool->available();
+        stats.bufferMisses = bufpool->getMisses();
+    }
+    return stats;
+}
+
+
+/**
+ * Returns the loss statistics of the multicast reception. Comparing the
+ * products which lost blocks with those that lost them while the socket
+ * dropped datagrams tells losses on the network from losses in the host.
+ * Thread-safe.
+ *
+ * @return  The statistics.
+ */
+LossStats fmtpRecvv3::getLossStats() const
+{
+    LossStats stats = {};
+    stats.socketDrops        = socketDrops();
+    stats.blocksLost         = blocksLost.load(std::memory_order_relaxed);
+    stats.reorderedBlocks    = reorderedBlocks.load(
+            std::memory_order_relaxed);
+    stats.eopsInferred       = eopsInferred.load(std::memory_order_relaxed);
+    stats.duplicateReqs      = duplicateReqs.load(std::memory_order_relaxed);
+    stats.retriedReqs        = retriedReqs.load(std::memory_order_relaxed);
+    stats.bopsLost           = bopsLost.load(std::memory_order_relaxed);
+    stats.lossyProducts      = lossyProds.load(std::memory_order_relaxed);
+    stats.socketLossProducts = sockLossProds.load(std::memory_order_relaxed);
+    stats.filteredProducts   = prodfilter ? prodfilter->getRejected() : 0;
+    stats.rcvbufSize         = rcvbufSize;
+    stats.dropsCounted       = poller && poller->dropsCounted();
+    return stats;
+}
+
+
+/**
+ * Returns the link speed which the EOP deadlines of new products are based on.
+ * The arrival rate of the multicast is estimated continuously from the
+ * receive timestamps of its packets and capped by the send rate which the
+ * sender may announce in its BOPs. The speed set by `SetLinkSpeed()` only
+ * stands in until there is an estimate. Thread-safe.
+ *
+ * @return  The link speed in bits per second.
+ */
+uint64_t fmtpRecvv3::getLinkSpeed() const
+{
+    const uint64_t estimate = linkrate.get();
+    if (estimate)
+        return estimate;
+    std::unique_lock<std::mutex> lock(linkmtx);
+    return linkspeed;
+}
+
+
+/**
+ * Returns a buffer of the buffer pool which the receiving application kept in
+ * `notify_of_bop()`, after it is done with the product. Thread-safe.
+ *
+ * @param[in] buf                 The buffer.
+ * @throw std::invalid_argument  if there is no buffer pool or `buf` isn't a
+ *                               buffer of it.
+ */
+void fmtpRecvv3::releaseBuffer(void* const buf)
+{
+    if (!bufpool)
+        throw std::invalid_argument("fmtpRecvv3::releaseBuffer(): no buffer "
+                "pool");
+    bufpool->put(buf);
+}
+
+
+/**
+ * Reserves buffers which are offered to the receiving application in
+ * `notify_of_bop()`, so that the multicast thread doesn't wait for the
+ * application to allocate memory. A product that doesn't fit into a buffer,
+ * or arrives while all of them are in use, is offered none. Must be called
+ * before `Start()`.
+ *
+ * @param[in] bufsize  Size of a buffer in bytes.
+ * @param[in] count    Number of buffers.
+ * @throw std::invalid_argument  if `bufsize` or `count` is 0.
+ */
+void fmtpRecvv3::SetBufferPool(const size_t bufsize, const size_t count)
+{
+    SetProductBufferPool(bufsize, bufsize, count);
+}
+
+
+/**
+ * Reserves buffers in size classes which double from `minsize` to `maxsize`
+ * and offers the smallest free one which is large enough to the receiving
+ * application in `notify_of_bop()`. The buffers are pre-faulted huge pages,
+ * so placing data into them costs neither page faults nor many TLB misses,
+ * and they are recycled once the application releases them. Unless a node is
+ * given, they are moved to the NUMA node of the multicast-receiving thread
+ * when it starts. Must be called before `Start()`.
+ *
+ * @param[in] minsize  Size of a buffer of the smallest class in bytes.
+ * @param[in] maxsize  Size of a buffer of the largest class in bytes.
+ * @param[in] count    Number of buffers of every class.
+ * @param[in] node     NUMA node of the buffers, -1 for the node of the
+ *                     multicast-receiving thread.
+ * @throw std::invalid_argument  if a size or `count` is 0 or `minsize`
+ *                               exceeds `maxsize`.
+ * @throw std::system_error      if the memory can't be allocated.
+ */
+void fmtpRecvv3::SetProductBufferPool(const size_t minsize,
+                                      const size_t maxsize,
+                                      const size_t count,
+                                      const int    node)
+{
+    ProductBufferPool* const pool = new ProductBufferPool(minsize, maxsize,
+            count, node);
+    delete bufpool;
+    bufpool = pool;
+}
+
+
+/**
+ * Makes the receiver write products into files in a directory instead of
+ * memory supplied by the receiving application. Every product gets a file
+ * named after its index, which is preallocated when the BOP arrives, and
+ * data blocks are written to it asynchronously by the file sink. The
+ * application is notified of the end of a product only after its file has
+ * been synced to disk. Must be called before `Start()`.
+ *
+ * @param[in] dir             Directory of the product files.
+ * @throw std::system_error   if the writer thread can't be started.
+ */
+void fmtpRecvv3::SetFileSink(const std::string& dir)
+{
+    FileSink* const sink = new FileSink(dir,
+            [this](uint32_t prodindex, bool ok) {
+                try {
+                    notifyEnd(prodindex, ok);
+                }
+                catch (...) {
+                    taskExit(std::current_exception());
+                }
+            });
+    delete filesink;
+    filesink = sink;
+}
+
+
 /**
  * A public setter of link speed. The setter is thread-safe, but a recommended
- * way is to set the link speed before the receiver starts. Due to the feature
- * of virtual circuits, the link speed won't change when it's set up. So the
- * link speed remains for the whole life of the receiver. As the possible link
- * speed nowadays could possibly be 10Gbps or even higher, a 64-bit unsigned
- * integer is used to hold the value, which can be up to 18000 Pbps.
+ * way is to set the link speed before the receiver starts. The link speed is
+ * the initial estimate of the arrival rate of the multicast, which sizes the
+ * socket buffer and sets the EOP deadlines until the rate is measured, see
+ * getLinkSpeed(). As the possible link speed nowadays could possibly be
+ * 10Gbps or even higher, a 64-bit unsigned integer is used to hold the
+ * value, which can be up to 18000 Pbps.
  *
  * @param[in] speed                 User-specified link speed
  */
@@ -159,6 +356,166 @@ void fmtpRecvv3::SetLinkSpeed(uint64_t speed)
 }
 
 
+/**
+ * Acknowledges completed products to the sender in batches: a batch is sent
+ * once it holds `count` products or its first product has waited `seconds`.
+ * The products which complete in order are acknowledged as one range, so a
+ * batch costs the sender a single pass over its retransmission entries
+ * instead of one per product. A sender which doesn't understand
+ * FMTP_RETX_END_BATCH would keep every product until it times out, so this is
+ * off by default. Must be called before `Start()`.
+ *
+ * @param[in] count              Number of products which are sent at once.
+ * @param[in] seconds            Longest time a product waits for its batch.
+ * @throw std::invalid_argument  if `count` is 0 or `seconds` isn't positive.
+ */
+void fmtpRecvv3::SetAckBatch(const unsigned count, const double seconds)
+{
+    AckBatch* const batch = new AckBatch(count, seconds, MAX_ACK_RANGES);
+    delete ackBatch;
+    ackBatch = batch;
+}
+
+
+/**
+ * Makes the multicast thread poll its socket without sleeping and lets the
+ * kernel busy poll the device queue during each read (SO_BUSY_POLL and, where
+ * available, SO_PREFER_BUSY_POLL). This saves the wake-up of a sleeping thread
+ * on every packet at the price of a fully used CPU, which is best an isolated
+ * one, see `SetThreadAffinity()`. Must be called before `Start()`.
+ *
+ * @param[in] usecs  How long the kernel may busy poll the device per read in
+ *                   microseconds, 0 to sleep as usual.
+ */
+void fmtpRecvv3::SetBusyPoll(const unsigned usecs)
+{
+    busyPollUsecs = usecs;
+}
+
+
+/**
+ * Delivers end-of-product and missed-product notifications on a pool of
+ * threads instead of the multicast and retransmission threads, so that a slow
+ * receiving application doesn't delay the reading of packets. Notifications
+ * of different products may then be delivered concurrently and out of order.
+ * An exception thrown by the application terminates the receiver. Must be
+ * called before `Start()`.
+ *
+ * @param[in] nthreads          Number of notification threads.
+ * @param[in] capacity          Maximum number of waiting notifications, a
+ *                              power of 2.
+ * @throw std::invalid_argument if `nthreads` is 0 or `capacity` isn't a power
+ *                              of 2.
+ * @throw std::system_error     if a thread can't be started.
+ */
+void fmtpRecvv3::SetNotifyDispatcher(const unsigned nthreads,
+                                     const size_t   capacity)
+{
+    NotifyDispatcher* const disp = new NotifyDispatcher(
+            [this](uint32_t prodindex, bool complete) {
+                try {
+                    deliverNotice(prodindex, complete);
+                }
+                catch (...) {
+                    taskExit(std::current_exception());
+                }
+            }, nthreads, capacity);
+    delete dispatcher;
+    dispatcher = disp;
+}
+
+
+/**
+ * Subscribes to the products whose BOP metadata satisfy a predicate. For a
+ * rejected product the receiver attaches a BPF program to the multicast
+ * socket which drops the product's data and EOP packets in the kernel, sends
+ * RETX_END to the sender right away and neither requests nor notifies
+ * anything about it. Must be called before `Start()`.
+ *
+ * @param[in] accept  Called with the metadata of every BOP on the thread
+ *                    which receives it; returns false to reject.
+ */
+void fmtpRecvv3::SetProductFilter(const ProdFilter::Predicate& accept)
+{
+    this->accept = accept;
+}
+
+
+/**
+ * Waits before requesting a data block which is missing when a later block of
+ * the same product arrives on multicast. Packets reordered on the way, e.g. by
+ * multipath routing or bonded links, then cost no retransmission: the request
+ * is dropped if the block arrives within the window. A lost block is requested
+ * that much later, so the window should be little more than the reordering
+ * of the network. Must be called before `Start()`.
+ *
+ * @param[in] seconds            How long to wait, 0 to request at once.
+ * @throw std::invalid_argument  if `seconds` is negative.
+ */
+void fmtpRecvv3::SetReorderWindow(const double seconds)
+{
+    if (seconds < 0)
+        throw std::invalid_argument("fmtpRecvv3::SetReorderWindow(): "
+                "negative window");
+    reorderDelay = seconds;
+}
+
+
+/**
+ * Runs the multicast thread with the SCHED_FIFO policy, so that it isn't
+ * preempted by normal threads. A busy-polling thread at a real-time priority
+ * must have a CPU of its own or it starves everything else on it. Must be
+ * called before `Start()`.
+ *
+ * @param[in] priority           Real-time priority, 0 for the normal policy.
+ * @throw std::invalid_argument  if `priority` isn't valid for SCHED_FIFO.
+ */
+void fmtpRecvv3::SetSchedFifo(const int priority)
+{
+    if (priority && (priority < sched_get_priority_min(SCHED_FIFO) ||
+            priority > sched_get_priority_max(SCHED_FIFO)))
+        throw std::invalid_argument("fmtpRecvv3::SetSchedFifo(): invalid "
+                "priority " + std::to_string(priority));
+    fifoPriority = priority;
+}
+
+
+/**
+ * Pins a thread of the receiver to a CPU. The thread applies it itself when
+ * it starts, so the multicast thread is on its CPU before it touches the
+ * buffer pool or the socket. Must be called before `Start()`.
+ *
+ * @param[in] thread             The thread.
+ * @param[in] cpu                The CPU, -1 to let the thread run on any.
+ * @throw std::invalid_argument  if `thread` or `cpu` is invalid.
+ */
+void fmtpRecvv3::SetThreadAffinity(const Thread thread, const int cpu)
+{
+    if (thread < 0 || thread >= THREAD_COUNT || cpu < -1 || cpu >= CPU_SETSIZE)
+        throw std::invalid_argument("fmtpRecvv3::SetThreadAffinity(): invalid "
+                "thread or CPU");
+    threadCpu[thread] = cpu;
+}
+
+
+/**
+ * Expects the 64-bit product sizes and offsets of a sender which calls
+ * fmtpSendv3::SetWideOffsets(), so that products can be larger than 4 GB, up
+ * to MAX_WIDE_PRODSIZE. The product size of a BOP then takes 8 bytes, and the
+ * seqnum of a data block or a retransmission request is the number of the
+ * block instead of its offset. The sender and its receivers must agree, so
+ * the 32-bit format stays the default; a BOP whose FMTP_WIDE flag doesn't
+ * match is dropped, and its product is given up as missed. Must be called
+ * before `Start()`.
+ *
+ * @param[in] enable  Whether to expect 64-bit sizes and offsets.
+ */
+void fmtpRecvv3::SetWideOffsets(bool enable)
+{
+    wide = enable;
+}
+
+
 /**
  * Connect to sender via TCP socket, join given multicast group (defined by
  * mcastAddr:mcastPort) to receive multicasting products. Start retransmission
@@ -202,8 +559,9 @@ void fmtpRecvv3::Start()
     }
     stopJoinRetxRequester();
     stopJoinRetxHandler();
-    stopJoinTimerThread();
     stopJoinMcastHandler();
+    /* stopped last because the other threads add deadlines */
+    stopJoinTimerThread();
 
     {
         std::unique_lock<std::mutex> lock(exitMutex);
@@ -245,36 +603,20 @@ void fmtpRecvv3::Stop()
 }
 
 
-/**
- * Add the unrequested BOP identified by the given prodindex into the list.
- * If the BOP is already in the list, return with a false. If it's not, add
- * it into the list and return with a true.
- *
- * @param[in] prodindex        Product index of the missing BOP
- */
-bool fmtpRecvv3::addUnrqBOPinSet(uint32_t prodindex)
-{
-    std::pair<std::unordered_set<uint32_t>::iterator, bool> retval;
-    int size = 0;
-    {
-        std::unique_lock<std::mutex> lock(BOPSetMtx);
-        retval = misBOPset.insert(prodindex);
-        size = misBOPset.size();
-    }
-    return retval.second;
-}
-
-
 /**
  * Handles a multicast BOP message given its peeked-at and decoded FMTP header.
  *
- * @pre                       The multicast socket contains a FMTP BOP packet.
+ * @pre                       The multicast socket contains a FMTP BOP packet
+ *                            unless `payload` is given.
  * @param[in] header          The associated, peeked-at and already-decoded
  *                            FMTP header.
+ * @param[in] payload         Payload of a BOP unpacked from an aggregate, or
+ *                            NULL if the BOP is still in the socket.
  * @throw std::runtime_error  if an error occurs while reading the socket.
  * @throw std::runtime_error  if the packet is invalid.
  */
-void fmtpRecvv3::mcastBOPHandler(const FmtpHeader& header)
+void fmtpRecvv3::mcastBOPHandler(const FmtpHeader& header,
+                                 const char* const payload)
 {
     #ifdef MODBASE
         uint32_t tmpidx = header.prodindex % MODBASE;
@@ -290,17 +632,22 @@ void fmtpRecvv3::mcastBOPHandler(const FmtpHeader& header)
         WriteToLog(debugmsg);
     #endif
 
-    const int     bufsize = FMTP_HEADER_LEN + header.payloadlen;
-    char          pktBuf[bufsize];
-    const ssize_t nbytes = recv(mcastSock, pktBuf, bufsize, 0);
-
-    if (nbytes < 0) {
-        throw std::runtime_error("fmtpRecvv3::mcastBOPHandler() recv() got less"
-                "than 0 bytes returned.");
+    if (payload) {
+        BOPHandler(header, payload);
     }
+    else {
+        const int     bufsize = FMTP_HEADER_LEN + header.payloadlen;
+        char          pktBuf[bufsize];
+        const ssize_t nbytes = recv(mcastSock, pktBuf, bufsize, 0);
 
-    checkPayloadLen(header, nbytes);
-    BOPHandler(header, pktBuf + FMTP_HEADER_LEN);
+        if (nbytes < 0) {
+            throw std::runtime_error("fmtpRecvv3::mcastBOPHandler() recv() "
+                    "got less than 0 bytes returned.");
+        }
+
+        checkPayloadLen(header, nbytes);
+        BOPHandler(header, pktBuf + FMTP_HEADER_LEN);
+    }
 
     /**
      * detects completely missing products by checking the consistency
@@ -338,68 +685,63 @@ void fmtpRecvv3::retxBOPHandler(const FmtpHeader& header,
 
 
 /**
- * Parse BOP message and call notifier to notify receiving application.
+ * Parse BOP message and call notifier to notify receiving application. A send
+ * rate announced by the sender after the metadata caps the estimated link
+ * speed.
  *
  * @param[in] header           Header associated with the packet.
  * @param[in] FmtpPacketData  Pointer to payload of FMTP packet.
  * @throw std::runtime_error   if the payload is too small.
  * @throw std::runtime_error   if the amount of metadata is invalid.
+ * @throw std::runtime_error   if the trailer after the metadata is invalid.
  */
 void fmtpRecvv3::BOPHandler(const FmtpHeader& header,
                             const char* const  FmtpPacketData)
 {
     void*    prodptr = NULL;
+    bool     tofile  = false;
     BOPMsg   BOPmsg;
+    if (dropMismatchedBOP(header))
+        return;
     /**
      * Every time a new BOP arrives, save the msg to check following data
      * packets
      */
-    size_t BOPCONST = sizeof(BOPmsg.prodsize) + sizeof(BOPmsg.metasize);
-    if (header.payloadlen < BOPCONST) {
-        throw std::runtime_error("fmtpRecvv3::BOPHandler(): packet too small");
-    }
-    const unsigned char* wire = (unsigned char*)FmtpPacketData;
-    BOPmsg.prodsize = ntohl(*(uint32_t*)wire);
-    wire += sizeof(BOPmsg.prodsize);
-    BOPmsg.metasize = ntohs(*(uint16_t*)wire);
-    wire += sizeof(BOPmsg.metasize);
-    if ((header.payloadlen - BOPCONST) != BOPmsg.metasize) {
+    const size_t BOPlen = parseBOP(header, FmtpPacketData, BOPmsg);
+    const unsigned char* wire = (unsigned char*)FmtpPacketData + BOPlen;
+    const size_t trailer = header.payloadlen - BOPlen;
+    if (trailer != 0 && trailer != BOP_RATE_HINT_LEN) {
         throw std::runtime_error("fmtpRecvv3::BOPHandler(): metasize "
                 "mismatched payload indicated by header");
     }
-    (void)memcpy(BOPmsg.metadata, wire, BOPmsg.metasize);
+    if (trailer == BOP_RATE_HINT_LEN) {
+        /* the send rate of the sender, see fmtpSendv3::SetBopRateHint() */
+        uint32_t rate[2];
+        (void)memcpy(rate, wire, sizeof(rate));
+        linkrate.hint(((uint64_t)ntohl(rate[0]) << 32) | ntohl(rate[1]));
+    }
 
     /**
-     * Here a strict check is performed to make sure the information in
-     * trackermap and BlockMNG would not be overwritten by duplicate BOP.
-     * By design, a product should exist in both the trackermap and
-     * BlockMNG or neither, which is the condition of executing all the
-     * initialization. Also, notify_of_bop() will only be called for a
-     * fresh new BOP. All the duplicate calls will be suppressed.
+     * Here a strict check is performed to make sure the record of a product
+     * would not be overwritten by duplicate BOP. notify_of_bop() will only be
+     * called for a fresh new BOP. All the duplicate calls will be suppressed.
+     * A record without BOP is either new or a placeholder of a requested BOP.
      */
-    bool insertion = pSegMNG->addProd(header.prodindex, BOPmsg.prodsize);
-    bool inTracker;
-    {
-        std::unique_lock<std::mutex> lock(trackermtx);
-        inTracker = trackermap.count(header.prodindex);
-    }
-    if (insertion && !inTracker) {
-        if(notifier) {
-            notifier->notify_of_bop(header.prodindex, BOPmsg.prodsize,
-                    BOPmsg.metadata, BOPmsg.metasize, &prodptr);
-        }
-
-        /* Atomic insertion for BOP of new product */
-        {
-            ProdTracker tracker = {BOPmsg.prodsize, prodptr, 0, 0};
-            std::unique_lock<std::mutex> lock(trackermtx);
-            trackermap[header.prodindex] = tracker;
-        }
-
-        /* forcibly terminate the previous timer */
-        timerWake.notify_all();
-
-        initEOPStatus(header.prodindex);
+    std::unique_lock<std::mutex> lock;
+    bool                         added;
+    ProdRecord* rec = prodtable->findOrAdd(header.prodindex, lock, added);
+    if (!rec) {
+        /* too many incomplete products to keep track of one more */
+        notifyEnd(header.prodindex, false);
+        return;
+    }
+    if (!rec->hasBOP) {
+        if (!beginProduct(header.prodindex, BOPmsg, rec, lock, prodptr,
+                    tofile))
+            return;
+        rec->init(BOPmsg.prodsize, prodptr, tofile);
+        rec->dropsAtBop = socketDrops();
+        lock.unlock();
 
         /**
          * Since the receiver timer starts after BOP is received, the RTT is not
@@ -409,28 +751,13 @@ void fmtpRecvv3::BOPHandler(const FmtpHeader& header,
          * link speed. Besides, a little more extra time would be favorable to
          * tolerate possible fluctuation.
          */
-        double sleeptime = 0.0;
-        {
-            std::unique_lock<std::mutex> lock(trackermtx);
-            if (trackermap.count(header.prodindex)) {
-                sleeptime =
-                    Frcv * ((double)trackermap[header.prodindex].prodsize /
-                    (double)linkspeed);
-            }
-            else {
-                throw std::runtime_error("fmtpRecvv3::BOPHandler(): "
-                        "Error accessing newly added BOP in trackermap.");
-            }
-        }
-        /* add the new product into timer queue */
-        {
-            std::unique_lock<std::mutex> lock(timerQmtx);
-            timerParam timerparam = {header.prodindex, sleeptime};
-            timerParamQ.push(timerparam);
-            timerQfilled.notify_all();
-        }
+        double sleeptime = Frcv * ((double)BOPmsg.prodsize /
+                (double)getLinkSpeed());
+        /* add the deadline of the new product into the timing wheel */
+        eopTimers.push(header.prodindex, sleeptime);
     }
     else {
+        lock.unlock();
         std::cout << "fmtpRecvv3::BOPHandler(): duplicate BOP for product #"
             << header.prodindex << "received." << std::endl;
     }
@@ -442,17 +769,7 @@ void fmtpRecvv3::BOPHandler(const FmtpHeader& header,
     #endif
 
     #ifdef MEASURE
-        {
-            std::unique_lock<std::mutex> lock(trackermtx);
-            if (trackermap.count(header.prodindex)) {
-                ProdTracker tracker = trackermap[header.prodindex];
-                measure->insert(header.prodindex, tracker.prodsize);
-            }
-            else {
-                throw std::runtime_error("fmtpRecvv3::BOPHandler(): "
-                        "[Measure] Error accessing newly added BOP");
-            }
-        }
+        measure->insert(header.prodindex, BOPmsg.prodsize);
         std::string measuremsg = "[MEASURE] Product #" +
             std::to_string(tmpidx);
         measuremsg += ": BOP is received. Product size = ";
@@ -465,6 +782,229 @@ void fmtpRecvv3::BOPHandler(const FmtpHeader& header,
 }
 
 
+/**
+ * Decodes the product size, metadata size and metadata which start the
+ * payload of a BOP and of a tiny product. Whatever follows is left to the
+ * caller. With 64-bit offsets, see SetWideOffsets(), the product size is a
+ * 64-bit integer in network byte order, high word first.
+ *
+ * @param[in]  header         Header of the packet.
+ * @param[in]  payload        Payload of the packet.
+ * @param[out] BOPmsg         The decoded BOP.
+ * @return                    Number of bytes decoded.
+ * @throw std::runtime_error  if the payload is too small.
+ * @throw std::runtime_error  if the amount of metadata is invalid.
+ * @throw std::runtime_error  if the product is too large.
+ */
+size_t fmtpRecvv3::parseBOP(const FmtpHeader& header,
+                            const char* const payload, BOPMsg& BOPmsg)
+{
+    const size_t extra    = wide ? WIDE_PRODSIZE_EXTRA : 0;
+    const size_t sizelen  = sizeof(uint32_t) + extra;
+    const size_t BOPCONST = sizelen + sizeof(BOPmsg.metasize);
+    if (header.payloadlen < BOPCONST) {
+        throw std::runtime_error("fmtpRecvv3::parseBOP(): packet too small");
+    }
+    const unsigned char* wire = (unsigned char*)payload;
+    uint32_t size[2] = {0, 0};
+    (void)memcpy(size + 2 - sizelen / sizeof(uint32_t), wire, sizelen);
+    BOPmsg.prodsize = ((uint64_t)ntohl(size[0]) << 32) | ntohl(size[1]);
+    wire += sizelen;
+    BOPmsg.metasize = ntohs(*(uint16_t*)wire);
+    wire += sizeof(BOPmsg.metasize);
+    if ((header.payloadlen - BOPCONST) < BOPmsg.metasize ||
+            BOPmsg.metasize > AVAIL_BOP_LEN - extra) {
+        throw std::runtime_error("fmtpRecvv3::parseBOP(): metasize "
+                "mismatched payload indicated by header");
+    }
+    if (BOPmsg.prodsize > MAX_WIDE_PRODSIZE) {
+        throw std::runtime_error("fmtpRecvv3::parseBOP(): product size " +
+                std::to_string(BOPmsg.prodsize) + " too large");
+    }
+    (void)memcpy(BOPmsg.metadata, wire, BOPmsg.metasize);
+
+    return BOPCONST + BOPmsg.metasize;
+}
+
+
+/**
+ * Drops a BOP or tiny product whose FMTP_WIDE flag doesn't match
+ * SetWideOffsets(): it comes from a sender with the other setting, so its
+ * product size would be misread. The product is given up as missed like one
+ * whose BOP the sender rejects, and the receiver keeps running. A product
+ * which has already started is left alone.
+ *
+ * @param[in] header  Header of the packet.
+ * @return            True if the packet was dropped.
+ * @throws std::runtime_error  Receiving application error.
+ */
+bool fmtpRecvv3::dropMismatchedBOP(const FmtpHeader& header)
+{
+    if (((header.flags & FMTP_WIDE) != 0) == wide)
+        return false;
+
+    std::cout << "fmtpRecvv3::dropMismatchedBOP(): dropped BOP of product #"
+        << header.prodindex << ": width of product size doesn't match "
+        "SetWideOffsets()" << std::endl;
+    bopsLost.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = prodtable->find(header.prodindex, lock);
+    if (rec && rec->hasBOP)
+        return true;
+    /* a placeholder's BOP was requested, and this packet answers it */
+    const bool requested = rec && rec->bopRequested;
+    if (rec) {
+        prodtable->erase(rec);
+        lock.unlock();
+    }
+    if (requested)
+        bopAnswered(header.prodindex);
+    notifyEnd(header.prodindex, false);
+
+    return true;
+}
+
+
+/**
+ * Starts the reception of a product whose BOP has arrived. An unsubscribed or
+ * already held product is removed and acknowledged. Otherwise, the product
+ * is given a file in the file sink or a buffer of the pool, and the receiving
+ * application is notified.
+ *
+ * @pre                  `rec` is locked by `lock` and has no BOP.
+ * @param[in] prodindex  Index of the product.
+ * @param[in] BOPmsg     The BOP of the product.
+ * @param[in] rec        Record of the product.
+ * @param[in,out] lock   Lock of the record, released if the product is
+ *                       rejected.
+ * @param[out] prodptr   Where the product goes, or NULL.
+ * @param[out] tofile    Whether the product goes to the file sink.
+ * @return               False if the product is rejected.
+ * @throws std::runtime_error  Receiving application error.
+ */
+bool fmtpRecvv3::beginProduct(const uint32_t prodindex, BOPMsg& BOPmsg,
+                              ProdRecord* const rec,
+                              std::unique_lock<std::mutex>& lock,
+                              void*& prodptr, bool& tofile)
+{
+    if (prodfilter &&
+            ((accept && !accept(prodindex, BOPmsg.metadata,
+                    BOPmsg.metasize)) ||
+            (notifier && notifier->is_duplicate(prodindex,
+                    BOPmsg.metadata, BOPmsg.metasize)))) {
+        /**
+         * An unsubscribed or already held product is forgotten at once: the
+         * kernel drops its remaining packets, nothing is requested for it,
+         * and the sender needn't keep it for this receiver.
+         */
+        prodfilter->reject(prodindex);
+        prodtable->erase(rec);
+        lock.unlock();
+        acknowledge(prodindex);
+        return false;
+    }
+
+    /**
+     * With a file sink, the application is given the pathname of the
+     * file and only decides whether to accept the product.
+     */
+    std::string path;
+    void*       pooled = NULL;
+    prodptr = NULL;
+    tofile  = false;
+    if (filesink) {
+        path    = filesink->pathOf(prodindex);
+        prodptr = (void*)path.c_str();
+    }
+    else if (bufpool && notifier) {
+        /* offer a buffer which the application needn't allocate */
+        pooled  = bufpool->tryGet(BOPmsg.prodsize);
+        prodptr = pooled;
+    }
+    if(notifier) {
+        notifier->notify_of_bop(prodindex, BOPmsg.prodsize,
+                BOPmsg.metadata, BOPmsg.metasize, &prodptr);
+    }
+    if (pooled && prodptr != pooled)
+        bufpool->put(pooled);
+    if (filesink && prodptr) {
+        filesink->open(prodindex, BOPmsg.prodsize);
+        prodptr = NULL;
+        tofile  = true;
+    }
+
+    return true;
+}
+
+
+/**
+ * Receives a product which the sender multicast in a single packet holding
+ * its BOP and all of its data, see fmtpSendv3::SetTinyProducts(). The
+ * product is complete as soon as it's started, so it's neither given an EOP
+ * timer nor tracked block by block: its record only guards against a
+ * concurrent BOP and is removed again at once. A product which is already
+ * known, e.g. from a retransmitted BOP, is left to its own packets. A
+ * placeholder of a requested BOP counts as answered, see bopAnswered().
+ *
+ * @param[in] header          Header of the packet.
+ * @param[in] payload         Payload of the packet.
+ * @throw std::runtime_error  if the packet is invalid.
+ * @throw std::runtime_error  Receiving application error.
+ */
+void fmtpRecvv3::tinyHandler(const FmtpHeader& header,
+                             const char* const payload)
+{
+    if (dropMismatchedBOP(header))
+        return;
+    BOPMsg       BOPmsg;
+    const size_t BOPlen = parseBOP(header, payload, BOPmsg);
+    if (header.payloadlen - BOPlen != BOPmsg.prodsize) {
+        throw std::runtime_error("fmtpRecvv3::tinyHandler(): product size "
+                "mismatched payload indicated by header");
+    }
+
+    std::unique_lock<std::mutex> lock;
+    bool                         added;
+    ProdRecord* rec = prodtable->findOrAdd(header.prodindex, lock, added);
+    if (!rec) {
+        /* too many incomplete products to keep track of one more */
+        notifyEnd(header.prodindex, false);
+        return;
+    }
+    if (rec->hasBOP)
+        return;
+
+    /* a placeholder's BOP was requested, and this packet answers it */
+    const bool requested = rec->bopRequested;
+    void*      prodptr;
+    bool       tofile;
+    if (!beginProduct(header.prodindex, BOPmsg, rec, lock, prodptr, tofile)) {
+        if (requested)
+            bopAnswered(header.prodindex);
+        return;
+    }
+    if (tofile && BOPmsg.prodsize) {
+        char* const sinkbuf = filesink->getBuffer();
+        (void)memcpy(sinkbuf, payload + BOPlen, BOPmsg.prodsize);
+        filesink->write(header.prodindex, 0, sinkbuf, BOPmsg.prodsize);
+    }
+    else if (prodptr && BOPmsg.prodsize) {
+        (void)memcpy(prodptr, payload + BOPlen, BOPmsg.prodsize);
+    }
+    prodtable->erase(rec);
+    lock.unlock();
+    if (requested)
+        bopAnswered(header.prodindex);
+
+    #ifdef MEASURE
+        measure->insert(header.prodindex, BOPmsg.prodsize);
+    #endif
+
+    productCompleted(header.prodindex, false);
+}
+
+
 /**
  * Checks the length of the payload of a FMTP packet -- as stated in the FMTP
  * header -- against the actual length of a FMTP packet.
@@ -483,14 +1023,23 @@ void fmtpRecvv3::checkPayloadLen(const FmtpHeader& header, const size_t nbytes)
 
 
 /**
- * Clears the EOP arrival status.
+ * Completes a product if all of its blocks have been written. Whoever removes
+ * the record first, this function or EOPHandler(), acknowledges the product,
+ * so it is done exactly once.
  *
- * @param[in] prodindex    Product index which the EOP belongs to.
+ * @param[in] prodindex        Index of the product.
+ * @throws std::runtime_error  Receiving application error.
  */
-void fmtpRecvv3::clearEOPStatus(const uint32_t prodindex)
+void fmtpRecvv3::checkCompletion(const uint32_t prodindex)
 {
-    std::unique_lock<std::mutex> lock(EOPmapmtx);
-    EOPmap.erase(prodindex);
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = prodtable->find(prodindex, lock);
+    if (rec && rec->isComplete()) {
+        accountLoss(rec);
+        prodtable->erase(rec);
+        lock.unlock();
+        productCompleted(prodindex);
+    }
 }
 
 
@@ -530,87 +1079,35 @@ void fmtpRecvv3::decodeHeader(char* const  packet, FmtpHeader& header)
 
 
 /**
- * Handles a received EOP from the unicast thread. Check the bitmap to see if
- * all the data blocks are received. If true, notify the RecvApp. If false,
- * request for retransmission if it has to be so.
+ * Handles a received EOP from either the multicast or the unicast thread.
+ * Check the bitmap to see if all the data blocks are received. If true, notify
+ * the RecvApp. If false, request for retransmission if it has to be so.
  *
+ * @pre                        `rec` is locked by `lock` and has a BOP.
  * @param[in] header           Reference to the received FMTP packet header.
+ * @param[in] rec              Record of the product.
+ * @param[in,out] lock         Lock of the record, released if the product is
+ *                             complete.
  * @throws std::out_of_range   The notifier doesn't know about
  *                             `header.prodindex`.
  * @throws std::runtime_error  Receiving application error.
  */
-void fmtpRecvv3::EOPHandler(const FmtpHeader& header)
+void fmtpRecvv3::EOPHandler(const FmtpHeader&             header,
+                            ProdRecord* const             rec,
+                            std::unique_lock<std::mutex>& lock)
 {
     /**
-     * if segmap check tells everything is completed, then sends the
+     * if the bitmap tells everything is completed, then sends the
      * RETX_END message back to sender. Meanwhile notify receiving
      * application.
      */
-    if (pSegMNG->delIfComplete(header.prodindex)) {
-        sendRetxEnd(header.prodindex);
-        bool inTracker;
-        {
-            std::unique_lock<std::mutex> lock(trackermtx);
-            inTracker = trackermap.count(header.prodindex);
-        }
-        if (notifier && inTracker) {
-            notifier->notify_of_eop(header.prodindex);
-        }
-        else if (inTracker) {
-            /**
-             * Updates the most recently acknowledged product and notifies
-             * a dummy notification handler (getNotify()).
-             */
-            {
-                std::unique_lock<std::mutex> lock(notifyprodmtx);
-                notifyprodidx = header.prodindex;
-            }
-            notify_cv.notify_one();
-        }
-
-        {
-            std::unique_lock<std::mutex> lock(trackermtx);
-            trackermap.erase(header.prodindex);
-        }
-
-        #ifdef MODBASE
-            uint32_t tmpidx = header.prodindex % MODBASE;
-        #else
-            uint32_t tmpidx = header.prodindex;
-        #endif
-
-        #ifdef DEBUG2
-            std::string debugmsg = "[MSG] Product #" +
-                std::to_string(tmpidx);
-            debugmsg += " has been completely received";
-            std::cout << debugmsg << std::endl;
-            WriteToLog(debugmsg);
-        #elif DEBUG1
-            std::string debugmsg = "[MSG] Product #" +
-                std::to_string(tmpidx);
-            debugmsg += " has been completely received";
-            std::cout << debugmsg << std::endl;
-        #endif
-
-        #ifdef MEASURE
-            uint32_t bytes = measure->getsize(header.prodindex);
-            std::string measuremsg = "[SUCCESS] Product #" +
-                std::to_string(tmpidx);
-            measuremsg += ": product received, size = ";
-            measuremsg += std::to_string(bytes);
-            measuremsg += " bytes, elapsed time = ";
-            measuremsg += measure->gettime(header.prodindex);
-            measuremsg += " seconds.";
-            if (measure->getEOPmiss(header.prodindex)) {
-                measuremsg += " EOP is retransmitted";
-            }
-            std::cout << measuremsg << std::endl;
-            WriteToLog(measuremsg);
-            /* remove the measurement if completely received */
-            measure->remove(header.prodindex);
-        #endif
+    if (rec->isComplete()) {
+        accountLoss(rec);
+        prodtable->erase(rec);
+        lock.unlock();
+        productCompleted(header.prodindex);
     }
-    else {
+    else if (!rec->hasLastBlock()) {
         /**
          * check if the last data block has been received. If true, then
          * all the other missing blocks have been requested. In this case,
@@ -618,54 +1115,36 @@ void fmtpRecvv3::EOPHandler(const FmtpHeader& header)
          * Otherwise, last block is missing as well, receiver needs to
          * request retx for all the missing blocks including the last one.
          */
-        if (!hasLastBlock(header.prodindex)) {
-            uint32_t prodsize;
-            bool     haveProdsize;
-            {
-                std::unique_lock<std::mutex> lock(trackermtx);
-                haveProdsize = trackermap.count(header.prodindex) > 0;
-                if (haveProdsize)
-                    prodsize = trackermap[header.prodindex].prodsize;
-            }
-            if (haveProdsize)
-                requestAnyMissingData(header.prodindex, prodsize);
-        }
+        requestAnyMissingData(rec, rec->prodsize);
     }
 }
 
 
 /**
- * Gets the EOP arrival status.
- *
- * @param[in] prodindex    Product index which the EOP belongs to.
- */
-bool fmtpRecvv3::getEOPStatus(const uint32_t prodindex)
-{
-    std::unique_lock<std::mutex> lock(EOPmapmtx);
-    return EOPmap[prodindex];
-}
-
-
-/**
- * Check if the last data block has been received.
+ * Notifies the receiving application about the end of a product on the
+ * calling thread. Without a notifier, updates the most recently acknowledged
+ * product and wakes up a dummy notification handler (getNotify()).
  *
- * @param[in] none
- */
-bool fmtpRecvv3::hasLastBlock(const uint32_t prodindex)
-{
-    return pSegMNG->getLastSegment(prodindex);
-}
-
-
-/**
- * Initialize the EOP arrival status.
- *
- * @param[in] prodindex    Product index which the EOP belongs to.
+ * @param[in] prodindex        Index of the product.
+ * @param[in] complete         True if the product is complete, false if it is
+ *                             missed.
+ * @throws std::runtime_error  Receiving application error.
  */
-void fmtpRecvv3::initEOPStatus(const uint32_t prodindex)
+void fmtpRecvv3::deliverNotice(const uint32_t prodindex, const bool complete)
 {
-    std::unique_lock<std::mutex> lock(EOPmapmtx);
-    EOPmap[prodindex] = false;
+    if (notifier) {
+        if (complete)
+            notifier->notify_of_eop(prodindex);
+        else
+            notifier->notify_of_missed_prod(prodindex);
+    }
+    else {
+        {
+            std::unique_lock<std::mutex> lock(notifyprodmtx);
+            notifyprodidx = prodindex;
+        }
+        notify_cv.notify_one();
+    }
 }
 
 
@@ -702,14 +1181,56 @@ void fmtpRecvv3::joinGroup(
         throw std::runtime_error("fmtpRecvv3::joinGroup() setsockopt() add "
                 "membership failed.");
     }
+    setupMcastSock();
 }
 
 
 /**
- * Handles multicast packets. To avoid extra copying operations, here recv()
- * is called with a MSG_PEEK flag to only peek the header instead of reading
- * it out (which would cause the buffer to be wiped). And the recv() call
- * will block if there is no data coming to the mcastSock.
+ * Sets up the poller of the multicast socket, which counts the datagrams the
+ * socket drops and busy polls if so configured, and enlarges the buffer to
+ * hold `RCVBUF_SECONDS` of traffic at the link speed. Without privileges the
+ * kernel caps the size at `net.core.rmem_max`. Neither failure is fatal: the
+ * statistics tell what the kernel granted.
+ */
+void fmtpRecvv3::setupMcastSock()
+{
+    delete poller;
+    poller = new McastPoller(mcastSock, busyPollUsecs);
+    /* no program is attached until a product is dropped */
+    delete prodfilter;
+    prodfilter = new ProdFilter(mcastSock);
+
+    int       size;
+    socklen_t len = sizeof(size);
+    if (getsockopt(mcastSock, SOL_SOCKET, SO_RCVBUF, &size, &len))
+        size = 0;
+    double wanted;
+    {
+        std::unique_lock<std::mutex> lock(linkmtx);
+        wanted = RCVBUF_SECONDS * linkspeed / 8;
+    }
+    if (wanted > RCVBUF_MAX)
+        wanted = RCVBUF_MAX;
+    /* the kernel reports twice the size it is given */
+    if (wanted > size / 2) {
+        const int request = wanted;
+        if (setsockopt(mcastSock, SOL_SOCKET, SO_RCVBUFFORCE, &request,
+                    sizeof(request)))
+            (void)setsockopt(mcastSock, SOL_SOCKET, SO_RCVBUF, &request,
+                    sizeof(request));
+        len = sizeof(size);
+        if (getsockopt(mcastSock, SOL_SOCKET, SO_RCVBUF, &size, &len))
+            size = 0;
+    }
+    rcvbufSize = size;
+}
+
+
+/**
+ * Handles multicast packets. To avoid extra copying operations, the header is
+ * only peeked at instead of read out (which would cause the buffer to be
+ * wiped). The peek blocks if there is no data coming to the mcastSock, or
+ * spins in busy-poll mode.
  *
  * @throw std::runtime_error   if an I/O error occurs.
  * @throw std::runtime_error  if a packet is invalid.
@@ -718,7 +1239,7 @@ void fmtpRecvv3::joinGroup(
  */
 void fmtpRecvv3::mcastHandler()
 {
-    static bool started = false; // Has this method been called?
+    bool started = false; // Has a packet been received?
     while(1)
     {
         FmtpHeader   header;
@@ -729,8 +1250,7 @@ void fmtpRecvv3::mcastHandler()
          * more than one return value).
          */
         
-	const ssize_t nbytes = recv(mcastSock, &header, sizeof(header),
-                                    MSG_PEEK);
+	const ssize_t nbytes = poller->peek(&header, sizeof(header));
         /*
          * Allow the current thread to be cancelled only when it is likely
          * blocked attempting to read from the multicast socket because that
@@ -750,13 +1270,18 @@ void fmtpRecvv3::mcastHandler()
         }
 
         decodeHeader(header);
+        linkrate.add(poller->getArrival(), FMTP_HEADER_LEN + header.payloadlen);
 
         if (!started) {
             prodidx_mcast = header.prodindex;
+            lastMcastProd = header.prodindex;
             started = true;
         }
+        else {
+            trackMcastProduct(header.prodindex);
+        }
 
-        if (header.flags == FMTP_BOP) {
+        if ((header.flags & ~FMTP_WIDE) == FMTP_BOP) {
             mcastBOPHandler(header);
         }
         else if (header.flags == FMTP_MEM_DATA) {
@@ -773,6 +1298,12 @@ void fmtpRecvv3::mcastHandler()
 
             mcastEOPHandler(header);
         }
+        else if (header.flags == FMTP_AGGREGATE) {
+            mcastAggregateHandler(header);
+        }
+        else if ((header.flags & ~FMTP_WIDE) == FMTP_TINY) {
+            mcastTinyHandler(header);
+        }
 
         int ignoredState;
         (void)pthread_setcancelstate(initState, &ignoredState);
@@ -783,22 +1314,26 @@ void fmtpRecvv3::mcastHandler()
 /**
  * Handles a received EOP from the multicast thread. Since the data is only
  * fetched with a MSG_PEEK flag, it's necessary to remove the data by calling
- * recv() again without MSG_PEEK.
+ * recv() again without MSG_PEEK, unless the EOP was unpacked from an
+ * aggregate.
  *
  * @param[in] FmtpHeader      Reference to the received FMTP packet header
+ * @param[in] unpacked        Whether the EOP was unpacked from an aggregate.
  * @throws std::out_of_range   The notifier doesn't know about
  *                             `header.prodindex`.
  * @throws std::runtime_error  Receiving application error.
  */
-void fmtpRecvv3::mcastEOPHandler(const FmtpHeader& header)
+void fmtpRecvv3::mcastEOPHandler(const FmtpHeader& header, const bool unpacked)
 {
-    char          pktBuf[FMTP_HEADER_LEN];
-    /* read the EOP packet out in order to remove it from buffer */
-    const ssize_t nbytes = recv(mcastSock, pktBuf, FMTP_HEADER_LEN, 0);
+    if (!unpacked) {
+        char          pktBuf[FMTP_HEADER_LEN];
+        /* read the EOP packet out in order to remove it from buffer */
+        const ssize_t nbytes = recv(mcastSock, pktBuf, FMTP_HEADER_LEN, 0);
 
-    if (nbytes < 0) {
-        throw std::runtime_error("fmtpRecvv3::mcastEOPHandler() recv() less than "
-                "zero bytes.");
+        if (nbytes < 0) {
+            throw std::runtime_error("fmtpRecvv3::mcastEOPHandler() recv() "
+                    "less than zero bytes.");
+        }
     }
 
     #ifdef MODBASE
@@ -815,20 +1350,18 @@ void fmtpRecvv3::mcastEOPHandler(const FmtpHeader& header)
         WriteToLog(debugmsg);
     #endif
 
-    bool hasBOP = false;
-    {
-        std::unique_lock<std::mutex> lock(trackermtx);
-        if (trackermap.count(header.prodindex)) {
-            hasBOP = true;
-        }
-    }
-    if (hasBOP) {
-        setEOPStatus(header.prodindex);
-        timerWake.notify_all();
-        EOPHandler(header);
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = prodtable->find(header.prodindex, lock);
+    if (rec && rec->hasBOP) {
+        rec->eopArrived = true;
+        (void)eopTimers.cancel(header.prodindex);
+        EOPHandler(header, rec, lock);
     }
     else {
-        (void)requestMissingBopsInclusive(header.prodindex);
+        if (lock)
+            lock.unlock();
+        if (!prodfilter || !prodfilter->isRejected(header.prodindex))
+            (void)requestMissingBopsInclusive(header.prodindex);
 #if 0
         /**
          * prodidx_mcast is only updated if no corresponding BOP is found.
@@ -851,34 +1384,173 @@ void fmtpRecvv3::mcastEOPHandler(const FmtpHeader& header)
 }
 
 
+/**
+ * Notifies the receiving application about the end of a product. With a
+ * notification dispatcher the notification is only queued, so the calling
+ * thread never waits for the application.
+ *
+ * @param[in] prodindex        Index of the product.
+ * @param[in] complete         True if the product is complete, false if it is
+ *                             missed.
+ * @throws std::runtime_error  Receiving application error.
+ */
+void fmtpRecvv3::notifyEnd(const uint32_t prodindex, const bool complete)
+{
+    if (dispatcher)
+        dispatcher->push(prodindex, complete);
+    else
+        deliverNotice(prodindex, complete);
+}
+
+
+/**
+ * Returns the number of datagrams the multicast socket has dropped.
+ * Thread-safe.
+ *
+ * @return  The number of dropped datagrams, 0 before `Start()`.
+ */
+uint64_t fmtpRecvv3::socketDrops() const
+{
+    return poller ? poller->getDrops() : 0;
+}
+
+
+/**
+ * Accounts for the loss of a product which is about to be removed. A product
+ * which missed blocks while the socket dropped datagrams is counted as a
+ * socket loss as well.
+ *
+ * @pre                 `rec` is locked by the caller.
+ * @param[in] rec       Record of the product.
+ */
+void fmtpRecvv3::accountLoss(const ProdRecord* const rec)
+{
+    if (rec->blocksLost.load(std::memory_order_relaxed)) {
+        lossyProds.fetch_add(1, std::memory_order_relaxed);
+        if (socketDrops() != rec->dropsAtBop)
+            sockLossProds.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+/**
+ * Acknowledges a completely received product to the sender, see acknowledge(),
+ * and notifies the receiving application. The record of the product
+ * has been removed, so no other thread can touch the product any more.
+ *
+ * @pre                  The record of the product is removed.
+ * @param[in] prodindex  Index of the completed product.
+ * @param[in] timed      Whether the product has an EOP timer to cancel.
+ * @throws std::runtime_error  Receiving application error.
+ */
+void fmtpRecvv3::productCompleted(const uint32_t prodindex, const bool timed)
+{
+    if (timed)
+        (void)eopTimers.cancel(prodindex);
+    acknowledge(prodindex);
+    /* the file sink notifies once the file is on disk */
+    if (!filesink || !filesink->finish(prodindex))
+        notifyEnd(prodindex, true);
+
+    #ifdef MODBASE
+        uint32_t tmpidx = prodindex % MODBASE;
+    #else
+        uint32_t tmpidx = prodindex;
+    #endif
+
+    #ifdef DEBUG2
+        std::string debugmsg = "[MSG] Product #" +
+            std::to_string(tmpidx);
+        debugmsg += " has been completely received";
+        std::cout << debugmsg << std::endl;
+        WriteToLog(debugmsg);
+    #elif DEBUG1
+        std::string debugmsg = "[MSG] Product #" +
+            std::to_string(tmpidx);
+        debugmsg += " has been completely received";
+        std::cout << debugmsg << std::endl;
+    #endif
+
+    #ifdef MEASURE
+        uint32_t bytes = measure->getsize(prodindex);
+        std::string measuremsg = "[SUCCESS] Product #" +
+            std::to_string(tmpidx);
+        measuremsg += ": product received, size = ";
+        measuremsg += std::to_string(bytes);
+        measuremsg += " bytes, elapsed time = ";
+        measuremsg += measure->gettime(prodindex);
+        measuremsg += " seconds.";
+        if (measure->getEOPmiss(prodindex)) {
+            measuremsg += " EOP is retransmitted";
+        }
+        std::cout << measuremsg << std::endl;
+        WriteToLog(measuremsg);
+        /* remove the measurement if completely received */
+        measure->remove(prodindex);
+    #endif
+}
+
+
 /**
  * Pushes a request for a data-packet onto the retransmission-request queue.
  *
- * @pre                  The retransmission-request queue is locked.
  * @param[in] prodindex  Index of the associated data-product.
- * @param[in] seqnum     Sequence number of the data-packet.
+ * @param[in] seqnum     Offset of the data-packet in bytes.
  * @param[in] datalen    Amount of data in bytes.
  */
 void fmtpRecvv3::pushMissingDataReq(const uint32_t prodindex,
-                                    const uint32_t seqnum,
+                                    const uint64_t seqnum,
                                     const uint16_t datalen)
 {
-    INLReqMsg reqmsg = {MISSING_DATA, prodindex, seqnum, datalen};
+    const INLReqMsg reqmsg = {MISSING_DATA, prodindex, seqnum, datalen};
     msgqueue.push(reqmsg);
 }
 
 
 /**
- * Pushes a request for a BOP-packet onto the retransmission-request queue.
+ * Pushes a request for a data-packet which may only be reordered onto the
+ * retransmission-request queue. The retransmission-request thread holds it
+ * back for the reorder window.
  *
  * @param[in] prodindex  Index of the associated data-product.
+ * @param[in] seqnum     Offset of the data-packet in bytes.
+ * @param[in] datalen    Amount of data in bytes.
  */
-void fmtpRecvv3::pushMissingBopReq(const uint32_t prodindex)
+void fmtpRecvv3::pushDelayedDataReq(const uint32_t prodindex,
+                                    const uint64_t seqnum,
+                                    const uint16_t datalen)
 {
-    std::unique_lock<std::mutex> lock(msgQmutex);
-    INLReqMsg                    reqmsg = {MISSING_BOP, prodindex, 0, 0};
+    const INLReqMsg reqmsg = {DELAYED_DATA, prodindex, seqnum, datalen};
     msgqueue.push(reqmsg);
-    msgQfilled.notify_one();
+}
+
+
+/**
+ * Pushes the products of missed BOPs onto the retransmission-request queue as
+ * one request, however many they are.
+ *
+ * @param[in] first  Index of the first product.
+ * @param[in] count  Number of products.
+ */
+void fmtpRecvv3::pushMissingBopRange(const uint32_t first,
+                                     const uint32_t count)
+{
+    const INLReqMsg reqmsg = {MISSING_BOP_RANGE, first, count, 0};
+    msgqueue.push(reqmsg);
+}
+
+
+/**
+ * Notes the answer of the sender for a BOP, i.e. the retransmitted BOP or a
+ * rejection. An empty range wakes up the retransmission-request thread if the
+ * answer completes the requested range of missed BOPs and more are waiting.
+ *
+ * @param[in] prodindex  Index of the product.
+ */
+void fmtpRecvv3::bopAnswered(const uint32_t prodindex)
+{
+    if (bopBacklog.answered(prodindex))
+        pushMissingBopRange(prodindex, 0);
 }
 
 
@@ -889,10 +1561,8 @@ void fmtpRecvv3::pushMissingBopReq(const uint32_t prodindex)
  */
 void fmtpRecvv3::pushMissingEopReq(const uint32_t prodindex)
 {
-    std::unique_lock<std::mutex> lock(msgQmutex);
-    INLReqMsg                    reqmsg = {MISSING_EOP, prodindex, 0, 0};
+    const INLReqMsg reqmsg = {MISSING_EOP, prodindex, 0, 0};
     msgqueue.push(reqmsg);
-    msgQfilled.notify_one();
 }
 
 
@@ -901,7 +1571,9 @@ void fmtpRecvv3::pushMissingEopReq(const uint32_t prodindex)
  * the underlying layer offers a stream-based reliable transmission, MSG_PEEK
  * is not necessary any more to reduce extra copies. It's always possible to
  * read the amount of bytes equaling to FMTP_HEADER_LEN first, and read the
- * remaining payload next.
+ * remaining payload next. A data block is read straight into the product
+ * buffer; only payloads that have nowhere to go (BOPs, duplicate or unwanted
+ * blocks) are read into a scratch buffer, which is allocated once.
  *
  * @param[in] none
  * @throw std::out_of_range   The notifier doesn't know about the product-index.
@@ -913,6 +1585,9 @@ void fmtpRecvv3::retxHandler()
     char        pktHead[FMTP_HEADER_LEN];
     int         initState;
     int         ignoredState;
+    /* sink for payloads which aren't placed into a product */
+    std::vector<char> scratch(UINT16_MAX);
+    char* const       paytmp = scratch.data();
 
     (void)memset(pktHead, 0, sizeof(pktHead));
     /*
@@ -955,12 +1630,7 @@ void fmtpRecvv3::retxHandler()
 	    decodeHeader(pktHead, header);
         }
 
-        /* dynamically creates a buffer on stack based on payload size */
-        const int bufsize = header.payloadlen;
-        char      paytmp[bufsize];
-        (void)memset(paytmp, 0, sizeof(paytmp));
-
-        if (header.flags == FMTP_RETX_BOP) {
+        if ((header.flags & ~FMTP_WIDE) == FMTP_RETX_BOP) {
             (void)pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &ignoredState);
             nbytes = tcprecv->recvData(NULL, 0, paytmp, header.payloadlen);
             (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &ignoredState);
@@ -973,52 +1643,44 @@ void fmtpRecvv3::retxHandler()
             }
             else {
                 retxBOPHandler(header, paytmp);
+                bopAnswered(header.prodindex);
             }
 
-            /** remove the BOP from missing list */
-            (void)rmMisBOPinSet(header.prodindex);
-
-            uint32_t prodsize    = 0;
-            uint32_t seqnum      = 0;
-            uint32_t lastprodidx = 0xFFFFFFFF;
-            {
-                std::unique_lock<std::mutex> lock(antiracemtx);
-                {
-                    std::unique_lock<std::mutex> lock(trackermtx);
-                    if (trackermap.count(header.prodindex)) {
-                        ProdTracker tracker  = trackermap[header.prodindex];
-                        prodsize             = tracker.prodsize;
-                        seqnum               = tracker.seqnum;
-
-                        lastprodidx = prodidx_mcast;
-                    }
-                }
-                if (prodsize > 0) {
+            /**
+             * The record lock keeps the multicast thread from requesting
+             * and updating the most recent block at the same time.
+             */
+            uint32_t lastprodidx = prodidx_mcast;
+            std::unique_lock<std::mutex> lock;
+            ProdRecord* rec = prodtable->find(header.prodindex, lock);
+            if (rec && rec->hasBOP) {
+                /**
+                 * If seqnum != 0, the seqnum is updated right after the
+                 * retx BOP is handled, which means the multicast thread
+                 * is receiving blocks. In this case, nothing needs to be
+                 * done.
+                 */
+                if (rec->seqnum.load(std::memory_order_relaxed) == 0) {
                     /**
-                     * If seqnum != 0, the seqnum is updated right after the
-                     * retx BOP is handled, which means the multicast thread
-                     * is receiving blocks. In this case, nothing needs to be
-                     * done.
+                     * If two indices don't equal, the product is totally
+                     * missed. Thus, all blocks should be requested.
+                     * On the other hand, if they equal, there could be
+                     * concurrency or a gap before next product arrives.
+                     * Only requesting EOP is the most economic choice.
                      */
-                    if (seqnum == 0) {
-                        /**
-                         * If two indices don't equal, the product is totally
-                         * missed. Thus, all blocks should be requested.
-                         * On the other hand, if they equal, there could be
-                         * concurrency or a gap before next product arrives.
-                         * Only requesting EOP is the most economic choice.
-                         */
-                        if (lastprodidx != header.prodindex) {
-                            requestAnyMissingData(header.prodindex, prodsize);
-                        }
-                        pushMissingEopReq(header.prodindex);
+                    if (lastprodidx != header.prodindex) {
+                        requestAnyMissingData(rec, rec->prodsize, true);
                     }
-                }
-                else {
-                    throw std::runtime_error("fmtpRecvv3::retxHandler() "
-                            "Product not found in BOPMap after receiving retx BOP");
+                    pushMissingEopReq(header.prodindex);
                 }
             }
+            else if (!prodfilter ||
+                    !prodfilter->isRejected(header.prodindex)) {
+                /* a rejected product is removed as soon as its BOP arrives */
+                throw std::runtime_error("fmtpRecvv3::retxHandler() "
+                        "Product not found in product table after receiving "
+                        "retx BOP");
+            }
         }
         else if (header.flags == FMTP_RETX_DATA) {
             #ifdef MEASURE
@@ -1043,142 +1705,57 @@ void fmtpRecvv3::retxHandler()
                 WriteToLog(debugmsg);
             #endif
 
-            uint32_t prodsize = 0;
-            void*    prodptr  = NULL;
-            {
-                std::unique_lock<std::mutex> lock(trackermtx);
-                if (trackermap.count(header.prodindex)) {
-                    ProdTracker tracker = trackermap[header.prodindex];
-                    prodsize = tracker.prodsize;
-                    prodptr  = tracker.prodptr;
-                }
-            }
+            /**
+             * The block is placed without locking the product, so that the
+             * multicast thread can keep on receiving blocks of the same
+             * product. The reference keeps the product from being removed
+             * until the block is written.
+             */
+            ProdRef        ref;
+            ProdRecord*    rec    = prodtable->acquire(header.prodindex, ref);
+            const uint64_t offset = offsetOf(header);
 
-            if ((prodsize > 0) &&
-                (header.seqnum + header.payloadlen > prodsize)) {
+            if (rec && offset + header.payloadlen > rec->prodsize) {
                 throw std::runtime_error("fmtpRecvv3::retxHandler() "
                         "retx block out of boundary: seqnum=" +
-                        std::to_string(header.seqnum) + ", payloadlen=" +
+                        std::to_string(offset) + ", payloadlen=" +
                         std::to_string(header.payloadlen) + "prodsize=" +
-                        std::to_string(prodsize));
-            }
-            else if (prodsize <= 0) {
-                (void)pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,
-                                             &ignoredState);
-                /**
-                 * drop the payload since there is no location allocated
-                 * in the product queue.
-                 */
-                nbytes = tcprecv->recvData(NULL, 0, paytmp, header.payloadlen);
-                (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,
-                                             &ignoredState);
-                if (nbytes == 0) {
-                    throw std::runtime_error("fmtpRecvv3::retxHandler() "
-                            "Error reading FMTP_RETX_DATA (prodsize <= 0): "
-                            "EOF read from the retransmission TCP socket.");
-                }
-
-                /*
-                 * The TrackerMap will only be erased when the associated
-                 * product has been completely received. So if no valid
-                 * prodindex found, it indicates the product is received
-                 * and thus removed or there is out-of-order arrival on
-                 * TCP.
-                 */
-                continue;
-            }
-
-            if (prodptr) {
-                (void)pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,
-                                             &ignoredState);
-                nbytes = tcprecv->recvData(NULL, 0, (char*)prodptr +
-                                           header.seqnum, header.payloadlen);
-                (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,
-                                             &ignoredState);
-                if (nbytes == 0) {
-                    throw std::runtime_error("fmtpRecvv3::retxHandler() "
-                            "Error reading FMTP_RETX_DATA (with prodptr): "
-                            "EOF read from the retransmission TCP socket.");
-                }
-            }
-            else {
-                /** dump the payload since there is no product queue */
-                (void)pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,
-                                             &ignoredState);
-                nbytes = tcprecv->recvData(NULL, 0, paytmp, header.payloadlen);
-                (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,
-                                             &ignoredState);
-                if (nbytes == 0) {
-                    throw std::runtime_error("fmtpRecvv3::retxHandler() "
-                            "Error reading FMTP_RETX_DATA (without prodptr): "
-                            "EOF read from the retransmission TCP socket.");
-                }
+                        std::to_string(rec->prodsize));
             }
 
             /**
-             * set() returns -1/0/1, receiver can parse the info for detailed
-             * operations. But currently it is ignored to keep the process going
-             */
-            pSegMNG->set(header.prodindex, header.seqnum, header.payloadlen);
-
-            if (pSegMNG->delIfComplete(header.prodindex)) {
-                sendRetxEnd(header.prodindex);
-                bool inTracker;
-                {
-                    std::unique_lock<std::mutex> lock(trackermtx);
-                    inTracker = trackermap.count(header.prodindex);
-                }
-                if (notifier && inTracker) {
-                    notifier->notify_of_eop(header.prodindex);
-                }
-                else if (inTracker) {
-                    /**
-                     * Updates the most recently acknowledged product and notifies
-                     * a dummy notification handler (getNotify()).
-                     */
-                    {
-                        std::unique_lock<std::mutex> lock(notifyprodmtx);
-                        notifyprodidx = header.prodindex;
-                    }
-                    notify_cv.notify_one();
-                }
-
-                {
-                    std::unique_lock<std::mutex> lock(trackermtx);
-                    trackermap.erase(header.prodindex);
-                }
-
-                #ifdef DEBUG2
-                    std::string debugmsg = "[MSG] Product #" +
-                        std::to_string(tmpidx);
-                    debugmsg += " has been completely received";
-                    std::cout << debugmsg << std::endl;
-                    WriteToLog(debugmsg);
-                #elif DEBUG1
-                    std::string debugmsg = "[MSG] Product #" +
-                        std::to_string(tmpidx);
-                    debugmsg += " has been completely received";
-                    std::cout << debugmsg << std::endl;
-                #endif
+             * The record will only be removed when the associated product
+             * has been completely received. So if no valid prodindex found,
+             * it indicates the product is received and thus removed or there
+             * is out-of-order arrival on TCP. If the block has been claimed
+             * by the multicast thread, it is a duplicate. In both cases, and
+             * if there is no product queue, the payload is dropped.
+             */
+            const bool claimed = rec &&
+                rec->claimBlock(offset, header.payloadlen) > 0;
+            char* const sinkbuf = (claimed && rec->tofile) ?
+                filesink->getBuffer() : NULL;
+            char* const dest = sinkbuf ? sinkbuf :
+                (claimed && rec->prodptr) ?
+                (char*)rec->prodptr + offset : paytmp;
 
-                #ifdef MEASURE
-                    uint32_t bytes = measure->getsize(header.prodindex);
-                    std::string measuremsg = "[SUCCESS] Product #" +
-                        std::to_string(tmpidx);
-                    measuremsg += ": product received, size = ";
-                    measuremsg += std::to_string(bytes);
-                    measuremsg += " bytes, elapsed time = ";
-                    measuremsg += measure->gettime(header.prodindex);
-                    measuremsg += " seconds.";
-                    if (measure->getEOPmiss(header.prodindex)) {
-                        measuremsg += " EOP is retransmitted";
-                    }
-                    std::cout << measuremsg << std::endl;
-                    WriteToLog(measuremsg);
-                    /* remove the measurement if completely received */
-                    measure->remove(header.prodindex);
-                #endif
+            (void)pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &ignoredState);
+            nbytes = tcprecv->recvData(NULL, 0, dest, header.payloadlen);
+            (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &ignoredState);
+            if (nbytes == 0) {
+                throw std::runtime_error("fmtpRecvv3::retxHandler() "
+                        "Error reading FMTP_RETX_DATA: "
+                        "EOF read from the retransmission TCP socket.");
+            }
+            if (sinkbuf) {
+                filesink->write(header.prodindex, offset, sinkbuf,
+                        header.payloadlen);
             }
+
+            const bool last = claimed && rec->blockDone();
+            ref.release();
+            if (last)
+                checkCompletion(header.prodindex);
         }
         else if (header.flags == FMTP_RETX_EOP) {
             #ifdef MEASURE
@@ -1193,13 +1770,22 @@ void fmtpRecvv3::retxHandler()
             retxEOPHandler(header);
         }
         else if (header.flags == FMTP_RETX_REJ) {
-            const bool hadBop = rmMisBOPinSet(header.prodindex);
+            bopAnswered(header.prodindex);
             /*
-             * if associated segmap exists, remove the segmap. Also avoid
-             * duplicated notification if the product's segmap has
-             * already been removed.
+             * if the record of the product exists, either with a BOP or as
+             * a requested BOP, remove it. Also avoid duplicated notification
+             * if the record has already been removed.
              */
-            if (pSegMNG->rmProd(header.prodindex) || hadBop) {
+            std::unique_lock<std::mutex> lock;
+            ProdRecord* rec = prodtable->find(header.prodindex, lock);
+            if (rec) {
+                accountLoss(rec);
+                prodtable->erase(rec);
+                lock.unlock();
+                (void)eopTimers.cancel(header.prodindex);
+                if (filesink)
+                    (void)filesink->discard(header.prodindex);
+
                 #ifdef MODBASE
                     uint32_t tmpidx = header.prodindex % MODBASE;
                 #else
@@ -1214,25 +1800,7 @@ void fmtpRecvv3::retxHandler()
                     WriteToLog(debugmsg);
                 #endif
 
-                if (notifier) {
-                    notifier->notify_of_missed_prod(header.prodindex);
-                }
-                else {
-                    /**
-                     * Updates the most recently acknowledged product and
-                     * notifies a dummy notification handler (getNotify()).
-                     */
-                    {
-                        std::unique_lock<std::mutex> lock(notifyprodmtx);
-                        notifyprodidx = header.prodindex;
-                    }
-                    notify_cv.notify_one();
-                }
-
-                {
-                    std::unique_lock<std::mutex> lock(trackermtx);
-                    trackermap.erase(header.prodindex);
-                }
+                notifyEnd(header.prodindex, false);
             }
         }
     }
@@ -1242,58 +1810,199 @@ void fmtpRecvv3::retxHandler()
 
 
 /**
- * Fetch the requests from an internal message queue and call corresponding
- * handler to send requests respectively. The read operation on the internal
- * message queue will block if the queue is empty itself. The existing request
- * being handled will only be removed from the queue if the handler returns a
- * successful state. Doesn't return until a "shutdown" request is encountered or
- * an error occurs.
+ * Tells whether a block whose request was held back by the reorder window is
+ * still missing, and accounts for its loss if so. A block that arrived in the
+ * meantime, or whose product is done, is not requested.
  *
- * @param[in] none
+ * @param[in] reqmsg  Request for the block.
+ * @return            True if the block should be requested.
  */
-void fmtpRecvv3::retxRequester()
+bool fmtpRecvv3::confirmGap(const INLReqMsg& reqmsg)
 {
-    while(1)
-    {
-        INLReqMsg reqmsg;
+    ProdRef     ref;
+    ProdRecord* rec = prodtable->acquire(reqmsg.prodindex, ref);
+
+    if (!rec)
+        return false;
+    if (rec->hasBlock(reqmsg.seqnum)) {
+        reorderedBlocks.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    rec->blocksLost.fetch_add(1, std::memory_order_relaxed);
+    blocksLost.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
 
-        {
-            std::unique_lock<std::mutex> lock(msgQmutex);
-            while (msgqueue.empty())
-                msgQfilled.wait(lock);
-            reqmsg = msgqueue.front();
-        }
 
-        if (reqmsg.reqtype == SHUTDOWN)
-            break; // leave "shutdown" message in queue
+/**
+ * Tells whether the packet of a retransmission request is still missing.
+ *
+ * @param[in]  reqmsg  The request.
+ * @param[out] known   Whether the product of the request is still known.
+ * @return             True if the packet is still missing.
+ */
+bool fmtpRecvv3::isMissing(const INLReqMsg& reqmsg, bool& known)
+{
+    if (reqmsg.reqtype == MISSING_DATA) {
+        ProdRef     ref;
+        ProdRecord* rec = prodtable->acquire(reqmsg.prodindex, ref);
+        known = rec != NULL;
+        return rec && !rec->hasBlock(reqmsg.seqnum);
+    }
+
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = prodtable->find(reqmsg.prodindex, lock);
+    known = rec != NULL;
+    if (!rec)
+        return false;
+    return (reqmsg.reqtype == MISSING_BOP) ? !rec->hasBOP :
+            (rec->hasBOP && !rec->eopArrived);
+}
 
-        if ( ((reqmsg.reqtype == MISSING_BOP) &&
-                sendBOPRetxReq(reqmsg.prodindex)) ||
-            ((reqmsg.reqtype == MISSING_DATA) &&
-                sendDataRetxReq(reqmsg.prodindex, reqmsg.seqnum,
-                                reqmsg.payloadlen)) ||
-            ((reqmsg.reqtype == MISSING_EOP) &&
-                sendEOPRetxReq(reqmsg.prodindex)) )
-        {
-            std::unique_lock<std::mutex> lock(msgQmutex);
-            msgqueue.pop();
-        }
-    }
+
+/**
+ * Returns the offset of the data of a data-packet. The seqnum of the packet
+ * is the offset itself, or with 64-bit offsets, see SetWideOffsets(), the
+ * number of the FMTP_DATA_LEN block, since every block but the last one of a
+ * product is that long.
+ *
+ * @param[in] header  Header of the packet.
+ * @return            Offset of the data in bytes.
+ */
+uint64_t fmtpRecvv3::offsetOf(const FmtpHeader& header) const
+{
+    return wide ? (uint64_t)header.seqnum * FMTP_DATA_LEN : header.seqnum;
 }
 
 
 /**
- * Remove the BOP identified by the given prodindex out of the list. If the
- * BOP is not in the list, return a false. Or if it's in the list, remove it
- * and reurn a true.
+ * Fetches the requests from an internal message queue in batches and calls the
+ * corresponding handler to send each request. Data gaps which may only be
+ * reordering are held back in a reorder window and requested once it has
+ * passed if they are still open. A request for a packet which is already
+ * requested and not yet overdue is dropped; an overdue request whose packet
+ * is still missing is sent again with an exponentially growing timeout. A
+ * batch is coalesced first, so that a burst of adjacent missing blocks costs
+ * only a few requests. Missed BOPs are requested in ranges, one window of
+ * products at a time, see BopBacklog. A batch of acknowledgements is sent once
+ * its deadline has passed, see SetAckBatch(). A request that can't be sent is
+ * retried until it succeeds. Doesn't return until a "shutdown" request is
+ * encountered or an error occurs.
  *
- * @param[in] prodindex        Product index of the missing BOP
+ * @param[in] none
  */
-bool fmtpRecvv3::rmMisBOPinSet(uint32_t prodindex)
+void fmtpRecvv3::retxRequester()
 {
-    std::unique_lock<std::mutex> lock(BOPSetMtx);
-    bool rmsuccess = misBOPset.erase(prodindex);
-    return rmsuccess;
+    typedef RetxReqTable::Clock Clock;
+
+    INLReqMsg     reqmsgs[RETX_REQ_BATCH];
+    ReorderWindow window(reorderDelay);
+    RetxReqTable  outstanding(RETX_TIMEOUT, RETX_MAX_TIMEOUT);
+
+    while(1)
+    {
+        size_t nreqs;
+        if (window.empty() && !outstanding.hasDeadline() &&
+                !bopBacklog.hasDeadline() &&
+                !(ackBatch && ackBatch->hasDeadline())) {
+            nreqs = msgqueue.pop(reqmsgs, RETX_REQ_BATCH);
+        }
+        else {
+            Clock::time_point deadline = Clock::time_point::max();
+            if (!window.empty())
+                deadline = window.nextDeadline();
+            if (outstanding.hasDeadline() &&
+                    outstanding.nextDeadline() < deadline)
+                deadline = outstanding.nextDeadline();
+            if (bopBacklog.hasDeadline() &&
+                    bopBacklog.nextDeadline() < deadline)
+                deadline = bopBacklog.nextDeadline();
+            if (ackBatch && ackBatch->hasDeadline() &&
+                    ackBatch->nextDeadline() < deadline)
+                deadline = ackBatch->nextDeadline();
+            nreqs = msgqueue.pop(reqmsgs, RETX_REQ_BATCH, deadline);
+        }
+        const Clock::time_point now = Clock::now();
+        size_t n    = 0;
+        bool   stop = false;
+
+        for (size_t i = 0; i < nreqs; ++i) {
+            if (reqmsgs[i].reqtype == SHUTDOWN) {
+                stop = true;
+                break;
+            }
+            if (reqmsgs[i].reqtype == DELAYED_DATA)
+                (void)window.add(reqmsgs[i], now);
+            else if (reqmsgs[i].reqtype == MISSING_BOP_RANGE)
+                addMissingBops(reqmsgs[i].prodindex,
+                               (uint32_t)reqmsgs[i].seqnum);
+            else if (reqmsgs[i].reqtype != ACKS_PENDING)
+                reqmsgs[n++] = reqmsgs[i];
+        }
+        nreqs = n;
+
+        /* gaps still open after the reorder window are requested */
+        const size_t end = nreqs + window.expire(now, reqmsgs + nreqs,
+                RETX_REQ_BATCH - nreqs);
+        for (size_t i = nreqs; i < end; ++i) {
+            if (confirmGap(reqmsgs[i]))
+                reqmsgs[nreqs++] = reqmsgs[i];
+        }
+
+        /* a packet is only requested once until its request is overdue */
+        n = 0;
+        for (size_t i = 0; i < nreqs; ++i) {
+            if (outstanding.add(reqmsgs[i], now))
+                reqmsgs[n++] = reqmsgs[i];
+            else
+                duplicateReqs.fetch_add(1, std::memory_order_relaxed);
+        }
+        nreqs = n;
+
+        /* overdue requests, e.g. lost with a TCP connection, are repeated */
+        const size_t last = nreqs + outstanding.expire(now, reqmsgs + nreqs,
+                RETX_REQ_BATCH - nreqs);
+        for (size_t i = nreqs; i < last; ++i) {
+            bool known;
+            if (isMissing(reqmsgs[i], known)) {
+                outstanding.retry(reqmsgs[i], now);
+                retriedReqs.fetch_add(1, std::memory_order_relaxed);
+                reqmsgs[nreqs++] = reqmsgs[i];
+            }
+            else if (known) {
+                outstanding.remove(reqmsgs[i]);
+            }
+            else {
+                outstanding.forget(reqmsgs[i].prodindex);
+            }
+        }
+        nreqs = RetxReqQueue::coalesce(reqmsgs, nreqs);
+
+        for (size_t i = 0; i < nreqs; ++i) {
+            const INLReqMsg& reqmsg = reqmsgs[i];
+            while (!( ((reqmsg.reqtype == MISSING_BOP) &&
+                        sendBOPRetxReq(reqmsg.prodindex)) ||
+                      ((reqmsg.reqtype == MISSING_DATA) &&
+                        sendDataRetxReq(reqmsg.prodindex, reqmsg.seqnum,
+                                        reqmsg.payloadlen)) ||
+                      ((reqmsg.reqtype == MISSING_EOP) &&
+                        sendEOPRetxReq(reqmsg.prodindex)) ))
+                ;
+        }
+
+        uint32_t       first;
+        const uint32_t count = bopBacklog.next(now, first);
+        if (count)
+            requestBopRange(first, count, outstanding, now);
+
+        /* a batch of acknowledgements is sent by its deadline at the latest */
+        if (ackBatch && ackBatch->hasDeadline() &&
+                (stop || !(now < ackBatch->nextDeadline())))
+            flushAcks();
+
+        if (stop)
+            break;
+    }
 }
 
 
@@ -1322,15 +2031,11 @@ void fmtpRecvv3::retxEOPHandler(const FmtpHeader& header)
         WriteToLog(debugmsg);
     #endif
 
-    bool hasBOP = false;
-    {
-        std::unique_lock<std::mutex> lock(trackermtx);
-        if (trackermap.count(header.prodindex)) {
-            hasBOP = true;
-        }
-    }
-    if (hasBOP) {
-        EOPHandler(header);
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = prodtable->find(header.prodindex, lock);
+    if (rec && rec->hasBOP) {
+        rec->eopArrived = true;
+        EOPHandler(header, rec, lock);
     }
     else {
         /**
@@ -1360,23 +2065,17 @@ void fmtpRecvv3::retxEOPHandler(const FmtpHeader& header)
  *
  * @pre                       The socket contains a FMTP data-packet.
  * @param[in] header          The associated, peeked-at, and decoded header.
+ * @param[in] dest            Where the data goes, or NULL to discard the
+ *                            data.
  * @throw std::runtime_error  if an error occurs while reading the multicast
  *                            socket.
  * @throw std::runtime_error  if the packet is invalid.
  */
-void fmtpRecvv3::readMcastData(const FmtpHeader& header)
+void fmtpRecvv3::readMcastData(const FmtpHeader& header, void* const dest)
 {
     ssize_t nbytes = 0;
-    void*   prodptr = NULL;
-    {
-        std::unique_lock<std::mutex> lock(trackermtx);
-        if (trackermap.count(header.prodindex)) {
-            ProdTracker tracker = trackermap[header.prodindex];
-            prodptr = tracker.prodptr;
-        }
-    }
 
-    if (0 == prodptr) {
+    if (0 == dest) {
         const int bufsize = FMTP_HEADER_LEN + header.payloadlen;
         char pktbuf[bufsize];
         nbytes = read(mcastSock, &pktbuf, bufsize);
@@ -1387,7 +2086,7 @@ void fmtpRecvv3::readMcastData(const FmtpHeader& header)
 
         iovec[0].iov_base = &headBuf;
         iovec[0].iov_len  = sizeof(headBuf);
-        iovec[1].iov_base = (char*)prodptr + header.seqnum;
+        iovec[1].iov_base = dest;
         iovec[1].iov_len  = header.payloadlen;
 
         nbytes = readv(mcastSock, iovec, 2);
@@ -1415,13 +2114,6 @@ void fmtpRecvv3::readMcastData(const FmtpHeader& header)
             std::cout << debugmsg << std::endl;
             WriteToLog(debugmsg);
         #endif
-
-        /**
-         * Since now receiver has no knowledge about the segment size, it
-         * trusts the packet from sender is legal. Also, ProdBlockMNG has
-         * control to make sure no malicious segments will be ACKed.
-         */
-        pSegMNG->set(header.prodindex, header.seqnum, header.payloadlen);
     }
 }
 
@@ -1431,33 +2123,43 @@ void fmtpRecvv3::readMcastData(const FmtpHeader& header)
  * data-packet of the current data-product and its most recently-received
  * data-packet.
  *
+ * Unless `immediate` is set, the requests are held back for the reorder
+ * window, see `SetReorderWindow()`.
+ *
  * @pre                  The most recently-received data-packet is for the
  *                       current data-product.
- * @param[in] prodindex  Product index.
+ * @pre                  `rec` is locked or referenced by the caller.
+ * @param[in] rec        Record of the product.
  * @param[in] mostRecent The most recently-received data-packet of the current
  *                       data-product.
+ * @param[in] immediate  Whether to bypass the reorder window because the gap
+ *                       can't be due to reordering.
  */
-void fmtpRecvv3::requestAnyMissingData(const uint32_t prodindex,
-                                       const uint32_t mostRecent)
+void fmtpRecvv3::requestAnyMissingData(ProdRecord* const rec,
+                                       const uint64_t    mostRecent,
+                                       const bool        immediate)
 {
-    uint32_t seqnum = 0;
-    {
-        std::unique_lock<std::mutex> lock(trackermtx);
-        if (trackermap.count(prodindex)) {
-            ProdTracker tracker = trackermap[prodindex];
-            seqnum = tracker.seqnum + tracker.paylen;
-        }
-    }
+    const uint32_t prodindex = rec->prodindex.load(std::memory_order_relaxed);
+    uint64_t       seqnum    = rec->seqnum.load(std::memory_order_relaxed) +
+                               rec->paylen.load(std::memory_order_relaxed);
 
     /**
      * requests for missing blocks counting from the last received
-     * block sequence number.
+     * block sequence number. Blocks which have already been claimed by
+     * the retransmission thread are skipped.
      */
     if (seqnum != mostRecent) {
-        std::unique_lock<std::mutex> lock(msgQmutex);
-
         for (; seqnum < mostRecent; seqnum += FMTP_DATA_LEN) {
+            if (rec->hasBlock(seqnum))
+                continue;
+            if (reorderDelay > 0 && !immediate) {
+                /* the loss is accounted for if the gap stays open */
+                pushDelayedDataReq(prodindex, seqnum, FMTP_DATA_LEN);
+                continue;
+            }
             pushMissingDataReq(prodindex, seqnum, FMTP_DATA_LEN);
+            rec->blocksLost.fetch_add(1, std::memory_order_relaxed);
+            blocksLost.fetch_add(1, std::memory_order_relaxed);
 
             #ifdef MODBASE
                 uint32_t tmpidx = prodindex % MODBASE;
@@ -1478,22 +2180,20 @@ void fmtpRecvv3::requestAnyMissingData(const uint32_t prodindex,
             #endif
         }
 
-        // TODO: Merged RETX_REQ cannot be implemented so far, because
-        // current FMTP header has a limited payloadlen field of 16 bits.
-        // A merged RETX_REQ could have more than 65535 in payloadlen, the
-        // field thus needs to be upgraded to 32 bits. We will do this in
-        // the next version of FMTP.
-        //
-        /* merged requests, multiple missing blocks in one request */
-        // pushMissingDataReq(prodindex, seqnum, mostRecent - seqnum);
-
-        msgQfilled.notify_one();
+        /**
+         * One request per block; retxRequester() merges adjacent blocks into
+         * requests of up to 64 KiB, which is what the 16-bit payloadlen of a
+         * request can describe.
+         */
     }
 }
 
 
 /**
- * Requests BOP packets for a prodindex interval.
+ * Requests BOP packets for a prodindex interval. The interval is handed to
+ * the retransmission-request thread as a whole, which requests it in ranges
+ * of a bounded window, so that even the gap of a long outage costs the
+ * multicast thread next to nothing.
  *
  * @param[in] openleft   Open left end of the prodindex interval.
  * @param[in] openright  Open right end of the prodindex interval.
@@ -1501,13 +2201,84 @@ void fmtpRecvv3::requestAnyMissingData(const uint32_t prodindex,
 void fmtpRecvv3::requestMissingBops(const uint32_t openleft,
                                      const uint32_t openright)
 {
-    if (openright - openleft > 1) {
-        for (uint32_t i = (openleft + 1); i != openright; i++) {
-            if (addUnrqBOPinSet(i)) {
-                pushMissingBopReq(i);
-            }
+    /* an older product, e.g. a late retransmission, leaves no gap */
+    if ((int32_t)(openright - openleft) > 1)
+        pushMissingBopRange(openleft + 1, openright - openleft - 1);
+}
+
+
+/**
+ * Adds products whose BOPs were missed to the backlog of BOP requests. The
+ * oldest products beyond the limit of the backlog are given up as missed, so
+ * that a huge gap can't grow the backlog without bound.
+ *
+ * @param[in] first  Index of the first product.
+ * @param[in] count  Number of products.
+ */
+void fmtpRecvv3::addMissingBops(const uint32_t first, const uint32_t count)
+{
+    bopBacklog.add(first, count);
+
+    uint32_t dropped;
+    uint32_t ndropped;
+    while ((ndropped = bopBacklog.dropExcess(dropped)) != 0) {
+        bopsLost.fetch_add(ndropped, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < ndropped; ++i)
+            notifyEnd(dropped + i, false);
+    }
+}
+
+
+/**
+ * Requests the BOPs of a range of products with one request. A placeholder
+ * record makes sure each BOP is requested once, and an entry in the table of
+ * outstanding requests repeats the request of a single product whose answer
+ * is overdue. Products which are already known are requested with the others,
+ * so that the sender's answer for the last product completes the range; if
+ * all of them are known, nothing is requested. Products which don't fit into
+ * the product table any more are given up as missed.
+ *
+ * @param[in]     first        Index of the first product.
+ * @param[in]     count        Number of products.
+ * @param[in,out] outstanding  Table of outstanding requests.
+ * @param[in]     now          Current time.
+ */
+void fmtpRecvv3::requestBopRange(const uint32_t first, const uint32_t count,
+                                 RetxReqTable& outstanding,
+                                 const RetxReqTable::Clock::time_point& now)
+{
+    bool     any     = false;
+    uint32_t tracked = count;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        std::unique_lock<std::mutex> lock;
+        bool                         added;
+        ProdRecord* rec = prodtable->findOrAdd(first + i, lock, added);
+        if (!rec) {
+            /* the products which can't be tracked are given up */
+            for (uint32_t j = i; j < count; ++j)
+                notifyEnd(first + j, false);
+            tracked = i;
+            break;
+        }
+        if (added) {
+            rec->bopRequested = true;
+            lock.unlock();
+            const INLReqMsg reqmsg = {MISSING_BOP, first + i, 0, 0};
+            (void)outstanding.add(reqmsg, now);
+            bopsLost.fetch_add(1, std::memory_order_relaxed);
+            any = true;
         }
     }
+
+    if (any) {
+        while (!sendBOPRangeReq(first, tracked))
+            ;
+    }
+    if (!any || tracked < count) {
+        /* nothing to wait for, at least not for the end of the range */
+        (void)bopBacklog.answered(first + count - 1);
+    }
 }
 
 
@@ -1526,7 +2297,7 @@ int fmtpRecvv3::requestMissingBopsExclusive(const uint32_t prodindex)
     /* fetches the most recent product index */
     uint32_t lastprodidx = prodidx_mcast;
 
-    if (prodindex - lastprodidx > 0) {
+    if ((int32_t)(prodindex - lastprodidx) > 0) {
         prodidx_mcast = prodindex;
     }
 
@@ -1551,7 +2322,7 @@ int fmtpRecvv3::requestMissingBopsInclusive(const uint32_t prodindex)
     /* fetches the most recent product index */
     uint32_t lastprodidx = prodidx_mcast;
 
-    if (prodindex - lastprodidx > 0) {
+    if ((int32_t)(prodindex - lastprodidx) > 0) {
         prodidx_mcast = prodindex;
     }
 
@@ -1565,58 +2336,78 @@ int fmtpRecvv3::requestMissingBopsInclusive(const uint32_t prodindex)
  * Handles a multicast FMTP data-packet given the associated peeked-at and
  * decoded FMTP header. Directly store and check for missing blocks.
  *
- * @pre                       The socket contains a FMTP data-packet.
+ * @pre                       The socket contains a FMTP data-packet unless
+ *                            `payload` is given.
  * @param[in] header          The associated, peeked-at and decoded header.
+ * @param[in] payload         Payload of a data-packet unpacked from an
+ *                            aggregate, or NULL if the packet is still in the
+ *                            socket.
  * @throw std::runtime_error  if `seqnum + payloadlen` is out of boundary.
  * @throw std::runtime_error  if the packet is invalid.
  * @throw std::runtime_error   if an error occurs while reading the socket.
  */
-void fmtpRecvv3::recvMemData(const FmtpHeader& header)
+void fmtpRecvv3::recvMemData(const FmtpHeader& header,
+                             const char* const payload)
 {
-    //int state = 0;
-    uint32_t prodsize = 0;
-    {
-        std::unique_lock<std::mutex> lock(trackermtx);
-        if (trackermap.count(header.prodindex)) {
-            ProdTracker tracker = trackermap[header.prodindex];
-            prodsize = tracker.prodsize;
-        }
-    }
-
-    if ((prodsize > 0) && (header.seqnum + header.payloadlen > prodsize)) {
-        throw std::runtime_error(
-            std::string("fmtpRecvv3::recvMemData() block out of boundary: ") +
-            "seqnum=" + std::to_string(header.seqnum) + ", payloadlen=" +
-            std::to_string(header.payloadlen) + ", prodsize=" +
-            std::to_string(prodsize));
-    }
+    ProdRef     ref;
+    ProdRecord* rec = prodtable->acquire(header.prodindex, ref);
 
     /**
-     * If prodsize > 0, the BOP of the currently receiving product is
+     * If the record is found, the BOP of the currently receiving product is
      * received, otherwise, it is either removed or not even received.
      * Since this function is called by multicast thread, it is likely
      * to be the first time a product arrives. So BOP loss is the only
      * possibility.
      */
-    if (prodsize > 0) {
-        readMcastData(header);
-        {
-            std::unique_lock<std::mutex> lock(antiracemtx);
-            requestAnyMissingData(header.prodindex, header.seqnum);
-            /* update most recent seqnum and payloadlen */
-            {
-                std::unique_lock<std::mutex> lock(trackermtx);
-                if (trackermap.count(header.prodindex)) {
-                    trackermap[header.prodindex].seqnum = header.seqnum;
-                    trackermap[header.prodindex].paylen = header.payloadlen;
-                }
-            }
+    if (rec) {
+        const uint64_t offset = offsetOf(header);
+        if (offset + header.payloadlen > rec->prodsize) {
+            throw std::runtime_error(
+                std::string("fmtpRecvv3::recvMemData() block out of boundary: ")
+                + "seqnum=" + std::to_string(offset) + ", payloadlen="
+                + std::to_string(header.payloadlen) + ", prodsize="
+                + std::to_string(rec->prodsize));
+        }
+
+        /**
+         * Since now receiver has no knowledge about the segment size, it
+         * trusts the packet from sender is legal. Also, claimBlock() has
+         * control to make sure no malicious segments will be ACKed. A block
+         * which has already been retransmitted is discarded.
+         */
+        const bool claimed =
+            rec->claimBlock(offset, header.payloadlen) > 0;
+        char* const sinkbuf = (claimed && rec->tofile) ?
+            filesink->getBuffer() : NULL;
+        char* const dest = sinkbuf ? sinkbuf :
+                (claimed && rec->prodptr) ?
+                (char*)rec->prodptr + offset : NULL;
+        if (!payload)
+            readMcastData(header, dest);
+        else if (dest)
+            (void)memcpy(dest, payload, header.payloadlen);
+        if (sinkbuf) {
+            filesink->write(header.prodindex, offset, sinkbuf,
+                    header.payloadlen);
         }
+        const bool last = claimed && rec->blockDone();
+
+        requestAnyMissingData(rec, offset);
+        /* update most recent seqnum and payloadlen */
+        rec->seqnum.store(offset, std::memory_order_relaxed);
+        rec->paylen.store(header.payloadlen, std::memory_order_relaxed);
+        ref.release();
+
+        if (last)
+            checkCompletion(header.prodindex);
     }
     else {
         char buf[1];
-        (void)recv(mcastSock, buf, 1, 0); // skip unusable datagram
-        (void)requestMissingBopsInclusive(header.prodindex);
+        if (!payload)
+            (void)recv(mcastSock, buf, 1, 0); // skip unusable datagram
+        /* packets of a rejected product may precede its filter */
+        if (!prodfilter || !prodfilter->isRejected(header.prodindex))
+            (void)requestMissingBopsInclusive(header.prodindex);
     }
 
 #if 0
@@ -1628,6 +2419,155 @@ void fmtpRecvv3::recvMemData(const FmtpHeader& header)
 }
 
 
+/**
+ * Handles a multicast datagram which carries the complete BOP, data and EOP
+ * packets of several small products, see fmtpSendv3::sendProducts(). The
+ * datagram is read out at once and each packet is handled in turn as if it
+ * had arrived by itself, so every product is tracked, requested and
+ * acknowledged like any other. A datagram whose packets don't fill its payload
+ * exactly is rejected before any of them is handled.
+ *
+ * @pre                       The multicast socket contains a FMTP aggregate.
+ * @param[in] header          The associated, peeked-at and decoded header.
+ * @throw std::runtime_error  if an error occurs while reading the socket.
+ * @throw std::runtime_error  if the datagram is invalid.
+ * @throw std::runtime_error  Receiving application error.
+ */
+void fmtpRecvv3::mcastAggregateHandler(const FmtpHeader& header)
+{
+    char          pktBuf[MAX_FMTP_PACKET_LEN];
+    const ssize_t nbytes = recv(mcastSock, pktBuf, sizeof(pktBuf), 0);
+
+    if (nbytes < 0) {
+        throw std::runtime_error("fmtpRecvv3::mcastAggregateHandler() recv() "
+                "less than zero bytes.");
+    }
+    checkPayloadLen(header, nbytes);
+
+    /* the packets must fill the payload exactly before any is handled */
+    const char* const end    = pktBuf + FMTP_HEADER_LEN + header.payloadlen;
+    char*             packet = pktBuf + FMTP_HEADER_LEN;
+    for (uint32_t i = 0; i < header.seqnum; i++) {
+        FmtpHeader inner;
+        if (end - packet < FMTP_HEADER_LEN) {
+            throw std::runtime_error("fmtpRecvv3::mcastAggregateHandler(): "
+                    "truncated header");
+        }
+        decodeHeader(packet, inner);
+        packet += FMTP_HEADER_LEN;
+        if (end - packet < inner.payloadlen) {
+            throw std::runtime_error("fmtpRecvv3::mcastAggregateHandler(): "
+                    "truncated payload");
+        }
+        packet += inner.payloadlen;
+    }
+    if (packet != end) {
+        throw std::runtime_error("fmtpRecvv3::mcastAggregateHandler(): "
+                "payload longer than its packets");
+    }
+
+    packet = pktBuf + FMTP_HEADER_LEN;
+    for (uint32_t i = 0; i < header.seqnum; i++) {
+        FmtpHeader inner;
+        decodeHeader(packet, inner);
+        const char* const payload = packet + FMTP_HEADER_LEN;
+
+        trackMcastProduct(inner.prodindex);
+        if ((inner.flags & ~FMTP_WIDE) == FMTP_BOP)
+            mcastBOPHandler(inner, payload);
+        else if (inner.flags == FMTP_MEM_DATA)
+            recvMemData(inner, payload);
+        else if (inner.flags == FMTP_EOP)
+            mcastEOPHandler(inner, true);
+        else if ((inner.flags & ~FMTP_WIDE) == FMTP_TINY)
+            mcastTinyHandler(inner, payload);
+
+        packet += FMTP_HEADER_LEN + inner.payloadlen;
+    }
+}
+
+
+/**
+ * Handles a multicast datagram which carries a whole product, see
+ * tinyHandler(). Since the datagram is only peeked at, it's read out here
+ * unless the product was unpacked from an aggregate.
+ *
+ * @pre                       The multicast socket contains a FMTP tiny
+ *                            product unless `payload` is given.
+ * @param[in] header          The associated, already-decoded FMTP header.
+ * @param[in] payload         Payload of a tiny product unpacked from an
+ *                            aggregate, or NULL.
+ * @throw std::runtime_error  if an error occurs while reading the socket.
+ * @throw std::runtime_error  if the packet is invalid.
+ * @throw std::runtime_error  Receiving application error.
+ */
+void fmtpRecvv3::mcastTinyHandler(const FmtpHeader& header,
+                                  const char* const payload)
+{
+    if (payload) {
+        tinyHandler(header, payload);
+    }
+    else {
+        const int     bufsize = FMTP_HEADER_LEN + header.payloadlen;
+        char          pktBuf[bufsize];
+        const ssize_t nbytes = recv(mcastSock, pktBuf, bufsize, 0);
+
+        if (nbytes < 0) {
+            throw std::runtime_error("fmtpRecvv3::mcastTinyHandler() recv() "
+                    "got less than 0 bytes returned.");
+        }
+
+        checkPayloadLen(header, nbytes);
+        tinyHandler(header, pktBuf + FMTP_HEADER_LEN);
+    }
+
+    /* a gap before this product means the BOPs in between were lost */
+    requestMissingBopsExclusive(header.prodindex);
+}
+
+
+/**
+ * Notes the product of a multicast packet. Products are multicast one after
+ * the other, so a later product than the previous one ends the multicast of
+ * that one, see inferEOP().
+ *
+ * @param[in] prodindex  Index of the product.
+ */
+void fmtpRecvv3::trackMcastProduct(const uint32_t prodindex)
+{
+    if ((int32_t)(prodindex - lastMcastProd) > 0) {
+        /* the multicast of the previous product is over */
+        inferEOP(lastMcastProd);
+        lastMcastProd = prodindex;
+    }
+}
+
+
+/**
+ * Handles the end of the multicast of a product as if its EOP had arrived,
+ * because a packet of a later product has. Products are multicast one after
+ * the other, so the blocks and EOP of the product which haven't arrived by
+ * now are lost. The missing tail is requested at once instead of waiting for
+ * the EOP timer, and the timer is brought forward to request the EOP if it
+ * isn't there by the end of the reorder window. The timer itself stays the
+ * fallback for the last product of a burst, which no packet follows.
+ *
+ * @param[in] prodindex  Index of the product.
+ */
+void fmtpRecvv3::inferEOP(const uint32_t prodindex)
+{
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = prodtable->find(prodindex, lock);
+
+    if (rec && rec->hasBOP && !rec->eopArrived) {
+        requestAnyMissingData(rec, rec->prodsize);
+        lock.unlock();
+        eopTimers.push(prodindex, reorderDelay);
+        eopsInferred.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
 /**
  * Request for EOP retransmission if the EOP is not received. This function is
  * an integration of isEOPReceived() and pushMissingEopReq() but being made
@@ -1639,7 +2579,9 @@ void fmtpRecvv3::recvMemData(const FmtpHeader& header)
 bool fmtpRecvv3::reqEOPifMiss(const uint32_t prodindex)
 {
     bool hasReq = false;
-    if (!getEOPStatus(prodindex)) {
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = prodtable->find(prodindex, lock);
+    if (rec && rec->hasBOP && !rec->eopArrived) {
         pushMissingEopReq(prodindex);
         hasReq = true;
     }
@@ -1656,6 +2598,7 @@ void* fmtpRecvv3::runTimerThread(void* ptr)
 {
     fmtpRecvv3* const recvr = static_cast<fmtpRecvv3*>(ptr);
     try {
+        recvr->setupThread(TIMER_THREAD);
         recvr->timerThread();
     }
     catch (std::runtime_error& e) {
@@ -1683,6 +2626,25 @@ bool fmtpRecvv3::sendBOPRetxReq(uint32_t prodindex)
 }
 
 
+/**
+ * Sends a request for retransmission of the BOPs of a range of products. The
+ * sender answers each of them in order with a BOP or a rejection.
+ *
+ * @param[in] first  Index of the first product.
+ * @param[in] count  Number of products, at most MAX_BOP_RANGE.
+ */
+bool fmtpRecvv3::sendBOPRangeReq(uint32_t first, uint32_t count)
+{
+    FmtpHeader header;
+    header.prodindex  = htonl(first);
+    header.seqnum     = htonl(count);
+    header.payloadlen = 0;
+    header.flags      = htons(FMTP_BOP_RANGE_REQ);
+
+    return (-1 != tcprecv->sendData(&header, sizeof(FmtpHeader), NULL, 0));
+}
+
+
 /**
  * Sends a request for retransmission of the missing EOP identified by the
  * given product index.
@@ -1707,15 +2669,17 @@ bool fmtpRecvv3::sendEOPRetxReq(uint32_t prodindex)
  * a legal block.
  *
  * @param[in] prodindex        The product index of the requested block.
- * @param[in] seqnum           The sequence number of the requested block.
+ * @param[in] seqnum           The offset of the requested block in bytes,
+ *                             which is sent as the number of the block with
+ *                             64-bit offsets, see SetWideOffsets().
  * @param[in] payloadlen       The block size of the requested block.
  */
-bool fmtpRecvv3::sendDataRetxReq(uint32_t prodindex, uint32_t seqnum,
+bool fmtpRecvv3::sendDataRetxReq(uint32_t prodindex, uint64_t seqnum,
                                   uint16_t payloadlen)
 {
     FmtpHeader header;
     header.prodindex  = htonl(prodindex);
-    header.seqnum     = htonl(seqnum);
+    header.seqnum     = htonl(wide ? seqnum / FMTP_DATA_LEN : seqnum);
     header.payloadlen = htons(payloadlen);
     header.flags      = htons(FMTP_RETX_REQ);
 
@@ -1741,6 +2705,74 @@ bool fmtpRecvv3::sendRetxEnd(uint32_t prodindex)
 }
 
 
+/**
+ * Sends the acknowledgements of a batch of products as one
+ * FMTP_RETX_END_BATCH message, whose payload holds the first index and the
+ * number of products of each range.
+ *
+ * @param[in] ranges  The ranges of products, at most MAX_ACK_RANGES.
+ * @return            False if the message couldn't be sent.
+ */
+bool fmtpRecvv3::sendRetxEndBatch(const std::vector<AckBatch::Range>& ranges)
+{
+    uint32_t payload[2 * MAX_ACK_RANGES];
+    size_t   n = 0;
+    for (size_t i = 0; i < ranges.size() && i < MAX_ACK_RANGES; i++) {
+        payload[n++] = htonl(ranges[i].first);
+        payload[n++] = htonl(ranges[i].count);
+    }
+
+    FmtpHeader header;
+    header.prodindex  = htonl(ranges.front().first);
+    header.seqnum     = htonl(n / 2);
+    header.payloadlen = htons(n * sizeof(uint32_t));
+    header.flags      = htons(FMTP_RETX_END_BATCH);
+
+    return (-1 != tcprecv->sendData(&header, sizeof(FmtpHeader),
+                (char*)payload, n * sizeof(uint32_t)));
+}
+
+
+/**
+ * Acknowledges a product which the sender needn't keep for this receiver any
+ * more. Without a batch, FMTP_RETX_END is sent at once. Otherwise, the
+ * product is added to the batch, which is sent right away if it's full; the
+ * first product of a batch wakes the retx request thread, which sends the
+ * batch by its deadline.
+ *
+ * @param[in] prodindex  Index of the product.
+ */
+void fmtpRecvv3::acknowledge(const uint32_t prodindex)
+{
+    if (!ackBatch) {
+        sendRetxEnd(prodindex);
+        return;
+    }
+
+    bool started;
+    if (ackBatch->add(prodindex, AckBatch::Clock::now(), started)) {
+        flushAcks();
+    }
+    else if (started) {
+        const INLReqMsg reqmsg = {ACKS_PENDING, prodindex, 0, 0};
+        msgqueue.push(reqmsg);
+    }
+}
+
+
+/**
+ * Sends the batch of acknowledgements, if any. A batch which can't be sent is
+ * dropped like a FMTP_RETX_END which can't be sent; the sender keeps its
+ * products until they time out.
+ */
+void fmtpRecvv3::flushAcks()
+{
+    std::vector<AckBatch::Range> ranges;
+    if (ackBatch->take(ranges))
+        (void)sendRetxEndBatch(ranges);
+}
+
+
 /**
  * Start the retxRequester thread using a passed-in fmtpRecvv3 pointer. Called
  * by `pthread_create()`.
@@ -1753,6 +2785,7 @@ void* fmtpRecvv3::StartRetxRequester(void* ptr)
 {
     fmtpRecvv3* const recvr = static_cast<fmtpRecvv3*>(ptr);
     try {
+        recvr->setupThread(RETX_REQUESTER_THREAD);
         recvr->retxRequester();
     }
     catch (std::runtime_error& e) {
@@ -1771,12 +2804,8 @@ void* fmtpRecvv3::StartRetxRequester(void* ptr)
  */
 void fmtpRecvv3::stopJoinRetxRequester()
 {
-    {
-        std::unique_lock<std::mutex> lock(msgQmutex);
-        INLReqMsg reqmsg = {SHUTDOWN};
-        msgqueue.push(reqmsg);
-        msgQfilled.notify_one();
-    }
+    const INLReqMsg reqmsg = {SHUTDOWN};
+    msgqueue.push(reqmsg);
 
     int status = pthread_join(retx_rq, NULL);
     if (status) {
@@ -1797,6 +2826,7 @@ void* fmtpRecvv3::StartRetxHandler(void* ptr)
 {
     fmtpRecvv3* const recvr = static_cast<fmtpRecvv3*>(ptr);
     try {
+        recvr->setupThread(RETX_HANDLER_THREAD);
         recvr->retxHandler();
     }
     catch (std::exception& e) {
@@ -1844,6 +2874,10 @@ void* fmtpRecvv3::StartMcastHandler(
 {
     fmtpRecvv3* const recvr = static_cast<fmtpRecvv3*>(arg);
     try {
+        recvr->setupThread(MCAST_THREAD);
+        /* the buffers are filled by this thread, so keep them near it */
+        if (recvr->bufpool && recvr->bufpool->getNode() < 0)
+            recvr->bufpool->bind(-1);
         recvr->mcastHandler();
     }
     catch (const std::exception& e) {
@@ -1876,6 +2910,41 @@ void fmtpRecvv3::stopJoinMcastHandler()
 }
 
 
+/**
+ * Applies the configured CPU and, for the multicast thread, the scheduling
+ * policy to the calling thread. Called by each thread of the receiver when it
+ * starts.
+ *
+ * @param[in] thread          Which thread of the receiver it is.
+ * @throw std::system_error   if the policy can't be applied, e.g. because the
+ *                            CPU doesn't exist or real-time scheduling isn't
+ *                            permitted.
+ */
+void fmtpRecvv3::setupThread(const Thread thread)
+{
+    if (threadCpu[thread] >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(threadCpu[thread], &cpus);
+        const int status = pthread_setaffinity_np(pthread_self(),
+                sizeof(cpus), &cpus);
+        if (status)
+            throw std::system_error(status, std::system_category(),
+                    "fmtpRecvv3::setupThread() Couldn't pin thread to CPU " +
+                    std::to_string(threadCpu[thread]));
+    }
+    if (thread == MCAST_THREAD && fifoPriority) {
+        struct sched_param param = {};
+        param.sched_priority = fifoPriority;
+        const int status = pthread_setschedparam(pthread_self(), SCHED_FIFO,
+                &param);
+        if (status)
+            throw std::system_error(status, std::system_category(),
+                    "fmtpRecvv3::setupThread() Couldn't set SCHED_FIFO");
+    }
+}
+
+
 /**
  * Start a Retx procedure, including the retxHandler thread and retxRequester
  * thread. These two threads will be started independently and after the
@@ -1927,20 +2996,14 @@ void fmtpRecvv3::startTimerThread()
 
 
 /**
- * Stops the timer task by adding a "shutdown" entry to the associated queue and
- * joins with its thread.
+ * Stops the timer task by disabling the timing wheel and joins with its
+ * thread.
  *
  * @throws std::runtime_error if the timer thread can't be joined.
  */
 void fmtpRecvv3::stopJoinTimerThread()
 {
-    timerParam timerparam;
-    {
-        std::unique_lock<std::mutex> lock(timerQmtx);
-        timerParam timerparam = {0, -1.0};
-        timerParamQ.push(timerparam);
-        timerQfilled.notify_one();
-    }
+    eopTimers.disable(); // will cause timer thread to exit
 
     int status = pthread_join(timer_t, NULL);
     if (status) {
@@ -1951,59 +3014,32 @@ void fmtpRecvv3::stopJoinTimerThread()
 
 
 /**
- * Sets the EOP arrival status to true, which indicates the successful
- * reception of EOP.
- *
- * @param[in] prodindex    Product index which the EOP belongs to.
- */
-void fmtpRecvv3::setEOPStatus(const uint32_t prodindex)
-{
-    std::unique_lock<std::mutex> lock(EOPmapmtx);
-    EOPmap[prodindex] = true;
-}
-
-
-/**
- * Runs a timer thread to watch for the case of missing EOP. If an expected
- * EOP is not received, the timer should trigger after sleeping. If it is
- * received from the mcast socket, do not trigger to request for retransmission
- * of the EOP. mcastEOPHandler will notify the condition variable to interrupt
- * the timed wait function. Doesn't return unless a "shutdown" entry is
- * encountered or an exception is thrown.
+ * Runs a timer thread to watch for the case of missing EOP. Every product has
+ * its own deadline in the timing wheel, so the deadlines of any number of
+ * concurrent products expire independently. If an expected EOP is not
+ * received by its deadline, the timer requests for retransmission of the
+ * EOP. If it is received from the mcast socket, mcastEOPHandler cancels the
+ * deadline. Doesn't return unless the timing wheel is disabled or an
+ * exception is thrown.
  */
 void fmtpRecvv3::timerThread()
 {
     while (1) {
-        timerParam timerparam;
-        {
-            std::unique_lock<std::mutex> lock(timerQmtx);
-            while (timerParamQ.empty())
-                timerQfilled.wait(lock);
-            timerparam = timerParamQ.front();
-        }
-
-        if (timerparam.seconds < 0)
-            break; // leave "shutdown" entry in queue
-
-        unsigned long period = timerparam.seconds * 1000000000lu;
-        {
-            std::unique_lock<std::mutex> lk(timerWakemtx);
-            /** sleep for a given amount of time in precision of nanoseconds */
-            timerWake.wait_for(lk, std::chrono::nanoseconds(period));
+        uint32_t prodindex;
+        try {
+            prodindex = eopTimers.pop();
         }
-
-        /** pop the current entry in timer queue when timer wakes up */
-        {
-            std::unique_lock<std::mutex> lock(timerQmtx);
-            timerParamQ.pop();
+        catch (std::runtime_error& e) {
+            // Timing wheel, `eopTimers`, was externally disabled
+            return;
         }
 
         /** if EOP has not been received yet, issue a request for retx */
-        if (reqEOPifMiss(timerparam.prodindex)) {
+        if (reqEOPifMiss(prodindex)) {
             #ifdef MODBASE
-                uint32_t tmpidx = timerparam.prodindex % MODBASE;
+                uint32_t tmpidx = prodindex % MODBASE;
             #else
-                uint32_t tmpidx = timerparam.prodindex;
+                uint32_t tmpidx = prodindex;
             #endif
 
             #ifdef DEBUG2
@@ -2014,12 +3050,6 @@ void fmtpRecvv3::timerThread()
                 WriteToLog(debugmsg);
             #endif
         }
-        /**
-         * After waking up, the timer checks the EOP arrival status of
-         * a product and decides whether to request for re-transmission.
-         * Only the timer can clear the EOPmap.
-         */
-        clearEOPStatus(timerparam.prodindex);
     }
 }
 
@@ -41,15 +41,25 @@
 #include <exception>
 #include <list>
 #include <mutex>
-#include <queue>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
+#include "ProductBufferPool.h"
+#include "AckBatch.h"
+#include "BopBacklog.h"
+#include "FileSink.h"
+#include "McastPoller.h"
 #include "Measure.h"
-#include "ProdSegMNG.h"
+#include "NotifyDispatcher.h"
+#include "ProdFilter.h"
+#include "ProdTable.h"
+#include "RateEstimator.h"
 #include "RecvProxy.h"
+#include "ReorderWindow.h"
+#include "RetxReqQueue.h"
+#include "RetxReqTable.h"
 #include "TcpRecv.h"
+#include "TimingWheel.h"
 #include "fmtpBase.h"
 
 
@@ -62,20 +72,55 @@ struct StartTimerInfo
     fmtpRecvv3* receiver;   /*!< a poniter to the fmtpRecvv3 instance */
 };
 
-struct ProdTracker
+
+/**
+ * Loss statistics of the multicast reception of a receiver. A product which
+ * lost blocks while the socket dropped datagrams has likely lost them in the
+ * receiving host rather than on the network.
+ */
+struct LossStats
 {
-    uint32_t     prodsize;
-    void*        prodptr;
-    uint32_t     seqnum;
-    uint16_t     paylen;
+    /**
+     * datagrams dropped by the kernel because the socket buffer was full or,
+     * for filtered products, by the socket filter
+     */
+    uint64_t socketDrops;
+    /* data blocks missed on multicast and requested */
+    uint64_t blocksLost;
+    /* gaps closed by a late multicast block within the reorder window */
+    uint64_t reorderedBlocks;
+    /* missing EOPs inferred from a packet of a later product */
+    uint64_t eopsInferred;
+    /* requests not sent because the same one was outstanding */
+    uint64_t duplicateReqs;
+    /* requests sent again because they weren't answered in time */
+    uint64_t retriedReqs;
+    /* BOPs missed on multicast and requested */
+    uint64_t bopsLost;
+    /* finished products which missed data blocks on multicast */
+    uint64_t lossyProducts;
+    /* lossy products during whose reception the socket dropped datagrams */
+    uint64_t socketLossProducts;
+    /* unsubscribed and duplicate products dropped after their BOP */
+    uint64_t filteredProducts;
+    /* size of the socket buffer in bytes as granted by the kernel */
+    int      rcvbufSize;
+    /* false if the kernel doesn't count drops, see SO_RXQ_OVFL */
+    bool     dropsCounted;
 };
 
-typedef std::unordered_map<uint32_t, ProdTracker> TrackerMap;
-typedef std::unordered_map<uint32_t, bool> EOPStatusMap;
-
 
 class fmtpRecvv3 {
 public:
+    /* threads of a receiver whose CPU can be set */
+    enum Thread {
+        MCAST_THREAD,
+        RETX_HANDLER_THREAD,
+        RETX_REQUESTER_THREAD,
+        TIMER_THREAD,
+        THREAD_COUNT
+    };
+
     fmtpRecvv3(const std::string    tcpAddr,
                const unsigned short tcpPort,
                const std::string    mcastAddr,
@@ -85,12 +130,172 @@ public:
     ~fmtpRecvv3();
 
     uint32_t getNotify();
+    /**
+     * Returns the statistics of the notification stage.
+     *
+     * @return  The statistics, 0 for the parts which aren't set up.
+     */
+    NotifyStats getNotifyStats() const;
+    /**
+     * Returns the loss statistics of the multicast reception.
+     *
+     * @return  The statistics.
+     */
+    LossStats getLossStats() const;
+    /**
+     * Returns the link speed which the EOP deadlines of new products are
+     * based on: the estimated arrival rate of the multicast, or the speed set
+     * by `SetLinkSpeed()` before there is an estimate.
+     *
+     * @return  The link speed in bits per second.
+     */
+    uint64_t getLinkSpeed() const;
+    /**
+     * Returns a buffer of the buffer pool which the receiving application
+     * kept in `notify_of_bop()`.
+     *
+     * @param[in] buf                 The buffer.
+     * @throw std::invalid_argument  if `buf` isn't a buffer of the pool.
+     */
+    void releaseBuffer(void* const buf);
+    /**
+     * Acknowledges completed products to the sender in batches instead of one
+     * message each. The sender must understand FMTP_RETX_END_BATCH. Must be
+     * called before `Start()`.
+     *
+     * @param[in] count              Number of products which are sent at
+     *                               once.
+     * @param[in] seconds            Longest time a product waits for its
+     *                               batch.
+     * @throw std::invalid_argument  if `count` is 0 or `seconds` isn't
+     *                               positive.
+     */
+    void SetAckBatch(const unsigned count, const double seconds);
+    /**
+     * Reserves buffers which are offered to the receiving application in
+     * `notify_of_bop()`. Must be called before `Start()`.
+     *
+     * @param[in] bufsize  Size of a buffer in bytes.
+     * @param[in] count    Number of buffers.
+     */
+    void SetBufferPool(const size_t bufsize, const size_t count);
+    /**
+     * Makes the multicast thread poll its socket instead of sleeping until a
+     * packet arrives. Must be called before `Start()`.
+     *
+     * @param[in] usecs  How long the kernel may busy poll the device per read
+     *                   in microseconds, 0 to sleep as usual.
+     */
+    void SetBusyPoll(const unsigned usecs);
+    /**
+     * Reserves buffers in size classes from `minsize` to `maxsize` which are
+     * offered to the receiving application in `notify_of_bop()`. Must be
+     * called before `Start()`.
+     *
+     * @param[in] minsize  Size of a buffer of the smallest class in bytes.
+     * @param[in] maxsize  Size of a buffer of the largest class in bytes.
+     * @param[in] count    Number of buffers of every class.
+     * @param[in] node     NUMA node of the buffers, -1 for the node of the
+     *                     multicast-receiving thread.
+     */
+    void SetProductBufferPool(const size_t minsize, const size_t maxsize,
+                              const size_t count, const int node = -1);
+    /**
+     * Writes products into files in a directory instead of memory supplied by
+     * the receiving application. Must be called before `Start()`.
+     *
+     * @param[in] dir             Directory of the product files.
+     * @throw std::system_error   if the writer thread can't be started.
+     */
+    void SetFileSink(const std::string& dir);
     void SetLinkSpeed(uint64_t speed);
+    /**
+     * Delivers end-of-product and missed-product notifications on a pool of
+     * threads instead of the receiving threads. Must be called before
+     * `Start()`.
+     *
+     * @param[in] nthreads          Number of notification threads.
+     * @param[in] capacity          Maximum number of waiting notifications,
+     *                              a power of 2.
+     * @throw std::invalid_argument if an argument is invalid.
+     * @throw std::system_error     if a thread can't be started.
+     */
+    void SetNotifyDispatcher(const unsigned nthreads,
+                             const size_t capacity = 65536);
+    /**
+     * Subscribes to the products whose BOP metadata satisfy a predicate. The
+     * packets of the other products are dropped by the kernel. Must be called
+     * before `Start()`.
+     *
+     * @param[in] accept  Called with the metadata of every BOP on the thread
+     *                    which receives it; returns false to reject.
+     */
+    void SetProductFilter(const ProdFilter::Predicate& accept);
+    /**
+     * Waits before requesting a data block which is missing when a later one
+     * arrives, in case the packets are merely reordered. Must be called
+     * before `Start()`.
+     *
+     * @param[in] seconds            How long to wait, 0 to request at once.
+     * @throw std::invalid_argument  if `seconds` is negative.
+     */
+    void SetReorderWindow(const double seconds);
+    /**
+     * Runs the multicast thread with the SCHED_FIFO policy. Must be called
+     * before `Start()`.
+     *
+     * @param[in] priority           Real-time priority, 0 for the normal
+     *                               policy.
+     * @throw std::invalid_argument  if `priority` isn't valid for SCHED_FIFO.
+     */
+    void SetSchedFifo(const int priority);
+    /**
+     * Pins a thread of the receiver to a CPU. Must be called before
+     * `Start()`.
+     *
+     * @param[in] thread             The thread.
+     * @param[in] cpu                The CPU, -1 to let the thread run on any.
+     * @throw std::invalid_argument  if `thread` or `cpu` is invalid.
+     */
+    void SetThreadAffinity(const Thread thread, const int cpu);
+    /**
+     * Expects the 64-bit product sizes and offsets of a sender which calls
+     * `fmtpSendv3::SetWideOffsets()`. A BOP of the other width is dropped and
+     * its product given up as missed. Must be called before `Start()`.
+     *
+     * @param[in] enable  Whether to expect 64-bit sizes and offsets.
+     */
+    void SetWideOffsets(bool enable);
     void Start();
     void Stop();
 
 private:
-    bool addUnrqBOPinSet(uint32_t prodindex);
+    /**
+     * Accounts for the loss of a product which is about to be removed.
+     *
+     * @pre                 `rec` is locked by the caller.
+     * @param[in] rec       Record of the product.
+     */
+    void accountLoss(const ProdRecord* const rec);
+    /**
+     * Starts the reception of a product whose BOP has arrived: filters it,
+     * opens its file in the file sink and notifies the receiving application.
+     * A rejected product is removed and acknowledged.
+     *
+     * @pre                  `rec` is locked by `lock` and has no BOP.
+     * @param[in] prodindex  Index of the product.
+     * @param[in] BOPmsg     The BOP of the product.
+     * @param[in] rec        Record of the product.
+     * @param[in,out] lock   Lock of the record, released if the product is
+     *                       rejected.
+     * @param[out] prodptr   Where the product goes, or NULL.
+     * @param[out] tofile    Whether the product goes to the file sink.
+     * @return               False if the product is rejected.
+     */
+    bool beginProduct(const uint32_t prodindex, BOPMsg& BOPmsg,
+                      ProdRecord* const rec,
+                      std::unique_lock<std::mutex>& lock, void*& prodptr,
+                      bool& tofile);
     /**
      * Parse BOP message and call notifier to notify receiving application.
      *
@@ -100,8 +305,21 @@ private:
      */
     void BOPHandler(const FmtpHeader& header,
                     const char* const  FmtpPacketData);
+    /**
+     * Completes a product if all of its blocks have been written.
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void checkCompletion(const uint32_t prodindex);
     void checkPayloadLen(const FmtpHeader& header, const size_t nbytes);
-    void clearEOPStatus(const uint32_t prodindex);
+    /**
+     * Tells whether a block whose request was held back by the reorder window
+     * is still missing, and accounts for its loss if so.
+     *
+     * @param[in] reqmsg  Request for the block.
+     * @return            True if the block should be requested.
+     */
+    bool confirmGap(const INLReqMsg& reqmsg);
     /**
      * Decodes the header of a FMTP packet in-place.
      *
@@ -119,38 +337,209 @@ private:
      * @throw std::runtime_error  if the packet has in invalid payload length.
      */
     void decodeHeader(char* const packet, FmtpHeader& header);
-    void EOPHandler(const FmtpHeader& header);
-    bool getEOPStatus(const uint32_t prodindex);
-    bool hasLastBlock(const uint32_t prodindex);
-    void initEOPStatus(const uint32_t prodindex);
+    /**
+     * Checks if a product is complete after its EOP is received. Completes the
+     * product or requests the blocks still missing.
+     *
+     * @pre                  `rec` is locked by `lock` and has a BOP.
+     * @param[in] header     Header of the EOP packet.
+     * @param[in] rec        Record of the product.
+     * @param[in,out] lock   Lock of the record, released if the product is
+     *                       complete.
+     */
+    void EOPHandler(const FmtpHeader& header, ProdRecord* const rec,
+                    std::unique_lock<std::mutex>& lock);
+    /**
+     * Handles the end of the multicast of a product whose EOP hasn't arrived
+     * because a packet of a later product has.
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void inferEOP(const uint32_t prodindex);
+    /**
+     * Tells whether the packet of a retransmission request is still missing.
+     *
+     * @param[in]  reqmsg  The request.
+     * @param[out] known   Whether the product of the request is still known.
+     * @return             True if the packet is still missing.
+     */
+    bool isMissing(const INLReqMsg& reqmsg, bool& known);
+    /**
+     * Returns the offset of the data of a data-packet.
+     *
+     * @param[in] header  Header of the packet.
+     * @return            Offset of the data in bytes.
+     */
+    uint64_t offsetOf(const FmtpHeader& header) const;
+    /**
+     * Notifies the receiving application about the end of a product on the
+     * calling thread.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] complete   True if the product is complete, false if it is
+     *                       missed.
+     */
+    void deliverNotice(const uint32_t prodindex, const bool complete);
     void joinGroup(std::string mcastAddr, const unsigned short mcastPort);
+    /**
+     * Enables the drop counter of the multicast socket and sizes its buffer
+     * for the link speed.
+     */
+    void setupMcastSock();
+    /**
+     * Applies the configured CPU and scheduling policy to the calling thread.
+     *
+     * @param[in] thread          Which thread of the receiver it is.
+     * @throw std::system_error   if the policy can't be applied.
+     */
+    void setupThread(const Thread thread);
+    /**
+     * Returns the number of datagrams the multicast socket has dropped.
+     *
+     * @return  The number of dropped datagrams.
+     */
+    uint64_t socketDrops() const;
     /**
      * Handles a multicast BOP message given a peeked-at FMTP header.
      *
      * @pre                           The multicast socket contains a FMTP BOP
-     *                                packet.
+     *                                packet unless `payload` is given.
      * @param[in] header              The associated, already-decoded FMTP header.
+     * @param[in] payload             Payload of a BOP unpacked from an
+     *                                aggregate, or NULL.
      * @throw     std::system_error   if an error occurs while reading the socket.
      * @throw     std::runtime_error  if the packet is invalid.
      */
-    void mcastBOPHandler(const FmtpHeader& header);
+    void mcastBOPHandler(const FmtpHeader& header,
+                         const char* const payload = NULL);
     void mcastHandler();
-    void mcastEOPHandler(const FmtpHeader& header);
+    void mcastEOPHandler(const FmtpHeader& header,
+                         const bool unpacked = false);
+    /**
+     * Handles a multicast datagram which carries the packets of several small
+     * products.
+     *
+     * @pre                       The multicast socket contains a FMTP
+     *                            aggregate.
+     * @param[in] header          The associated, peeked-at and decoded header.
+     * @throw std::runtime_error  if an error occurs while reading the socket.
+     * @throw std::runtime_error  if the datagram is invalid.
+     */
+    void mcastAggregateHandler(const FmtpHeader& header);
+    /**
+     * Handles a multicast datagram which carries a whole product.
+     *
+     * @pre                       The multicast socket contains a FMTP tiny
+     *                            product unless `payload` is given.
+     * @param[in] header          The associated, already-decoded FMTP header.
+     * @param[in] payload         Payload of a tiny product unpacked from an
+     *                            aggregate, or NULL.
+     * @throw std::system_error   if an error occurs while reading the socket.
+     * @throw std::runtime_error  if the packet is invalid.
+     */
+    void mcastTinyHandler(const FmtpHeader& header,
+                          const char* const payload = NULL);
+    /**
+     * Notes the product of a multicast packet. A later product than the
+     * previous one ends the multicast of that one, see inferEOP().
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void trackMcastProduct(const uint32_t prodindex);
+    /**
+     * Notifies the receiving application about the end of a product, through
+     * the notification dispatcher if there is one.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @param[in] complete   True if the product is complete, false if it is
+     *                       missed.
+     */
+    void notifyEnd(const uint32_t prodindex, const bool complete);
+    /**
+     * Acknowledges a completely received product and notifies the receiving
+     * application.
+     *
+     * @pre                  The record of the product is removed.
+     * @param[in] prodindex  Index of the completed product.
+     * @param[in] timed      Whether the product has an EOP timer.
+     */
+    void productCompleted(const uint32_t prodindex, const bool timed = true);
+    /**
+     * Decodes the product size, metadata size and metadata at the start of
+     * the payload of a BOP or a tiny product.
+     *
+     * @param[in]  header         Header of the packet.
+     * @param[in]  payload        Payload of the packet.
+     * @param[out] BOPmsg         The decoded BOP.
+     * @return                    Number of bytes decoded.
+     * @throw std::runtime_error  if the payload is too small.
+     * @throw std::runtime_error  if the amount of metadata is invalid.
+     */
+    size_t parseBOP(const FmtpHeader& header, const char* const payload,
+                    BOPMsg& BOPmsg);
+    /**
+     * Drops a BOP or tiny product whose FMTP_WIDE flag doesn't match
+     * SetWideOffsets() and gives its product up as missed.
+     *
+     * @param[in] header           Header of the packet.
+     * @return                     True if the packet was dropped.
+     * @throws std::runtime_error  Receiving application error.
+     */
+    bool dropMismatchedBOP(const FmtpHeader& header);
     /**
      * Pushes a request for a data-packet onto the retransmission-request queue.
      *
      * @param[in] prodindex  Index of the associated data-product.
-     * @param[in] seqnum     Sequence number of the data-packet.
+     * @param[in] seqnum     Offset of the data-packet in bytes.
      * @param[in] datalen    Amount of data in bytes.
      */
-    void pushMissingDataReq(const uint32_t prodindex, const uint32_t seqnum,
+    void pushMissingDataReq(const uint32_t prodindex, const uint64_t seqnum,
                             const uint16_t datalen);
     /**
-     * Pushes a request for a BOP-packet onto the retransmission-request queue.
+     * Pushes the products of missed BOPs onto the retransmission-request
+     * queue.
+     *
+     * @param[in] first  Index of the first product.
+     * @param[in] count  Number of products.
+     */
+    void pushMissingBopRange(const uint32_t first, const uint32_t count);
+    /**
+     * Notes the answer of the sender for a BOP and wakes up the
+     * retransmission-request thread if the next range of missed BOPs can be
+     * requested.
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void bopAnswered(const uint32_t prodindex);
+    /**
+     * Adds products whose BOPs were missed to the backlog of BOP requests and
+     * gives up the oldest ones beyond its limit.
+     *
+     * @param[in] first  Index of the first product.
+     * @param[in] count  Number of products.
+     */
+    void addMissingBops(const uint32_t first, const uint32_t count);
+    /**
+     * Requests the BOPs of a range of products with one request.
+     *
+     * @param[in]     first        Index of the first product.
+     * @param[in]     count        Number of products.
+     * @param[in,out] outstanding  Table of outstanding requests.
+     * @param[in]     now          Current time.
+     */
+    void requestBopRange(const uint32_t first, const uint32_t count,
+                         RetxReqTable& outstanding,
+                         const RetxReqTable::Clock::time_point& now);
+    /**
+     * Pushes a request for a data-packet which may only be reordered onto the
+     * retransmission-request queue, see `SetReorderWindow()`.
      *
      * @param[in] prodindex  Index of the associated data-product.
+     * @param[in] seqnum     Offset of the data-packet in bytes.
+     * @param[in] datalen    Amount of data in bytes.
      */
-    void pushMissingBopReq(const uint32_t prodindex);
+    void pushDelayedDataReq(const uint32_t prodindex, const uint64_t seqnum,
+                            const uint16_t datalen);
     /**
      * Pushes a request for a EOP-packet onto the retransmission-request queue.
      *
@@ -159,7 +548,6 @@ private:
     void pushMissingEopReq(const uint32_t prodindex);
     void retxHandler();
     void retxRequester();
-    bool rmMisBOPinSet(uint32_t prodindex);
     /**
      * Handles a retransmitted BOP message.
      *
@@ -169,28 +557,42 @@ private:
     void retxBOPHandler(const FmtpHeader& header,
                         const char* const  FmtpPacketData);
     void retxEOPHandler(const FmtpHeader& header);
+    /**
+     * Receives a product which arrived in a single packet, without an EOP
+     * timer or block tracking.
+     *
+     * @param[in] header          Header of the packet.
+     * @param[in] payload         Payload of the packet.
+     * @throw std::runtime_error  if the packet is invalid.
+     */
+    void tinyHandler(const FmtpHeader& header, const char* const payload);
     /**
      * Reads the data portion of a FMTP data-packet into the location specified
-     * by the receiving application.
+     * by the receiving application or a buffer of the file sink.
      *
      * @pre                       The socket contains a FMTP data-packet.
      * @param[in] header          The associated, peeked-at and decoded header.
+     * @param[in] dest            Where the data goes, or NULL to discard the
+     *                            data.
      * @throw std::system_error   if an error occurs while reading the multicast
      *                            socket.
      * @throw std::runtime_error  if the packet is invalid.
      */
-    void readMcastData(const FmtpHeader& header);
+    void readMcastData(const FmtpHeader& header, void* const dest);
     /**
      * Requests data-packets that lie between the last previously-received
      * data-packet of the current data-product and its most recently-received
      * data-packet.
      *
-     * @param[in] prodindex Product index.
-     * @param[in] seqnum  The most recently-received data-packet of the current
-     *                    data-product.
+     * @pre                  `rec` is locked or referenced by the caller.
+     * @param[in] rec        Record of the product.
+     * @param[in] seqnum     The most recently-received data-packet of the
+     *                       current data-product.
+     * @param[in] immediate  Whether to bypass the reorder window.
      */
-    void requestAnyMissingData(const uint32_t prodindex,
-                               const uint32_t mostRecent);
+    void requestAnyMissingData(ProdRecord* const rec,
+                               const uint64_t mostRecent,
+                               const bool immediate = false);
     /**
      * Requests BOP packets for a prodindex interval.
      *
@@ -222,12 +624,16 @@ private:
      * Handles a multicast FMTP data-packet given the associated peeked-at and
      * decoded FMTP header. Directly store and check for missing blocks.
      *
-     * @pre                       The socket contains a FMTP data-packet.
+     * @pre                       The socket contains a FMTP data-packet
+     *                            unless `payload` is given.
      * @param[in] header          The associated, peeked-at and decoded header.
+     * @param[in] payload         Payload of a data-packet unpacked from an
+     *                            aggregate, or NULL.
      * @throw std::system_error   if an error occurs while reading the socket.
      * @throw std::runtime_error  if the packet is invalid.
      */
-    void recvMemData(const FmtpHeader& header);
+    void recvMemData(const FmtpHeader& header,
+                     const char* const payload = NULL);
     /**
      * request EOP retx if EOP is not received yet and return true if
      * the request is sent out. Otherwise, return false.
@@ -235,16 +641,35 @@ private:
     bool reqEOPifMiss(const uint32_t prodindex);
     static void* runTimerThread(void* ptr);
     bool sendBOPRetxReq(uint32_t prodindex);
+    bool sendBOPRangeReq(uint32_t first, uint32_t count);
     bool sendEOPRetxReq(uint32_t prodindex);
-    bool sendDataRetxReq(uint32_t prodindex, uint32_t seqnum,
+    bool sendDataRetxReq(uint32_t prodindex, uint64_t seqnum,
                          uint16_t payloadlen);
     bool sendRetxEnd(uint32_t prodindex);
+    /**
+     * Sends the acknowledgements of a batch of products as one
+     * FMTP_RETX_END_BATCH message.
+     *
+     * @param[in] ranges  The ranges of products.
+     * @return            False if the message couldn't be sent.
+     */
+    bool sendRetxEndBatch(const std::vector<AckBatch::Range>& ranges);
+    /**
+     * Acknowledges a product which the sender needn't keep for this receiver
+     * any more, at once or with the next batch, see `SetAckBatch()`.
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void acknowledge(const uint32_t prodindex);
+    /**
+     * Sends the batch of acknowledgements, if any.
+     */
+    void flushAcks();
     static void*  StartRetxRequester(void* ptr);
     static void*  StartRetxHandler(void* ptr);
     static void*  StartMcastHandler(void* ptr);
     void StartRetxProcedure();
     void startTimerThread();
-    void setEOPStatus(const uint32_t prodindex);
     void timerThread();
     void taskExit(const std::exception_ptr& e);
     void WriteToLog(const std::string& content);
@@ -266,24 +691,51 @@ private:
     /* struct of multicast object */
     struct ip_mreq          mreq;
     std::atomic<uint32_t>   prodidx_mcast;
+    /* product of the most recent multicast packet, see inferEOP() */
+    uint32_t                lastMcastProd;
+    /* peeks at the packets of mcastSock and counts its drops */
+    McastPoller*            poller;
+    /* subscription predicate, see SetProductFilter() */
+    ProdFilter::Predicate   accept;
+    /* drops the packets of rejected and duplicate products */
+    ProdFilter*             prodfilter;
+    /* busy-poll time of the multicast thread, 0 to sleep in recvmsg() */
+    unsigned                busyPollUsecs;
+    /* how long a data gap is held back in seconds, 0 to request at once */
+    double                  reorderDelay;
+    /* SCHED_FIFO priority of the multicast thread, 0 for SCHED_OTHER */
+    int                     fifoPriority;
+    /* CPU of each thread, -1 for any */
+    int                     threadCpu[THREAD_COUNT];
+    /* SO_RCVBUF of mcastSock as granted by the kernel */
+    int                     rcvbufSize;
+    std::atomic<uint64_t>   blocksLost;
+    std::atomic<uint64_t>   reorderedBlocks;
+    std::atomic<uint64_t>   eopsInferred;
+    std::atomic<uint64_t>   duplicateReqs;
+    std::atomic<uint64_t>   retriedReqs;
+    std::atomic<uint64_t>   bopsLost;
+    std::atomic<uint64_t>   lossyProds;
+    std::atomic<uint64_t>   sockLossProds;
     /* callback function of the receiving application */
     RecvProxy*              notifier;
     TcpRecv*                tcprecv;
-    /* a map from prodindex to struct ProdTracker */
-    TrackerMap              trackermap;
-    std::mutex              trackermtx;
-    /* eliminate race conditions between mcast and retx */
-    std::mutex              antiracemtx;
-    /* a map from prodindex to EOP arrival status */
-    EOPStatusMap            EOPmap;
-    std::mutex              EOPmapmtx;
-    ProdSegMNG*             pSegMNG;
-    std::queue<INLReqMsg>   msgqueue;
-    std::condition_variable msgQfilled;
-    std::mutex              msgQmutex;
-    /* track all the missing BOP until received */
-    std::unordered_set<uint32_t> misBOPset;
-    std::mutex              BOPSetMtx;
+    /* per-product state, including products whose BOP is requested */
+    ProdTable*              prodtable;
+    /* writes products into files if set, see SetFileSink() */
+    FileSink*               filesink;
+    /* delivers notifications if set, see SetNotifyDispatcher() */
+    NotifyDispatcher*       dispatcher;
+    /* buffers offered in notify_of_bop() if set, see SetBufferPool() */
+    ProductBufferPool*      bufpool;
+    /* requests from the other threads to the retx request thread */
+    RetxReqQueue            msgqueue;
+    /* products of missed BOPs which are requested in ranges */
+    BopBacklog              bopBacklog;
+    /* acknowledgements waiting to be sent if set, see SetAckBatch() */
+    AckBatch*               ackBatch;
+    /* sizes and offsets are 64-bit, see SetWideOffsets() */
+    bool                    wide;
     /* Retransmission request thread */
     pthread_t               retx_rq;
     /* Retransmission receive thread */
@@ -292,19 +744,17 @@ private:
     pthread_t               mcast_t;
     /* BOP timer thread */
     pthread_t               timer_t;
-    /* a queue containing timerParam structure for each product */
-    std::queue<timerParam>  timerParamQ;
-    std::condition_variable timerQfilled;
-    std::mutex              timerQmtx;
-    std::condition_variable timerWake;
-    std::mutex              timerWakemtx;
+    /* EOP deadline of each product whose BOP is received */
+    TimingWheel             eopTimers;
     std::mutex              exitMutex;
     std::condition_variable exitCond;
     bool                    stopRequested;
     std::exception_ptr      except;
-    std::mutex              linkmtx;
-    /* max link speed up to 18000 Pbps */
+    mutable std::mutex      linkmtx;
+    /* max link speed up to 18000 Pbps, used until there is an estimate */
     uint64_t                linkspeed;
+    /* arrival rate of the multicast, see getLinkSpeed() */
+    RateEstimator           linkrate;
     std::atomic_flag        retxHandlerCanceled;
     std::atomic_flag        mcastHandlerCanceled;
     std::mutex              notifyprodmtx;
@@ -33,6 +33,7 @@
 #include "TcpSend.h"
 
 #include <errno.h>
+#include <algorithm>
 #include <exception>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -47,6 +48,8 @@
     #define NULL 0
 #endif
 #define MAX_CONNECTION 100
+/* maximum number of blocks sent by one writev(), at most IOV_MAX/2 */
+#define BLOCKS_PER_WRITE 256
 
 
 /**
@@ -320,17 +323,21 @@ void TcpSend::Init()
  * FMTP header size. Parse the buffer which stores the packet header and fill
  * each field of FmtpHeader structure with corresponding information. If the
  * read() system call fails, return immediately. Otherwise, return when this
- * function finishes.
+ * function finishes. The bytes are read through the receive buffer of the
+ * socket, so a batch of requests from a receiver is read with one call.
  *
  * @param[in] retxsockfd    retransmission socket file descriptor.
+ * @param[in] rbuf          receive buffer of the socket.
  * @param[in] *recvheader   pointer of a FmtpHeader structure, whose fields
  *                          are to hold the parsed out information.
  * @return    retval        return the status value returned by read()
  */
-int TcpSend::parseHeader(int retxsockfd, FmtpHeader* recvheader)
+int TcpSend::parseHeader(int retxsockfd, TcpRecvBuffer& rbuf,
+                         FmtpHeader* recvheader)
 {
     char recvbuf[FMTP_HEADER_LEN];
-    if (recvall(retxsockfd, recvbuf, FMTP_HEADER_LEN) < FMTP_HEADER_LEN)
+    if (recvbuffered(retxsockfd, rbuf, recvbuf, FMTP_HEADER_LEN) <
+            FMTP_HEADER_LEN)
         return 0;
 
     // TODO: re-write using sizeof()
@@ -347,6 +354,25 @@ int TcpSend::parseHeader(int retxsockfd, FmtpHeader* recvheader)
 }
 
 
+/**
+ * Reads the payload which follows a header parsed by parseHeader() through
+ * the same receive buffer, e.g. the ranges of a batched acknowledgement.
+ *
+ * @param[in]  retxsockfd  retransmission socket file descriptor.
+ * @param[in]  rbuf        receive buffer of the socket.
+ * @param[out] payload     buffer for the payload.
+ * @param[in]  paylen      length of the payload in bytes.
+ * @return                 number of bytes read, less than `paylen` on EOF.
+ * @throws std::system_error  if an error is encountered reading from the
+ *                            socket.
+ */
+size_t TcpSend::parsePayload(int retxsockfd, TcpRecvBuffer& rbuf,
+                             void* payload, size_t paylen)
+{
+    return recvbuffered(retxsockfd, rbuf, payload, paylen);
+}
+
+
 /**
  * Read a given amount of bytes from the socket.
  *
@@ -396,6 +422,73 @@ int TcpSend::sendData(int retxsockfd, FmtpHeader* sendheader, char* payload,
 }
 
 
+/**
+ * Sends a range of data blocks of a product as FMTP_RETX_DATA packets. The
+ * headers of a batch of blocks are built in one array and an I/O vector
+ * alternates them with the payloads, which are sent straight from the
+ * product, so one `writev()` moves up to BLOCKS_PER_WRITE blocks. Only the last
+ * block of the range can be shorter than FMTP_DATA_LEN.
+ *
+ * @param[in] retxsockfd  retransmission socket file descriptor.
+ * @param[in] prodindex   product index.
+ * @param[in] prodptr     start of the product in memory.
+ * @param[in] start       offset of the first block, a multiple of
+ *                        FMTP_DATA_LEN.
+ * @param[in] end         offset just past the last byte to send.
+ * @param[in] wide        whether the sequence number of a block is its number
+ *                        instead of its offset.
+ * @return                number of bytes sent, headers included.
+ * @throws std::system_error  if an error is encountered writing to the
+ *                            socket.
+ */
+size_t TcpSend::sendDataBlocks(int retxsockfd, uint32_t prodindex,
+                               const char* prodptr, uint64_t start,
+                               uint64_t end, const bool wide)
+{
+    FmtpHeader   headers[BLOCKS_PER_WRITE];
+    struct iovec iov[2 * BLOCKS_PER_WRITE];
+    size_t       total = 0;
+
+    while (start < end) {
+        int nblocks = 0;
+        for (; nblocks < BLOCKS_PER_WRITE && start < end; ++nblocks) {
+            const uint16_t paylen =
+                    std::min<uint64_t>(FMTP_DATA_LEN, end - start);
+            FmtpHeader&    header = headers[nblocks];
+            header.prodindex  = htonl(prodindex);
+            header.seqnum     = htonl(wide ? start / FMTP_DATA_LEN : start);
+            header.payloadlen = htons(paylen);
+            header.flags      = htons(FMTP_RETX_DATA);
+            iov[2*nblocks].iov_base   = &header;
+            iov[2*nblocks].iov_len    = sizeof(FmtpHeader);
+            iov[2*nblocks+1].iov_base = (void*)(prodptr + start);
+            iov[2*nblocks+1].iov_len  = paylen;
+            start += paylen;
+            total += sizeof(FmtpHeader) + paylen;
+        }
+        sendallv(retxsockfd, iov, 2 * nblocks);
+    }
+
+    return total;
+}
+
+
+/**
+ * Sends FMTP packets which are already encoded into one buffer, e.g. the
+ * answers to a ranged request, with as few system calls as possible.
+ *
+ * @param[in] retxsockfd  retransmission socket file descriptor.
+ * @param[in] packets     the packets, headers in network byte order.
+ * @param[in] nbytes      size of the packets in bytes.
+ * @throws std::system_error  if an error is encountered writing to the
+ *                            socket.
+ */
+void TcpSend::sendPackets(int retxsockfd, const char* packets, size_t nbytes)
+{
+    sendall(retxsockfd, (void*)packets, nbytes);
+}
+
+
 /**
  * Sends a FMTP packet through the given retransmission connection identified
  * by retxsockfd. It blocks until all sending is finished. Or it can terminate
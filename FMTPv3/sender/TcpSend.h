@@ -61,7 +61,19 @@ public:
     unsigned short getPortNum();
     void Init(); /*!< start point that upper layer should call */
     /** only parse the header part of a coming packet */
-    int parseHeader(int retxsockfd, FmtpHeader* recvheader);
+    int parseHeader(int retxsockfd, TcpRecvBuffer& rbuf,
+                    FmtpHeader* recvheader);
+    /**
+     * Reads the payload which follows a header parsed by parseHeader().
+     *
+     * @param[in]  retxsockfd  retransmission socket file descriptor.
+     * @param[in]  rbuf        receive buffer of the socket.
+     * @param[out] payload     buffer for the payload.
+     * @param[in]  paylen      length of the payload in bytes.
+     * @return                 number of bytes read, less than `paylen` on EOF.
+     */
+    size_t parsePayload(int retxsockfd, TcpRecvBuffer& rbuf, void* payload,
+                        size_t paylen);
     /** read any data coming into this given socket */
     int readSock(int retxsockfd, char* pktBuf, int bufSize);
     void rmSockInList(int sockfd);
@@ -70,6 +82,31 @@ public:
                  size_t paylen);
     static int send(int retxsockfd, FmtpHeader* sendheader, char* payload,
                     size_t paylen);
+    /**
+     * Sends a range of data blocks of a product as FMTP_RETX_DATA packets,
+     * gathering many header and payload pairs into each system call.
+     *
+     * @param[in] retxsockfd  retransmission socket file descriptor.
+     * @param[in] prodindex   product index.
+     * @param[in] prodptr     start of the product in memory.
+     * @param[in] start       offset of the first block, a multiple of
+     *                        FMTP_DATA_LEN.
+     * @param[in] end         offset just past the last byte to send.
+     * @param[in] wide        whether the sequence numbers are block numbers,
+     *                        see fmtpSendv3::SetWideOffsets().
+     * @return                number of bytes sent, headers included.
+     */
+    size_t sendDataBlocks(int retxsockfd, uint32_t prodindex,
+                          const char* prodptr, uint64_t start, uint64_t end,
+                          const bool wide = false);
+    /**
+     * Sends FMTP packets which are already encoded into one buffer.
+     *
+     * @param[in] retxsockfd  retransmission socket file descriptor.
+     * @param[in] packets     the packets, headers in network byte order.
+     * @param[in] nbytes      size of the packets in bytes.
+     */
+    void sendPackets(int retxsockfd, const char* packets, size_t nbytes);
     void updatePathMTU(int sockfd);
 
 private:
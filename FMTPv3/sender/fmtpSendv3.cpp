@@ -31,12 +31,17 @@
 #include "fmtpSendv3.h"
 
 #include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <fstream>
 #include <iostream>
 #include <math.h>
 #include <stdexcept>
 #include <system_error>
+#include <vector>
 
 
 
@@ -87,12 +92,24 @@ fmtpSendv3::fmtpSendv3(const char*                 tcpAddr,
     notifier(notifier),
     prodIndex(initProdIndex),
     linkspeed(0),
+    rateHint(false),
+    aggregate(false),
+    tiny(false),
+    wide(false),
     exitMutex(),
     except(),
     exceptIsSet(false),
     coor_t(),
     timer_t(),
     tsnd(tsnd),
+    probeInterval(0),
+    probe_t(),
+    probemtx(),
+    probecond(),
+    probeStart(),
+    probeIndex(0),
+    probeArmed(false),
+    probeStop(false),
     txdone(false),
     /* Coverity Scan #1: Fix #1: Initialize notifyprodidx, suppressor to 0 as product index*/
     notifyprodidx(0),
@@ -179,7 +196,7 @@ uint32_t fmtpSendv3::releaseMem()
  * @throws std::runtime_error     if retrieving sender side RetxMetadata fails.
  * @throws std::runtime_error     if UdpSend::SendData() fails.
  */
-uint32_t fmtpSendv3::sendProduct(void* data, uint32_t dataSize)
+uint32_t fmtpSendv3::sendProduct(void* data, uint64_t dataSize)
 {
     return sendProduct(data, dataSize, 0, 0);
 }
@@ -200,8 +217,9 @@ uint32_t fmtpSendv3::sendProduct(void* data, uint32_t dataSize)
  *                         data. May be 0, in which case `metaSize` must be 0
  *                         and no metadata is sent.
  * @param[in] metaSize     Size of the metadata in bytes. Must be less than or
- *                         equal 1442 bytes. May be 0, in which case no
- *                         metadata is sent.
+ *                         equal 1442 bytes, or 1438 bytes with 64-bit
+ *                         offsets. May be 0, in which case no metadata is
+ *                         sent.
  * @param[in] perProdTimeoutRatio
  *                         the per-product timeout ratio to balance performance
  *                         and robustness (reliability).
@@ -213,45 +231,192 @@ uint32_t fmtpSendv3::sendProduct(void* data, uint32_t dataSize)
  * @throws std::runtime_error  if `metadata` == 0 and metaSize != 0
  * @throws std::runtime_error     if a runtime error occurs.
  */
-uint32_t fmtpSendv3::sendProduct(void* data, uint32_t dataSize, void* metadata,
+uint32_t fmtpSendv3::sendProduct(void* data, uint64_t dataSize, void* metadata,
                                   uint16_t metaSize)
 {
-    try {
-        if (data == NULL)
-            throw std::runtime_error(
-                    "fmtpSendv3::sendProduct() data pointer is NULL");
-        if (dataSize > 0xFFFFFFFFu)
-            throw std::runtime_error(
-                    "fmtpSendv3::sendProduct() dataSize out of range");
-        if (metadata) {
-            if (AVAIL_BOP_LEN < metaSize)
-                throw std::runtime_error(
-                        "fmtpSendv3::SendBOPMessage(): metaSize too large");
+    return transferProduct(data, dataSize, metadata, metaSize, 0);
+}
+
+
+/**
+ * Transfers several products, which are given consecutive indexes. With
+ * aggregation, see SetAggregation(), the products whose BOP, data and EOP
+ * packets fit into one datagram together are packed into shared
+ * FMTP_AGGREGATE datagrams, each of which is filled with as many consecutive
+ * products as it holds. Every product still has its own retransmission entry
+ * and timer, so it's retransmitted and acknowledged like any other. Larger
+ * products, or every product without aggregation, are sent as by
+ * sendProduct(). The data of each product must be kept until it's
+ * acknowledged.
+ *
+ * @param[in] prods  The products.
+ * @param[in] count  Number of products.
+ * @return           Index of the first product.
+ * @throws std::runtime_error  if a product is invalid.
+ * @throws std::runtime_error  if a runtime error occurs.
+ */
+uint32_t fmtpSendv3::sendProducts(const ProductDesc* prods, size_t count)
+{
+    const uint32_t first = prodIndex;
+    Aggregate      agg;
+
+    for (size_t i = 0; i < count; i++) {
+        const ProductDesc& prod = prods[i];
+        if (aggregate && packedLen(prod) <= FMTP_DATA_LEN) {
+            if (agg.len + packedLen(prod) > FMTP_DATA_LEN)
+                sendAggregate(agg);
+            packProduct(agg, prod);
         }
         else {
-            if (metaSize)
-                throw std::runtime_error(
-                        "fmtpSendv3::SendBOPMessage(): Non-zero metaSize");
+            /* products are multicast in the order of their indexes */
+            sendAggregate(agg);
+            (void)transferProduct(prod.data, prod.dataSize, prod.metadata,
+                                  prod.metaSize, 0);
         }
+    }
+    sendAggregate(agg);
+
+    return first;
+}
+
+
+/**
+ * Transfers a file. The whole file is mapped read-only and shared, so the
+ * product is backed by the page cache instead of the heap: pages can be
+ * evicted while the product is retained and are read back in if a receiver
+ * requests them. Sequential access and read-ahead are advised for the
+ * multicast. The mapping is released when the retransmission entry of the
+ * product is removed, after which `notify_of_eop()` only tells the application
+ * that the product is done.
+ *
+ * @param[in] path      Pathname of the file.
+ * @param[in] metadata  Application-specific metadata or `NULL`.
+ * @param[in] metaSize  Size of the metadata in bytes.
+ * @return              Index of the product.
+ * @throws std::system_error   if the file can't be opened or mapped.
+ * @throws std::runtime_error  if the file is too large.
+ * @throws std::runtime_error  if a runtime error occurs.
+ */
+uint32_t fmtpSendv3::sendFile(const char* path, void* metadata,
+                              uint16_t metaSize)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(),
+                std::string("fmtpSendv3::sendFile() Couldn't open ") + path);
+
+    try {
+        const uint32_t index = sendFile(fd, metadata, metaSize);
+        (void)close(fd);
+        return index;
+    }
+    catch (...) {
+        (void)close(fd);
+        throw;
+    }
+}
+
+
+/**
+ * Transfers an open file. See `sendFile(const char*, void*, uint16_t)`. The
+ * mapping doesn't need the file descriptor, which isn't closed.
+ *
+ * @param[in] fd        File descriptor of the file, open for reading.
+ * @param[in] metadata  Application-specific metadata or `NULL`.
+ * @param[in] metaSize  Size of the metadata in bytes.
+ * @return              Index of the product.
+ * @throws std::system_error   if the file can't be mapped.
+ * @throws std::runtime_error  if the file is too large.
+ * @throws std::runtime_error  if a runtime error occurs.
+ */
+uint32_t fmtpSendv3::sendFile(int fd, void* metadata, uint16_t metaSize)
+{
+    struct stat st;
+    if (fstat(fd, &st))
+        throw std::system_error(errno, std::system_category(),
+                "fmtpSendv3::sendFile() Couldn't get size of file " +
+                std::to_string(fd));
+    if ((uint64_t)st.st_size > maxProdSize())
+        throw std::runtime_error("fmtpSendv3::sendFile() file too large");
+
+    /* an empty file can't be mapped and has no data to send anyway */
+    static char empty;
+    if (st.st_size == 0)
+        return transferProduct(&empty, 0, metadata, metaSize, 0);
+
+    const size_t maplen = st.st_size;
+    void* const  data   = mmap(NULL, maplen, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+        throw std::system_error(errno, std::system_category(),
+                "fmtpSendv3::sendFile() Couldn't map file " +
+                std::to_string(fd));
+    (void)madvise(data, maplen, MADV_SEQUENTIAL);
+    (void)madvise(data, maplen, MADV_WILLNEED);
+
+    return transferProduct(data, maplen, metadata, metaSize, maplen);
+}
+
+
+/**
+ * Transfers Application-specific metadata and a contiguous block of memory
+ * which is either the application's or a file mapping. Construct sender side
+ * RetxMetadata and insert the new entry into a global map. The
+ * retransmission timeout period should also be set by considering the
+ * essential properties. If an exception is thrown inside this function, it
+ * will be caught by the handler. As a result, the exception will cause all
+ * the threads in this process to terminate. If any exception is thrown, the
+ * Stop() will be effectively called.
+ *
+ * @param[in] data      Memory data to be sent.
+ * @param[in] dataSize  Size of the memory data in bytes.
+ * @param[in] metadata  Application-specific metadata or `NULL`.
+ * @param[in] metaSize  Size of the metadata in bytes.
+ * @param[in] maplen    Length of the file mapping at `data`, which is released
+ *                      with the product, or 0.
+ * @return              Index of the product.
+ * @throws std::runtime_error  if `data == 0`.
+ * @throws std::runtime_error  if `metadata` != 0 and metaSize is too large
+ * @throws std::runtime_error  if `metadata` == 0 and metaSize != 0
+ * @throws std::runtime_error  if a runtime error occurs.
+ */
+uint32_t fmtpSendv3::transferProduct(void* data, uint64_t dataSize,
+                                     void* metadata, uint16_t metaSize,
+                                     size_t maplen)
+{
+    /* owns the mapping once it exists */
+    RetxMetadata* senderProdMeta = NULL;
+
+    try {
+        checkProduct(data, dataSize, metadata, metaSize);
 
         /* Add a retransmission metadata entry */
-        RetxMetadata* senderProdMeta = addRetxMetadata(data, dataSize,
-                                                       metadata, metaSize);
-        // TODO: use latest MTU for file to be sent
-        // TcpSend::getMinPathMTU()
-        /* send out BOP message */
-        SendBOPMessage(dataSize, metadata, metaSize);
-        /* Send the data */
-        sendData(data, dataSize);
-        /* Send out EOP message */
-        sendEOPMessage();
+        senderProdMeta = addRetxMetadata(data, dataSize, metadata, metaSize,
+                                         maplen);
+        /* the multicast isn't idle while the product is sent */
+        armProbe(false, prodIndex);
+        if (isTiny(dataSize, metaSize)) {
+            sendTinyMessage(data, dataSize, metadata, metaSize);
+        }
+        else {
+            // TODO: use latest MTU for file to be sent
+            // TcpSend::getMinPathMTU()
+            /* send out BOP message */
+            SendBOPMessage(dataSize, metadata, metaSize);
+            /* Send the data */
+            sendData(data, dataSize);
+            /* Send out EOP message */
+            sendEOPMessage();
+        }
 
         /* Set the retransmission timeout parameters */
         setTimerParameters(senderProdMeta);
         /* start a new timer for this product in a separate thread */
         timerDelayQ.push(prodIndex, senderProdMeta->retxTimeoutPeriod);
+        armProbe(true, prodIndex);
     }
     catch (std::runtime_error& e) {
+        if (maplen && senderProdMeta == NULL)
+            (void)munmap(data, maplen);
         taskExit(e);
         std::rethrow_exception(except);
     }
@@ -272,6 +437,331 @@ uint32_t fmtpSendv3::sendProduct(void* data, uint32_t dataSize, void* metadata,
 }
 
 
+/**
+ * Returns the size of the product size and metadata size which start a BOP:
+ * the product size takes 8 bytes instead of 4 with 64-bit offsets, see
+ * SetWideOffsets(), which leaves less room for the metadata.
+ *
+ * @return  Size in bytes.
+ */
+size_t fmtpSendv3::bopHeadLen() const
+{
+    return (FMTP_DATA_LEN - AVAIL_BOP_LEN) + (wide ? WIDE_PRODSIZE_EXTRA : 0);
+}
+
+
+/**
+ * Writes the product size and metadata size which start a BOP or a tiny
+ * product in network byte order.
+ *
+ * @param[in]  prodsize  Size of the product in bytes.
+ * @param[in]  metaSize  Size of the metadata in bytes.
+ * @param[out] buf       Buffer of at least bopHeadLen() bytes.
+ * @return               Number of bytes written, see bopHeadLen().
+ */
+size_t fmtpSendv3::putBopHead(uint64_t prodsize, uint16_t metaSize,
+                              char* buf) const
+{
+    char* const start = buf;
+    if (wide) {
+        const uint32_t high = htonl((uint32_t)(prodsize >> 32));
+        (void)memcpy(buf, &high, sizeof(high));
+        buf += sizeof(high);
+    }
+    const uint32_t low = htonl((uint32_t)prodsize);
+    (void)memcpy(buf, &low, sizeof(low));
+    buf += sizeof(low);
+    const uint16_t metasize = htons(metaSize);
+    (void)memcpy(buf, &metasize, sizeof(metasize));
+    buf += sizeof(metasize);
+    return buf - start;
+}
+
+
+/**
+ * Returns the sequence number of a data block: its byte offset, or the number
+ * of the block with 64-bit offsets, see SetWideOffsets().
+ *
+ * @param[in] offset  Offset of the block in the product in bytes.
+ * @return            Sequence number in host byte order.
+ */
+uint32_t fmtpSendv3::seqnumOf(uint64_t offset) const
+{
+    return wide ? offset / FMTP_DATA_LEN : offset;
+}
+
+
+/**
+ * Returns the flags of a packet which carries a product size: marked with
+ * FMTP_WIDE if the size takes 8 bytes, see SetWideOffsets().
+ *
+ * @param[in] flags  FMTP_BOP, FMTP_RETX_BOP or FMTP_TINY.
+ * @return           The flags in host byte order.
+ */
+uint16_t fmtpSendv3::bopFlags(uint16_t flags) const
+{
+    return wide ? flags | FMTP_WIDE : flags;
+}
+
+
+/**
+ * Checks the arguments of a product to be sent.
+ *
+ * @param[in] data      Memory data to be sent.
+ * @param[in] dataSize  Size of the data in bytes.
+ * @param[in] metadata  Application-specific metadata or `NULL`.
+ * @param[in] metaSize  Size of the metadata in bytes.
+ * @throws std::runtime_error  if `data == 0`.
+ * @throws std::runtime_error  if `dataSize` is too large, see maxProdSize().
+ * @throws std::runtime_error  if `metadata` != 0 and metaSize is too large
+ * @throws std::runtime_error  if `metadata` == 0 and metaSize != 0
+ */
+void fmtpSendv3::checkProduct(const void* data, uint64_t dataSize,
+                              const void* metadata, uint16_t metaSize) const
+{
+    if (data == NULL)
+        throw std::runtime_error(
+                "fmtpSendv3::sendProduct() data pointer is NULL");
+    if (dataSize > maxProdSize())
+        throw std::runtime_error(
+                "fmtpSendv3::sendProduct() dataSize too large");
+    if (metadata) {
+        if (FMTP_DATA_LEN - bopHeadLen() < metaSize)
+            throw std::runtime_error(
+                    "fmtpSendv3::SendBOPMessage(): metaSize too large");
+    }
+    else {
+        if (metaSize)
+            throw std::runtime_error(
+                    "fmtpSendv3::SendBOPMessage(): Non-zero metaSize");
+    }
+}
+
+
+/**
+ * Returns the largest product which can be sent: 4 GB, or MAX_WIDE_PRODSIZE
+ * with 64-bit offsets, see SetWideOffsets().
+ *
+ * @return  Size in bytes.
+ */
+uint64_t fmtpSendv3::maxProdSize() const
+{
+    return wide ? MAX_WIDE_PRODSIZE : UINT32_MAX;
+}
+
+
+/**
+ * Returns the size of the packets of a product in an aggregate: its tiny
+ * packet, see SetTinyProducts(), or else the BOP, with room for the send rate
+ * if it's announced, the data in one packet unless there is none, and the
+ * EOP.
+ *
+ * @param[in] prod  The product.
+ * @return          Size of its packets in bytes.
+ */
+size_t fmtpSendv3::packedLen(const ProductDesc& prod) const
+{
+    if (isTiny(prod.dataSize, prod.metaSize))
+        return FMTP_HEADER_LEN + bopHeadLen() + prod.metaSize + prod.dataSize;
+
+    size_t len = FMTP_HEADER_LEN + bopHeadLen() + prod.metaSize +
+            (hasRateHint(prod.metaSize) ? BOP_RATE_HINT_LEN : 0);
+    if (prod.dataSize)
+        len += FMTP_HEADER_LEN + (size_t)prod.dataSize;
+    return len + FMTP_HEADER_LEN;
+}
+
+
+/**
+ * Tells whether the BOP of a product announces the send rate: the
+ * announcement must be enabled, see SetBopRateHint(), and the metadata must
+ * leave room for it. The BOP still goes without it if no send rate is set.
+ *
+ * @param[in] metaSize  Size of the metadata in bytes.
+ * @return              True if the BOP has room for the send rate.
+ */
+bool fmtpSendv3::hasRateHint(const uint16_t metaSize) const
+{
+    return rateHint &&
+            bopHeadLen() + metaSize + BOP_RATE_HINT_LEN <= FMTP_DATA_LEN;
+}
+
+
+/**
+ * Tells whether a product is multicast as a single FMTP_TINY packet: tiny
+ * products must be enabled, see SetTinyProducts(), and the product size,
+ * metadata size, metadata and data must fit into the payload of one packet.
+ *
+ * @param[in] dataSize  Size of the data in bytes.
+ * @param[in] metaSize  Size of the metadata in bytes.
+ * @return              True if the product is sent in one packet.
+ */
+bool fmtpSendv3::isTiny(uint64_t dataSize, uint16_t metaSize) const
+{
+    return tiny && dataSize <= FMTP_DATA_LEN &&
+            bopHeadLen() + metaSize + dataSize <= FMTP_DATA_LEN;
+}
+
+
+/**
+ * Adds a product to an aggregate: creates its retransmission entry and
+ * appends its packets as they would be multicast one by one, see
+ * packedLen(). The product is given the next index.
+ *
+ * @pre                     `agg` has room for `packedLen(prod)` bytes.
+ * @param[in,out] agg       The aggregate.
+ * @param[in]     prod      The product.
+ * @throws std::runtime_error  if the product is invalid.
+ * @throws std::runtime_error  if a runtime error occurs.
+ */
+void fmtpSendv3::packProduct(Aggregate& agg, const ProductDesc& prod)
+{
+    try {
+        checkProduct(prod.data, prod.dataSize, prod.metadata, prod.metaSize);
+
+        RetxMetadata* const senderProdMeta = addRetxMetadata(prod.data,
+                prod.dataSize, prod.metadata, prod.metaSize, 0);
+        agg.prods.push_back(senderProdMeta);
+
+        char*      packet = agg.packets + agg.len;
+        FmtpHeader header;
+        uint16_t   payloadlen = bopHeadLen() + prod.metaSize;
+        uint64_t   speed = 0;
+        if (isTiny(prod.dataSize, prod.metaSize)) {
+            /* the tiny packet, see sendTinyMessage() */
+            header.prodindex  = htonl(prodIndex);
+            header.seqnum     = 0;
+            header.payloadlen = htons(payloadlen + prod.dataSize);
+            header.flags      = htons(bopFlags(FMTP_TINY));
+            (void)memcpy(packet, &header, sizeof(header));
+            packet += sizeof(header);
+            packet += putBopHead(prod.dataSize, prod.metaSize, packet);
+            if (prod.metaSize)
+                (void)memcpy(packet, prod.metadata, prod.metaSize);
+            packet += prod.metaSize;
+            if (prod.dataSize)
+                (void)memcpy(packet, prod.data, prod.dataSize);
+            packet += prod.dataSize;
+            agg.npackets++;
+
+            agg.len = packet - agg.packets;
+            prodIndex++;
+            return;
+        }
+        if (hasRateHint(prod.metaSize)) {
+            std::unique_lock<std::mutex> lock(linkmtx);
+            speed = linkspeed;
+        }
+        if (speed)
+            payloadlen += BOP_RATE_HINT_LEN;
+
+        /* the BOP, see SendBOPMessage() */
+        header.prodindex  = htonl(prodIndex);
+        header.seqnum     = 0;
+        header.payloadlen = htons(payloadlen);
+        header.flags      = htons(bopFlags(FMTP_BOP));
+        (void)memcpy(packet, &header, sizeof(header));
+        packet += sizeof(header);
+        packet += putBopHead(prod.dataSize, prod.metaSize, packet);
+        if (prod.metaSize)
+            (void)memcpy(packet, prod.metadata, prod.metaSize);
+        packet += prod.metaSize;
+        if (speed) {
+            const uint32_t rate[2] = {htonl((uint32_t)(speed >> 32)),
+                                      htonl((uint32_t)speed)};
+            (void)memcpy(packet, rate, sizeof(rate));
+            packet += sizeof(rate);
+        }
+        agg.npackets++;
+
+        /* the data in a single block */
+        if (prod.dataSize) {
+            header.seqnum     = 0;
+            header.payloadlen = htons(prod.dataSize);
+            header.flags      = htons(FMTP_MEM_DATA);
+            (void)memcpy(packet, &header, sizeof(header));
+            packet += sizeof(header);
+            (void)memcpy(packet, prod.data, prod.dataSize);
+            packet += prod.dataSize;
+            agg.npackets++;
+        }
+
+        /* the EOP */
+        header.payloadlen = 0;
+        header.flags      = htons(FMTP_EOP);
+        (void)memcpy(packet, &header, sizeof(header));
+        packet += sizeof(header);
+        agg.npackets++;
+
+        agg.len = packet - agg.packets;
+        prodIndex++;
+    }
+    catch (std::runtime_error& e) {
+        taskExit(e);
+        std::rethrow_exception(except);
+    }
+}
+
+
+/**
+ * Multicasts an aggregate as one FMTP_AGGREGATE datagram, whose header has the
+ * index of its first product and the number of packets it carries, and
+ * starts the retransmission timers of its products. Does nothing if the
+ * aggregate is empty.
+ *
+ * @param[in,out] agg  The aggregate, which is emptied.
+ * @throws std::runtime_error  if an I/O error occurs.
+ */
+void fmtpSendv3::sendAggregate(Aggregate& agg)
+{
+    if (agg.prods.empty())
+        return;
+
+    try {
+        FmtpHeader header;
+        header.prodindex  = htonl(agg.prods.front()->prodindex);
+        header.seqnum     = htonl(agg.npackets);
+        header.payloadlen = htons(agg.len);
+        header.flags      = htons(FMTP_AGGREGATE);
+
+        uint64_t speed;
+        {
+            std::unique_lock<std::mutex> lock(linkmtx);
+            speed = linkspeed;
+        }
+
+        /* the multicast isn't idle while the aggregate is sent */
+        armProbe(false, agg.prods.front()->prodindex);
+        if (speed) {
+            rateshaper.CalcPeriod(sizeof(header) + agg.len);
+        }
+        if (udpsend->SendData(&header, sizeof(header), agg.packets,
+                              agg.len) < 0) {
+            throw std::runtime_error(
+                    "fmtpSendv3::sendAggregate::SendData() error");
+        }
+        if (speed) {
+            rateshaper.Sleep();
+        }
+
+        for (size_t i = 0; i < agg.prods.size(); i++) {
+            setTimerParameters(agg.prods[i]);
+            timerDelayQ.push(agg.prods[i]->prodindex,
+                             agg.prods[i]->retxTimeoutPeriod);
+        }
+        armProbe(true, agg.prods.back()->prodindex);
+    }
+    catch (std::runtime_error& e) {
+        taskExit(e);
+        std::rethrow_exception(except);
+    }
+
+    agg.prods.clear();
+    agg.len      = 0;
+    agg.npackets = 0;
+}
+
+
 /**
  * Sets sending rate. The timer thread needs this link speed to calculate
  * the sleep time. It is an alternative solution to tc rate limiting.
@@ -287,6 +777,96 @@ void fmtpSendv3::SetSendRate(uint64_t speed)
 }
 
 
+/**
+ * Announces the send rate set by SetSendRate() after the metadata of each
+ * multicast BOP. Receivers estimate the link speed from the arrival of the
+ * multicast, and the send rate caps the estimate, e.g. when packets which
+ * queued up in the network arrive in a burst. Nothing is announced without a
+ * send rate or if the metadata leaves no room. Receivers which predate the
+ * announcement reject such BOPs, so it's disabled by default. Must be called
+ * before `Start()`.
+ *
+ * @param[in] enable  Whether to announce the send rate.
+ */
+void fmtpSendv3::SetBopRateHint(bool enable)
+{
+    rateHint = enable;
+}
+
+
+/**
+ * Packs the BOP, data and EOP packets of several small products of
+ * sendProducts() into one FMTP_AGGREGATE datagram instead of multicasting
+ * each packet by itself, which saves datagrams and per-packet work on both
+ * sides for feeds of many sub-kilobyte products. Receivers which predate
+ * aggregation can't read such datagrams, so it's disabled by default. Must be
+ * called before `Start()`.
+ *
+ * @param[in] enable  Whether to aggregate small products.
+ */
+void fmtpSendv3::SetAggregation(bool enable)
+{
+    aggregate = enable;
+}
+
+
+/**
+ * Multicasts each product whose product size, metadata and data fit into the
+ * payload of one packet as a single FMTP_TINY packet instead of a BOP, a data
+ * packet and an EOP. A receiver completes such a product as soon as the
+ * packet arrives, without an EOP timer or block tracking, which matters for
+ * feeds of many sub-kilobyte products. The packet carries no send rate, see
+ * SetBopRateHint(). A lost tiny product is recovered through the usual BOP,
+ * data and EOP retransmissions. Receivers which predate tiny products can't
+ * read such packets, so it's disabled by default. Must be called before
+ * `Start()`.
+ *
+ * @param[in] enable  Whether to send tiny products in one packet.
+ */
+void fmtpSendv3::SetTinyProducts(bool enable)
+{
+    tiny = enable;
+}
+
+
+/**
+ * Sends the size of a product in 8 bytes instead of 4 and the sequence
+ * number of a data block as the number of the block instead of its byte
+ * offset, so that products may be larger than 4 GB, up to
+ * MAX_WIDE_PRODSIZE. The FMTP header keeps its layout; BOPs and tiny
+ * products lose 4 bytes of metadata and are marked with FMTP_WIDE. Receivers
+ * must call fmtpRecvv3::SetWideOffsets() as well, so it's disabled by
+ * default. Must be called before `Start()`.
+ *
+ * @param[in] enable  Whether to use 64-bit product sizes and offsets.
+ */
+void fmtpSendv3::SetWideOffsets(bool enable)
+{
+    wide = enable;
+}
+
+
+/**
+ * Repeats the EOP of the most recent product on multicast once the multicast
+ * has been idle for `seconds`. Without it, a receiver which lost the last
+ * blocks or the EOP of the last product of a burst only notices when its EOP
+ * timer expires, which takes many times the transmission time of the product;
+ * a later product would reveal the loss at once. The probe is a plain EOP, so
+ * receivers need no support for it, and it is only sent while some receiver
+ * hasn't acknowledged the product. Must be called before `Start()`.
+ *
+ * @param[in] seconds            Idle time before the probe, 0 for none.
+ * @throw std::invalid_argument  if `seconds` is negative.
+ */
+void fmtpSendv3::SetTailProbe(double seconds)
+{
+    if (seconds < 0)
+        throw std::invalid_argument("fmtpSendv3::SetTailProbe(): negative "
+                "interval");
+    probeInterval = seconds;
+}
+
+
 /**
  * Starts the coordinator thread and timer thread from this function. And
  * passes a fmtpSendv3 type pointer to each newly created thread so that
@@ -323,6 +903,18 @@ void fmtpSendv3::Start()
                 "fmtpSendv3::Start() pthread_create() coordinator error with"
                 " retval = " + std::to_string(retval));
     }
+
+    if (probeInterval > 0) {
+        retval = pthread_create(&probe_t, NULL, &fmtpSendv3::probeWrapper,
+                this);
+        if(retval != 0) {
+            (void)pthread_cancel(coor_t);
+            (void)pthread_cancel(timer_t);
+            throw std::runtime_error(
+                    "fmtpSendv3::Start() pthread_create() probeWrapper error "
+                    "with retval = " + std::to_string(retval));
+        }
+    }
 }
 
 
@@ -342,6 +934,15 @@ void fmtpSendv3::Stop()
     (void)pthread_join(timer_t, NULL);
     (void)pthread_join(coor_t, NULL);
 
+    if (probeInterval > 0) {
+        {
+            std::unique_lock<std::mutex> lock(probemtx);
+            probeStop = true;
+            probecond.notify_one();
+        }
+        (void)pthread_join(probe_t, NULL);
+    }
+
     {
         std::unique_lock<std::mutex> lock(exitMutex);
         if (exceptIsSet) {
@@ -356,13 +957,16 @@ void fmtpSendv3::Stop()
  *
  * @param[in] data      The data-product.
  * @param[in] dataSize  The size of the data-product in bytes.
+ * @param[in] maplen    Length of the file mapping at `data`, which the entry
+ *                      takes over, or 0.
  * @return              The corresponding retransmission entry.
  * @throw std::runtime_error  if a retransmission entry couldn't be created.
  */
 RetxMetadata* fmtpSendv3::addRetxMetadata(void* const data,
-                                           const uint32_t dataSize,
+                                           const uint64_t dataSize,
                                            void* const metadata,
-                                           const uint16_t metaSize)
+                                           const uint16_t metaSize,
+                                           const size_t maplen)
 {
     /* Create a new RetxMetadata struct for this product */
     RetxMetadata* senderProdMeta = new RetxMetadata();
@@ -394,6 +998,9 @@ RetxMetadata* fmtpSendv3::addRetxMetadata(void* const data,
     /* Update current product pointer in RetxMetadata */
     senderProdMeta->dataprod_p       = (void*)data;
 
+    /* The entry releases the mapping, if any, when it is destroyed */
+    senderProdMeta->maplen           = maplen;
+
     /* Get a full list of current connected sockets and add to unfinished set */
     std::list<int> currSockList = tcpsend->getConnSockList();
     std::list<int>::iterator it;
@@ -407,6 +1014,28 @@ RetxMetadata* fmtpSendv3::addRetxMetadata(void* const data,
 }
 
 
+/**
+ * Arms the tail-loss probe for a product after its EOP has been multicast, or
+ * disarms it before the product's BOP, so that only an idle multicast is
+ * probed. Waits for a probe which is being multicast. Does nothing without a
+ * probe interval.
+ *
+ * @param[in] arm        Whether to arm the probe.
+ * @param[in] prodindex  Index of the product.
+ */
+void fmtpSendv3::armProbe(const bool arm, const uint32_t prodindex)
+{
+    if (probeInterval > 0) {
+        std::unique_lock<std::mutex> lock(probemtx);
+        probeIndex = prodindex;
+        probeStart = std::chrono::steady_clock::now();
+        probeArmed = arm;
+        if (arm)
+            probecond.notify_one();
+    }
+}
+
+
 /**
  * The sender side coordinator thread. Listen for incoming TCP connection
  * requests in an infinite loop and assign a new socket for the corresponding
@@ -518,27 +1147,77 @@ void fmtpSendv3::handleRetxEnd(FmtpHeader*   const recvheader,
              * since this receiver is the last one in the unfinished set,
              * notify the sending application.
              */
-            if (notifier) {
-                notifier->notify_of_eop(recvheader->prodindex);
-            }
-            else {
-                suppressor->remove(recvheader->prodindex);
-                /**
-                 * Updates the most recently acknowledged product and notifies
-                 * a dummy notification handler (getNotify()).
-                 */
-                {
-                    std::unique_lock<std::mutex> lock(notifyprodmtx);
-                    notifyprodidx = recvheader->prodindex;
-                }
-                notify_cv.notify_one();
-                memrelease_cv.notify_one();
-            }
+            notifyAcked(recvheader->prodindex);
         }
     }
 }
 
 
+/**
+ * Handles a batched notice from a receiver that data-products have been
+ * completely received. The payload holds {first, count} pairs of product
+ * indexes, which are applied to the retransmission entries in a single pass;
+ * the products for which this receiver was the last one are then notified
+ * like by handleRetxEnd().
+ *
+ * @param[in] recvheader  The FMTP header of the notice.
+ * @param[in] rbuf        The receive buffer of the receiver's socket.
+ * @param[in] sock        The receiver's socket.
+ * @throws std::runtime_error  if the payload is invalid or incomplete.
+ * @throws std::system_error   if an error occurs reading the socket.
+ */
+void fmtpSendv3::handleRetxEndBatch(FmtpHeader* const recvheader,
+                                    TcpRecvBuffer&    rbuf,
+                                    const int         sock)
+{
+    const uint32_t nranges = recvheader->seqnum;
+    if (nranges == 0 || nranges > MAX_ACK_RANGES ||
+            recvheader->payloadlen != nranges * 2 * sizeof(uint32_t))
+        throw std::runtime_error("fmtpSendv3::handleRetxEndBatch() "
+                                 "invalid RETX_END_BATCH");
+
+    uint32_t ranges[2 * MAX_ACK_RANGES];
+    if (tcpsend->parsePayload(sock, rbuf, ranges, recvheader->payloadlen) <
+            recvheader->payloadlen)
+        throw std::runtime_error("fmtpSendv3::handleRetxEndBatch() "
+                                 "incomplete RETX_END_BATCH");
+    for (uint32_t i = 0; i < 2 * nranges; i++)
+        ranges[i] = ntohl(ranges[i]);
+
+    std::vector<uint32_t> removed;
+    sendMeta->clearUnfinishedSets(ranges, nranges, sock, tcpsend, removed);
+    for (size_t i = 0; i < removed.size(); i++)
+        notifyAcked(removed[i]);
+}
+
+
+/**
+ * Notifies the sending application that every receiver has acknowledged a
+ * product, i.e. that its retransmission entry is removed.
+ *
+ * @param[in] prodindex  Index of the product.
+ */
+void fmtpSendv3::notifyAcked(const uint32_t prodindex)
+{
+    if (notifier) {
+        notifier->notify_of_eop(prodindex);
+    }
+    else {
+        suppressor->remove(prodindex);
+        /**
+         * Updates the most recently acknowledged product and notifies
+         * a dummy notification handler (getNotify()).
+         */
+        {
+            std::unique_lock<std::mutex> lock(notifyprodmtx);
+            notifyprodidx = prodindex;
+        }
+        notify_cv.notify_one();
+        memrelease_cv.notify_one();
+    }
+}
+
+
 /**
  * Handles the RETX_BOP request from receiver. If the corresponding metadata
  * is still in the RetxMetadata map, then issue a BOP retransmission.
@@ -581,6 +1260,76 @@ void fmtpSendv3::handleBopReq(FmtpHeader* const  recvheader,
 }
 
 
+/**
+ * Handles the BOP_RANGE_REQ request from a receiver, which lost the BOPs of
+ * `seqnum` products from `prodindex` on, e.g. during an outage. Each product
+ * is answered in order, with a RETX_BOP if its metadata is still in the
+ * RetxMetadata map and with a RETX_REJ otherwise. The answers are gathered
+ * into batches, so that a range costs a few system calls rather than two per
+ * product. A range is limited to MAX_BOP_RANGE products.
+ *
+ * @param[in] recvheader  The FMTP header of the retransmission request.
+ * @param[in] retxMeta    Retransmission entry of the first product.
+ * @param[in] sock        The receiver's socket.
+ */
+void fmtpSendv3::handleBopRangeReq(FmtpHeader* const  recvheader,
+                                   RetxMetadata* const retxMeta,
+                                   const int           sock)
+{
+    const uint32_t    count = std::min(recvheader->seqnum, MAX_BOP_RANGE);
+    const size_t      batchSize = 64 * MAX_FMTP_PACKET_LEN;
+    std::vector<char> batch;
+
+    batch.reserve(batchSize + MAX_FMTP_PACKET_LEN);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t      prodindex = recvheader->prodindex + i;
+        RetxMetadata* const meta = i ? sendMeta->getMetadata(prodindex) :
+                retxMeta;
+        FmtpHeader          header;
+
+        header.prodindex = htonl(prodindex);
+        header.seqnum    = 0;
+        if (meta) {
+            char         head[FMTP_DATA_LEN - AVAIL_BOP_LEN +
+                              WIDE_PRODSIZE_EXTRA];
+            const size_t headlen = putBopHead(meta->prodLength,
+                                              meta->metaSize, head);
+            header.payloadlen = htons(meta->metaSize + headlen);
+            header.flags      = htons(bopFlags(FMTP_RETX_BOP));
+            batch.insert(batch.end(), (char*)&header,
+                    (char*)&header + sizeof(header));
+            batch.insert(batch.end(), head, head + headlen);
+            batch.insert(batch.end(), (char*)meta->metadata,
+                    (char*)meta->metadata + meta->metaSize);
+        }
+        else {
+            header.payloadlen = 0;
+            header.flags      = htons(FMTP_RETX_REJ);
+            batch.insert(batch.end(), (char*)&header,
+                    (char*)&header + sizeof(header));
+        }
+        if (i)
+            sendMeta->releaseMetadata(prodindex);
+
+        if (batch.size() >= batchSize) {
+            tcpsend->sendPackets(sock, batch.data(), batch.size());
+            batch.clear();
+        }
+    }
+    if (!batch.empty())
+        tcpsend->sendPackets(sock, batch.data(), batch.size());
+
+    #ifdef DEBUG2
+        std::string debugmsg = "Products #" +
+            std::to_string(recvheader->prodindex) + " to #" +
+            std::to_string(recvheader->prodindex + count - 1);
+        debugmsg += ": BOP_RANGE_REQ answered.";
+        std::cout << debugmsg << std::endl;
+        WriteToLog(debugmsg);
+    #endif
+}
+
+
 /**
  * Handles the RETX_EOP request from receiver. If the corresponding metadata
  * is still in the RetxMetadata map, then issue a EOP retransmission.
@@ -644,13 +1393,15 @@ void fmtpSendv3::handleEopReq(FmtpHeader* const  recvheader,
  */
 void fmtpSendv3::RunRetxThread(int retxsockfd)
 {
-    FmtpHeader recvheader;
+    FmtpHeader    recvheader;
+    /* requests of the receiver are read in batches through this buffer */
+    TcpRecvBuffer rbuf;
 
     while(1) {
         /* Receive the message from tcp connection and parse the header */
         int parsestate;
         try {
-            parsestate = tcpsend->parseHeader(retxsockfd, &recvheader);
+            parsestate = tcpsend->parseHeader(retxsockfd, rbuf, &recvheader);
         }
         catch (const std::runtime_error& e) {
             /**
@@ -700,6 +1451,16 @@ void fmtpSendv3::RunRetxThread(int retxsockfd)
                 #endif
                 handleRetxEnd(&recvheader, retxMeta, retxsockfd);
             }
+            else if (recvheader.flags == FMTP_RETX_END_BATCH) {
+                #ifdef DEBUG2
+                    std::string debugmsg = "Product #" +
+                        std::to_string(recvheader.prodindex);
+                    debugmsg += ": RETX_END_BATCH received";
+                    std::cout << debugmsg << std::endl;
+                    WriteToLog(debugmsg);
+                #endif
+                handleRetxEndBatch(&recvheader, rbuf, retxsockfd);
+            }
             else if (recvheader.flags == FMTP_BOP_REQ) {
                 #ifdef DEBUG2
                     std::string debugmsg = "Product #" +
@@ -710,6 +1471,16 @@ void fmtpSendv3::RunRetxThread(int retxsockfd)
                 #endif
                 handleBopReq(&recvheader, retxMeta, retxsockfd);
             }
+            else if (recvheader.flags == FMTP_BOP_RANGE_REQ) {
+                #ifdef DEBUG2
+                    std::string debugmsg = "Product #" +
+                        std::to_string(recvheader.prodindex);
+                    debugmsg += ": BOP_RANGE_REQ received";
+                    std::cout << debugmsg << std::endl;
+                    WriteToLog(debugmsg);
+                #endif
+                handleBopRangeReq(&recvheader, retxMeta, retxsockfd);
+            }
             else if (recvheader.flags == FMTP_EOP_REQ) {
                 #ifdef DEBUG2
                     std::string debugmsg = "Product #" +
@@ -779,67 +1550,74 @@ void fmtpSendv3::retransmit(
         const int                 sock)
 {
     if (recvheader->payloadlen > 0) {
-        uint32_t start = recvheader->seqnum;
+        /* byte offset of the first requested block, see SetWideOffsets() */
+        uint64_t start = wide ? (uint64_t)recvheader->seqnum * FMTP_DATA_LEN :
+                recvheader->seqnum;
         /* make sure the requested bytes do not exceed file size */
-        uint32_t out   = MIN(retxMeta->prodLength,
+        uint64_t out   = MIN(retxMeta->prodLength,
                              start + recvheader->payloadlen);
 
-        FmtpHeader sendheader;
-        sendheader.prodindex  = htonl(recvheader->prodindex);
-        sendheader.flags      = htons(FMTP_RETX_DATA);
-
         /**
          * aligns starting seqnum to the multiple-of-MTU boundary.
          */
         start = (start/FMTP_DATA_LEN) * FMTP_DATA_LEN;
-        uint16_t payLen = FMTP_DATA_LEN;
+        if (start >= out)
+            return;
 
-        /**
-         * Support sending multiple blocks.
-         */
-        for (uint32_t nbytes = out - start; nbytes > 0;
-             nbytes -= payLen, start += payLen) {
-            if (payLen > nbytes) {
-                /** only last block might be truncated */
-                payLen = nbytes;
-            } else {
-                payLen = FMTP_DATA_LEN;
-            }
+        #if defined(DEBUG1) || defined(DEBUG2)
+            FmtpHeader sendheader;
+            sendheader.prodindex  = htonl(recvheader->prodindex);
+            sendheader.flags      = htons(FMTP_RETX_DATA);
+            uint16_t payLen = FMTP_DATA_LEN;
+
+            /**
+             * Support sending multiple blocks.
+             */
+            for (uint32_t nbytes = out - start; nbytes > 0;
+                 nbytes -= payLen, start += payLen) {
+                if (payLen > nbytes) {
+                    /** only last block might be truncated */
+                    payLen = nbytes;
+                } else {
+                    payLen = FMTP_DATA_LEN;
+                }
 
-            sendheader.seqnum     = htonl(start);
-            sendheader.payloadlen = htons(payLen);
+                sendheader.seqnum     = htonl(seqnumOf(start));
+                sendheader.payloadlen = htons(payLen);
 
-            #if defined(DEBUG1) || defined(DEBUG2)
                 char tmp[1460] = {0};
                 int retval = tcpsend->sendData(sock, &sendheader, tmp, payLen);
-            #else
-                int retval = tcpsend->sendData(sock, &sendheader,
-                                (char*)retxMeta->dataprod_p + start, payLen);
-            #endif
-
-            if (retval < 0) {
-                throw std::runtime_error(
-                        "fmtpSendv3::retransmit() TcpSend::send() error");
-            }
+                if (retval < 0) {
+                    throw std::runtime_error(
+                            "fmtpSendv3::retransmit() TcpSend::send() error");
+                }
 
-            #ifdef MODBASE
-                uint32_t tmpidx = recvheader->prodindex % MODBASE;
-            #else
-                uint32_t tmpidx = recvheader->prodindex;
-            #endif
+                #ifdef MODBASE
+                    uint32_t tmpidx = recvheader->prodindex % MODBASE;
+                #else
+                    uint32_t tmpidx = recvheader->prodindex;
+                #endif
 
-            #ifdef DEBUG2
-                std::string debugmsg = "Product #" +
-                    std::to_string(tmpidx);
-                debugmsg += ": Data block (SeqNum = ";
-                debugmsg += std::to_string(start);
-                debugmsg += "), (PayLen = ";
-                debugmsg += std::to_string(payLen);
-                debugmsg += ") has been retransmitted";
-                std::cout << debugmsg << std::endl;
-                WriteToLog(debugmsg);
-            #endif
-        }
+                #ifdef DEBUG2
+                    std::string debugmsg = "Product #" +
+                        std::to_string(tmpidx);
+                    debugmsg += ": Data block (SeqNum = ";
+                    debugmsg += std::to_string(start);
+                    debugmsg += "), (PayLen = ";
+                    debugmsg += std::to_string(payLen);
+                    debugmsg += ") has been retransmitted";
+                    std::cout << debugmsg << std::endl;
+                    WriteToLog(debugmsg);
+                #endif
+            }
+        #else
+            /**
+             * Sends all the requested blocks, header and payload pairs
+             * gathered into as few system calls as possible.
+             */
+            (void)tcpsend->sendDataBlocks(sock, recvheader->prodindex,
+                    (const char*)retxMeta->dataprod_p, start, out, wide);
+        #endif
     }
 }
 
@@ -862,22 +1640,20 @@ void fmtpSendv3::retransBOP(
         const int                 sock)
 {
     FmtpHeader   sendheader;
-    BOPMsg        bopMsg;
+    char         bopMsg[FMTP_DATA_LEN];
+
+    /* Set the FMTP BOP message. */
+    const size_t headlen = putBopHead(retxMeta->prodLength,
+                                      retxMeta->metaSize, bopMsg);
+    memcpy(bopMsg + headlen, retxMeta->metadata, retxMeta->metaSize);
 
     /* Set the FMTP packet header. */
     sendheader.prodindex  = htonl(recvheader->prodindex);
     sendheader.seqnum     = 0;
-    sendheader.payloadlen = htons(retxMeta->metaSize +
-                                  (FMTP_DATA_LEN - AVAIL_BOP_LEN));
-    sendheader.flags      = htons(FMTP_RETX_BOP);
+    sendheader.payloadlen = htons(retxMeta->metaSize + headlen);
+    sendheader.flags      = htons(bopFlags(FMTP_RETX_BOP));
 
-    /* Set the FMTP BOP message. */
-    bopMsg.prodsize = htonl(retxMeta->prodLength);
-    bopMsg.metasize = htons(retxMeta->metaSize);
-    memcpy(&bopMsg.metadata, retxMeta->metadata, retxMeta->metaSize);
-
-    /** actual BOPmsg size may not be AVAIL_BOP_LEN, payloadlen is corret */
-    int retval = tcpsend->sendData(sock, &sendheader, (char*)(&bopMsg),
+    int retval = tcpsend->sendData(sock, &sendheader, bopMsg,
                                ntohs(sendheader.payloadlen));
     if (retval < 0) {
         throw std::runtime_error(
@@ -955,33 +1731,46 @@ void fmtpSendv3::retransEOP(
  *                           case no metadata is sent.
  * @throw std::runtime_error  if the UdpSend::SendTo() fails.
  */
-void fmtpSendv3::SendBOPMessage(uint32_t prodSize, void* metadata,
+void fmtpSendv3::SendBOPMessage(uint64_t prodSize, void* metadata,
                                  const uint16_t metaSize)
 {
     FmtpHeader   header;
-    BOPMsg        bopMsg;
+    char          head[FMTP_DATA_LEN - AVAIL_BOP_LEN + WIDE_PRODSIZE_EXTRA];
     struct iovec  ioVec[4];
+    int           nvec = 3;
+    uint32_t      rate[2];
 
     /* Set the FMTP packet header. */
     header.prodindex  = htonl(prodIndex);
     header.seqnum     = 0;
-    header.payloadlen = htons(metaSize + (uint16_t)(FMTP_DATA_LEN -
-                                                    AVAIL_BOP_LEN));
-    header.flags      = htons(FMTP_BOP);
+    header.payloadlen = htons(metaSize + (uint16_t)bopHeadLen());
+    header.flags      = htons(bopFlags(FMTP_BOP));
 
     ioVec[0].iov_base = &header;
     ioVec[0].iov_len  = sizeof(FmtpHeader);
 
-    bopMsg.prodsize = htonl(prodSize);
-    ioVec[1].iov_base = &bopMsg.prodsize;
-    ioVec[1].iov_len  = sizeof(bopMsg.prodsize);
+    ioVec[1].iov_base = head;
+    ioVec[1].iov_len  = putBopHead(prodSize, metaSize, head);
 
-    bopMsg.metasize = htons(metaSize);
-    ioVec[2].iov_base = &bopMsg.metasize;
-    ioVec[2].iov_len  = sizeof(bopMsg.metasize);
+    ioVec[2].iov_base = metadata;
+    ioVec[2].iov_len  = metaSize;
 
-    ioVec[3].iov_base = metadata;
-    ioVec[3].iov_len  = metaSize;
+    if (hasRateHint(metaSize)) {
+        uint64_t speed;
+        {
+            std::unique_lock<std::mutex> lock(linkmtx);
+            speed = linkspeed;
+        }
+        if (speed) {
+            rate[0] = htonl((uint32_t)(speed >> 32));
+            rate[1] = htonl((uint32_t)speed);
+            ioVec[3].iov_base = rate;
+            ioVec[3].iov_len  = BOP_RATE_HINT_LEN;
+            header.payloadlen = htons(ntohs(header.payloadlen) +
+                    BOP_RATE_HINT_LEN);
+            nvec = 4;
+        }
+    }
 
     #ifdef MODBASE
         uint32_t tmpidx = prodIndex % MODBASE;
@@ -1010,7 +1799,7 @@ void fmtpSendv3::SendBOPMessage(uint32_t prodSize, void* metadata,
     #endif
 
     /* Send the BOP message on multicast socket */
-    udpsend->SendTo(ioVec, 4);
+    udpsend->SendTo(ioVec, nvec);
 
     #ifdef DEBUG2
         std::string debugmsg = "Product #" + std::to_string(tmpidx);
@@ -1073,6 +1862,68 @@ void fmtpSendv3::sendEOPMessage()
 }
 
 
+/**
+ * Multicasts a whole product as one FMTP_TINY packet, whose payload is the
+ * product size, metadata size and metadata of a BOP followed by the data.
+ * The caller has checked that it fits, see isTiny().
+ *
+ * @param[in] data      The data of the product.
+ * @param[in] dataSize  Size of the data in bytes.
+ * @param[in] metadata  Application-specific metadata or `NULL`.
+ * @param[in] metaSize  Size of the metadata in bytes.
+ * @throw std::runtime_error  if UdpSend::SendTo() fails.
+ */
+void fmtpSendv3::sendTinyMessage(void* data, uint64_t dataSize,
+                                 void* metadata, uint16_t metaSize)
+{
+    FmtpHeader   header;
+    char         head[FMTP_DATA_LEN - AVAIL_BOP_LEN + WIDE_PRODSIZE_EXTRA];
+    struct iovec ioVec[4];
+
+    header.prodindex  = htonl(prodIndex);
+    header.seqnum     = 0;
+    header.payloadlen = htons((uint16_t)bopHeadLen() + metaSize + dataSize);
+    header.flags      = htons(bopFlags(FMTP_TINY));
+
+    ioVec[0].iov_base = &header;
+    ioVec[0].iov_len  = sizeof(FmtpHeader);
+
+    ioVec[1].iov_base = head;
+    ioVec[1].iov_len  = putBopHead(dataSize, metaSize, head);
+
+    ioVec[2].iov_base = metadata;
+    ioVec[2].iov_len  = metaSize;
+
+    ioVec[3].iov_base = data;
+    ioVec[3].iov_len  = dataSize;
+
+    uint64_t speed;
+    {
+        std::unique_lock<std::mutex> lock(linkmtx);
+        speed = linkspeed;
+    }
+    if (speed) {
+        rateshaper.CalcPeriod(sizeof(header) + ntohs(header.payloadlen));
+    }
+    udpsend->SendTo(ioVec, 4);
+    if (speed) {
+        rateshaper.Sleep();
+    }
+
+    #ifdef DEBUG2
+        #ifdef MODBASE
+            uint32_t tmpidx = prodIndex % MODBASE;
+        #else
+            uint32_t tmpidx = prodIndex;
+        #endif
+        std::string debugmsg = "Product #" + std::to_string(tmpidx);
+        debugmsg += ": tiny product has been sent.";
+        std::cout << debugmsg << std::endl;
+        WriteToLog(debugmsg);
+    #endif
+}
+
+
 /**
  * Multicasts the data blocks of a data-product. A legal boundary check is
  * performed to make sure all the data blocks going out are multiples of
@@ -1082,11 +1933,11 @@ void fmtpSendv3::sendEOPMessage()
  * @param[in] dataSize  The size of the data-product in bytes.
  * @throw std::runtime_error  if an I/O error occurs.
  */
-void fmtpSendv3::sendData(void* data, uint32_t dataSize)
+void fmtpSendv3::sendData(void* data, uint64_t dataSize)
 {
     FmtpHeader header;
-    uint32_t datasize = dataSize;
-    uint32_t seqNum = 0;
+    uint64_t datasize = dataSize;
+    uint64_t seqNum = 0;
     header.prodindex = htonl(prodIndex);
     header.flags     = htons(FMTP_MEM_DATA);
 
@@ -1095,7 +1946,7 @@ void fmtpSendv3::sendData(void* data, uint32_t dataSize)
         uint16_t payloadlen = datasize < FMTP_DATA_LEN ?
                               datasize : FMTP_DATA_LEN;
 
-        header.seqnum     = htonl(seqNum);
+        header.seqnum     = htonl(seqnumOf(seqNum));
         header.payloadlen = htons(payloadlen);
 
         #ifdef TEST_DATA_MISS
@@ -1333,6 +2184,90 @@ void fmtpSendv3::timerThread()
 }
 
 
+/**
+ * Waits for the multicast to be idle for the probe interval after the EOP of
+ * a product, then multicasts the EOP again if some receiver still hasn't
+ * acknowledged the product. A receiver that lost the end of the product then
+ * requests the missing blocks at once, and one that lost the whole product
+ * requests its BOP. Each product is probed at most once, and the probe is
+ * rate-shaped like the products. Returns when the sender is stopped.
+ *
+ * @throws std::runtime_error  if the EOP can't be sent.
+ */
+void fmtpSendv3::probeThread()
+{
+    const std::chrono::steady_clock::duration interval =
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(probeInterval));
+    std::unique_lock<std::mutex> lock(probemtx);
+
+    while (!probeStop) {
+        if (!probeArmed) {
+            probecond.wait(lock);
+            continue;
+        }
+        const std::chrono::steady_clock::time_point deadline =
+                probeStart + interval;
+        if (std::chrono::steady_clock::now() < deadline) {
+            (void)probecond.wait_until(lock, deadline);
+            continue;
+        }
+
+        /*
+         * The lock is kept until the probe is out, so armProbe() holds off
+         * the next product meanwhile and the probe can't follow its BOP.
+         */
+        probeArmed = false;
+        if (sendMeta->isRetained(probeIndex)) {
+            FmtpHeader header;
+            header.prodindex  = htonl(probeIndex);
+            header.seqnum     = 0;
+            header.payloadlen = 0;
+            header.flags      = htons(FMTP_EOP);
+
+            uint64_t speed;
+            {
+                std::unique_lock<std::mutex> linklock(linkmtx);
+                speed = linkspeed;
+            }
+            if (speed) {
+                rateshaper.CalcPeriod(sizeof(header));
+            }
+            udpsend->SendTo(&header, sizeof(header));
+            if (speed) {
+                rateshaper.Sleep();
+            }
+
+            #ifdef DEBUG2
+                std::string debugmsg = "Product #" +
+                    std::to_string(probeIndex);
+                debugmsg += ": EOP has been sent again as tail-loss probe.";
+                std::cout << debugmsg << std::endl;
+                WriteToLog(debugmsg);
+            #endif
+        }
+    }
+}
+
+
+/**
+ * A wrapper function which is used to call the real probeThread().
+ *
+ * @param[in] ptr                a pointer to the fmtpSendv3 class.
+ */
+void* fmtpSendv3::probeWrapper(void* ptr)
+{
+    fmtpSendv3* const sender = static_cast<fmtpSendv3*>(ptr);
+    try {
+        sender->probeThread();
+    }
+    catch (std::runtime_error& e) {
+        sender->taskExit(e);
+    }
+    return NULL;
+}
+
+
 /**
  * A wrapper function which is used to call the real timerThread(). Due to the
  * unavailability of some fmtpSendv3 private resources (e.g. notifier), this
@@ -35,10 +35,13 @@
 #include <pthread.h>
 #include <sys/types.h>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <exception>
 #include <list>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "ProdIndexDelayQueue.h"
 #include "../RateShaper/RateShaper.h"
@@ -80,6 +83,19 @@ struct StartTimerThreadInfo
 };
 
 
+/**
+ * A data-product of fmtpSendv3::sendProducts().
+ */
+struct ProductDesc
+{
+    /** the data, which must be kept until the product is acknowledged */
+    void*           data;
+    uint32_t        dataSize;  /*!< size of the data in bytes */
+    void*           metadata;  /*!< application-specific metadata or NULL */
+    uint16_t        metaSize;  /*!< size of the metadata in bytes */
+};
+
+
 /**
  * sender side class handling the multicasting, restransmission and timeout.
  */
@@ -115,26 +131,208 @@ public:
 
     unsigned short getTcpPortNum();
     uint32_t       getNextProdIndex() const {return prodIndex;}
-    uint32_t       sendProduct(void* data, uint32_t dataSize);
-    uint32_t       sendProduct(void* data, uint32_t dataSize, void* metadata,
+    uint32_t       sendProduct(void* data, uint64_t dataSize);
+    uint32_t       sendProduct(void* data, uint64_t dataSize, void* metadata,
                                uint16_t metaSize);
+    /**
+     * Transfers several products, which are given consecutive indexes. With
+     * aggregation, small products are packed into shared datagrams, see
+     * `SetAggregation()`.
+     *
+     * @param[in] prods  The products.
+     * @param[in] count  Number of products.
+     * @return           Index of the first product.
+     * @throws std::runtime_error  if a product is invalid.
+     * @throws std::runtime_error  if a runtime error occurs.
+     */
+    uint32_t       sendProducts(const ProductDesc* prods, size_t count);
+    /**
+     * Transfers a file. The file is memory-mapped, multicast from the mapping
+     * and retransmitted from it, and the mapping is released when the product
+     * is no longer retained. The caller may close or remove the file as soon
+     * as this returns.
+     *
+     * @param[in] path      Pathname of the file.
+     * @param[in] metadata  Application-specific metadata or `NULL`.
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @return              Index of the product.
+     * @throws std::system_error   if the file can't be opened or mapped.
+     * @throws std::runtime_error  if the file is too large.
+     */
+    uint32_t       sendFile(const char* path, void* metadata = NULL,
+                            uint16_t metaSize = 0);
+    /**
+     * Transfers an open file. The file descriptor isn't closed.
+     *
+     * @param[in] fd        File descriptor of the file, open for reading.
+     * @param[in] metadata  Application-specific metadata or `NULL`.
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @return              Index of the product.
+     * @throws std::system_error   if the file can't be mapped.
+     * @throws std::runtime_error  if the file is too large.
+     */
+    uint32_t       sendFile(int fd, void* metadata = NULL,
+                            uint16_t metaSize = 0);
     void           SetSendRate(uint64_t speed);
+    /**
+     * Announces the send rate in the multicast BOPs, so that receivers can
+     * bound their estimates of the link speed. Receivers which predate the
+     * announcement reject such BOPs. Must be called before `Start()`.
+     *
+     * @param[in] enable  Whether to announce the send rate.
+     */
+    void           SetBopRateHint(bool enable);
+    /**
+     * Packs the BOP, data and EOP of several small products of
+     * `sendProducts()` into one multicast datagram. Receivers which predate
+     * aggregation can't read such datagrams. Must be called before `Start()`.
+     *
+     * @param[in] enable  Whether to aggregate small products.
+     */
+    void           SetAggregation(bool enable);
+    /**
+     * Multicasts each product whose BOP and data fit into one packet as a
+     * single FMTP_TINY packet instead of a BOP, a data packet and an EOP.
+     * Receivers which predate tiny products can't read such packets. Must be
+     * called before `Start()`.
+     *
+     * @param[in] enable  Whether to send tiny products in one packet.
+     */
+    void           SetTinyProducts(bool enable);
+    /**
+     * Repeats the EOP of the most recent product on multicast once the
+     * multicast has been idle for a while, so that receivers which lost the
+     * end of the product notice it. Must be called before `Start()`.
+     *
+     * @param[in] seconds            Idle time before the probe, 0 for none.
+     * @throw std::invalid_argument  if `seconds` is negative.
+     */
+    void           SetTailProbe(double seconds);
+    /**
+     * Sends 64-bit product sizes and offsets, so that products can be larger
+     * than 4 GB, up to MAX_WIDE_PRODSIZE. Receivers must call
+     * `fmtpRecvv3::SetWideOffsets()` as well. Must be called before
+     * `Start()`.
+     *
+     * @param[in] enable  Whether to send 64-bit sizes and offsets.
+     */
+    void           SetWideOffsets(bool enable);
     /** Sender side start point, the first function to be called */
     void           Start();
     /** Sender side stop point */
     void           Stop();
 
 private:
+    /**
+     * Small products which are packed into one FMTP_AGGREGATE datagram.
+     */
+    struct Aggregate
+    {
+        /** the packets of the products, which form the payload */
+        char                       packets[FMTP_DATA_LEN];
+        size_t                     len;      /*!< size of the packets */
+        uint32_t                   npackets; /*!< number of packets */
+        /** retransmission entries of the products */
+        std::vector<RetxMetadata*> prods;
+
+        Aggregate() : len(0), npackets(0), prods() {}
+    };
+
+    /**
+     * Returns the size of the product size and metadata size of a BOP.
+     *
+     * @return  Size in bytes.
+     */
+    size_t bopHeadLen() const;
+    /**
+     * Checks the arguments of a product to be sent.
+     *
+     * @param[in] data      Memory data to be sent.
+     * @param[in] dataSize  Size of the data in bytes.
+     * @param[in] metadata  Application-specific metadata or `NULL`.
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @throws std::runtime_error  if an argument is invalid.
+     */
+    void checkProduct(const void* data, uint64_t dataSize,
+                      const void* metadata, uint16_t metaSize) const;
+    /**
+     * Returns the largest product which can be sent.
+     *
+     * @return  Size in bytes.
+     */
+    uint64_t maxProdSize() const;
+    /**
+     * Returns the size of the packets of a product in an aggregate.
+     *
+     * @param[in] prod  The product.
+     * @return          Size of its BOP, data and EOP packets in bytes.
+     */
+    size_t packedLen(const ProductDesc& prod) const;
+    /**
+     * Tells whether the BOP of a product has room for the send rate.
+     *
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @return              True if the send rate is announced.
+     */
+    bool hasRateHint(const uint16_t metaSize) const;
+    /**
+     * Tells whether a product is sent as a single FMTP_TINY packet.
+     *
+     * @param[in] dataSize  Size of the data in bytes.
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @return              True if the product is sent in one packet.
+     */
+    bool isTiny(uint64_t dataSize, uint16_t metaSize) const;
+    /**
+     * Adds a product to an aggregate, which must have room for it.
+     *
+     * @param[in,out] agg   The aggregate.
+     * @param[in]     prod  The product.
+     * @throws std::runtime_error  if the product is invalid.
+     */
+    void packProduct(Aggregate& agg, const ProductDesc& prod);
+    /**
+     * Multicasts an aggregate, if it isn't empty, and empties it.
+     *
+     * @param[in,out] agg  The aggregate.
+     * @throws std::runtime_error  if an I/O error occurs.
+     */
+    void sendAggregate(Aggregate& agg);
+    /**
+     * Transfers metadata and a contiguous block of memory, which is either
+     * the application's or a file mapping.
+     *
+     * @param[in] data      Memory data to be sent.
+     * @param[in] dataSize  Size of the memory data in bytes.
+     * @param[in] metadata  Application-specific metadata or `NULL`.
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @param[in] maplen    Length of the file mapping at `data`, which is
+     *                      released with the product, or 0.
+     * @return              Index of the product.
+     */
+    uint32_t transferProduct(void* data, uint64_t dataSize, void* metadata,
+                             uint16_t metaSize, size_t maplen);
     /**
      * Adds and entry for a data-product to the retransmission set.
      *
      * @param[in] data      The data-product.
      * @param[in] dataSize  The size of the data-product in bytes.
+     * @param[in] maplen    Length of the file mapping at `data`, which the
+     *                      entry takes over, or 0.
      * @return              The corresponding retransmission entry.
      * @throw std::runtime_error  if a retransmission entry couldn't be created.
      */
-    RetxMetadata* addRetxMetadata(void* const data, const uint32_t dataSize,
-                                  void* const metadata, const uint16_t metaSize);
+    RetxMetadata* addRetxMetadata(void* const data, const uint64_t dataSize,
+                                  void* const metadata, const uint16_t metaSize,
+                                  const size_t maplen);
+    /**
+     * Arms the tail-loss probe for a product after its EOP, or disarms it
+     * before its BOP. Waits for a probe which is being multicast.
+     *
+     * @param[in] arm        Whether to arm the probe.
+     * @param[in] prodindex  Index of the product.
+     */
+    void armProbe(const bool arm, const uint32_t prodindex);
     static uint32_t blockIndex(uint32_t start) {return start/FMTP_DATA_LEN;}
     /** new coordinator thread */
     static void* coordinator(void* ptr);
@@ -156,6 +354,23 @@ private:
      */
     void handleRetxEnd(FmtpHeader* const  recvheader,
                        RetxMetadata* const retxMeta, const int sock);
+    /**
+     * Handles a notice from a receiver that batches of data-products have
+     * been completely received.
+     *
+     * @param[in] recvheader  The FMTP header of the notice.
+     * @param[in] rbuf        The receive buffer of the receiver's socket.
+     * @param[in] sock        The receiver's socket.
+     */
+    void handleRetxEndBatch(FmtpHeader* const recvheader, TcpRecvBuffer& rbuf,
+                            const int sock);
+    /**
+     * Notifies the sending application that every receiver has acknowledged
+     * a product.
+     *
+     * @param[in] prodindex  Index of the product.
+     */
+    void notifyAcked(const uint32_t prodindex);
     /**
      * Handles a notice from a receiver that BOP for a product is missing.
      *
@@ -165,6 +380,15 @@ private:
      */
     void handleBopReq(FmtpHeader* const  recvheader,
                       RetxMetadata* const retxMeta, const int sock);
+    /**
+     * Handles a request from a receiver for the BOPs of a range of products.
+     *
+     * @param[in] recvheader  The FMTP header of the request.
+     * @param[in] retxMeta    The retransmission entry of the first product.
+     * @param[in] sock        The receiver's socket.
+     */
+    void handleBopRangeReq(FmtpHeader* const  recvheader,
+                           RetxMetadata* const retxMeta, const int sock);
     /**
      * Handles a notice from a receiver that EOP for a product is missing.
      *
@@ -174,6 +398,13 @@ private:
      */
     void handleEopReq(FmtpHeader* const  recvheader,
                       RetxMetadata* const retxMeta, const int sock);
+    /**
+     * Repeats the EOP of the most recent product when the multicast has been
+     * idle for the probe interval. Returns when the sender is stopped.
+     */
+    void probeThread();
+    /** a wrapper to call the actual fmtpSendv3::probeThread() */
+    static void* probeWrapper(void* ptr);
     /** new timer thread */
     void RunRetxThread(int retxsockfd);
     /**
@@ -208,7 +439,7 @@ private:
      * @param[in] sock        The receiver's socket.
      */
     void retransEOP(const FmtpHeader* const  recvheader, const int sock);
-    void SendBOPMessage(uint32_t prodSize, void* metadata,
+    void SendBOPMessage(uint64_t prodSize, void* metadata,
                         const uint16_t metaSize);
     /**
      * Multicasts the data of a data-product.
@@ -218,7 +449,41 @@ private:
      * @throw std::runtime_error  if an I/O error occurs.
      */
     void sendEOPMessage();
-    void sendData(void* data, uint32_t dataSize);
+    void sendData(void* data, uint64_t dataSize);
+    /**
+     * Encodes the product size and metadata size of a BOP.
+     *
+     * @param[in]  prodsize  Size of the product in bytes.
+     * @param[in]  metaSize  Size of the metadata in bytes.
+     * @param[out] buf       Where they go, at least `bopHeadLen()` bytes.
+     * @return               Number of bytes encoded, see `bopHeadLen()`.
+     */
+    size_t putBopHead(uint64_t prodsize, uint16_t metaSize, char* buf) const;
+    /**
+     * Returns the seqnum of a data block on the wire.
+     *
+     * @param[in] offset  Offset of the block in bytes.
+     * @return            The seqnum.
+     */
+    uint32_t seqnumOf(uint64_t offset) const;
+    /**
+     * Returns the flags of a packet which carries a product size.
+     *
+     * @param[in] flags  FMTP_BOP, FMTP_RETX_BOP or FMTP_TINY.
+     * @return           The flags, marked with FMTP_WIDE in wide mode.
+     */
+    uint16_t bopFlags(uint16_t flags) const;
+    /**
+     * Multicasts a whole product as one FMTP_TINY packet.
+     *
+     * @param[in] data      The data of the product.
+     * @param[in] dataSize  Size of the data in bytes.
+     * @param[in] metadata  Application-specific metadata or `NULL`.
+     * @param[in] metaSize  Size of the metadata in bytes.
+     * @throw std::runtime_error  if an I/O error occurs.
+     */
+    void sendTinyMessage(void* data, uint64_t dataSize, void* metadata,
+                         uint16_t metaSize);
     /**
      * Sets the retransmission timeout parameters in a retransmission entry.
      *
@@ -254,6 +519,14 @@ private:
     RetxThreads         retxThreadList;
     std::mutex          linkmtx;
     uint64_t            linkspeed;
+    /* whether the BOP carries linkspeed, see SetBopRateHint() */
+    bool                rateHint;
+    /* whether small products share datagrams, see SetAggregation() */
+    bool                aggregate;
+    /* whether a product fitting one packet is sent so, see SetTinyProducts() */
+    bool                tiny;
+    /* whether sizes and offsets are 64-bit, see SetWideOffsets() */
+    bool                wide;
     std::mutex          exitMutex;
     std::exception_ptr  except;
     bool                exceptIsSet;
@@ -267,6 +540,20 @@ private:
     SilenceSuppressor*  suppressor;
     /* sender maximum retransmission timeout */
     double              tsnd;
+    /* multicast idle time before the tail-loss probe, 0 for none */
+    double              probeInterval;
+    pthread_t           probe_t;
+    /* protects the members of the tail-loss probe below and is held while
+     * the probe is multicast */
+    std::mutex          probemtx;
+    std::condition_variable probecond;
+    /* when the EOP of the most recent product was multicast */
+    std::chrono::steady_clock::time_point probeStart;
+    /* index of the most recent product */
+    uint32_t            probeIndex;
+    /* whether the most recent product is complete and not yet probed */
+    bool                probeArmed;
+    bool                probeStop;
 
 
     /* member variables for measurement use only */
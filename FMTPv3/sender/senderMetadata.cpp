@@ -32,6 +32,7 @@
 #include "senderMetadata.h"
 
 #include <algorithm>
+#include <iterator>
 
 
 #ifndef NULL
@@ -92,60 +93,121 @@ void senderMetadata::addRetxMetadata(RetxMetadata* ptrMeta)
 bool senderMetadata::clearUnfinishedSet(uint32_t prodindex, int retxsockfd,
                                         TcpSend* tcpsend)
 {
-    bool prodRemoved;
     std::map<uint32_t, RetxMetadata*>::iterator it;
-    std::list<int> sklist;
-    std::list<int>::iterator sklit;
-    std::set<int>::iterator sockit;
 
     std::unique_lock<std::mutex> lock(indexMetaMapLock);
     /* socklist should not be empty */
-    sklist = tcpsend->getConnSockList();
-    if ((it = indexMetaMap.find(prodindex)) != indexMetaMap.end()) {
-        it->second->unfinReceivers.erase(retxsockfd);
-        /* find possible legacy offline receivers and erase from set */
-        if (!it->second->unfinReceivers.empty()) {
-            for (sockit = it->second->unfinReceivers.begin();
-                 sockit != it->second->unfinReceivers.end(); ) {
-                sklit = std::find(sklist.begin(), sklist.end(), *sockit);
-                if (sklit == sklist.end()) {
-                    /* erase while iterating, conforming c++0x */
-                    it->second->unfinReceivers.erase(sockit++);
-                }
-                else {
-                    ++sockit;
-                }
+    const std::list<int> sklist = tcpsend->getConnSockList();
+    if ((it = indexMetaMap.find(prodindex)) != indexMetaMap.end())
+        return clearReceiver(it, retxsockfd, sklist);
+    return false;
+}
+
+
+/**
+ * Removes a receiver from the unfinished sets of ranges of products, e.g. the
+ * products of a batched acknowledgement, with the lock and the list of
+ * connected receivers taken once for all of them. Only the retained products
+ * of a range are visited, so a long range costs no more than its entries. A
+ * range may wrap around the largest product index.
+ *
+ * @param[in]  ranges      {first, count} pairs of product indexes.
+ * @param[in]  nranges     Number of pairs.
+ * @param[in]  retxsockfd  sock file descriptor of the retransmission tcp
+ *                         connection.
+ * @param[in]  tcpsend     The connections of the receivers.
+ * @param[out] removed     Appended with the indexes of the products which
+ *                         are removed, see clearUnfinishedSet().
+ */
+void senderMetadata::clearUnfinishedSets(const uint32_t* ranges,
+                                         size_t nranges, int retxsockfd,
+                                         TcpSend* tcpsend,
+                                         std::vector<uint32_t>& removed)
+{
+    std::unique_lock<std::mutex> lock(indexMetaMapLock);
+    const std::list<int> sklist = tcpsend->getConnSockList();
+
+    for (size_t i = 0; i < nranges; i++) {
+        const uint32_t first = ranges[2 * i];
+        const uint32_t count = ranges[2 * i + 1];
+        const bool     wraps = (uint32_t)(first + count) < first;
+
+        MetaIter it = indexMetaMap.lower_bound(first);
+        for (int pass = 0; pass < (wraps ? 2 : 1); pass++) {
+            if (pass == 1)
+                it = indexMetaMap.begin();
+            while (it != indexMetaMap.end() &&
+                    (uint32_t)(it->first - first) < count &&
+                    (pass == 0 || it->first < first)) {
+                const MetaIter next = std::next(it);
+                const uint32_t prodindex = it->first;
+                if (clearReceiver(it, retxsockfd, sklist))
+                    removed.push_back(prodindex);
+                it = next;
             }
         }
-        if (it->second->unfinReceivers.empty()) {
-            if (it->second->inuse) {
-                if (it->second->remove) {
-                    /**
-                     * If the remove flag is already marked as true, it implies
-                     * the deletion has been successfully done by another call.
-                     * Thus, the prodRemoved should be set to false and nothing
-                     * else should be done.
-                     */
-                    prodRemoved = false;
-                }
-                else {
-                    /**
-                     * If the remove flag is not marked as true, it implies
-                     * the deletion is successfully done by this call. Thus,
-                     * it deserves to set the prodRemoved to true.
-                     */
-                    it->second->remove = true;
-                    prodRemoved = true;
-                }
+    }
+}
+
+
+/**
+ * Remove the particular receiver identified by the retxsockfd from the
+ * unfinished receiver set of a product and erase the legacy offline receivers
+ * as well. If the set is empty afterwards, remove the whole entry from the
+ * map, or mark it for removal if it's in use. The lock must be held.
+ *
+ * @param[in] it                Entry of the product.
+ * @param[in] retxsockfd        sock file descriptor of the retransmission tcp
+ *                              connection.
+ * @param[in] sklist            Sockets of the connected receivers.
+ * @return    True if RetxMetadata is removed, otherwise false.
+ */
+bool senderMetadata::clearReceiver(MetaIter it, int retxsockfd,
+                                   const std::list<int>& sklist)
+{
+    bool prodRemoved;
+    std::set<int>::iterator sockit;
+
+    it->second->unfinReceivers.erase(retxsockfd);
+    /* find possible legacy offline receivers and erase from set */
+    if (!it->second->unfinReceivers.empty()) {
+        for (sockit = it->second->unfinReceivers.begin();
+             sockit != it->second->unfinReceivers.end(); ) {
+            if (std::find(sklist.begin(), sklist.end(), *sockit) ==
+                    sklist.end()) {
+                /* erase while iterating, conforming c++0x */
+                it->second->unfinReceivers.erase(sockit++);
+            }
+            else {
+                ++sockit;
+            }
+        }
+    }
+    if (it->second->unfinReceivers.empty()) {
+        if (it->second->inuse) {
+            if (it->second->remove) {
+                /**
+                 * If the remove flag is already marked as true, it implies
+                 * the deletion has been successfully done by another call.
+                 * Thus, the prodRemoved should be set to false and nothing
+                 * else should be done.
+                 */
+                prodRemoved = false;
             }
             else {
-                it->second->~RetxMetadata();
-                indexMetaMap.erase(it);
+                /**
+                 * If the remove flag is not marked as true, it implies
+                 * the deletion is successfully done by this call. Thus,
+                 * it deserves to set the prodRemoved to true.
+                 */
+                it->second->remove = true;
                 prodRemoved = true;
             }
         }
         else {
-            prodRemoved = false;
+            it->second->~RetxMetadata();
+            indexMetaMap.erase(it);
+            prodRemoved = true;
         }
     }
     else {
@@ -155,6 +217,21 @@ bool senderMetadata::clearUnfinishedSet(uint32_t prodindex, int retxsockfd,
 }
 
 
+/**
+ * Tells whether a product is still retained for retransmission, i.e. whether
+ * some receiver hasn't acknowledged it and it hasn't timed out. Unlike
+ * getMetadata(), doesn't acquire the entry.
+ *
+ * @param[in] prodindex  Index of the product.
+ * @return               True if the product is retained.
+ */
+bool senderMetadata::isRetained(uint32_t prodindex)
+{
+    std::unique_lock<std::mutex> lock(indexMetaMapLock);
+    return indexMetaMap.find(prodindex) != indexMetaMap.end();
+}
+
+
 /**
  * Fetch the requested RetxMetadata entry identified by a given prodindex. If
  * found nothing, return NULL pointer. Otherwise return the pointer to that
@@ -35,12 +35,15 @@
 
 #include <pthread.h>
 #include <stdint.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <chrono>
 #include <cstring>
+#include <list>
 #include <map>
 #include <mutex>
 #include <set>
+#include <vector>
 
 #include "fmtpBase.h"
 #include "TcpSend.h"
@@ -51,11 +54,13 @@ typedef std::chrono::high_resolution_clock HRclock;
 struct RetxMetadata {
     uint32_t       prodindex;
     /* recording the whole product size (for timeout factor use) */
-    uint32_t       prodLength;
+    uint64_t       prodLength;
     uint16_t       metaSize;          /*!< metadata size               */
     void*          metadata;          /*!< metadata pointer            */
     double         retxTimeoutPeriod; /*!< timeout time in seconds     */
     void*          dataprod_p;        /*!< pointer to the data product */
+    /* length of the file mapping at dataprod_p, 0 if it isn't a mapping */
+    size_t         maplen;
     /* unfinished receiver set indexed by socket id */
     std::set<int>  unfinReceivers;
     /* indicates the RetxMetadata is in use */
@@ -65,7 +70,8 @@ struct RetxMetadata {
 
     RetxMetadata(): prodindex(0), prodLength(0), metaSize(0),
                     metadata(NULL), retxTimeoutPeriod(99999999999.0),
-                    dataprod_p(NULL), inuse(false), remove(false) {}
+                    dataprod_p(NULL), maplen(0), inuse(false),
+                    remove(false) {}
     ~RetxMetadata() {
         delete[] (char*)metadata;
         metadata = NULL;
@@ -73,6 +79,8 @@ struct RetxMetadata {
          * TODO: put a callback here to notify the application to
          * release the dataprod_p.
          */
+        if (maplen)
+            (void)munmap(dataprod_p, maplen);
         dataprod_p = NULL;
     }
 
@@ -83,6 +91,7 @@ struct RetxMetadata {
         prodLength(meta.prodLength),
         metaSize(meta.metaSize),
         retxTimeoutPeriod(meta.retxTimeoutPeriod),
+        maplen(0),
         unfinReceivers(meta.unfinReceivers),
         inuse(meta.inuse),
         remove(meta.remove)
@@ -106,13 +115,48 @@ public:
     void addRetxMetadata(RetxMetadata* ptrMeta);
     bool clearUnfinishedSet(uint32_t prodindex, int retxsockfd,
                             TcpSend* tcpsend);
+    /**
+     * Removes a receiver from the unfinished sets of ranges of products in
+     * one pass.
+     *
+     * @param[in]  ranges      {first, count} pairs of product indexes.
+     * @param[in]  nranges     Number of pairs.
+     * @param[in]  retxsockfd  The receiver's socket.
+     * @param[in]  tcpsend     The connections of the receivers.
+     * @param[out] removed     Appended with the indexes of the products
+     *                         which are removed.
+     */
+    void clearUnfinishedSets(const uint32_t* ranges, size_t nranges,
+                             int retxsockfd, TcpSend* tcpsend,
+                             std::vector<uint32_t>& removed);
     RetxMetadata* getMetadata(uint32_t prodindex);
+    /**
+     * Tells whether a product is still retained for retransmission.
+     *
+     * @param[in] prodindex  Index of the product.
+     * @return               True if the product is retained.
+     */
+    bool isRetained(uint32_t prodindex);
     void notifyUnACKedRcvrs(uint32_t prodindex, FmtpHeader* header,
                             TcpSend* tcpsend);
     bool releaseMetadata(uint32_t prodindex);
     bool rmRetxMetadata(uint32_t prodindex);
 
 private:
+    typedef std::map<uint32_t, RetxMetadata*>::iterator MetaIter;
+
+    /**
+     * Removes a receiver from the unfinished set of a product. The lock must
+     * be held.
+     *
+     * @param[in] it          The entry of the product.
+     * @param[in] retxsockfd  The receiver's socket.
+     * @param[in] sklist      Sockets of the connected receivers.
+     * @return                True if the product is removed.
+     */
+    bool clearReceiver(MetaIter it, int retxsockfd,
+                       const std::list<int>& sklist);
+
     /* first: prodindex; second: pointer to metadata of the specified prodindex */
     std::map<uint32_t, RetxMetadata*> indexMetaMap;
     std::mutex                        indexMetaMapLock;
@@ -0,0 +1,154 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: AckBatchTest.cpp
+ *
+ * This file tests class `AckBatch`.
+ */
+
+#include "AckBatch.h"
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef AckBatch::Clock Clock;
+
+// The fixture for testing class AckBatch.
+class AckBatchTest : public ::testing::Test {
+ protected:
+  AckBatchTest() : batch(10, 0.01, 4), now(Clock::now()) {
+  }
+
+  Clock::time_point at(const double seconds) const {
+    return now + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds));
+  }
+
+  bool add(const uint32_t prodindex) {
+    bool started;
+    return batch.add(prodindex, now, started);
+  }
+
+  AckBatch          batch;
+  Clock::time_point now;
+};
+
+TEST_F(AckBatchTest, InvalidArguments) {
+    EXPECT_THROW(AckBatch(0, 1, 1), std::invalid_argument);
+    EXPECT_THROW(AckBatch(1, 0, 1), std::invalid_argument);
+    EXPECT_THROW(AckBatch(1, 1, 0), std::invalid_argument);
+}
+
+TEST_F(AckBatchTest, Deadline) {
+    std::vector<AckBatch::Range> ranges;
+    EXPECT_FALSE(batch.hasDeadline());
+    EXPECT_EQ(0, batch.take(ranges));
+    EXPECT_TRUE(ranges.empty());
+
+    bool started;
+    EXPECT_FALSE(batch.add(1, now, started));
+    EXPECT_TRUE(started);
+    EXPECT_FALSE(batch.add(2, at(0.005), started));
+    EXPECT_FALSE(started);
+    ASSERT_TRUE(batch.hasDeadline());
+    EXPECT_EQ(at(0.01), batch.nextDeadline());
+
+    EXPECT_EQ(2, batch.take(ranges));
+    EXPECT_FALSE(batch.hasDeadline());
+    EXPECT_EQ(0, batch.size());
+    EXPECT_FALSE(batch.add(3, at(1), started));
+    EXPECT_TRUE(started);
+    EXPECT_EQ(at(1.01), batch.nextDeadline());
+}
+
+TEST_F(AckBatchTest, Merge) {
+    // in order, out of order, and the gap filled from both ends
+    const uint32_t order[] = {5, 6, 7, 10, 12, 9, 8, 11};
+    for (int i = 0; i < 8; i++)
+        EXPECT_FALSE(add(order[i]));
+    std::vector<AckBatch::Range> ranges;
+    EXPECT_EQ(8, batch.take(ranges));
+    ASSERT_EQ(1, ranges.size());
+    EXPECT_EQ(5, ranges[0].first);
+    EXPECT_EQ(8, ranges[0].count);
+}
+
+TEST_F(AckBatchTest, Sparse) {
+    EXPECT_FALSE(add(1));
+    EXPECT_FALSE(add(2));
+    EXPECT_FALSE(add(20));
+    std::vector<AckBatch::Range> ranges;
+    EXPECT_EQ(3, batch.take(ranges));
+    ASSERT_EQ(2, ranges.size());
+    EXPECT_EQ(1, ranges[0].first);
+    EXPECT_EQ(2, ranges[0].count);
+    EXPECT_EQ(20, ranges[1].first);
+    EXPECT_EQ(1, ranges[1].count);
+}
+
+TEST_F(AckBatchTest, Wraparound) {
+    EXPECT_FALSE(add(UINT32_MAX));
+    EXPECT_FALSE(add(0));
+    std::vector<AckBatch::Range> ranges;
+    EXPECT_EQ(2, batch.take(ranges));
+    ASSERT_EQ(1, ranges.size());
+    EXPECT_EQ(UINT32_MAX, ranges[0].first);
+    EXPECT_EQ(2, ranges[0].count);
+}
+
+TEST_F(AckBatchTest, Full) {
+    // by products
+    for (uint32_t i = 0; i < 9; i++)
+        EXPECT_FALSE(add(i));
+    EXPECT_TRUE(add(9));
+    std::vector<AckBatch::Range> ranges;
+    EXPECT_EQ(10, batch.take(ranges));
+    // by ranges
+    for (uint32_t i = 0; i < 3; i++)
+        EXPECT_FALSE(add(i * 2));
+    EXPECT_TRUE(add(6));
+}
+
+TEST_F(AckBatchTest, Performance) {
+    AckBatch       big(1000, 0.01, 512);
+    const uint32_t nprods = 1000000;
+    unsigned       nbatches = 0;
+    uint64_t       acked = 0;
+    std::vector<AckBatch::Range> ranges;
+
+    const Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < nprods; i++) {
+        // every 10th product completes a little late
+        const uint32_t prodindex = i % 10 == 9 ? i - 5 : i % 10 >= 5 ?
+                i + 1 : i;
+        bool started;
+        if (big.add(prodindex, now, started)) {
+            nbatches++;
+            acked += big.take(ranges);
+        }
+    }
+    acked += big.take(ranges);
+    const double secs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(Clock::now() - start).count();
+    EXPECT_EQ(nprods, acked);
+    EXPECT_EQ(nprods / 1000, nbatches);
+    std::cerr << "AckBatch: " << nbatches << " messages for " << nprods
+            << " products, " << std::to_string(nprods/secs)
+            << " products/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
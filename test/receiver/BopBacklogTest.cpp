@@ -0,0 +1,185 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: BopBacklogTest.cpp
+ *
+ * This file tests class `BopBacklog`.
+ */
+
+#include "BopBacklog.h"
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+typedef BopBacklog::Clock Clock;
+
+// The fixture for testing class BopBacklog.
+class BopBacklogTest : public ::testing::Test {
+ protected:
+  BopBacklogTest() : backlog(100, 1), now(Clock::now()) {
+  }
+
+  Clock::time_point at(const double seconds) const {
+    return now + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds));
+  }
+
+  BopBacklog        backlog;
+  Clock::time_point now;
+};
+
+TEST_F(BopBacklogTest, InvalidArguments) {
+    EXPECT_THROW(BopBacklog(0, 1), std::invalid_argument);
+    EXPECT_THROW(BopBacklog(1, 0), std::invalid_argument);
+    EXPECT_THROW(BopBacklog(1, 1, 0), std::invalid_argument);
+}
+
+TEST_F(BopBacklogTest, Empty) {
+    uint32_t first;
+    EXPECT_EQ(0, backlog.next(now, first));
+    EXPECT_FALSE(backlog.hasDeadline());
+    backlog.add(5, 0);
+    EXPECT_EQ(0, backlog.size());
+    EXPECT_EQ(0, backlog.next(now, first));
+}
+
+TEST_F(BopBacklogTest, Windows) {
+    uint32_t first;
+    backlog.add(10, 250);
+    EXPECT_EQ(250, backlog.size());
+
+    ASSERT_EQ(100, backlog.next(now, first));
+    EXPECT_EQ(10, first);
+    EXPECT_EQ(150, backlog.size());
+    // one range at a time
+    EXPECT_EQ(0, backlog.next(now, first));
+    EXPECT_TRUE(backlog.hasDeadline());
+    EXPECT_EQ(at(1), backlog.nextDeadline());
+
+    // only the answer for the last product completes the range
+    EXPECT_FALSE(backlog.answered(10));
+    EXPECT_FALSE(backlog.answered(108));
+    EXPECT_EQ(0, backlog.next(now, first));
+    EXPECT_TRUE(backlog.answered(109));
+    EXPECT_FALSE(backlog.answered(109));
+
+    ASSERT_EQ(100, backlog.next(now, first));
+    EXPECT_EQ(110, first);
+    EXPECT_TRUE(backlog.answered(209));
+    ASSERT_EQ(50, backlog.next(now, first));
+    EXPECT_EQ(210, first);
+    // nothing waits for the last range
+    EXPECT_FALSE(backlog.hasDeadline());
+    EXPECT_FALSE(backlog.answered(259));
+    EXPECT_EQ(0, backlog.size());
+}
+
+TEST_F(BopBacklogTest, Overdue) {
+    uint32_t first;
+    backlog.add(0, 150);
+    ASSERT_EQ(100, backlog.next(now, first));
+    EXPECT_EQ(0, backlog.next(at(0.999), first));
+    ASSERT_EQ(50, backlog.next(at(1), first));
+    EXPECT_EQ(100, first);
+    // a late answer for the previous range doesn't count
+    EXPECT_FALSE(backlog.answered(99));
+}
+
+TEST_F(BopBacklogTest, Merge) {
+    uint32_t first;
+    // gaps reported piecemeal fill whole windows
+    for (uint32_t i = 0; i < 10; i++)
+        backlog.add(1000 + 20 * i, 20);
+    backlog.add(2000, 10);
+    EXPECT_EQ(210, backlog.size());
+    ASSERT_EQ(100, backlog.next(now, first));
+    EXPECT_EQ(1000, first);
+    ASSERT_TRUE(backlog.answered(1099));
+    ASSERT_EQ(100, backlog.next(now, first));
+    EXPECT_EQ(1100, first);
+    ASSERT_TRUE(backlog.answered(1199));
+    ASSERT_EQ(10, backlog.next(now, first));
+    EXPECT_EQ(2000, first);
+}
+
+TEST_F(BopBacklogTest, Wraparound) {
+    uint32_t first;
+    backlog.add(UINT32_MAX - 9, 20);
+    ASSERT_EQ(20, backlog.next(now, first));
+    EXPECT_EQ(UINT32_MAX - 9, first);
+    backlog.add(10, 5);
+    EXPECT_TRUE(backlog.answered(9));
+}
+
+TEST_F(BopBacklogTest, Limit) {
+    BopBacklog small(100, 1, 150);
+    uint32_t   first;
+    small.add(0, 100);
+    small.add(200, 40);
+    EXPECT_EQ(0, small.dropExcess(first));
+
+    // the oldest products go first, range by range
+    small.add(300, 60);
+    ASSERT_EQ(50, small.dropExcess(first));
+    EXPECT_EQ(0, first);
+    EXPECT_EQ(0, small.dropExcess(first));
+    EXPECT_EQ(150, small.size());
+
+    small.add(400, 100);
+    ASSERT_EQ(50, small.dropExcess(first));
+    EXPECT_EQ(50, first);
+    ASSERT_EQ(40, small.dropExcess(first));
+    EXPECT_EQ(200, first);
+    ASSERT_EQ(10, small.dropExcess(first));
+    EXPECT_EQ(300, first);
+    EXPECT_EQ(0, small.dropExcess(first));
+
+    ASSERT_EQ(50, small.next(now, first));
+    EXPECT_EQ(310, first);
+}
+
+/*
+ * An outage of 100k products is requested in ranges of MAX_BOP_RANGE
+ * products, each answered at once.
+ */
+TEST_F(BopBacklogTest, Performance) {
+    BopBacklog     big(1024, 1);
+    const uint32_t nprods = 100000;
+    unsigned       nreqs = 0;
+    uint32_t       requested = 0;
+    uint32_t       first;
+    uint32_t       count;
+
+    const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    big.add(1, nprods);
+    while ((count = big.next(now, first)) > 0) {
+        nreqs++;
+        requested += count;
+        for (uint32_t i = 0; i < count; i++)
+            (void)big.answered(first + i);
+    }
+    const double secs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(std::chrono::steady_clock::now() -
+            start).count();
+    EXPECT_EQ(nprods, requested);
+    EXPECT_EQ((nprods + 1023) / 1024, nreqs);
+    std::cerr << "BopBacklog: " << nreqs << " requests for " << nprods
+            << " products, " << std::to_string(nprods/secs)
+            << " answers/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,129 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: BufferPoolTest.cpp
+ *
+ * This file tests class `BufferPool`.
+ */
+
+#include "BufferPool.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class BufferPool.
+class BufferPoolTest : public ::testing::Test {
+ protected:
+  BufferPoolTest() : pool(1000, 3) {
+  }
+
+  BufferPool pool;
+};
+
+TEST_F(BufferPoolTest, InvalidArguments) {
+    EXPECT_THROW(BufferPool(0, 1), std::invalid_argument);
+    EXPECT_THROW(BufferPool(1, 0), std::invalid_argument);
+}
+
+TEST_F(BufferPoolTest, GetPut) {
+    EXPECT_EQ(3, pool.available());
+    std::set<void*> bufs;
+    for (int i = 0; i < 3; i++) {
+        void* buf = pool.tryGet(1000);
+        ASSERT_TRUE(buf != NULL);
+        ASSERT_TRUE(pool.owns(buf));
+        (void)memset(buf, i, 1000);
+        bufs.insert(buf);
+    }
+    EXPECT_EQ(3, bufs.size());
+    EXPECT_EQ(0, pool.available());
+    // exhausted
+    EXPECT_TRUE(pool.tryGet(1) == NULL);
+    EXPECT_EQ(1, pool.getMisses());
+    for (std::set<void*>::iterator it = bufs.begin(); it != bufs.end(); ++it)
+        pool.put(*it);
+    EXPECT_EQ(3, pool.available());
+}
+
+TEST_F(BufferPoolTest, TooLarge) {
+    EXPECT_TRUE(pool.tryGet(1001) == NULL);
+    EXPECT_EQ(1, pool.getMisses());
+    EXPECT_EQ(3, pool.available());
+}
+
+TEST_F(BufferPoolTest, Foreign) {
+    char  other[1000];
+    char* buf = (char*)pool.tryGet(10);
+    EXPECT_FALSE(pool.owns(other));
+    EXPECT_FALSE(pool.owns(buf + 1));
+    EXPECT_THROW(pool.put(other), std::invalid_argument);
+    EXPECT_THROW(pool.put(buf + 1), std::invalid_argument);
+    pool.put(buf);
+}
+
+TEST_F(BufferPoolTest, Concurrent) {
+    BufferPool               big(64, 64);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([&big, t] {
+            for (int i = 0; i < 100000; i++) {
+                char* buf = (char*)big.tryGet(64);
+                if (buf) {
+                    buf[0] = (char)t;
+                    big.put(buf);
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    EXPECT_EQ(64, big.available());
+}
+
+TEST(BufferPoolPerformance, Performance) {
+    // a BOP buffer of 1 MB from malloc() and from the pool
+    const int          times = 100000;
+    const size_t       size  = 1048576;
+    BufferPool         pool(size, 16);
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    for (int i = 0; i < times; i++) {
+        char* buf = (char*)malloc(size);
+        buf[i % size] = 1;
+        free(buf);
+    }
+    const double mallocSecs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < times; i++) {
+        char* buf = (char*)pool.tryGet(size);
+        buf[i % size] = 1;
+        pool.put(buf);
+    }
+    const double poolSecs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    std::cerr << "malloc(): " << std::to_string(mallocSecs * 1e9 / times) <<
+            " ns per buffer\n";
+    std::cerr << "Pool:     " << std::to_string(poolSecs * 1e9 / times) <<
+            " ns per buffer\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,228 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: FileSinkTest.cpp
+ *
+ * This file tests class `FileSink`.
+ */
+
+#include "FileSink.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class FileSink.
+class FileSinkTest : public ::testing::Test {
+ protected:
+  FileSinkTest() {
+    char tmpl[] = "/tmp/FileSinkTest.XXXXXX";
+    if (mkdtemp(tmpl) == NULL)
+        throw std::runtime_error("Couldn't create directory");
+    dir = tmpl;
+  }
+
+  ~FileSinkTest() {
+    (void)system(("rm -rf " + dir).c_str());
+  }
+
+  FileSink* newSink(const bool useIoUring, const size_t nbufs = 4096) {
+    return new FileSink(dir, [this](uint32_t prodindex, bool ok) {
+        std::unique_lock<std::mutex> lock(mutex);
+        completed[prodindex] = ok;
+        cond.notify_all();
+    }, nbufs, useIoUring);
+  }
+
+  bool waitFor(const uint32_t prodindex) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!completed.count(prodindex))
+        cond.wait(lock);
+    return completed[prodindex];
+  }
+
+  static char pat(const uint32_t prodindex, const uint32_t off) {
+    return (char)(prodindex * 31 + off * 7 + (off >> 11));
+  }
+
+  // Hands the blocks of a product to the sink in a shuffled order
+  static void writeShuffled(FileSink& sink, const uint32_t prodindex,
+          const uint32_t prodsize) {
+    std::vector<uint32_t> offsets;
+    for (uint32_t off = 0; off < prodsize; off += FMTP_DATA_LEN)
+        offsets.push_back(off);
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(prodindex));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        const uint16_t len = std::min<uint32_t>(FMTP_DATA_LEN,
+                prodsize - offsets[i]);
+        char* const    buf = sink.getBuffer();
+        for (uint16_t k = 0; k < len; k++)
+            buf[k] = pat(prodindex, offsets[i] + k);
+        sink.write(prodindex, offsets[i], buf, len);
+    }
+  }
+
+  void checkFile(const uint32_t prodindex, const uint32_t prodsize) {
+    const std::string path = dir + "/" + std::to_string(prodindex);
+    const int         fd   = open(path.c_str(), O_RDONLY);
+    ASSERT_LE(0, fd);
+    std::vector<char> data(prodsize + 1);
+    ASSERT_EQ(prodsize, read(fd, data.data(), data.size()));
+    close(fd);
+    for (uint32_t off = 0; off < prodsize; off++)
+        ASSERT_EQ(pat(prodindex, off), data[off]) << "offset " << off;
+  }
+
+  bool exists(const uint32_t prodindex) {
+    struct stat st;
+    return stat((dir + "/" + std::to_string(prodindex)).c_str(), &st) == 0;
+  }
+
+  std::string                 dir;
+  std::mutex                  mutex;
+  std::condition_variable     cond;
+  std::map<uint32_t, bool>    completed;
+};
+
+TEST_F(FileSinkTest, Path) {
+    FileSink* sink = newSink(false);
+    EXPECT_EQ(dir + "/42", sink->pathOf(42));
+    delete sink;
+}
+
+TEST_F(FileSinkTest, Preallocated) {
+    FileSink* sink = newSink(false);
+    sink->open(1, 1000000);
+    struct stat st;
+    ASSERT_EQ(0, stat(sink->pathOf(1).c_str(), &st));
+    EXPECT_EQ(1000000, st.st_size);
+    delete sink;
+    // an unfinished product is removed
+    EXPECT_FALSE(exists(1));
+}
+
+TEST_F(FileSinkTest, ShuffledBlocks) {
+    for (int ring = 0; ring < 2; ring++) {
+        FileSink* sink = newSink(ring);
+        for (uint32_t i = 0; i < 5; i++) {
+            const uint32_t prodsize = 100000 * i + 17 * ring + 3;
+            sink->open(ring * 10 + i, prodsize);
+            writeShuffled(*sink, ring * 10 + i, prodsize);
+            ASSERT_TRUE(sink->finish(ring * 10 + i));
+        }
+        for (uint32_t i = 0; i < 5; i++) {
+            ASSERT_TRUE(waitFor(ring * 10 + i));
+            checkFile(ring * 10 + i, 100000 * i + 17 * ring + 3);
+        }
+        delete sink;
+    }
+}
+
+TEST_F(FileSinkTest, EmptyProduct) {
+    FileSink* sink = newSink(false);
+    sink->open(3, 0);
+    ASSERT_TRUE(sink->finish(3));
+    ASSERT_TRUE(waitFor(3));
+    checkFile(3, 0);
+    delete sink;
+}
+
+TEST_F(FileSinkTest, Discard) {
+    FileSink* sink = newSink(true);
+    sink->open(4, 10000);
+    writeShuffled(*sink, 4, 5000);
+    ASSERT_TRUE(sink->discard(4));
+    ASSERT_FALSE(sink->discard(4));
+    ASSERT_FALSE(sink->finish(4));
+    // blocks of an unknown product are dropped
+    sink->write(4, 0, sink->getBuffer(), FMTP_DATA_LEN);
+    delete sink;
+    EXPECT_FALSE(exists(4));
+    EXPECT_EQ(0, completed.count(4));
+}
+
+TEST_F(FileSinkTest, FewBuffers) {
+    // the writer thread recycles the buffers
+    FileSink* sink = newSink(true, 2);
+    sink->open(5, 3000000);
+    writeShuffled(*sink, 5, 3000000);
+    ASSERT_TRUE(sink->finish(5));
+    ASSERT_TRUE(waitFor(5));
+    checkFile(5, 3000000);
+    delete sink;
+}
+
+TEST_F(FileSinkTest, Performance) {
+    // 16 products of 16 MiB, in order, one write per block and then the sink
+    const uint32_t    nprods   = 16;
+    const uint32_t    prodsize = 16777216;
+    const double      gb       = (double)nprods * prodsize / 1e9;
+    std::vector<char> block(FMTP_DATA_LEN, 'x');
+
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nprods; i++) {
+        const std::string path = dir + "/p" + std::to_string(i);
+        const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        for (uint32_t off = 0; off < prodsize; off += FMTP_DATA_LEN)
+            ASSERT_LT(0, pwrite(fd, block.data(),
+                    std::min<uint32_t>(FMTP_DATA_LEN, prodsize - off), off));
+        ASSERT_EQ(0, fsync(fd));
+        close(fd);
+    }
+    double seconds = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    std::cerr << "pwrite() per block: " << std::to_string(gb / seconds) <<
+            " GB/s\n";
+
+    for (int ring = 0; ring < 2; ring++) {
+        FileSink* sink = newSink(ring);
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < nprods; i++) {
+            const uint32_t prodindex = 100 * (ring + 1) + i;
+            sink->open(prodindex, prodsize);
+            for (uint32_t off = 0; off < prodsize; off += FMTP_DATA_LEN) {
+                const uint16_t len = std::min<uint32_t>(FMTP_DATA_LEN,
+                        prodsize - off);
+                char* const buf = sink->getBuffer();
+                (void)memcpy(buf, block.data(), len);
+                sink->write(prodindex, off, buf, len);
+            }
+            ASSERT_TRUE(sink->finish(prodindex));
+        }
+        for (uint32_t i = 0; i < nprods; i++)
+            ASSERT_TRUE(waitFor(100 * (ring + 1) + i));
+        seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+                std::chrono::steady_clock::now() - start).count();
+        std::cerr << (sink->usesIoUring() ? "FileSink, io_uring:  " :
+                "FileSink, pwritev(): ") << std::to_string(gb / seconds) <<
+                " GB/s\n";
+        delete sink;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
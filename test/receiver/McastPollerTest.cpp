@@ -0,0 +1,184 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: McastPollerTest.cpp
+ *
+ * This file tests class `McastPoller`.
+ */
+
+#include "McastPoller.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class McastPoller.
+class McastPollerTest : public ::testing::Test {
+ protected:
+  McastPollerTest() {
+    recvSock = socket(AF_INET, SOCK_DGRAM, 0);
+    sendSock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+    if (bind(recvSock, (struct sockaddr*)&addr, sizeof(addr)))
+        throw std::runtime_error("Couldn't bind socket");
+    socklen_t len = sizeof(addr);
+    (void)getsockname(recvSock, (struct sockaddr*)&addr, &len);
+    if (connect(sendSock, (struct sockaddr*)&addr, sizeof(addr)))
+        throw std::runtime_error("Couldn't connect socket");
+  }
+
+  ~McastPollerTest() {
+    close(recvSock);
+    close(sendSock);
+  }
+
+  void send(const void* buf, const size_t len) {
+    ASSERT_EQ(len, ::send(sendSock, buf, len, 0));
+  }
+
+  // Measures the delay between sending and peeking at a packet while the
+  // receiver is idle
+  void latency(McastPoller& poller, std::vector<double>& usecs) {
+    const int nsamples = 2000;
+    std::thread sender([this, nsamples] {
+        for (int i = 0; i < nsamples; i++) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            const std::chrono::steady_clock::time_point now =
+                    std::chrono::steady_clock::now();
+            (void)::send(sendSock, &now, sizeof(now), 0);
+        }
+    });
+    for (int i = 0; i < nsamples; i++) {
+        std::chrono::steady_clock::time_point sent;
+        ASSERT_EQ(sizeof(sent), poller.peek(&sent, sizeof(sent)));
+        usecs.push_back(std::chrono::duration_cast<
+                std::chrono::duration<double, std::micro>>(
+                std::chrono::steady_clock::now() - sent).count());
+        (void)recv(recvSock, &sent, sizeof(sent), 0);
+    }
+    sender.join();
+    std::sort(usecs.begin(), usecs.end());
+  }
+
+  int recvSock;
+  int sendSock;
+};
+
+TEST_F(McastPollerTest, PeekLeavesPacket) {
+    for (int busy = 0; busy < 2; busy++) {
+        McastPoller poller(recvSock, busy * 50);
+        EXPECT_EQ(busy == 1, poller.isBusyPolling());
+        const char msg[] = "0123456789";
+        send(msg, sizeof(msg));
+        char head[4];
+        ASSERT_EQ(sizeof(head), poller.peek(head, sizeof(head)));
+        EXPECT_EQ(0, memcmp(head, msg, sizeof(head)));
+        char all[sizeof(msg)];
+        ASSERT_EQ(sizeof(msg), recv(recvSock, all, sizeof(all), 0));
+        EXPECT_STREQ(msg, all);
+    }
+}
+
+TEST_F(McastPollerTest, BusyWaitsForPacket) {
+    McastPoller poller(recvSock, 50);
+    std::thread sender([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        send("x", 1);
+    });
+    char c = 0;
+    ASSERT_EQ(1, poller.peek(&c, 1));
+    EXPECT_EQ('x', c);
+    sender.join();
+}
+
+TEST_F(McastPollerTest, BusyIsCancellable) {
+    McastPoller poller(recvSock, 50);
+    pthread_t   thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, [](void* arg) -> void* {
+        char c;
+        (void)static_cast<McastPoller*>(arg)->peek(&c, 1);
+        return arg;
+    }, &poller));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(0, pthread_cancel(thread));
+    void* result;
+    ASSERT_EQ(0, pthread_join(thread, &result));
+    EXPECT_EQ(PTHREAD_CANCELED, result);
+}
+
+TEST_F(McastPollerTest, CountsDrops) {
+    McastPoller poller(recvSock);
+    if (!poller.dropsCounted())
+        return;
+    const int size = 1;
+    ASSERT_EQ(0, setsockopt(recvSock, SOL_SOCKET, SO_RCVBUF, &size,
+            sizeof(size)));
+    char block[1400] = {};
+    for (int i = 0; i < 100; i++)
+        send(block, sizeof(block));
+    int queued = 0;
+    for (; recv(recvSock, block, sizeof(block), MSG_DONTWAIT) > 0; queued++)
+        ;
+    EXPECT_LT(0, queued);
+    // the counter arrives with the next packet
+    send(block, 1);
+    ASSERT_EQ(1, poller.peek(block, sizeof(block)));
+    EXPECT_EQ(100 - queued, poller.getDrops());
+}
+
+TEST_F(McastPollerTest, ArrivalTime) {
+    McastPoller poller(recvSock);
+    const double before = std::chrono::duration<double>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    char block[8] = {};
+    send(block, sizeof(block));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(sizeof(block), poller.peek(block, sizeof(block)));
+    const double after = std::chrono::duration<double>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    EXPECT_LE(before - 0.001, poller.getArrival());
+    EXPECT_GE(after, poller.getArrival());
+    // the time in the socket buffer doesn't count
+    if (poller.arrivalStamped()) {
+        EXPECT_LE(0.04, after - poller.getArrival());
+    }
+}
+
+TEST_F(McastPollerTest, Performance) {
+    // one packet every 50 us to an idle receiver, sleeping and busy polling
+    for (int busy = 0; busy < 2; busy++) {
+        McastPoller         poller(recvSock, busy * 50);
+        std::vector<double> usecs;
+        latency(poller, usecs);
+        std::cerr << (busy ? "Busy poll: " : "Sleeping:  ") << "median " <<
+                std::to_string(usecs[usecs.size() / 2]) << " us, 99% " <<
+                std::to_string(usecs[usecs.size() * 99 / 100]) << " us" <<
+                (poller.kernelBusyPolls() ? ", SO_BUSY_POLL\n" : "\n");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
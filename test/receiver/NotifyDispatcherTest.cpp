@@ -0,0 +1,183 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: NotifyDispatcherTest.cpp
+ *
+ * This file tests class `NotifyDispatcher` and its queue, `MpmcQueue`.
+ */
+
+#include "NotifyDispatcher.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class NotifyDispatcher.
+class NotifyDispatcherTest : public ::testing::Test {
+ protected:
+  NotifyDispatcherTest() : counts(100000, 0), missed(0), hold(false) {
+  }
+
+  NotifyDispatcher* newDispatcher(const unsigned nthreads) {
+    return new NotifyDispatcher([this](uint32_t prodindex, bool complete) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (hold)
+            cond.wait(lock);
+        counts[prodindex]++;
+        if (!complete)
+            missed++;
+    }, nthreads, 1024);
+  }
+
+  void setHold(const bool value) {
+    std::unique_lock<std::mutex> lock(mutex);
+    hold = value;
+    cond.notify_all();
+  }
+
+  std::vector<int>        counts;
+  int                     missed;
+  bool                    hold;
+  std::mutex              mutex;
+  std::condition_variable cond;
+};
+
+TEST_F(NotifyDispatcherTest, InvalidArguments) {
+    NotifyDispatcher::Callback callback = [](uint32_t, bool) {};
+    EXPECT_THROW(NotifyDispatcher(callback, 0), std::invalid_argument);
+    EXPECT_THROW(NotifyDispatcher(callback, 1, 1000), std::invalid_argument);
+}
+
+TEST_F(NotifyDispatcherTest, DeliversAll) {
+    NotifyDispatcher* disp = newDispatcher(3);
+    std::vector<std::thread> producers;
+    for (uint32_t t = 0; t < 4; t++) {
+        producers.push_back(std::thread([disp, t] {
+            for (uint32_t i = t; i < 100000; i += 4)
+                disp->push(i, i % 10 != 0);
+        }));
+    }
+    for (size_t t = 0; t < producers.size(); t++)
+        producers[t].join();
+    delete disp; // delivers the waiting notifications
+    for (uint32_t i = 0; i < 100000; i++)
+        ASSERT_EQ(1, counts[i]) << "product " << i;
+    EXPECT_EQ(10000, missed);
+}
+
+TEST_F(NotifyDispatcherTest, Stats) {
+    NotifyDispatcher* disp = newDispatcher(1);
+    setHold(true);
+    for (uint32_t i = 0; i < 10; i++)
+        disp->push(i, true);
+    // the only thread holds one notification
+    while (disp->getStats().depth != 9)
+        std::this_thread::yield();
+    EXPECT_LE(9, disp->getStats().maxDepth);
+    EXPECT_EQ(0, disp->getStats().delivered);
+    setHold(false);
+    while (disp->getStats().delivered != 10)
+        std::this_thread::yield();
+    EXPECT_EQ(0, disp->getStats().depth);
+    delete disp;
+}
+
+TEST_F(NotifyDispatcherTest, FullQueue) {
+    // pushing waits instead of dropping
+    NotifyDispatcher* disp = newDispatcher(2);
+    setHold(true);
+    std::thread producer([disp] {
+        for (uint32_t i = 0; i < 5000; i++)
+            disp->push(i, true);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(1024, disp->getStats().maxDepth);
+    setHold(false);
+    producer.join();
+    delete disp;
+    for (uint32_t i = 0; i < 5000; i++)
+        ASSERT_EQ(1, counts[i]);
+}
+
+TEST(MpmcQueueTest, MultipleConsumers) {
+    MpmcQueue<uint32_t>      queue(256);
+    std::vector<int>         counts(400000, 0);
+    std::vector<std::thread> threads;
+    std::mutex               mutex;
+    for (uint32_t t = 0; t < 4; t++) {
+        threads.push_back(std::thread([&queue, t] {
+            for (uint32_t i = t; i < 400000; i += 4)
+                while (!queue.tryPush(i))
+                    std::this_thread::yield();
+        }));
+        threads.push_back(std::thread([&queue, &counts, &mutex] {
+            std::vector<uint32_t> got;
+            uint32_t              item;
+            while (got.size() < 100000) {
+                if (queue.tryPop(item))
+                    got.push_back(item);
+                else
+                    std::this_thread::yield();
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            for (size_t i = 0; i < got.size(); i++)
+                counts[got[i]]++;
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    for (uint32_t i = 0; i < 400000; i++)
+        ASSERT_EQ(1, counts[i]);
+    uint32_t item;
+    EXPECT_FALSE(queue.tryPop(item));
+    EXPECT_EQ(0, queue.size());
+}
+
+// Stands in for an application that takes a while per notification
+static void slowApplication() {
+    std::chrono::steady_clock::time_point end =
+            std::chrono::steady_clock::now() + std::chrono::microseconds(20);
+    while (std::chrono::steady_clock::now() < end)
+        ;
+}
+
+TEST(NotifyDispatcherPerformance, Performance) {
+    // time the receiving thread spends on 20000 notifications
+    const uint32_t nprods = 20000;
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nprods; i++)
+        slowApplication();
+    const double inlineSecs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+
+    NotifyDispatcher disp([](uint32_t, bool) {slowApplication();}, 4, 32768);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nprods; i++)
+        disp.push(i, true);
+    const double queuedSecs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Inline:     " << std::to_string(inlineSecs * 1e6 / nprods) <<
+            " us per notification on the receiving thread\n";
+    std::cerr << "Dispatched: " << std::to_string(queuedSecs * 1e6 / nprods) <<
+            " us per notification on the receiving thread, max depth " <<
+            disp.getStats().maxDepth << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,177 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: ProdFilterTest.cpp
+ *
+ * This file tests class `ProdFilter`.
+ */
+
+#include "ProdFilter.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class ProdFilter.
+class ProdFilterTest : public ::testing::Test {
+ protected:
+  ProdFilterTest() {
+    recvSock = socket(AF_INET, SOCK_DGRAM, 0);
+    sendSock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(recvSock, (struct sockaddr*)&addr, sizeof(addr)))
+        throw std::runtime_error("Couldn't bind socket");
+    socklen_t len = sizeof(addr);
+    (void)getsockname(recvSock, (struct sockaddr*)&addr, &len);
+    if (connect(sendSock, (struct sockaddr*)&addr, sizeof(addr)))
+        throw std::runtime_error("Couldn't connect socket");
+  }
+
+  ~ProdFilterTest() {
+    close(recvSock);
+    close(sendSock);
+  }
+
+  void sendPacket(const uint32_t prodindex, const uint16_t flags,
+          const uint16_t payloadlen = 0) {
+    char       pkt[MAX_FMTP_PACKET_LEN] = {};
+    FmtpHeader header;
+    header.prodindex  = htonl(prodindex);
+    header.seqnum     = 0;
+    header.payloadlen = htons(payloadlen);
+    header.flags      = htons(flags);
+    (void)memcpy(pkt, &header, sizeof(header));
+    ASSERT_LT(0, send(sendSock, pkt, sizeof(header) + payloadlen, 0));
+  }
+
+  // Returns the product index and flags of the queued packets
+  std::vector<std::pair<uint32_t, uint16_t>> drain() {
+    std::vector<std::pair<uint32_t, uint16_t>> pkts;
+    FmtpHeader header;
+    while (recv(recvSock, &header, sizeof(header), MSG_DONTWAIT) > 0)
+        pkts.push_back(std::make_pair(ntohl(header.prodindex),
+                ntohs(header.flags)));
+    return pkts;
+  }
+
+  int recvSock;
+  int sendSock;
+};
+
+TEST_F(ProdFilterTest, InvalidCapacity) {
+    EXPECT_THROW(ProdFilter(recvSock, 0), std::invalid_argument);
+    EXPECT_THROW(ProdFilter(recvSock, ProdFilter::MAX_CAPACITY + 1),
+            std::invalid_argument);
+}
+
+TEST_F(ProdFilterTest, Program) {
+    std::vector<uint32_t> indexes;
+    indexes.push_back(7);
+    indexes.push_back(9);
+    std::vector<struct sock_filter> prog = ProdFilter::compile(indexes);
+    // flags, BOP test, index, 2 compares, accept, drop
+    ASSERT_EQ(7, prog.size());
+    EXPECT_EQ(FMTP_BOP, prog[1].k);
+    EXPECT_EQ(5, 1 + 1 + prog[1].jt);
+    EXPECT_EQ(7, prog[3].k);
+    EXPECT_EQ(6, 3 + 1 + prog[3].jt);
+    EXPECT_EQ(9, prog[4].k);
+    EXPECT_EQ(6, 4 + 1 + prog[4].jt);
+    EXPECT_EQ(0, prog[6].k);
+}
+
+TEST_F(ProdFilterTest, KernelDrops) {
+    ProdFilter filter(recvSock);
+    filter.reject(2);
+    if (!filter.inKernel()) {
+        std::cerr << "Socket filters aren't supported\n";
+        return;
+    }
+    EXPECT_TRUE(filter.isRejected(2));
+    EXPECT_FALSE(filter.isRejected(1));
+    for (uint32_t i = 1; i <= 3; i++) {
+        sendPacket(i, FMTP_BOP, 6);
+        sendPacket(i, FMTP_MEM_DATA, FMTP_DATA_LEN);
+        sendPacket(i, FMTP_EOP);
+    }
+    std::vector<std::pair<uint32_t, uint16_t>> pkts = drain();
+    ASSERT_EQ(7, pkts.size());
+    EXPECT_EQ(std::make_pair(2u, FMTP_BOP), pkts[3]);
+    EXPECT_EQ(std::make_pair(3u, FMTP_BOP), pkts[4]);
+}
+
+TEST_F(ProdFilterTest, ForgetsOldest) {
+    ProdFilter filter(recvSock, 2);
+    filter.reject(1);
+    filter.reject(2);
+    filter.reject(3);
+    EXPECT_FALSE(filter.isRejected(1));
+    EXPECT_TRUE(filter.isRejected(2));
+    EXPECT_TRUE(filter.isRejected(3));
+    EXPECT_EQ(3, filter.getRejected());
+    if (!filter.inKernel())
+        return;
+    sendPacket(1, FMTP_MEM_DATA, 10);
+    sendPacket(3, FMTP_MEM_DATA, 10);
+    std::vector<std::pair<uint32_t, uint16_t>> pkts = drain();
+    ASSERT_EQ(1, pkts.size());
+    EXPECT_EQ(1, pkts[0].first);
+}
+
+TEST_F(ProdFilterTest, Detach) {
+    {
+        ProdFilter filter(recvSock);
+        filter.reject(5);
+    }
+    sendPacket(5, FMTP_MEM_DATA, 10);
+    EXPECT_EQ(1, drain().size());
+}
+
+TEST_F(ProdFilterTest, Performance) {
+    // receiving 20000 data packets of which half belong to a rejected product
+    const int npkts = 20000;
+    for (int filtered = 0; filtered < 2; filtered++) {
+        ProdFilter filter(recvSock);
+        if (filtered)
+            filter.reject(2);
+        int received = 0;
+        std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+        for (int i = 0; i < npkts; i += 2) {
+            sendPacket(1, FMTP_MEM_DATA, FMTP_DATA_LEN);
+            sendPacket(2, FMTP_MEM_DATA, FMTP_DATA_LEN);
+            char pkt[MAX_FMTP_PACKET_LEN];
+            while (recv(recvSock, pkt, sizeof(pkt), MSG_DONTWAIT) > 0)
+                received++;
+        }
+        const double seconds = std::chrono::duration_cast<
+                std::chrono::duration<double>>(
+                std::chrono::steady_clock::now() - start).count();
+        std::cerr << (filtered ? "Filtered:   " : "Unfiltered: ") <<
+                received << " packets copied to user space, " <<
+                std::to_string(seconds * 1e9 / npkts) << " ns per packet\n";
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
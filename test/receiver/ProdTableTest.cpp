@@ -0,0 +1,344 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: ProdTableTest.cpp
+ *
+ * This file tests class `ProdTable`.
+ */
+
+#include "ProdTable.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class ProdTable.
+class ProdTableTest : public ::testing::Test {
+ protected:
+  ProdTableTest() : table(8) {
+  }
+
+  ProdRecord* add(const uint32_t prodindex, const uint64_t prodsize) {
+    std::unique_lock<std::mutex> lock;
+    bool                         added;
+    ProdRecord* rec = table.findOrAdd(prodindex, lock, added);
+    if (rec && added)
+        rec->init(prodsize, NULL);
+    return rec;
+  }
+
+  ProdTable table;
+};
+
+TEST_F(ProdTableTest, ConstructDestruct) {
+    ASSERT_EQ(0, table.size());
+}
+
+TEST_F(ProdTableTest, ZeroCapacity) {
+    EXPECT_THROW(ProdTable(0), std::invalid_argument);
+}
+
+TEST_F(ProdTableTest, AddFind) {
+    ASSERT_TRUE(add(1, 100) != NULL);
+    ASSERT_EQ(1, table.size());
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = table.find(1, lock);
+    ASSERT_TRUE(rec != NULL);
+    ASSERT_TRUE(lock.owns_lock());
+    ASSERT_EQ(100, rec->prodsize);
+    ASSERT_TRUE(rec->hasBOP);
+}
+
+TEST_F(ProdTableTest, FindMissing) {
+    std::unique_lock<std::mutex> lock;
+    ASSERT_TRUE(table.find(1, lock) == NULL);
+    ASSERT_FALSE(lock.owns_lock());
+}
+
+TEST_F(ProdTableTest, AddExisting) {
+    ProdRecord* first = add(1, 100);
+    std::unique_lock<std::mutex> lock;
+    bool                         added;
+    ASSERT_EQ(first, table.findOrAdd(1, lock, added));
+    ASSERT_FALSE(added);
+    ASSERT_EQ(1, table.size());
+}
+
+TEST_F(ProdTableTest, Collisions) {
+    // 1, 9 and 17 all hash to the same slot of an 8-slot table
+    ASSERT_TRUE(add(1, 1) != NULL);
+    ASSERT_TRUE(add(9, 9) != NULL);
+    ASSERT_TRUE(add(17, 17) != NULL);
+    {
+        std::unique_lock<std::mutex> lock;
+        ProdRecord* rec = table.find(9, lock);
+        ASSERT_TRUE(rec != NULL);
+        table.erase(rec);
+    }
+    std::unique_lock<std::mutex> lock;
+    ProdRecord* rec = table.find(17, lock);
+    ASSERT_TRUE(rec != NULL);
+    ASSERT_EQ(17, rec->prodsize);
+    ASSERT_EQ(2, table.size());
+}
+
+TEST_F(ProdTableTest, Full) {
+    for (uint32_t i = 0; i < 8; i++)
+        ASSERT_TRUE(add(i, 1) != NULL);
+    ASSERT_TRUE(add(8, 1) == NULL);
+    {
+        std::unique_lock<std::mutex> lock;
+        table.erase(table.find(3, lock));
+    }
+    ASSERT_TRUE(add(8, 1) != NULL);
+}
+
+TEST_F(ProdTableTest, PurgeTombstones) {
+    // 1, 9, 17 and 25 crowd the slots from 1 to 4
+    for (uint32_t i = 1; i < 32; i += 8)
+        ASSERT_TRUE(add(i, 1) != NULL);
+    ASSERT_EQ(3, table.probeLength());
+    for (uint32_t i = 1; i < 25; i += 8) {
+        std::unique_lock<std::mutex> lock;
+        table.erase(table.find(i, lock));
+    }
+    // the tombstones on the way to 25 are kept
+    ASSERT_TRUE(add(2, 1) != NULL);
+    ASSERT_EQ(3, table.probeLength());
+    const uint32_t rest[] = {25, 2};
+    for (uint32_t i = 0; i < 2; i++) {
+        std::unique_lock<std::mutex> lock;
+        ProdRecord* rec = table.find(rest[i], lock);
+        ASSERT_TRUE(rec != NULL);
+        table.erase(rec);
+    }
+
+    // with 25 gone, the crowded period is forgotten
+    ASSERT_TRUE(add(3, 1) != NULL);
+    ASSERT_EQ(0, table.probeLength());
+    std::unique_lock<std::mutex> lock;
+    ASSERT_TRUE(table.find(25, lock) == NULL);
+    ASSERT_TRUE(table.find(3, lock) != NULL);
+}
+
+TEST_F(ProdTableTest, Blocks) {
+    ProdRecord* rec = add(1, 2 * FMTP_DATA_LEN + 10);
+    ASSERT_EQ(3, rec->nblocks);
+    ASSERT_FALSE(rec->hasLastBlock());
+    ASSERT_EQ(-1, rec->claimBlock(1, FMTP_DATA_LEN));
+    ASSERT_EQ(-1, rec->claimBlock(2 * FMTP_DATA_LEN, FMTP_DATA_LEN));
+    ASSERT_EQ(1, rec->claimBlock(2 * FMTP_DATA_LEN, 10));
+    ASSERT_TRUE(rec->hasLastBlock());
+    ASSERT_EQ(0, rec->claimBlock(2 * FMTP_DATA_LEN, 10));
+    ASSERT_FALSE(rec->blockDone());
+    ASSERT_EQ(1, rec->claimBlock(0, FMTP_DATA_LEN));
+    ASSERT_FALSE(rec->blockDone());
+    ASSERT_FALSE(rec->isComplete());
+    ASSERT_FALSE(rec->hasBlock(FMTP_DATA_LEN));
+    ASSERT_EQ(1, rec->claimBlock(FMTP_DATA_LEN, FMTP_DATA_LEN));
+    ASSERT_FALSE(rec->isComplete());
+    ASSERT_TRUE(rec->blockDone());
+    ASSERT_TRUE(rec->isComplete());
+}
+
+TEST_F(ProdTableTest, Acquire) {
+    ProdRef ref;
+    ASSERT_TRUE(table.acquire(1, ref) == NULL);
+    {
+        // a record without BOP can't be referenced
+        std::unique_lock<std::mutex> lock;
+        bool                         added;
+        ASSERT_TRUE(table.findOrAdd(1, lock, added) != NULL);
+    }
+    ASSERT_TRUE(table.acquire(1, ref) == NULL);
+    {
+        std::unique_lock<std::mutex> lock;
+        table.find(1, lock)->init(100, NULL);
+    }
+    ProdRecord* rec = table.acquire(1, ref);
+    ASSERT_TRUE(rec != NULL);
+    ASSERT_EQ(1, rec->users);
+    ref.release();
+    ASSERT_EQ(0, rec->users);
+}
+
+TEST_F(ProdTableTest, EraseWaitsForReference) {
+    ProdRecord*       rec = add(1, 100);
+    ProdRef           ref;
+    std::atomic<bool> erased(false);
+    ASSERT_EQ(rec, table.acquire(1, ref));
+
+    std::thread eraser([this, &erased] {
+        std::unique_lock<std::mutex> lock;
+        table.erase(table.find(1, lock));
+        erased = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_FALSE(erased);
+    ProdRef other;
+    ASSERT_TRUE(table.acquire(1, other) == NULL);
+    ref.release();
+    eraser.join();
+    ASSERT_TRUE(erased);
+    ASSERT_EQ(0, table.size());
+}
+
+TEST_F(ProdTableTest, ConcurrentClaims) {
+    const uint32_t   nblocks = 10000;
+    ProdRecord*      rec = add(1, nblocks * FMTP_DATA_LEN);
+    std::atomic<int> claims(0);
+    std::atomic<int> lasts(0);
+    std::vector<std::thread> threads;
+
+    // every thread tries every block, like multicast plus retransmissions
+    for (int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([this, &claims, &lasts, nblocks, t] {
+            for (uint32_t i = 0; i < nblocks; i++) {
+                const uint32_t block = (t % 2) ? i : nblocks - 1 - i;
+                ProdRef        ref;
+                ProdRecord*    rec = table.acquire(1, ref);
+                if (rec && rec->claimBlock(block * FMTP_DATA_LEN,
+                                           FMTP_DATA_LEN) > 0) {
+                    claims++;
+                    if (rec->blockDone())
+                        lasts++;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    ASSERT_EQ(nblocks, claims);
+    ASSERT_EQ(1, lasts);
+    ASSERT_TRUE(rec->isComplete());
+}
+
+TEST_F(ProdTableTest, EmptyProduct) {
+    ProdRecord* rec = add(1, 0);
+    ASSERT_TRUE(rec->isComplete());
+    ASSERT_TRUE(rec->hasLastBlock());
+}
+
+TEST_F(ProdTableTest, WideProduct) {
+    // a product of 5 GB, whose last blocks are beyond 32-bit offsets
+    const uint64_t nblocks = 5000000000ULL / FMTP_DATA_LEN;
+    const uint64_t size    = nblocks * FMTP_DATA_LEN + 10;
+    ProdRecord*    rec     = add(1, size);
+    ASSERT_EQ(size, rec->prodsize);
+    ASSERT_FALSE(rec->hasLastBlock());
+    ASSERT_EQ(-1, rec->claimBlock(nblocks * FMTP_DATA_LEN, FMTP_DATA_LEN));
+    ASSERT_EQ(1, rec->claimBlock(nblocks * FMTP_DATA_LEN, 10));
+    ASSERT_TRUE(rec->hasLastBlock());
+    // the offset of the last block modulo 4 GB is another block
+    const uint64_t wrapped = (nblocks - (1ULL << 32) / FMTP_DATA_LEN) *
+            FMTP_DATA_LEN;
+    ASSERT_FALSE(rec->hasBlock(wrapped));
+    ASSERT_EQ(1, rec->claimBlock(wrapped, FMTP_DATA_LEN));
+    ASSERT_EQ(-1, rec->claimBlock(size, 10));
+}
+
+/*
+ * Per-packet path of the receiver before `ProdTable`: a tracker lookup for
+ * the product size, one for the product pointer, a block-map update and a
+ * tracker update, each under its own mutex.
+ */
+struct LegacyPath {
+    struct Tracker {
+        uint32_t prodsize;
+        void*    prodptr;
+        uint32_t seqnum;
+    };
+    std::unordered_map<uint32_t, Tracker>               trackermap;
+    std::mutex                                          trackermtx;
+    std::unordered_map<uint32_t, std::vector<bool> >    segmap;
+    std::mutex                                          segmtx;
+    std::mutex                                          antiracemtx;
+
+    void packet(const uint32_t prodindex, const uint32_t seqnum) {
+        {
+            std::unique_lock<std::mutex> lock(trackermtx);
+            (void)trackermap.at(prodindex).prodsize;
+        }
+        {
+            std::unique_lock<std::mutex> lock(trackermtx);
+            (void)trackermap.at(prodindex).prodptr;
+        }
+        {
+            std::unique_lock<std::mutex> lock(segmtx);
+            segmap.at(prodindex)[seqnum / FMTP_DATA_LEN] = true;
+        }
+        std::unique_lock<std::mutex> lock(antiracemtx);
+        std::unique_lock<std::mutex> lock2(trackermtx);
+        trackermap.at(prodindex).seqnum = seqnum;
+    }
+};
+
+TEST_F(ProdTableTest, Performance) {
+    const uint32_t nprods   = 1000;
+    const uint32_t nblocks  = 1000;
+    const uint32_t prodsize = nblocks * FMTP_DATA_LEN;
+    const double   npackets = (double)nprods * nblocks;
+    ProdTable      bigtable;
+    LegacyPath     legacy;
+
+    for (uint32_t i = 0; i < nprods; i++) {
+        LegacyPath::Tracker tracker = {prodsize, NULL, 0};
+        legacy.trackermap[i] = tracker;
+        legacy.segmap[i].resize(nblocks);
+    }
+
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nprods; i++)
+        for (uint32_t j = 0; j < nblocks; j++)
+            legacy.packet(i, j * FMTP_DATA_LEN);
+    double legacysecs = std::chrono::duration_cast
+            <std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nprods; i++) {
+        {
+            std::unique_lock<std::mutex> lock;
+            bool                         added;
+            bigtable.findOrAdd(i, lock, added)->init(prodsize, NULL);
+        }
+        for (uint32_t j = 0; j < nblocks; j++) {
+            ProdRef     ref;
+            ProdRecord* rec = bigtable.acquire(i, ref);
+            ASSERT_EQ(1, rec->claimBlock(j * FMTP_DATA_LEN, FMTP_DATA_LEN));
+            (void)rec->blockDone();
+            rec->seqnum.store(j * FMTP_DATA_LEN, std::memory_order_relaxed);
+        }
+        std::unique_lock<std::mutex> lock;
+        ProdRecord* rec = bigtable.find(i, lock);
+        ASSERT_TRUE(rec->isComplete());
+        bigtable.erase(rec);
+    }
+    double tablesecs = std::chrono::duration_cast
+            <std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << std::to_string(npackets/legacysecs) <<
+            " packets/s with the legacy maps\n";
+    std::cerr << std::to_string(npackets/tablesecs) <<
+            " packets/s with ProdTable\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,179 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: ProductBufferPoolTest.cpp
+ *
+ * This file tests class `ProductBufferPool`.
+ */
+
+#include "ProductBufferPool.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class ProductBufferPool.
+class ProductBufferPoolTest : public ::testing::Test {
+ protected:
+  // classes of 1000, 2000, 4000 and 5000 bytes
+  ProductBufferPoolTest() : pool(1000, 5000, 2) {
+  }
+
+  static long minorFaults() {
+    struct rusage usage;
+    (void)getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+  }
+
+  ProductBufferPool pool;
+};
+
+TEST_F(ProductBufferPoolTest, InvalidArguments) {
+    EXPECT_THROW(ProductBufferPool(0, 1, 1), std::invalid_argument);
+    EXPECT_THROW(ProductBufferPool(2, 1, 1), std::invalid_argument);
+    EXPECT_THROW(ProductBufferPool(1, 1, 0), std::invalid_argument);
+}
+
+TEST_F(ProductBufferPoolTest, SizeClasses) {
+    EXPECT_EQ(4, pool.getClassCount());
+    EXPECT_EQ(5000, pool.getMaxSize());
+    EXPECT_EQ(8, pool.available());
+    ProductBufferPool single(1448, 1448, 1);
+    EXPECT_EQ(1, single.getClassCount());
+}
+
+TEST_F(ProductBufferPoolTest, SmallestFit) {
+    char* small  = (char*)pool.tryGet(1);
+    char* small2 = (char*)pool.tryGet(1000);
+    char* mid    = (char*)pool.tryGet(1001);
+    ASSERT_TRUE(small && small2 && mid);
+    // buffers of a class are adjacent in its arena
+    EXPECT_EQ(1000, std::abs(small2 - small));
+    EXPECT_NE(small + 2000, mid);
+    (void)memset(mid, 1, 2000);
+    // the smallest class is used up, so the next one serves
+    char* spill = (char*)pool.tryGet(10);
+    EXPECT_EQ(2000, std::abs(spill - mid));
+    EXPECT_EQ(0, pool.getMisses());
+    pool.put(small);
+    pool.put(small2);
+    pool.put(mid);
+    pool.put(spill);
+    EXPECT_EQ(8, pool.available());
+}
+
+TEST_F(ProductBufferPoolTest, Exhausted) {
+    std::vector<void*> bufs;
+    void*              buf;
+    while ((buf = pool.tryGet(4500)) != NULL)
+        bufs.push_back(buf);
+    EXPECT_EQ(2, bufs.size());
+    EXPECT_EQ(1, pool.getMisses());
+    EXPECT_TRUE(pool.tryGet(5001) == NULL);
+    EXPECT_EQ(2, pool.getMisses());
+    for (size_t i = 0; i < bufs.size(); i++)
+        pool.put(bufs[i]);
+    EXPECT_EQ(8, pool.available());
+}
+
+TEST_F(ProductBufferPoolTest, Foreign) {
+    char  other[1000];
+    char* buf = (char*)pool.tryGet(3000);
+    EXPECT_TRUE(pool.owns(buf));
+    EXPECT_FALSE(pool.owns(other));
+    EXPECT_THROW(pool.put(other), std::invalid_argument);
+    EXPECT_THROW(pool.put(buf + 1), std::invalid_argument);
+    pool.put(buf);
+}
+
+TEST_F(ProductBufferPoolTest, Prefaulted) {
+    // neither taking nor filling a buffer faults a page in
+    ProductBufferPool big(1 << 20, 4 << 20, 4);
+    big.bind(-1);
+    const long faults = minorFaults();
+    for (int i = 0; i < 4; i++) {
+        char* buf = (char*)big.tryGet(4 << 20);
+        ASSERT_TRUE(buf != NULL);
+        (void)memset(buf, i, 4 << 20);
+    }
+    EXPECT_EQ(faults, minorFaults());
+}
+
+TEST_F(ProductBufferPoolTest, Concurrent) {
+    ProductBufferPool        many(64, 256, 16);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([&many, t] {
+            for (int i = 0; i < 100000; i++) {
+                char* buf = (char*)many.tryGet((i * 37 + t) % 257);
+                if (buf) {
+                    buf[0] = (char)t;
+                    many.put(buf);
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    EXPECT_EQ(48, many.available());
+}
+
+TEST_F(ProductBufferPoolTest, Performance) {
+    // 64 products of 4 MiB placed block by block into fresh memory and the pool
+    const int    nprods   = 64;
+    const size_t prodsize = 4 << 20;
+    const double gb       = (double)nprods * prodsize / 1e9;
+    char         block[FMTP_DATA_LEN];
+    (void)memset(block, 'x', sizeof(block));
+
+    long faults = minorFaults();
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    for (int i = 0; i < nprods; i++) {
+        char* buf = (char*)malloc(prodsize);
+        for (size_t off = 0; off + FMTP_DATA_LEN <= prodsize;
+                off += FMTP_DATA_LEN)
+            (void)memcpy(buf + off, block, FMTP_DATA_LEN);
+        free(buf);
+    }
+    double seconds = std::chrono::duration_cast<
+            std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    std::cerr << "malloc(): " << std::to_string(gb / seconds) << " GB/s, " <<
+            (minorFaults() - faults) / nprods << " page faults per product\n";
+
+    ProductBufferPool big(1 << 20, prodsize, 4);
+    faults = minorFaults();
+    start  = std::chrono::steady_clock::now();
+    for (int i = 0; i < nprods; i++) {
+        char* buf = (char*)big.tryGet(prodsize);
+        for (size_t off = 0; off + FMTP_DATA_LEN <= prodsize;
+                off += FMTP_DATA_LEN)
+            (void)memcpy(buf + off, block, FMTP_DATA_LEN);
+        big.put(buf);
+    }
+    seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Pool:     " << std::to_string(gb / seconds) << " GB/s, " <<
+            (minorFaults() - faults) / nprods << " page faults per product" <<
+            (big.usesHugePages() ? ", huge pages\n" : "\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
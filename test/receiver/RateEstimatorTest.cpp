@@ -0,0 +1,126 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: RateEstimatorTest.cpp
+ *
+ * This file tests class `RateEstimator`.
+ */
+
+#include "RateEstimator.h"
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Size of a multicast packet in bytes
+static const size_t PACKET = 1460;
+
+// The fixture for testing class RateEstimator.
+class RateEstimatorTest : public ::testing::Test {
+ protected:
+  RateEstimatorTest() : estimator(), time(1000), gen(42) {
+  }
+
+  // Adds `npackets` packets at `rate` bits/s with a jitter of up to a third
+  // of a packet time
+  void stream(const double rate, const unsigned npackets) {
+    const double spacing = 8.0 * PACKET / rate;
+    std::uniform_real_distribution<double> jitter(-spacing / 3, spacing / 3);
+    for (unsigned i = 0; i < npackets; i++) {
+        time += spacing;
+        estimator.add(time + jitter(gen), PACKET);
+    }
+  }
+
+  RateEstimator estimator;
+  double        time;
+  std::mt19937  gen;
+};
+
+TEST_F(RateEstimatorTest, InvalidArguments) {
+    EXPECT_THROW(RateEstimator(0), std::invalid_argument);
+    EXPECT_THROW(RateEstimator(1.5), std::invalid_argument);
+    EXPECT_THROW(RateEstimator(0.5, 0), std::invalid_argument);
+}
+
+TEST_F(RateEstimatorTest, NoEstimate) {
+    EXPECT_EQ(0, estimator.get());
+    // a sample needs more packets
+    stream(20e6, 16);
+    EXPECT_EQ(0, estimator.get());
+    estimator.hint(30000000);
+    EXPECT_EQ(30000000, estimator.get());
+}
+
+TEST_F(RateEstimatorTest, SteadyRate) {
+    stream(40e6, 2000);
+    EXPECT_NEAR(40e6, estimator.get(), 0.02 * 40e6);
+}
+
+TEST_F(RateEstimatorTest, IdleGapsIgnored) {
+    // products of 100 packets at 20 Mbps with a second between them
+    for (int i = 0; i < 20; i++) {
+        stream(20e6, 100);
+        time += 1;
+    }
+    EXPECT_NEAR(20e6, estimator.get(), 0.05 * 20e6);
+}
+
+TEST_F(RateEstimatorTest, FollowsChange) {
+    stream(20e6, 2000);
+    EXPECT_NEAR(20e6, estimator.get(), 0.05 * 20e6);
+    stream(80e6, 2000);
+    EXPECT_NEAR(80e6, estimator.get(), 0.05 * 80e6);
+    stream(10e6, 2000);
+    EXPECT_NEAR(10e6, estimator.get(), 0.05 * 10e6);
+}
+
+TEST_F(RateEstimatorTest, HintCapsEstimate) {
+    estimator.hint(50000000);
+    stream(20e6, 1000);
+    EXPECT_NEAR(20e6, estimator.get(), 0.05 * 20e6);
+    // packets which queued up arrive faster than they were sent
+    stream(1e9, 1000);
+    EXPECT_EQ(50000000, estimator.get());
+    estimator.hint(0);
+    EXPECT_LT(500e6, estimator.get());
+}
+
+TEST_F(RateEstimatorTest, ClockGoesBack) {
+    stream(20e6, 1000);
+    const uint64_t rate = estimator.get();
+    time -= 10;
+    estimator.add(time, PACKET);
+    EXPECT_EQ(rate, estimator.get());
+    stream(20e6, 1000);
+    EXPECT_NEAR(20e6, estimator.get(), 0.05 * 20e6);
+}
+
+TEST_F(RateEstimatorTest, Performance) {
+    const unsigned npackets = 10000000;
+    const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < npackets; i++)
+        estimator.add(i * 1e-5, PACKET);
+    const double secs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(std::chrono::steady_clock::now() -
+            start).count();
+    EXPECT_NEAR(8.0 * PACKET / 1e-5, estimator.get(), 0.01 * 8 * PACKET / 1e-5);
+    std::cerr << "RateEstimator: " << std::to_string(npackets/secs)
+            << " packets/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
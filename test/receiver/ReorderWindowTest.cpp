@@ -0,0 +1,198 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: ReorderWindowTest.cpp
+ *
+ * This file tests class `ReorderWindow`.
+ */
+
+#include "ReorderWindow.h"
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+typedef ReorderWindow::Clock Clock;
+
+// Request for a block held back by the window
+static INLReqMsg gap(const uint32_t prodindex, const uint32_t block) {
+    INLReqMsg req = {DELAYED_DATA, prodindex, block * FMTP_DATA_LEN,
+            FMTP_DATA_LEN};
+    return req;
+}
+
+// The fixture for testing class ReorderWindow.
+class ReorderWindowTest : public ::testing::Test {
+ protected:
+  ReorderWindowTest() : window(0.001), now(Clock::now()) {
+  }
+
+  ReorderWindow     window;
+  Clock::time_point now;
+};
+
+// Result of receiving a stream of blocks with a reorder window
+struct Outcome {
+  // requests for blocks which arrived on multicast after all
+  unsigned spurious;
+  // lost blocks which were never requested
+  unsigned unrequested;
+};
+
+/*
+ * Receives `nblocks` blocks of a product, one every 10 us, of which a fraction
+ * is lost and another arrives up to 50 us late. Gaps are detected the way
+ * fmtpRecvv3::requestAnyMissingData() does it and requested once their delay
+ * has passed unless the block arrived meanwhile.
+ */
+static Outcome receive(const double delay, const uint32_t nblocks) {
+    typedef std::pair<Clock::duration, uint32_t> Arrival;
+    std::mt19937              gen(1);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::vector<Arrival>      arrivals;
+    std::set<uint32_t>        lost;
+    const Clock::time_point   start;
+
+    for (uint32_t i = 0; i < nblocks; i++) {
+        if (unit(gen) < 0.01) {
+            lost.insert(i);
+            continue;
+        }
+        std::chrono::microseconds when(i * 10);
+        if (unit(gen) < 0.05)
+            when += std::chrono::microseconds(11 + gen() % 40);
+        arrivals.push_back(Arrival(when, i));
+    }
+    std::sort(arrivals.begin(), arrivals.end());
+
+    ReorderWindow      window(delay);
+    std::set<uint32_t> arrived;
+    std::set<uint32_t> requested;
+    Outcome            outcome = {0, 0};
+    uint32_t           next = 0; // block after the most recent one
+    INLReqMsg          reqs[64];
+    auto expire = [&](const Clock::time_point& time) {
+        size_t n;
+        while ((n = window.expire(time, reqs, 64)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                const uint32_t block = reqs[i].seqnum / FMTP_DATA_LEN;
+                EXPECT_EQ(MISSING_DATA, reqs[i].reqtype);
+                if (arrived.count(block))
+                    continue; // the gap closed within the window
+                requested.insert(block);
+                if (!lost.count(block))
+                    outcome.spurious++;
+            }
+        }
+    };
+    auto detect = [&](const uint32_t mostRecent,
+            const Clock::time_point& time) {
+        for (uint32_t b = next; b < mostRecent; b++)
+            if (!arrived.count(b))
+                (void)window.add(gap(1, b), time);
+        expire(time);
+    };
+
+    for (size_t i = 0; i < arrivals.size(); i++) {
+        const Clock::time_point time = start + arrivals[i].first;
+        const uint32_t          block = arrivals[i].second;
+        expire(time);
+        detect(block, time);
+        arrived.insert(block);
+        next = block + 1;
+    }
+    // the EOP
+    const Clock::time_point end = start + std::chrono::microseconds(
+            nblocks * 10 + 100);
+    detect(nblocks, end);
+    expire(end + std::chrono::seconds(1));
+
+    for (std::set<uint32_t>::iterator it = lost.begin(); it != lost.end();
+            ++it)
+        if (!requested.count(*it))
+            outcome.unrequested++;
+    return outcome;
+}
+
+TEST_F(ReorderWindowTest, InvalidDelay) {
+    EXPECT_THROW(ReorderWindow(-1), std::invalid_argument);
+}
+
+TEST_F(ReorderWindowTest, HeldBackForDelay) {
+    EXPECT_TRUE(window.empty());
+    EXPECT_TRUE(window.add(gap(1, 0), now));
+    EXPECT_TRUE(window.add(gap(1, 1), now + std::chrono::microseconds(500)));
+    EXPECT_EQ(now + std::chrono::milliseconds(1), window.nextDeadline());
+
+    INLReqMsg out[4];
+    EXPECT_EQ(0, window.expire(now + std::chrono::microseconds(999), out, 4));
+    ASSERT_EQ(1, window.expire(now + std::chrono::milliseconds(1), out, 4));
+    EXPECT_EQ(MISSING_DATA, out[0].reqtype);
+    EXPECT_EQ(1, out[0].prodindex);
+    EXPECT_EQ(0, out[0].seqnum);
+    EXPECT_EQ(FMTP_DATA_LEN, out[0].payloadlen);
+    ASSERT_EQ(1, window.expire(now + std::chrono::seconds(1), out, 4));
+    EXPECT_EQ(FMTP_DATA_LEN, out[0].seqnum);
+    EXPECT_TRUE(window.empty());
+}
+
+TEST_F(ReorderWindowTest, RepeatedGap) {
+    EXPECT_TRUE(window.add(gap(1, 3), now));
+    EXPECT_FALSE(window.add(gap(1, 3), now));
+    EXPECT_TRUE(window.add(gap(2, 3), now));
+    EXPECT_EQ(2, window.size());
+
+    INLReqMsg out[4];
+    ASSERT_EQ(1, window.expire(now + std::chrono::seconds(1), out, 1));
+    EXPECT_EQ(1, out[0].prodindex);
+    ASSERT_EQ(1, window.expire(now + std::chrono::seconds(1), out, 4));
+    EXPECT_EQ(2, out[0].prodindex);
+    // an expired gap can be held back again
+    EXPECT_TRUE(window.add(gap(1, 3), now));
+}
+
+TEST_F(ReorderWindowTest, ReorderInjection) {
+    const uint32_t nblocks   = 100000;
+    const Outcome  immediate = receive(0, nblocks);
+    const Outcome  delayed   = receive(0.0001, nblocks);
+
+    std::cerr << "Spurious requests without window: " << immediate.spurious
+            << ", with 100 us window: " << delayed.spurious << "\n";
+    EXPECT_GT(immediate.spurious, 0);
+    EXPECT_EQ(0, delayed.spurious);
+    EXPECT_EQ(0, immediate.unrequested);
+    EXPECT_EQ(0, delayed.unrequested);
+}
+
+TEST_F(ReorderWindowTest, Performance) {
+    const uint32_t          ngaps = 1000000;
+    INLReqMsg               out[256];
+    const Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < ngaps; i++) {
+        (void)window.add(gap(i / 100, i % 100), now);
+        if (i % 256 == 255)
+            (void)window.expire(now + std::chrono::seconds(1), out, 256);
+    }
+    const double secs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(Clock::now() - start).count();
+    std::cerr << "ReorderWindow: " << std::to_string(ngaps/secs)
+            << " gaps/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,254 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: RetxReqQueueTest.cpp
+ *
+ * This file tests class `RetxReqQueue`.
+ */
+
+#include "RetxReqQueue.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class RetxReqQueue.
+class RetxReqQueueTest : public ::testing::Test {
+ protected:
+  RetxReqQueueTest() : q(8) {
+  }
+
+  static INLReqMsg data(const uint32_t prodindex, const uint32_t block,
+          const uint16_t len = FMTP_DATA_LEN) {
+    INLReqMsg req = {MISSING_DATA, prodindex, block * FMTP_DATA_LEN, len};
+    return req;
+  }
+
+  static INLReqMsg req(const int type, const uint32_t prodindex) {
+    INLReqMsg req = {type, prodindex, 0, 0};
+    return req;
+  }
+
+  RetxReqQueue q;
+};
+
+TEST_F(RetxReqQueueTest, ConstructDestruct) {
+    ASSERT_EQ(0, q.size());
+}
+
+TEST_F(RetxReqQueueTest, InvalidCapacity) {
+    EXPECT_THROW(RetxReqQueue(0), std::invalid_argument);
+    EXPECT_THROW(RetxReqQueue(1), std::invalid_argument);
+    EXPECT_THROW(RetxReqQueue(100), std::invalid_argument);
+}
+
+TEST_F(RetxReqQueueTest, PushPop) {
+    INLReqMsg out[4];
+    q.push(data(1, 2));
+    ASSERT_EQ(1, q.size());
+    ASSERT_EQ(1, q.pop(out, 4));
+    EXPECT_EQ(MISSING_DATA, out[0].reqtype);
+    EXPECT_EQ(1, out[0].prodindex);
+    EXPECT_EQ(2 * FMTP_DATA_LEN, out[0].seqnum);
+    EXPECT_EQ(FMTP_DATA_LEN, out[0].payloadlen);
+    ASSERT_EQ(0, q.size());
+}
+
+TEST_F(RetxReqQueueTest, Batch) {
+    INLReqMsg out[3];
+    for (uint32_t i = 0; i < 5; i++)
+        q.push(req(MISSING_BOP, i));
+    ASSERT_EQ(3, q.pop(out, 3));
+    for (uint32_t i = 0; i < 3; i++)
+        EXPECT_EQ(i, out[i].prodindex);
+    ASSERT_EQ(2, q.pop(out, 3));
+    EXPECT_EQ(3, out[0].prodindex);
+    EXPECT_EQ(4, out[1].prodindex);
+}
+
+TEST_F(RetxReqQueueTest, Full) {
+    INLReqMsg out[8];
+    for (uint32_t i = 0; i < 8; i++)
+        ASSERT_TRUE(q.tryPush(req(MISSING_EOP, i)));
+    ASSERT_FALSE(q.tryPush(req(MISSING_EOP, 8)));
+    ASSERT_EQ(1, q.pop(out, 1));
+    ASSERT_TRUE(q.tryPush(req(MISSING_EOP, 8)));
+    ASSERT_EQ(8, q.pop(out, 8));
+    EXPECT_EQ(8, out[7].prodindex);
+}
+
+TEST_F(RetxReqQueueTest, PushWakesPop) {
+    INLReqMsg   out[1];
+    std::thread pusher([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        q.push(req(SHUTDOWN, 0));
+    });
+    ASSERT_EQ(1, q.pop(out, 1));
+    EXPECT_EQ(SHUTDOWN, out[0].reqtype);
+    pusher.join();
+}
+
+TEST_F(RetxReqQueueTest, MultipleProducers) {
+    const uint32_t           nthreads = 4;
+    const uint32_t           nreqs    = 100000;
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < nthreads; t++) {
+        threads.push_back(std::thread([this, t, nreqs] {
+            for (uint32_t i = 0; i < nreqs; i++)
+                q.push(data(t, i));
+        }));
+    }
+    // requests of one producer arrive in order
+    std::vector<uint32_t> next(nthreads, 0);
+    INLReqMsg             out[5];
+    for (uint32_t total = 0; total < nthreads * nreqs;) {
+        const size_t n = q.pop(out, 5);
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(next[out[i].prodindex] * FMTP_DATA_LEN, out[i].seqnum);
+            next[out[i].prodindex]++;
+        }
+        total += n;
+    }
+    for (uint32_t t = 0; t < nthreads; t++) {
+        threads[t].join();
+        EXPECT_EQ(nreqs, next[t]);
+    }
+}
+
+TEST_F(RetxReqQueueTest, PopDeadline) {
+    typedef std::chrono::steady_clock Clock;
+    INLReqMsg               out[1];
+    const Clock::time_point start = Clock::now();
+    EXPECT_EQ(0, q.pop(out, 1, start + std::chrono::milliseconds(20)));
+    EXPECT_GE(Clock::now() - start, std::chrono::milliseconds(20));
+
+    std::thread pusher([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        q.push(req(MISSING_EOP, 5));
+    });
+    ASSERT_EQ(1, q.pop(out, 1, Clock::now() + std::chrono::seconds(10)));
+    EXPECT_EQ(5, out[0].prodindex);
+    pusher.join();
+}
+
+TEST_F(RetxReqQueueTest, CoalesceAdjacent) {
+    INLReqMsg reqs[] = {data(1, 0), data(1, 1), data(1, 2), data(1, 4),
+                        data(2, 5)};
+    ASSERT_EQ(3, RetxReqQueue::coalesce(reqs, 5));
+    EXPECT_EQ(0, reqs[0].seqnum);
+    EXPECT_EQ(3 * FMTP_DATA_LEN, reqs[0].payloadlen);
+    EXPECT_EQ(4 * FMTP_DATA_LEN, reqs[1].seqnum);
+    EXPECT_EQ(FMTP_DATA_LEN, reqs[1].payloadlen);
+    EXPECT_EQ(2, reqs[2].prodindex);
+}
+
+TEST_F(RetxReqQueueTest, CoalesceLimit) {
+    INLReqMsg reqs[100];
+    for (uint32_t i = 0; i < 100; i++)
+        reqs[i] = data(1, i);
+    const size_t n      = RetxReqQueue::coalesce(reqs, 100);
+    uint32_t     seqnum = 0;
+    for (size_t i = 0; i < n; i++) {
+        ASSERT_EQ(seqnum, reqs[i].seqnum);
+        ASSERT_EQ(0, reqs[i].payloadlen % FMTP_DATA_LEN);
+        seqnum += reqs[i].payloadlen;
+    }
+    EXPECT_EQ(100 * FMTP_DATA_LEN, seqnum);
+    EXPECT_EQ(3, n);
+}
+
+TEST_F(RetxReqQueueTest, CoalesceDuplicates) {
+    INLReqMsg reqs[] = {req(MISSING_BOP, 1), req(MISSING_BOP, 1),
+                        req(MISSING_EOP, 1), data(1, 0), data(1, 1),
+                        data(1, 1), req(MISSING_EOP, 1)};
+    ASSERT_EQ(4, RetxReqQueue::coalesce(reqs, 7));
+    EXPECT_EQ(MISSING_BOP, reqs[0].reqtype);
+    EXPECT_EQ(MISSING_EOP, reqs[1].reqtype);
+    EXPECT_EQ(MISSING_DATA, reqs[2].reqtype);
+    EXPECT_EQ(2 * FMTP_DATA_LEN, reqs[2].payloadlen);
+    EXPECT_EQ(MISSING_EOP, reqs[3].reqtype);
+}
+
+TEST_F(RetxReqQueueTest, CoalesceShortBlock) {
+    // nothing is appended to a truncated last block
+    INLReqMsg reqs[] = {data(1, 0, 100), data(1, 1)};
+    reqs[1].seqnum = 100;
+    ASSERT_EQ(2, RetxReqQueue::coalesce(reqs, 2));
+}
+
+// The queue and condition variable that RetxReqQueue replaces
+class LockedQueue {
+ public:
+  void push(const INLReqMsg& reqmsg) {
+    std::unique_lock<std::mutex> lock(mutex);
+    queue.push(reqmsg);
+    cond.notify_one();
+  }
+  size_t pop(INLReqMsg* const reqmsgs, const size_t max) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (queue.empty())
+      cond.wait(lock);
+    size_t n = 0;
+    for (; n < max && !queue.empty(); n++) {
+      reqmsgs[n] = queue.front();
+      queue.pop();
+    }
+    return n;
+  }
+ private:
+  std::queue<INLReqMsg>   queue;
+  std::mutex              mutex;
+  std::condition_variable cond;
+};
+
+template<class Queue>
+static double transfer(Queue& queue, const uint32_t nthreads,
+        const uint32_t nreqs) {
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < nthreads; t++) {
+        threads.push_back(std::thread([&queue, t, nreqs] {
+            INLReqMsg req = {MISSING_DATA, t, 0, FMTP_DATA_LEN};
+            for (uint32_t i = 0; i < nreqs; i++, req.seqnum += FMTP_DATA_LEN)
+                queue.push(req);
+        }));
+    }
+    INLReqMsg out[256];
+    for (uint32_t total = 0; total < nthreads * nreqs;)
+        total += queue.pop(out, 256);
+    for (uint32_t t = 0; t < nthreads; t++)
+        threads[t].join();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(RetxReqQueuePerformance, Performance) {
+    const uint32_t nthreads = 3;
+    const uint32_t nreqs    = 1000000;
+    LockedQueue    locked;
+    RetxReqQueue   ring;
+    const double   lockedSecs = transfer(locked, nthreads, nreqs);
+    const double   ringSecs   = transfer(ring, nthreads, nreqs);
+    std::cerr << "Mutex queue:  " << std::to_string(nthreads*nreqs/lockedSecs)
+            << " requests/s\n";
+    std::cerr << "RetxReqQueue: " << std::to_string(nthreads*nreqs/ringSecs)
+            << " requests/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,201 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: RetxReqTableTest.cpp
+ *
+ * This file tests class `RetxReqTable`.
+ */
+
+#include "RetxReqTable.h"
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+typedef RetxReqTable::Clock Clock;
+
+// The fixture for testing class RetxReqTable.
+class RetxReqTableTest : public ::testing::Test {
+ protected:
+  RetxReqTableTest() : table(1, 4), now(Clock::now()) {
+  }
+
+  static INLReqMsg data(const uint32_t prodindex, const uint32_t block) {
+    INLReqMsg req = {MISSING_DATA, prodindex, block * FMTP_DATA_LEN,
+            FMTP_DATA_LEN};
+    return req;
+  }
+
+  static INLReqMsg req(const int type, const uint32_t prodindex) {
+    INLReqMsg req = {type, prodindex, 0, 0};
+    return req;
+  }
+
+  Clock::time_point at(const double seconds) const {
+    return now + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds));
+  }
+
+  RetxReqTable      table;
+  Clock::time_point now;
+};
+
+TEST_F(RetxReqTableTest, InvalidTimeout) {
+    EXPECT_THROW(RetxReqTable(0, 1), std::invalid_argument);
+    EXPECT_THROW(RetxReqTable(2, 1), std::invalid_argument);
+}
+
+TEST_F(RetxReqTableTest, Duplicate) {
+    EXPECT_TRUE(table.add(data(1, 0), now));
+    EXPECT_FALSE(table.add(data(1, 0), at(0.5)));
+    EXPECT_TRUE(table.add(data(1, 1), now));
+    // same seqnum, other type or product
+    EXPECT_TRUE(table.add(req(MISSING_BOP, 1), now));
+    EXPECT_TRUE(table.add(req(MISSING_EOP, 1), now));
+    EXPECT_TRUE(table.add(data(2, 0), now));
+    EXPECT_EQ(5, table.size());
+
+    // a stale request is still outstanding until it's retried or removed
+    INLReqMsg out[8];
+    EXPECT_EQ(5, table.expire(at(1), out, 8));
+    EXPECT_FALSE(table.add(data(1, 0), at(1)));
+    EXPECT_FALSE(table.hasDeadline());
+}
+
+TEST_F(RetxReqTableTest, Backoff) {
+    INLReqMsg out[2];
+    ASSERT_TRUE(table.add(data(1, 0), now));
+    EXPECT_EQ(at(1), table.nextDeadline());
+    EXPECT_EQ(0, table.expire(at(0.999), out, 2));
+
+    // timeouts of 1, 2 and 4 s, then the limit of 4 s
+    const double retries[] = {1, 3, 7, 11, 15};
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(1, table.expire(at(retries[i]), out, 2));
+        EXPECT_EQ(0, out[0].seqnum);
+        table.retry(out[0], at(retries[i]));
+        if (i < 4) {
+            EXPECT_EQ(at(retries[i + 1]), table.nextDeadline());
+        }
+    }
+    EXPECT_EQ(1, table.size());
+}
+
+TEST_F(RetxReqTableTest, RemoveForget) {
+    for (uint32_t b = 0; b < 3; b++) {
+        ASSERT_TRUE(table.add(data(1, b), now));
+        ASSERT_TRUE(table.add(data(2, b), at(0.1)));
+    }
+    table.remove(data(1, 1));
+    table.remove(data(1, 1));
+    EXPECT_EQ(5, table.size());
+    table.forget(2);
+    EXPECT_EQ(2, table.size());
+    EXPECT_TRUE(table.add(data(2, 0), now));
+
+    INLReqMsg out[8];
+    ASSERT_EQ(3, table.expire(at(10), out, 8));
+    EXPECT_EQ(1, out[0].prodindex);
+    EXPECT_EQ(0, out[0].seqnum);
+    EXPECT_EQ(1, out[1].prodindex);
+    EXPECT_EQ(2 * FMTP_DATA_LEN, out[1].seqnum);
+    EXPECT_EQ(2, out[2].prodindex);
+    for (int i = 0; i < 3; i++)
+        table.remove(out[i]);
+    EXPECT_EQ(0, table.size());
+}
+
+/*
+ * A receiver requests 1000 blocks, one every ms, and the sender answers a
+ * request after 10 ms. The requests of a 50 ms window are lost with the TCP
+ * connection. The receiver requests every block again when the EOP arrives.
+ */
+TEST_F(RetxReqTableTest, LostRequests) {
+    const uint32_t      nblocks = 1000;
+    std::set<uint32_t>  received;
+    std::vector<double> answers(nblocks, -1);
+    unsigned            sent = 0;
+    double              worst = 0;
+
+    auto send = [&](const INLReqMsg& reqmsg, const double time) {
+        const uint32_t block = reqmsg.seqnum / FMTP_DATA_LEN;
+        sent++;
+        if (time < 0.2 || time >= 0.25)
+            if (answers[block] < 0 || answers[block] > time + 0.01)
+                answers[block] = time + 0.01;
+    };
+    INLReqMsg out[64];
+    for (int ms = 0; ms < 60000; ms++) {
+        const double time = ms / 1000.0;
+        for (uint32_t b = 0; b < nblocks; b++) {
+            if (answers[b] >= 0 && answers[b] <= time && !received.count(b)) {
+                received.insert(b);
+                worst = std::max(worst, time - b / 1000.0);
+            }
+        }
+        if (ms < (int)nblocks && table.add(data(1, ms), at(time)))
+            send(data(1, ms), time);
+        if (ms == (int)nblocks) {
+            // the EOP
+            for (uint32_t b = 0; b < nblocks; b++)
+                if (!received.count(b) && table.add(data(1, b), at(time)))
+                    send(data(1, b), time);
+        }
+        size_t n;
+        while ((n = table.expire(at(time), out, 64)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                if (received.count(out[i].seqnum / FMTP_DATA_LEN)) {
+                    table.remove(out[i]);
+                }
+                else {
+                    table.retry(out[i], at(time));
+                    send(out[i], time);
+                }
+            }
+        }
+        if (received.size() == nblocks && table.size() == 0)
+            break;
+    }
+
+    std::cerr << "Requests sent: " << sent << ", longest recovery: "
+            << worst << " s\n";
+    EXPECT_EQ(nblocks, received.size());
+    EXPECT_EQ(0, table.size());
+    // 50 lost requests are each sent once more
+    EXPECT_EQ(nblocks + 50, sent);
+    EXPECT_LE(worst, 1.1);
+}
+
+TEST_F(RetxReqTableTest, Performance) {
+    const uint32_t nreqs = 1000000;
+    INLReqMsg      out[256];
+    const Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < nreqs; i++) {
+        (void)table.add(data(i / 1000, i % 1000), now);
+        if (i % 256 == 255) {
+            const size_t n = table.expire(at(10), out, 256);
+            for (size_t j = 0; j < n; j++)
+                table.remove(out[j]);
+        }
+    }
+    const double secs = std::chrono::duration_cast<
+            std::chrono::duration<double>>(Clock::now() - start).count();
+    std::cerr << "RetxReqTable: " << std::to_string(nreqs/secs)
+            << " requests/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: SignatureIndexTest.cpp
+ *
+ * This file tests class `SignatureIndex`.
+ */
+
+#include "SignatureIndex.h"
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class SignatureIndex.
+class SignatureIndexTest : public ::testing::Test {
+ protected:
+  SignatureIndexTest() : index(3) {
+  }
+
+  // An MD5-sized signature
+  struct Sig {
+    uint8_t bytes[16];
+    explicit Sig(const uint32_t n) {
+        for (int i = 0; i < 16; i++)
+            bytes[i] = (uint8_t)(n >> (i % 4 * 8));
+    }
+  };
+
+  SignatureIndex index;
+};
+
+TEST_F(SignatureIndexTest, InvalidCapacity) {
+    EXPECT_THROW(SignatureIndex(0), std::invalid_argument);
+}
+
+TEST_F(SignatureIndexTest, InsertContains) {
+    const Sig a(1), b(2);
+    EXPECT_FALSE(index.contains(a.bytes, sizeof(a.bytes)));
+    EXPECT_TRUE(index.insert(a.bytes, sizeof(a.bytes)));
+    EXPECT_FALSE(index.insert(a.bytes, sizeof(a.bytes)));
+    EXPECT_TRUE(index.contains(a.bytes, sizeof(a.bytes)));
+    EXPECT_FALSE(index.contains(b.bytes, sizeof(b.bytes)));
+    // a prefix is a different signature
+    EXPECT_FALSE(index.contains(a.bytes, 8));
+    EXPECT_EQ(1, index.size());
+}
+
+TEST_F(SignatureIndexTest, ForgetsOldest) {
+    for (uint32_t n = 1; n <= 4; n++) {
+        const Sig s(n);
+        EXPECT_TRUE(index.insert(s.bytes, sizeof(s.bytes)));
+    }
+    EXPECT_EQ(3, index.size());
+    const Sig first(1), last(4);
+    EXPECT_FALSE(index.contains(first.bytes, sizeof(first.bytes)));
+    EXPECT_TRUE(index.contains(last.bytes, sizeof(last.bytes)));
+}
+
+TEST_F(SignatureIndexTest, Concurrent) {
+    SignatureIndex           big(1000);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([&big] {
+            for (uint32_t n = 0; n < 2000; n++) {
+                const Sig s(n);
+                (void)big.insert(s.bytes, sizeof(s.bytes));
+                (void)big.contains(s.bytes, sizeof(s.bytes));
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    EXPECT_EQ(1000, big.size());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,224 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: TcpRecvTest.cpp
+ *
+ * This file tests the buffered reading of class `TcpRecv`.
+ */
+
+#include "TcpRecv.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Bytes the server of a test writes
+typedef std::vector<char> Stream;
+
+// The fixture for testing class TcpRecv.
+class TcpRecvTest : public ::testing::Test {
+ protected:
+  TcpRecvTest() : lsock(socket(AF_INET, SOCK_STREAM, 0)), port(0) {
+    struct sockaddr_in addr;
+    socklen_t          len = sizeof(addr);
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(lsock, (struct sockaddr*)&addr, sizeof(addr)) ||
+            listen(lsock, 1) ||
+            getsockname(lsock, (struct sockaddr*)&addr, &len))
+        throw std::runtime_error("Couldn't create listening socket");
+    port = ntohs(addr.sin_port);
+  }
+
+  ~TcpRecvTest() {
+    close(lsock);
+  }
+
+  // Appends a frame whose payload bytes depend on the frame number
+  static void addFrame(Stream& stream, const uint32_t n,
+          const uint16_t paylen) {
+    FmtpHeader header;
+    header.prodindex  = htonl(n);
+    header.seqnum     = htonl(n * 7);
+    header.payloadlen = htons(paylen);
+    header.flags      = htons(FMTP_RETX_DATA);
+    const char* ptr = (const char*)&header;
+    stream.insert(stream.end(), ptr, ptr + sizeof(header));
+    for (uint16_t i = 0; i < paylen; i++)
+        stream.push_back((char)(n + i));
+  }
+
+  // Accepts the connection and writes a stream, `times` times
+  std::thread serve(const Stream& stream, const int times = 1) {
+    return std::thread([this, &stream, times] {
+        const int sock = accept(lsock, NULL, NULL);
+        for (int i = 0; i < times; i++) {
+            size_t off = 0;
+            while (off < stream.size()) {
+                ssize_t n = write(sock, stream.data() + off,
+                        stream.size() - off);
+                if (n <= 0)
+                    break;
+                off += n;
+            }
+        }
+        close(sock);
+    });
+  }
+
+  // Reads a frame the way fmtpRecvv3::retxHandler() does
+  static bool readFrame(TcpRecv& recv, FmtpHeader& header, char* payload) {
+    if (recv.recvData(&header, sizeof(header), NULL, 0) == 0)
+        return false;
+    header.prodindex  = ntohl(header.prodindex);
+    header.seqnum     = ntohl(header.seqnum);
+    header.payloadlen = ntohs(header.payloadlen);
+    header.flags      = ntohs(header.flags);
+    return header.payloadlen == 0 ||
+            recv.recvData(NULL, 0, payload, header.payloadlen) > 0;
+  }
+
+  static void checkFrame(const FmtpHeader& header, const char* payload,
+          const uint32_t n, const uint16_t paylen) {
+    ASSERT_EQ(n, header.prodindex);
+    ASSERT_EQ(n * 7, header.seqnum);
+    ASSERT_EQ(paylen, header.payloadlen);
+    ASSERT_EQ(FMTP_RETX_DATA, header.flags);
+    for (uint16_t i = 0; i < paylen; i++)
+        ASSERT_EQ((char)(n + i), payload[i]);
+  }
+
+  int            lsock;
+  unsigned short port;
+};
+
+TEST_F(TcpRecvTest, Frames) {
+    Stream stream;
+    for (uint32_t n = 0; n < 1000; n++)
+        addFrame(stream, n, (n * 37) % (FMTP_DATA_LEN + 1));
+    std::thread server = serve(stream);
+    TcpRecv     recv("127.0.0.1", port);
+    recv.Init();
+    FmtpHeader  header;
+    char        payload[UINT16_MAX];
+    for (uint32_t n = 0; n < 1000; n++) {
+        ASSERT_TRUE(readFrame(recv, header, payload));
+        checkFrame(header, payload, n, (n * 37) % (FMTP_DATA_LEN + 1));
+    }
+    ASSERT_FALSE(readFrame(recv, header, payload));
+    server.join();
+    // many frames per recv() call
+    EXPECT_GT(1000u / 4, recv.getRecvCalls());
+}
+
+TEST_F(TcpRecvTest, LargePayloads) {
+    // payloads larger than a quarter of the buffer bypass it
+    Stream stream;
+    for (uint32_t n = 0; n < 50; n++)
+        addFrame(stream, n, n % 2 ? 60000 : 100);
+    std::thread server = serve(stream);
+    TcpRecv     recv("127.0.0.1", port);
+    recv.Init();
+    FmtpHeader  header;
+    char        payload[UINT16_MAX];
+    for (uint32_t n = 0; n < 50; n++) {
+        ASSERT_TRUE(readFrame(recv, header, payload));
+        checkFrame(header, payload, n, n % 2 ? 60000 : 100);
+    }
+    server.join();
+}
+
+TEST_F(TcpRecvTest, IncompleteFrame) {
+    Stream stream;
+    addFrame(stream, 1, 1000);
+    stream.resize(stream.size() - 1);
+    std::thread server = serve(stream);
+    TcpRecv     recv("127.0.0.1", port);
+    recv.Init();
+    FmtpHeader  header;
+    char        payload[UINT16_MAX];
+    ASSERT_FALSE(readFrame(recv, header, payload));
+    server.join();
+}
+
+// Reads like TcpBase::recvall(), one recv() per header and payload at least
+static size_t recvallCounted(const int sock, char* buf, size_t nbytes,
+        uint64_t& ncalls) {
+    size_t nleft = nbytes;
+    while (nleft > 0) {
+        ssize_t n = ::recv(sock, buf, nleft, 0);
+        ncalls++;
+        if (n <= 0)
+            break;
+        buf   += n;
+        nleft -= n;
+    }
+    return nbytes - nleft;
+}
+
+TEST_F(TcpRecvTest, Performance) {
+    // 256 MiB of full-size data blocks, read unbuffered and then buffered
+    const int   times = 256;
+    Stream      stream;
+    while (stream.size() < 1048576)
+        addFrame(stream, stream.size(), FMTP_DATA_LEN);
+    const double gb = (double)stream.size() * times / 1e9;
+    FmtpHeader   header;
+    char         payload[UINT16_MAX];
+
+    std::thread server = serve(stream, times);
+    int         sock   = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(port);
+    ASSERT_EQ(0, connect(sock, (struct sockaddr*)&addr, sizeof(addr)));
+    uint64_t ncalls = 0;
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    while (recvallCounted(sock, (char*)&header, sizeof(header), ncalls) ==
+            sizeof(header))
+        (void)recvallCounted(sock, payload, ntohs(header.payloadlen), ncalls);
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    close(sock);
+    server.join();
+    std::cerr << "Unbuffered: " << std::to_string(ncalls / gb) <<
+            " recv()/GB, " << std::to_string(gb / seconds) << " GB/s\n";
+
+    server = serve(stream, times);
+    TcpRecv recv("127.0.0.1", port);
+    recv.Init();
+    start = std::chrono::steady_clock::now();
+    while (readFrame(recv, header, payload))
+        ;
+    seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+    server.join();
+    std::cerr << "Buffered:   " << std::to_string(recv.getRecvCalls() / gb) <<
+            " recv()/GB, " << std::to_string(gb / seconds) << " GB/s\n";
+    EXPECT_GT(ncalls, recv.getRecvCalls());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: TimingWheelTest.cpp
+ *
+ * This file tests class `TimingWheel`.
+ */
+
+#include "TimingWheel.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// The fixture for testing class TimingWheel.
+class TimingWheelTest : public ::testing::Test {
+ protected:
+  TimingWheelTest() : w(0.001, 64) {
+  }
+
+  static double since(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now() - start).count();
+  }
+
+  TimingWheel w;
+};
+
+TEST_F(TimingWheelTest, ConstructDestruct) {
+    ASSERT_EQ(0, w.size());
+}
+
+TEST_F(TimingWheelTest, InvalidArguments) {
+    EXPECT_THROW(TimingWheel(0.0), std::invalid_argument);
+    EXPECT_THROW(TimingWheel(0.001, 0), std::invalid_argument);
+}
+
+TEST_F(TimingWheelTest, PushPop) {
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    w.push(1, 0.05);
+    ASSERT_EQ(1, w.size());
+    ASSERT_EQ(1, w.pop());
+    ASSERT_LE(0.05, since(start));
+    ASSERT_EQ(0, w.size());
+}
+
+TEST_F(TimingWheelTest, Order) {
+    w.push(1, 0.03);
+    w.push(2, -0.5);
+    w.push(3, 0.01);
+    ASSERT_EQ(2, w.pop());
+    ASSERT_EQ(3, w.pop());
+    ASSERT_EQ(1, w.pop());
+}
+
+TEST_F(TimingWheelTest, MoreThanOneTurn) {
+    // 64 slots of 1 ms: 0.1 s is more than one turn away
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    w.push(1, 0.1);
+    w.push(2, 0.02);
+    ASSERT_EQ(2, w.pop());
+    ASSERT_EQ(1, w.pop());
+    ASSERT_LE(0.1, since(start));
+}
+
+TEST_F(TimingWheelTest, Cancel) {
+    w.push(1, 0.01);
+    w.push(2, 0.02);
+    ASSERT_TRUE(w.cancel(1));
+    ASSERT_FALSE(w.cancel(1));
+    ASSERT_EQ(1, w.size());
+    ASSERT_EQ(2, w.pop());
+}
+
+TEST_F(TimingWheelTest, CancelExpired) {
+    w.push(1, -1.0);
+    ASSERT_TRUE(w.cancel(1));
+    ASSERT_EQ(0, w.size());
+}
+
+TEST_F(TimingWheelTest, Replace) {
+    w.push(1, 10.0);
+    w.push(1, 0.01);
+    ASSERT_EQ(1, w.size());
+    ASSERT_EQ(1, w.pop());
+}
+
+TEST_F(TimingWheelTest, PushWakesPop) {
+    std::thread pusher([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        w.push(7, 0.0);
+    });
+    ASSERT_EQ(7, w.pop());
+    pusher.join();
+}
+
+TEST_F(TimingWheelTest, DisablingCausesPushException) {
+    w.disable();
+    ASSERT_THROW(w.push(1, 0.5), std::runtime_error);
+}
+
+TEST_F(TimingWheelTest, DisablingCausesPopException) {
+    std::thread disabler([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        w.disable();
+    });
+    EXPECT_THROW((void)w.pop(), std::runtime_error);
+    disabler.join();
+}
+
+TEST_F(TimingWheelTest, Performance) {
+    TimingWheel                            wheel;
+    std::default_random_engine             generator;
+    std::uniform_real_distribution<double> distribution(1.0, 100.0);
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    for (int i = 0; i < 100000; i++)
+        wheel.push(i, distribution(generator));
+    for (int i = 0; i < 100000; i++)
+        ASSERT_TRUE(wheel.cancel(i));
+    double seconds = since(start);
+    ASSERT_EQ(0, wheel.size());
+    std::cerr << "100,000 push()/cancel()s in " << std::to_string(seconds) <<
+            " seconds\n";
+    std::cerr << std::to_string(100000/seconds) << " s-1\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,581 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: fmtpRecvv3Test.cpp
+ *
+ * This file tests the protocol handling of class `fmtpRecvv3`. The test plays
+ * the sender: it multicasts hand-made packets on the loopback interface and
+ * reads the requests of the receiver on the retransmission connection.
+ */
+
+#include "fmtpRecvv3.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char MCAST_ADDR[] = "239.1.2.5";
+
+typedef std::chrono::steady_clock Clock;
+
+// Records the notifications of the receiver
+class Proxy : public RecvProxy {
+ public:
+  Proxy() : buffer(NULL) {}
+
+  void notify_of_bop(const uint32_t iProd, size_t prodSize, void*, unsigned,
+          void** data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bops[iProd] = prodSize;
+    *data = buffer;
+    cond.notify_all();
+  }
+
+  void notify_of_eop(uint32_t iProd) {
+    std::lock_guard<std::mutex> lock(mutex);
+    eops.insert(iProd);
+    cond.notify_all();
+  }
+
+  void notify_of_missed_prod(uint32_t iProd) {
+    std::lock_guard<std::mutex> lock(mutex);
+    missed.insert(iProd);
+    cond.notify_all();
+  }
+
+  // Waits until `pred` holds or `seconds` have passed
+  bool waitFor(const std::function<bool()>& pred, const double seconds) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cond.wait_for(lock, std::chrono::duration<double>(seconds), pred);
+  }
+
+  std::mutex                 mutex;
+  std::condition_variable    cond;
+  std::map<uint32_t, size_t> bops;
+  std::set<uint32_t>         eops;
+  std::set<uint32_t>         missed;
+  // where products are written, NULL to discard their data
+  char*                      buffer;
+};
+
+// The fixture for testing class fmtpRecvv3.
+class fmtpRecvv3Test : public ::testing::Test {
+ protected:
+  fmtpRecvv3Test() : lsock(socket(AF_INET, SOCK_STREAM, 0)),
+          msock(socket(AF_INET, SOCK_DGRAM, 0)), csock(-1), receiver(NULL) {
+    struct sockaddr_in addr;
+    socklen_t          len = sizeof(addr);
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(lsock, (struct sockaddr*)&addr, sizeof(addr)) ||
+            listen(lsock, 1) ||
+            getsockname(lsock, (struct sockaddr*)&addr, &len))
+        throw std::runtime_error("Couldn't create listening socket");
+    const unsigned short tcpPort = ntohs(addr.sin_port);
+
+    // a free port for the multicast group
+    const int tmp = socket(AF_INET, SOCK_DGRAM, 0);
+    addr.sin_port = 0;
+    if (bind(tmp, (struct sockaddr*)&addr, sizeof(addr)) ||
+            getsockname(tmp, (struct sockaddr*)&addr, &len))
+        throw std::runtime_error("Couldn't get a port");
+    const unsigned short mcastPort = ntohs(addr.sin_port);
+    close(tmp);
+
+    struct in_addr ifaddr;
+    ifaddr.s_addr = htonl(INADDR_LOOPBACK);
+    const unsigned char loop = 1;
+    addr.sin_addr.s_addr = inet_addr(MCAST_ADDR);
+    if (setsockopt(msock, IPPROTO_IP, IP_MULTICAST_IF, &ifaddr,
+            sizeof(ifaddr)) ||
+            setsockopt(msock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop,
+            sizeof(loop)) ||
+            connect(msock, (struct sockaddr*)&addr, sizeof(addr)))
+        throw std::runtime_error("Couldn't create multicast socket");
+
+    receiver = new fmtpRecvv3("127.0.0.1", tcpPort, MCAST_ADDR, mcastPort,
+            &proxy, "127.0.0.1");
+  }
+
+  ~fmtpRecvv3Test() {
+    if (thread.joinable()) {
+        receiver->Stop();
+        thread.join();
+    }
+    delete receiver;
+    close(csock);
+    close(msock);
+    close(lsock);
+  }
+
+  // Starts the receiver and accepts its retransmission connection
+  void start() {
+    thread = std::thread([this] {
+        try {
+            receiver->Start();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(proxy.mutex);
+            error = std::current_exception();
+            proxy.cond.notify_all();
+        }
+    });
+    csock = accept(lsock, NULL, NULL);
+    ASSERT_LE(0, csock);
+    // the receiver joins the group after it has connected
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+
+  // Waits for the receiver to fail
+  bool failed(const double seconds) {
+    return proxy.waitFor([this] {return error != nullptr;}, seconds);
+  }
+
+  static std::vector<char> packet(const uint32_t prodindex,
+          const uint32_t seqnum, const uint16_t flags,
+          const std::vector<char>& payload = std::vector<char>()) {
+    FmtpHeader header;
+    header.prodindex  = htonl(prodindex);
+    header.seqnum     = htonl(seqnum);
+    header.payloadlen = htons(payload.size());
+    header.flags      = htons(flags);
+    std::vector<char> pkt((char*)&header, (char*)&header + sizeof(header));
+    pkt.insert(pkt.end(), payload.begin(), payload.end());
+    return pkt;
+  }
+
+  // Returns the payload of a BOP without metadata
+  static std::vector<char> bopPayload(const uint64_t prodsize,
+          const bool wide = false) {
+    std::vector<char> payload;
+    if (wide) {
+        const uint32_t high = htonl(prodsize >> 32);
+        payload.insert(payload.end(), (char*)&high, (char*)&high + 4);
+    }
+    const uint32_t low      = htonl((uint32_t)prodsize);
+    const uint16_t metasize = 0;
+    payload.insert(payload.end(), (char*)&low, (char*)&low + 4);
+    payload.insert(payload.end(), (char*)&metasize, (char*)&metasize + 2);
+    return payload;
+  }
+
+  // Returns the data of a block, whose bytes depend on its offset
+  static std::vector<char> block(const uint64_t offset, const uint16_t len) {
+    std::vector<char> data(len);
+    for (uint16_t i = 0; i < len; i++)
+        data[i] = (char)((offset + i) * 7 + (offset >> 20));
+    return data;
+  }
+
+  // Returns a tiny packet, whose data depend on the product index
+  static std::vector<char> tiny(const uint32_t prodindex,
+          const uint16_t prodsize) {
+    std::vector<char>       payload = bopPayload(prodsize);
+    const std::vector<char> data = block(prodindex, prodsize);
+    payload.insert(payload.end(), data.begin(), data.end());
+    return packet(prodindex, 0, FMTP_TINY, payload);
+  }
+
+  // Returns the packets of a whole product as an aggregate carries them
+  static std::vector<char> packed(const uint32_t prodindex,
+          const uint16_t prodsize) {
+    std::vector<char>       pkts = packet(prodindex, 0, FMTP_BOP,
+            bopPayload(prodsize));
+    const std::vector<char> eop = packet(prodindex, 0, FMTP_EOP);
+    if (prodsize) {
+        const std::vector<char> data = packet(prodindex, 0, FMTP_MEM_DATA,
+                block(0, prodsize));
+        pkts.insert(pkts.end(), data.begin(), data.end());
+    }
+    pkts.insert(pkts.end(), eop.begin(), eop.end());
+    return pkts;
+  }
+
+  void multicast(const std::vector<char>& pkt) {
+    ASSERT_EQ(pkt.size(), send(msock, pkt.data(), pkt.size(), 0));
+  }
+
+  void unicast(const std::vector<char>& pkt) {
+    ASSERT_EQ(pkt.size(), send(csock, pkt.data(), pkt.size(), 0));
+  }
+
+  // Reads the next request of the receiver, false if none comes in time
+  bool nextRequest(FmtpHeader& header, std::vector<char>& payload,
+          const double seconds = 2) {
+    struct pollfd pfd = {csock, POLLIN, 0};
+    if (poll(&pfd, 1, seconds * 1000) != 1)
+        return false;
+    if (!readAll(&header, sizeof(header)))
+        return false;
+    header.prodindex  = ntohl(header.prodindex);
+    header.seqnum     = ntohl(header.seqnum);
+    header.payloadlen = ntohs(header.payloadlen);
+    header.flags      = ntohs(header.flags);
+    // only a batch of acknowledgements carries a payload
+    payload.resize(header.flags == FMTP_RETX_END_BATCH ?
+            header.payloadlen : 0);
+    return payload.empty() || readAll(payload.data(), payload.size());
+  }
+
+  bool readAll(void* buf, const size_t nbytes) {
+    size_t nread = 0;
+    while (nread < nbytes) {
+        const ssize_t n = recv(csock, (char*)buf + nread, nbytes - nread,
+                0);
+        if (n <= 0)
+            return false;
+        nread += n;
+    }
+    return true;
+  }
+
+  int                lsock;
+  int                msock;
+  int                csock;
+  Proxy              proxy;
+  fmtpRecvv3*        receiver;
+  std::thread        thread;
+  std::exception_ptr error;
+};
+
+TEST_F(fmtpRecvv3Test, InferredEOP) {
+    // about 100 MB, whose EOP timer takes about 100 s
+    const uint32_t prodsize = 69000 * FMTP_DATA_LEN;
+    start();
+    multicast(packet(1, 0, FMTP_BOP, bopPayload(prodsize)));
+    multicast(packet(1, 0, FMTP_MEM_DATA, block(0, FMTP_DATA_LEN)));
+
+    // the rest of product 1 and its EOP are lost
+    FmtpHeader        header;
+    std::vector<char> payload;
+    while (nextRequest(header, payload, 0.3))
+        ASSERT_NE(FMTP_EOP_REQ, header.flags);
+    EXPECT_EQ(0, receiver->getLossStats().eopsInferred);
+
+    // the BOP of product 2 ends the multicast of product 1
+    multicast(packet(2, 0, FMTP_BOP, bopPayload(10)));
+    bool     eopReq = false;
+    uint64_t end    = FMTP_DATA_LEN;
+    while ((!eopReq || end < prodsize) && nextRequest(header, payload)) {
+        ASSERT_EQ(1, header.prodindex);
+        if (header.flags == FMTP_EOP_REQ) {
+            eopReq = true;
+        }
+        else {
+            ASSERT_EQ(FMTP_RETX_REQ, header.flags);
+            ASSERT_EQ(end, header.seqnum);
+            end += header.payloadlen;
+        }
+    }
+    EXPECT_TRUE(eopReq);
+    EXPECT_EQ(prodsize, end);
+    EXPECT_EQ(1, receiver->getLossStats().eopsInferred);
+}
+
+// Tests that a packet of an older product doesn't open a gap of missed BOPs
+TEST_F(fmtpRecvv3Test, OlderProduct) {
+    start();
+    for (uint32_t prodindex = 10; prodindex <= 11; prodindex++) {
+        multicast(packet(prodindex, 0, FMTP_BOP, bopPayload(FMTP_DATA_LEN)));
+        multicast(packet(prodindex, 0, FMTP_MEM_DATA,
+                block(0, FMTP_DATA_LEN)));
+        multicast(packet(prodindex, 0, FMTP_EOP));
+        ASSERT_TRUE(proxy.waitFor([this, prodindex] {
+                return proxy.eops.count(prodindex) > 0;}, 2));
+        // e.g. a late duplicate of an earlier product
+        if (prodindex == 10)
+            multicast(packet(5, 0, FMTP_BOP, bopPayload(10)));
+    }
+
+    FmtpHeader        header;
+    std::vector<char> payload;
+    while (nextRequest(header, payload, 0.5)) {
+        EXPECT_NE(FMTP_BOP_REQ, header.flags);
+        EXPECT_NE(FMTP_BOP_RANGE_REQ, header.flags);
+    }
+    EXPECT_EQ(0, receiver->getLossStats().bopsLost);
+}
+
+/*
+ * Tests that the requests on the retransmission connection stay intact while
+ * products complete on the multicast thread and on the retransmission thread
+ * at once, each sending its acknowledgement, and the request thread sends
+ * data requests.
+ */
+TEST_F(fmtpRecvv3Test, ConcurrentRequests) {
+    const uint32_t nprods   = 400;
+    const uint32_t prodsize = 2 * FMTP_DATA_LEN;
+    receiver->SetAckBatch(1, 1);
+    start();
+
+    // every other product misses its second block
+    std::thread mcaster([this, nprods, prodsize] {
+        for (uint32_t i = 0; i < nprods; i++) {
+            multicast(packet(i, 0, FMTP_BOP, bopPayload(prodsize)));
+            multicast(packet(i, 0, FMTP_MEM_DATA, block(0, FMTP_DATA_LEN)));
+            if (i % 2 == 0)
+                multicast(packet(i, FMTP_DATA_LEN, FMTP_MEM_DATA,
+                        block(FMTP_DATA_LEN, FMTP_DATA_LEN)));
+            multicast(packet(i, 0, FMTP_EOP));
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    });
+
+    // the multicast thread is joined even if a check fails
+    std::set<uint32_t> acked;
+    const auto         serve = [this, nprods, &acked] {
+        FmtpHeader        header;
+        std::vector<char> payload;
+        while (acked.size() < nprods && nextRequest(header, payload)) {
+            ASSERT_GT(nprods, header.prodindex);
+            if (header.flags == FMTP_RETX_REQ) {
+                ASSERT_EQ(1, header.prodindex % 2);
+                ASSERT_EQ(FMTP_DATA_LEN, header.seqnum);
+                ASSERT_EQ(FMTP_DATA_LEN, header.payloadlen);
+                unicast(packet(header.prodindex, header.seqnum, FMTP_RETX_DATA,
+                        block(header.seqnum, header.payloadlen)));
+            }
+            else {
+                ASSERT_EQ(FMTP_RETX_END_BATCH, header.flags);
+                ASSERT_LT(0, header.seqnum);
+                ASSERT_EQ(2 * sizeof(uint32_t) * header.seqnum,
+                        header.payloadlen);
+                const uint32_t* ranges = (const uint32_t*)payload.data();
+                ASSERT_EQ(header.prodindex, ntohl(ranges[0]));
+                for (uint32_t i = 0; i < header.seqnum; i++) {
+                    const uint32_t first = ntohl(ranges[2 * i]);
+                    const uint32_t count = ntohl(ranges[2 * i + 1]);
+                    ASSERT_GE(nprods, first + count);
+                    for (uint32_t j = 0; j < count; j++)
+                        ASSERT_TRUE(acked.insert(first + j).second);
+                }
+            }
+        }
+    };
+    serve();
+    mcaster.join();
+    EXPECT_EQ(nprods, acked.size());
+}
+
+// Tests that the products of an aggregate are handled in order
+TEST_F(fmtpRecvv3Test, Aggregate) {
+    std::vector<char> buf(1000);
+    proxy.buffer = buf.data();
+    start();
+    std::vector<char> pkts = packed(0, 1000);
+    const std::vector<char> empty = packed(1, 0);
+    pkts.insert(pkts.end(), empty.begin(), empty.end());
+    multicast(packet(0, 5, FMTP_AGGREGATE, pkts));
+    pkts = packed(2, 300);
+    multicast(packet(2, 3, FMTP_AGGREGATE, pkts));
+
+    ASSERT_TRUE(proxy.waitFor([this] {return proxy.eops.size() == 3;}, 2));
+    EXPECT_EQ(1000, proxy.bops[0]);
+    EXPECT_EQ(0, proxy.bops[1]);
+    EXPECT_EQ(300, proxy.bops[2]);
+    EXPECT_TRUE(proxy.missed.empty());
+    const std::vector<char> data = block(0, 1000);
+    EXPECT_EQ(0, memcmp(data.data(), buf.data(), 300));
+
+    FmtpHeader        header;
+    std::vector<char> payload;
+    while (nextRequest(header, payload, 0.3))
+        EXPECT_NE(FMTP_BOP_RANGE_REQ, header.flags);
+}
+
+// Tests that an aggregate with more packets than its payload is rejected
+TEST_F(fmtpRecvv3Test, AggregateCountTooLarge) {
+    start();
+    multicast(packet(0, 4, FMTP_AGGREGATE, packed(0, 100)));
+    EXPECT_TRUE(failed(2));
+    EXPECT_TRUE(proxy.bops.empty());
+}
+
+// Tests that an aggregate with fewer packets than its payload is rejected
+TEST_F(fmtpRecvv3Test, AggregateCountTooSmall) {
+    start();
+    multicast(packet(0, 2, FMTP_AGGREGATE, packed(0, 100)));
+    EXPECT_TRUE(failed(2));
+    EXPECT_TRUE(proxy.bops.empty());
+}
+
+// Tests that an aggregate whose packet is longer than the payload is rejected
+TEST_F(fmtpRecvv3Test, AggregateBadLength) {
+    start();
+    std::vector<char> pkts = packed(0, 100);
+    pkts.resize(pkts.size() - FMTP_HEADER_LEN - 1);
+    multicast(packet(0, 2, FMTP_AGGREGATE, pkts));
+    EXPECT_TRUE(failed(2));
+    EXPECT_TRUE(proxy.bops.empty());
+}
+
+// Tests that a tiny product is complete with its only packet
+TEST_F(fmtpRecvv3Test, Tiny) {
+    std::vector<char> buf(1000);
+    proxy.buffer = buf.data();
+    start();
+    multicast(tiny(7, 1000));
+    ASSERT_TRUE(proxy.waitFor([this] {return proxy.eops.count(7) > 0;}, 2));
+    EXPECT_EQ(1000, proxy.bops[7]);
+    const std::vector<char> data = block(7, 1000);
+    EXPECT_EQ(0, memcmp(data.data(), buf.data(), data.size()));
+
+    // the product is acknowledged and nothing is requested
+    FmtpHeader        header;
+    std::vector<char> payload;
+    ASSERT_TRUE(nextRequest(header, payload));
+    EXPECT_EQ(FMTP_RETX_END, header.flags);
+    EXPECT_EQ(7, header.prodindex);
+    EXPECT_FALSE(nextRequest(header, payload, 0.3));
+}
+
+// Tests that a tiny packet whose size doesn't match its data is rejected
+TEST_F(fmtpRecvv3Test, TinyBadSize) {
+    start();
+    std::vector<char> pkt = tiny(0, 100);
+    pkt.pop_back();
+    FmtpHeader header;
+    (void)memcpy(&header, pkt.data(), sizeof(header));
+    header.payloadlen = htons(ntohs(header.payloadlen) - 1);
+    (void)memcpy(pkt.data(), &header, sizeof(header));
+    multicast(pkt);
+    EXPECT_TRUE(failed(2));
+    EXPECT_TRUE(proxy.bops.empty());
+}
+
+/*
+ * Tests that a late tiny product whose BOP was requested answers the request,
+ * so that the next range of missed BOPs is requested without waiting for the
+ * timeout of the previous one.
+ */
+TEST_F(fmtpRecvv3Test, TinyAnswersBopRequest) {
+    const uint32_t last = 2 * MAX_BOP_RANGE;
+    start();
+    multicast(tiny(0, 100));
+    multicast(tiny(last, 100));
+
+    FmtpHeader        header;
+    std::vector<char> payload;
+    do
+        ASSERT_TRUE(nextRequest(header, payload));
+    while (header.flags != FMTP_BOP_RANGE_REQ);
+    ASSERT_EQ(1, header.prodindex);
+    ASSERT_EQ(MAX_BOP_RANGE, header.seqnum);
+    const Clock::time_point requested = Clock::now();
+
+    // the last product of the requested range arrives late
+    multicast(tiny(MAX_BOP_RANGE, 100));
+    do
+        ASSERT_TRUE(nextRequest(header, payload));
+    while (header.flags != FMTP_BOP_RANGE_REQ);
+    EXPECT_EQ(MAX_BOP_RANGE + 1, header.prodindex);
+    EXPECT_EQ(last - MAX_BOP_RANGE - 1, header.seqnum);
+    // well before the range would time out
+    EXPECT_GT(0.5, std::chrono::duration<double>(Clock::now() -
+            requested).count());
+    EXPECT_EQ(1, proxy.bops.count(MAX_BOP_RANGE));
+}
+
+/*
+ * Tests a product larger than 4 GB: a data block and a retransmitted block
+ * beyond 4 GB are written where they belong, and the requests number the
+ * blocks.
+ */
+TEST_F(fmtpRecvv3Test, WideOffsets) {
+    // the first block whose offset doesn't fit into 32 bits, and some more
+    const uint32_t last     = (1ULL << 32) / FMTP_DATA_LEN + 10;
+    const uint64_t prodsize = (uint64_t)(last + 1) * FMTP_DATA_LEN;
+    void* const    buffer   = mmap(NULL, prodsize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    ASSERT_NE(MAP_FAILED, buffer);
+    proxy.buffer = (char*)buffer;
+    receiver->SetWideOffsets(true);
+    start();
+    multicast(packet(1, 0, FMTP_BOP | FMTP_WIDE, bopPayload(prodsize, true)));
+    const std::vector<char> data = block((uint64_t)last * FMTP_DATA_LEN,
+            FMTP_DATA_LEN);
+    multicast(packet(1, last, FMTP_MEM_DATA, data));
+
+    // every block before the last one is requested by its number
+    const uint32_t    lost = last - 1;
+    FmtpHeader        header;
+    std::vector<char> payload;
+    bool              requested = false;
+    while (!requested && nextRequest(header, payload)) {
+        ASSERT_EQ(FMTP_RETX_REQ, header.flags);
+        ASSERT_EQ(1, header.prodindex);
+        ASSERT_GT(last, header.seqnum);
+        requested = header.seqnum <= lost && lost <
+                header.seqnum + header.payloadlen / FMTP_DATA_LEN;
+    }
+    ASSERT_TRUE(requested);
+    EXPECT_EQ(0, memcmp(data.data(),
+            proxy.buffer + (uint64_t)last * FMTP_DATA_LEN, data.size()));
+
+    const std::vector<char> retx = block((uint64_t)lost * FMTP_DATA_LEN,
+            FMTP_DATA_LEN);
+    unicast(packet(1, lost, FMTP_RETX_DATA, retx));
+    const char* const dest = proxy.buffer + (uint64_t)lost * FMTP_DATA_LEN;
+    for (int i = 0; i < 200 && memcmp(retx.data(), dest, retx.size()); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(0, memcmp(retx.data(), dest, retx.size()));
+
+    receiver->Stop();
+    thread.join();
+    EXPECT_EQ(prodsize, proxy.bops[1]);
+    EXPECT_EQ(0, munmap(buffer, prodsize));
+}
+
+/*
+ * Tests that a receiver which expects 32-bit sizes drops a wide BOP, misses
+ * its product and keeps receiving.
+ */
+TEST_F(fmtpRecvv3Test, NarrowDropsWideBop) {
+    start();
+    multicast(packet(1, 0, FMTP_BOP | FMTP_WIDE,
+            bopPayload(5ULL << 30, true)));
+    ASSERT_TRUE(proxy.waitFor([this] {return proxy.missed.count(1) > 0;},
+            2));
+
+    multicast(packet(2, 0, FMTP_BOP, bopPayload(FMTP_DATA_LEN)));
+    multicast(packet(2, 0, FMTP_MEM_DATA, block(0, FMTP_DATA_LEN)));
+    multicast(packet(2, 0, FMTP_EOP));
+    EXPECT_TRUE(proxy.waitFor([this] {return proxy.eops.count(2) > 0;}, 2));
+    EXPECT_FALSE(failed(0.1));
+    EXPECT_EQ(1, receiver->getLossStats().bopsLost);
+
+    receiver->Stop();
+    thread.join();
+    EXPECT_EQ(0, proxy.bops.count(1));
+    EXPECT_EQ(1, proxy.bops.count(2));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
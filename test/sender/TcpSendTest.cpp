@@ -0,0 +1,181 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: TcpSendTest.cpp
+ *
+ * This file tests the gathered retransmission of class `TcpSend`.
+ */
+
+#include "TcpSend.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The fixture for testing class TcpSend.
+class TcpSendTest : public ::testing::Test {
+ protected:
+  TcpSendTest() : tcpsend("127.0.0.1"), csock(-1), ssock(-1),
+          product(10000000) {
+    for (size_t i = 0; i < product.size(); i++)
+        product[i] = (char)(i * 7 + (i >> 12));
+    tcpsend.Init();
+    csock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(tcpsend.getPortNum());
+    if (connect(csock, (struct sockaddr*)&addr, sizeof(addr)))
+        throw std::runtime_error("Couldn't connect to TcpSend");
+    ssock = tcpsend.acceptConn();
+  }
+
+  ~TcpSendTest() {
+    close(csock);
+    tcpsend.dismantleConn(ssock);
+  }
+
+  static size_t readAll(const int sock, char* buf, const size_t nbytes) {
+    size_t nread = 0;
+    while (nread < nbytes) {
+        ssize_t n = recv(sock, buf + nread, nbytes - nread, 0);
+        if (n <= 0)
+            break;
+        nread += n;
+    }
+    return nread;
+  }
+
+  // Reads the blocks of a range and checks them against the product
+  void checkBlocks(const uint32_t prodindex, uint32_t start,
+          const uint32_t end, const bool wide = false) {
+    char buf[FMTP_DATA_LEN];
+    while (start < end) {
+        FmtpHeader header;
+        ASSERT_EQ(sizeof(header), readAll(csock, (char*)&header,
+                sizeof(header)));
+        const uint16_t paylen = std::min<uint32_t>(FMTP_DATA_LEN, end - start);
+        ASSERT_EQ(prodindex, ntohl(header.prodindex));
+        ASSERT_EQ(wide ? start / FMTP_DATA_LEN : start,
+                ntohl(header.seqnum));
+        ASSERT_EQ(paylen, ntohs(header.payloadlen));
+        ASSERT_EQ(FMTP_RETX_DATA, ntohs(header.flags));
+        ASSERT_EQ(paylen, readAll(csock, buf, paylen));
+        ASSERT_EQ(0, memcmp(buf, product.data() + start, paylen));
+        start += paylen;
+    }
+  }
+
+  TcpSend           tcpsend;
+  int               csock;
+  int               ssock;
+  std::vector<char> product;
+};
+
+TEST_F(TcpSendTest, OneBlock) {
+    std::thread reader([this] { checkBlocks(1, 0, FMTP_DATA_LEN); });
+    ASSERT_EQ(sizeof(FmtpHeader) + FMTP_DATA_LEN,
+            tcpsend.sendDataBlocks(ssock, 1, product.data(), 0,
+            FMTP_DATA_LEN));
+    reader.join();
+}
+
+TEST_F(TcpSendTest, ShortLastBlock) {
+    const uint32_t start = 10 * FMTP_DATA_LEN;
+    const uint32_t end   = start + 3 * FMTP_DATA_LEN + 17;
+    std::thread reader([this, start, end] { checkBlocks(2, start, end); });
+    ASSERT_EQ(4 * sizeof(FmtpHeader) + (end - start),
+            tcpsend.sendDataBlocks(ssock, 2, product.data(), start, end));
+    reader.join();
+}
+
+TEST_F(TcpSendTest, ManyWrites) {
+    // more blocks than one writev() takes and the whole socket buffer
+    const uint32_t end = product.size();
+    std::thread reader([this, end] { checkBlocks(3, 0, end); });
+    (void)tcpsend.sendDataBlocks(ssock, 3, product.data(), 0, end);
+    reader.join();
+}
+
+TEST_F(TcpSendTest, WideSeqnums) {
+    const uint32_t start = 10 * FMTP_DATA_LEN;
+    const uint32_t end   = start + 3 * FMTP_DATA_LEN + 17;
+    std::thread reader([this, start, end] {
+        checkBlocks(6, start, end, true);
+    });
+    ASSERT_EQ(4 * sizeof(FmtpHeader) + (end - start),
+            tcpsend.sendDataBlocks(ssock, 6, product.data(), start, end,
+            true));
+    reader.join();
+}
+
+TEST_F(TcpSendTest, EmptyRange) {
+    ASSERT_EQ(0, tcpsend.sendDataBlocks(ssock, 4, product.data(), 100, 100));
+}
+
+static double threadCpu() {
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+TEST_F(TcpSendTest, Performance) {
+    // retransmits the product 50 times, block by block and gathered
+    const int      times = 50;
+    const uint32_t end   = product.size();
+    const double   gb    = (double)end * times / 1e9;
+    std::thread    sink([this] {
+        std::vector<char> buf(1 << 20);
+        while (recv(csock, buf.data(), buf.size(), 0) > 0)
+            ;
+    });
+
+    double start = threadCpu();
+    for (int i = 0; i < times; i++) {
+        FmtpHeader header;
+        header.prodindex = htonl(5);
+        header.flags     = htons(FMTP_RETX_DATA);
+        for (uint32_t off = 0; off < end; off += FMTP_DATA_LEN) {
+            const uint16_t paylen = std::min<uint32_t>(FMTP_DATA_LEN,
+                    end - off);
+            header.seqnum     = htonl(off);
+            header.payloadlen = htons(paylen);
+            tcpsend.sendData(ssock, &header, product.data() + off, paylen);
+        }
+    }
+    const double blockCpu = threadCpu() - start;
+
+    start = threadCpu();
+    for (int i = 0; i < times; i++)
+        (void)tcpsend.sendDataBlocks(ssock, 5, product.data(), 0, end);
+    const double gatherCpu = threadCpu() - start;
+
+    (void)shutdown(ssock, SHUT_WR);
+    sink.join();
+    std::cerr << "Block by block: " << std::to_string(blockCpu / gb) <<
+            " CPU s/GB\n";
+    std::cerr << "Gathered:       " << std::to_string(gatherCpu / gb) <<
+            " CPU s/GB\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
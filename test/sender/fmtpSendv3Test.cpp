@@ -0,0 +1,388 @@
+/**
+ * Copyright 2026 University Corporation for Atmospheric Research. All rights
+ * reserved. See the the file COPYRIGHT in the top-level source-directory for
+ * licensing conditions.
+ *
+ *   @file: fmtpSendv3Test.cpp
+ *
+ * This file tests the protocol handling of class `fmtpSendv3`. The test plays
+ * a receiver: it joins the multicast group on the loopback interface and
+ * connects to the retransmission port of the sender.
+ */
+
+#include "fmtpSendv3.h"
+#include "fmtpBase.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char MCAST_ADDR[] = "239.1.2.6";
+
+typedef std::chrono::steady_clock Clock;
+
+// A packet as received, with its header in host byte-order
+struct Packet {
+  FmtpHeader        header;
+  std::vector<char> payload;
+  Clock::time_point time;
+};
+
+// The fixture for testing class fmtpSendv3.
+class fmtpSendv3Test : public ::testing::Test {
+ protected:
+  fmtpSendv3Test() : msock(socket(AF_INET, SOCK_DGRAM, 0)), csock(-1),
+          sender(NULL), started(false) {
+    struct sockaddr_in addr;
+    socklen_t          len = sizeof(addr);
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(MCAST_ADDR);
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = inet_addr(MCAST_ADDR);
+    mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(msock, (struct sockaddr*)&addr, sizeof(addr)) ||
+            getsockname(msock, (struct sockaddr*)&addr, &len) ||
+            setsockopt(msock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq,
+            sizeof(mreq)))
+        throw std::runtime_error("Couldn't join multicast group");
+
+    sender = new fmtpSendv3("127.0.0.1", 0, MCAST_ADDR, ntohs(addr.sin_port),
+            NULL, 1, "127.0.0.1");
+  }
+
+  ~fmtpSendv3Test() {
+    if (started)
+        sender->Stop();
+    delete sender;
+    close(csock);
+    close(msock);
+  }
+
+  // Starts the sender and connects to its retransmission port
+  void start() {
+    sender->Start();
+    started = true;
+    csock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(sender->getTcpPortNum());
+    ASSERT_EQ(0, connect(csock, (struct sockaddr*)&addr, sizeof(addr)));
+    // the sender accepts the connection on its own thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  // Receives the next multicast packet, false if none comes in time
+  bool nextPacket(Packet& pkt, const double seconds = 2) {
+    struct pollfd pfd = {msock, POLLIN, 0};
+    if (poll(&pfd, 1, seconds * 1000) != 1)
+        return false;
+    char          buf[65536];
+    const ssize_t n = recv(msock, buf, sizeof(buf), 0);
+    if (n < (ssize_t)sizeof(FmtpHeader))
+        return false;
+    pkt.time = Clock::now();
+    (void)memcpy(&pkt.header, buf, sizeof(FmtpHeader));
+    decode(pkt.header);
+    pkt.payload.assign(buf + sizeof(FmtpHeader), buf + n);
+    return pkt.payload.size() == pkt.header.payloadlen;
+  }
+
+  // Receives multicast packets until none comes for `seconds`
+  std::vector<Packet> packets(const double seconds) {
+    std::vector<Packet> pkts;
+    Packet              pkt;
+    while (nextPacket(pkt, seconds))
+        pkts.push_back(pkt);
+    return pkts;
+  }
+
+  // Returns the packets of an aggregate, false if they don't fill it exactly
+  static bool unpack(const Packet& agg, std::vector<Packet>& pkts) {
+    pkts.clear();
+    size_t pos = 0;
+    for (uint32_t i = 0; i < agg.header.seqnum; i++) {
+        Packet pkt;
+        if (agg.payload.size() - pos < sizeof(FmtpHeader))
+            return false;
+        (void)memcpy(&pkt.header, agg.payload.data() + pos,
+                sizeof(FmtpHeader));
+        decode(pkt.header);
+        pos += sizeof(FmtpHeader);
+        if (agg.payload.size() - pos < pkt.header.payloadlen)
+            return false;
+        pkt.payload.assign(agg.payload.begin() + pos,
+                agg.payload.begin() + pos + pkt.header.payloadlen);
+        pos += pkt.header.payloadlen;
+        pkts.push_back(pkt);
+    }
+    return pos == agg.payload.size();
+  }
+
+  static void decode(FmtpHeader& header) {
+    header.prodindex  = ntohl(header.prodindex);
+    header.seqnum     = ntohl(header.seqnum);
+    header.payloadlen = ntohs(header.payloadlen);
+    header.flags      = ntohs(header.flags);
+  }
+
+  static double seconds(const Clock::duration& duration) {
+    return std::chrono::duration<double>(duration).count();
+  }
+
+  int         msock;
+  int         csock;
+  fmtpSendv3* sender;
+  bool        started;
+};
+
+// Tests that the EOP is repeated once after the multicast has been idle
+TEST_F(fmtpSendv3Test, TailProbe) {
+    std::vector<char> product(5000);
+    sender->SetTailProbe(0.3);
+    start();
+    ASSERT_EQ(0, sender->sendProduct(product.data(), product.size()));
+
+    Packet pkt;
+    do
+        ASSERT_TRUE(nextPacket(pkt));
+    while (pkt.header.flags != FMTP_EOP);
+    const Clock::time_point eop = pkt.time;
+
+    ASSERT_TRUE(nextPacket(pkt));
+    EXPECT_EQ(FMTP_EOP, pkt.header.flags);
+    EXPECT_EQ(0, pkt.header.prodindex);
+    EXPECT_LE(0.29, seconds(pkt.time - eop));
+    // a product is probed only once
+    EXPECT_FALSE(nextPacket(pkt, 0.6));
+}
+
+// Tests that a product isn't probed once the next product has begun
+TEST_F(fmtpSendv3Test, NoProbeAfterNewerBop) {
+    std::vector<char> product(5000);
+    sender->SetTailProbe(0.3);
+    start();
+    ASSERT_EQ(0, sender->sendProduct(product.data(), product.size()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    ASSERT_EQ(1, sender->sendProduct(product.data(), product.size()));
+
+    const std::vector<Packet> pkts = packets(0.6);
+    bool     bop1 = false;
+    unsigned eops[2] = {0, 0};
+    for (size_t i = 0; i < pkts.size(); i++) {
+        const FmtpHeader& header = pkts[i].header;
+        ASSERT_GT(2, header.prodindex);
+        if (header.prodindex == 1 && header.flags == FMTP_BOP)
+            bop1 = true;
+        EXPECT_FALSE(bop1 && header.prodindex == 0);
+        if (header.flags == FMTP_EOP)
+            eops[header.prodindex]++;
+    }
+    EXPECT_TRUE(bop1);
+    EXPECT_EQ(1, eops[0]);
+    EXPECT_EQ(2, eops[1]);
+}
+
+/*
+ * Tests that small products are packed into as few aggregates as possible in
+ * the order of their indexes, and that a larger product is multicast by itself
+ * in between.
+ */
+TEST_F(fmtpSendv3Test, AggregatePacking) {
+    const uint32_t    small = 300;
+    // the BOP, data and EOP packets of a small product
+    const size_t      packedLen = 3 * FMTP_HEADER_LEN +
+            (FMTP_DATA_LEN - AVAIL_BOP_LEN) + small;
+    const size_t      perAggregate = FMTP_DATA_LEN / packedLen;
+    const uint32_t    large = perAggregate + 2;
+    const uint32_t    nprods = large + 3;
+    std::vector<char> data(5000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (char)(i * 7);
+    std::vector<ProductDesc> prods(nprods);
+    for (uint32_t i = 0; i < nprods; i++) {
+        prods[i].data     = data.data();
+        prods[i].dataSize = i == large ? data.size() : small;
+        prods[i].metadata = NULL;
+        prods[i].metaSize = 0;
+    }
+    sender->SetAggregation(true);
+    start();
+    ASSERT_EQ(0, sender->sendProducts(prods.data(), nprods));
+
+    const std::vector<Packet> pkts = packets(0.3);
+    std::vector<size_t>       aggregates;
+    uint32_t                  next = 0;
+    for (size_t i = 0; i < pkts.size(); i++) {
+        if (pkts[i].header.flags != FMTP_AGGREGATE) {
+            // the large product
+            ASSERT_EQ(large, pkts[i].header.prodindex);
+            next = large + 1;
+            continue;
+        }
+        EXPECT_GE(FMTP_DATA_LEN, pkts[i].header.payloadlen);
+        EXPECT_EQ(next, pkts[i].header.prodindex);
+        std::vector<Packet> inner;
+        ASSERT_TRUE(unpack(pkts[i], inner));
+        ASSERT_EQ(0, inner.size() % 3);
+        for (size_t j = 0; j < inner.size(); j += 3) {
+            EXPECT_EQ(next, inner[j].header.prodindex);
+            EXPECT_EQ(FMTP_BOP, inner[j].header.flags);
+            EXPECT_EQ(next, inner[j + 1].header.prodindex);
+            EXPECT_EQ(FMTP_MEM_DATA, inner[j + 1].header.flags);
+            ASSERT_EQ(small, inner[j + 1].payload.size());
+            EXPECT_EQ(0, memcmp(data.data(), inner[j + 1].payload.data(),
+                    small));
+            EXPECT_EQ(next, inner[j + 2].header.prodindex);
+            EXPECT_EQ(FMTP_EOP, inner[j + 2].header.flags);
+            next++;
+        }
+        aggregates.push_back(inner.size() / 3);
+    }
+    EXPECT_EQ(nprods, next);
+    // full aggregates, except before the large product and at the end
+    ASSERT_EQ(3, aggregates.size());
+    EXPECT_EQ(perAggregate, aggregates[0]);
+    EXPECT_EQ(2, aggregates[1]);
+    EXPECT_EQ(2, aggregates[2]);
+}
+
+// Tests that a product isn't probed once the next aggregate has been sent
+TEST_F(fmtpSendv3Test, NoProbeAfterNewerAggregate) {
+    std::vector<char>        product(5000);
+    std::vector<ProductDesc> prods(3);
+    for (size_t i = 0; i < prods.size(); i++) {
+        prods[i].data     = product.data();
+        prods[i].dataSize = 100;
+        prods[i].metadata = NULL;
+        prods[i].metaSize = 0;
+    }
+    sender->SetAggregation(true);
+    sender->SetTailProbe(0.3);
+    start();
+    ASSERT_EQ(0, sender->sendProduct(product.data(), product.size()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    ASSERT_EQ(1, sender->sendProducts(prods.data(), prods.size()));
+
+    const std::vector<Packet> pkts = packets(0.6);
+    size_t agg = pkts.size();
+    for (size_t i = 0; i < pkts.size(); i++) {
+        if (pkts[i].header.flags == FMTP_AGGREGATE)
+            agg = i;
+    }
+    ASSERT_GT(pkts.size(), agg);
+    // only the last product of the aggregate is probed
+    ASSERT_EQ(agg + 2, pkts.size());
+    EXPECT_EQ(FMTP_EOP, pkts[agg + 1].header.flags);
+    EXPECT_EQ(3, pkts[agg + 1].header.prodindex);
+    EXPECT_LE(0.29, seconds(pkts[agg + 1].time - pkts[agg].time));
+}
+
+// Tests the encoding of a tiny product
+TEST_F(fmtpSendv3Test, Tiny) {
+    const char        metadata[] = "metadata";
+    const uint16_t    metaSize = sizeof(metadata);
+    std::vector<char> data(100);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (char)(i * 7);
+    sender->SetTinyProducts(true);
+    start();
+    ASSERT_EQ(0, sender->sendProduct(data.data(), data.size(),
+            (void*)metadata, metaSize));
+
+    Packet pkt;
+    ASSERT_TRUE(nextPacket(pkt));
+    EXPECT_EQ(FMTP_TINY, pkt.header.flags);
+    EXPECT_EQ(0, pkt.header.prodindex);
+    EXPECT_EQ(0, pkt.header.seqnum);
+    ASSERT_EQ(6 + metaSize + data.size(), pkt.payload.size());
+    uint32_t prodsize;
+    uint16_t metasize;
+    (void)memcpy(&prodsize, pkt.payload.data(), sizeof(prodsize));
+    (void)memcpy(&metasize, pkt.payload.data() + 4, sizeof(metasize));
+    EXPECT_EQ(data.size(), ntohl(prodsize));
+    EXPECT_EQ(metaSize, ntohs(metasize));
+    EXPECT_EQ(0, memcmp(metadata, pkt.payload.data() + 6, metaSize));
+    EXPECT_EQ(0, memcmp(data.data(), pkt.payload.data() + 6 + metaSize,
+            data.size()));
+    // neither a BOP nor an EOP follows
+    EXPECT_FALSE(nextPacket(pkt, 0.3));
+}
+
+// Tests that only a product which fits into one packet is tiny
+TEST_F(fmtpSendv3Test, TinyLimit) {
+    const uint32_t    fits = FMTP_DATA_LEN - (FMTP_DATA_LEN - AVAIL_BOP_LEN);
+    std::vector<char> data(fits + 1);
+    sender->SetTinyProducts(true);
+    start();
+    ASSERT_EQ(0, sender->sendProduct(data.data(), fits));
+    ASSERT_EQ(1, sender->sendProduct(data.data(), fits + 1));
+
+    const std::vector<Packet> pkts = packets(0.3);
+    ASSERT_EQ(4, pkts.size());
+    EXPECT_EQ(FMTP_TINY, pkts[0].header.flags);
+    EXPECT_EQ(FMTP_DATA_LEN, pkts[0].header.payloadlen);
+    EXPECT_EQ(FMTP_BOP, pkts[1].header.flags);
+    EXPECT_EQ(FMTP_MEM_DATA, pkts[2].header.flags);
+    EXPECT_EQ(fits + 1, pkts[2].header.payloadlen);
+    EXPECT_EQ(FMTP_EOP, pkts[3].header.flags);
+    for (size_t i = 1; i < pkts.size(); i++)
+        EXPECT_EQ(1, pkts[i].header.prodindex);
+}
+
+// Tests that BOPs with 64-bit product sizes are marked and data are numbered
+TEST_F(fmtpSendv3Test, WideBop) {
+    std::vector<char> data(2 * FMTP_DATA_LEN + 1);
+    sender->SetWideOffsets(true);
+    start();
+    ASSERT_EQ(0, sender->sendProduct(data.data(), data.size()));
+
+    const std::vector<Packet> pkts = packets(0.3);
+    ASSERT_EQ(5, pkts.size());
+    EXPECT_EQ(FMTP_BOP | FMTP_WIDE, pkts[0].header.flags);
+    ASSERT_EQ(10, pkts[0].payload.size());
+    uint32_t size[2];
+    (void)memcpy(size, pkts[0].payload.data(), sizeof(size));
+    EXPECT_EQ(0, ntohl(size[0]));
+    EXPECT_EQ(data.size(), ntohl(size[1]));
+    for (uint32_t i = 0; i < 3; i++) {
+        EXPECT_EQ(FMTP_MEM_DATA, pkts[1 + i].header.flags);
+        EXPECT_EQ(i, pkts[1 + i].header.seqnum);
+    }
+    EXPECT_EQ(FMTP_EOP, pkts[4].header.flags);
+
+    // a retransmitted BOP is marked as well
+    FmtpHeader header;
+    header.prodindex  = htonl(0);
+    header.seqnum     = 0;
+    header.payloadlen = 0;
+    header.flags      = htons(FMTP_BOP_REQ);
+    ASSERT_EQ(sizeof(header), send(csock, &header, sizeof(header), 0));
+    struct pollfd pfd = {csock, POLLIN, 0};
+    ASSERT_EQ(1, poll(&pfd, 1, 2000));
+    ASSERT_EQ(sizeof(header), recv(csock, &header, sizeof(header),
+            MSG_WAITALL));
+    decode(header);
+    EXPECT_EQ(FMTP_RETX_BOP | FMTP_WIDE, header.flags);
+    EXPECT_EQ(10, header.payloadlen);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}